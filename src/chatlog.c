@@ -14,6 +14,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -29,16 +30,32 @@
 #include "xmpp/xmpp.h"
 #include "xmpp/muc.h"
 
+// Log files stay open between messages, at most MAX_OPEN_LOGS at a time
+#define MAX_OPEN_LOGS 64
+// Seconds between checks for removed files and files unused for LOG_IDLE_CLOSE seconds
+#define LOG_MAINTENANCE_INTERVAL 60
+#define LOG_IDLE_CLOSE 300
+
 static GHashTable* logs;
 static GHashTable* groupchat_logs;
+// open logs, most recently written first
+static GQueue* open_logs;
+static GDateTime* logs_date;
+static guint flush_source;
+static guint rollover_source;
+static guint maintenance_source;
 
 struct dated_chat_log
 {
     gchar* filename;
     GDateTime* date;
+    FILE* stream;
+    gint64 last_write;
+    gboolean dirty;
 };
 
-static gboolean _log_roll_needed(struct dated_chat_log* dated_log);
+static gboolean _log_roll_needed(GDateTime* date);
+static void _chatlog_schedule_rollover(void);
 static struct dated_chat_log* _create_chatlog(const char* const other, const char* const login);
 static struct dated_chat_log* _create_groupchat_log(const char* const room, const char* const login);
 static void _free_chat_log(struct dated_chat_log* dated_log);
@@ -48,11 +65,159 @@ static void _chat_log_chat(const char* const login, const char* const other, con
 static void _groupchat_log_chat(const gchar* const login, const gchar* const room, const gchar* const nick,
                                 const gchar* const msg);
 
+static void
+_chatlog_close_stream(struct dated_chat_log* dated_log)
+{
+    if (!dated_log->stream) {
+        return;
+    }
+
+    g_queue_remove(open_logs, dated_log);
+    if (fclose(dated_log->stream) == EOF) {
+        log_error("Error closing file %s, errno = %d", dated_log->filename, errno);
+    }
+    dated_log->stream = NULL;
+    dated_log->dirty = FALSE;
+}
+
+static gboolean
+_chatlog_flush_cb(gpointer userdata)
+{
+    for (GList* curr = open_logs->head; curr; curr = g_list_next(curr)) {
+        struct dated_chat_log* dated_log = curr->data;
+        if (dated_log->dirty) {
+            if (fflush(dated_log->stream) == EOF) {
+                log_error("Error writing file %s, errno = %d", dated_log->filename, errno);
+            }
+            dated_log->dirty = FALSE;
+        }
+    }
+    flush_source = 0;
+
+    return G_SOURCE_REMOVE;
+}
+
+// Start a new set of files for the new day, logs are recreated on their next message
+static void
+_chatlog_rollover(void)
+{
+    g_hash_table_remove_all(logs);
+    g_hash_table_remove_all(groupchat_logs);
+    if (logs_date) {
+        g_date_time_unref(logs_date);
+    }
+    logs_date = g_date_time_new_now_local();
+}
+
+static gboolean
+_chatlog_rollover_cb(gpointer userdata)
+{
+    rollover_source = 0;
+    _chatlog_rollover();
+    _chatlog_schedule_rollover();
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+_chatlog_schedule_rollover(void)
+{
+    GDateTime* now = g_date_time_new_now_local();
+    GDateTime* today = g_date_time_new_local(g_date_time_get_year(now), g_date_time_get_month(now), g_date_time_get_day_of_month(now), 0, 0, 0);
+    GDateTime* midnight = g_date_time_add_days(today, 1);
+
+    guint seconds = g_date_time_difference(midnight, now) / G_TIME_SPAN_SECOND + 1;
+    rollover_source = g_timeout_add_seconds(seconds, _chatlog_rollover_cb, NULL);
+
+    g_date_time_unref(midnight);
+    g_date_time_unref(today);
+    g_date_time_unref(now);
+}
+
+static gboolean
+_chatlog_maintenance_cb(gpointer userdata)
+{
+    // catches a missed rollover, e.g. after a suspend over midnight
+    if (logs_date && _log_roll_needed(logs_date)) {
+        _chatlog_rollover();
+    }
+
+    gint64 now = g_get_monotonic_time();
+    GList* curr = open_logs->head;
+    while (curr) {
+        struct dated_chat_log* dated_log = curr->data;
+        curr = g_list_next(curr);
+
+        // closed once idle, or when the file was removed so the next message recreates it
+        if (now - dated_log->last_write > LOG_IDLE_CLOSE * G_TIME_SPAN_SECOND
+            || !g_file_test(dated_log->filename, G_FILE_TEST_EXISTS)) {
+            _chatlog_close_stream(dated_log);
+        }
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+// Append a line to the log, the stream is flushed once the main loop is idle
+static void
+_chatlog_write(struct dated_chat_log* dated_log, const char* const format, ...)
+{
+    if (!dated_log->filename) {
+        return;
+    }
+
+    if (dated_log->stream) {
+        g_queue_remove(open_logs, dated_log);
+    } else {
+        if (g_queue_get_length(open_logs) >= MAX_OPEN_LOGS) {
+            _chatlog_close_stream(g_queue_peek_tail(open_logs));
+        }
+        dated_log->stream = fopen(dated_log->filename, "a");
+        if (!dated_log->stream) {
+            log_error("Error opening file %s, errno = %d", dated_log->filename, errno);
+            return;
+        }
+        g_chmod(dated_log->filename, S_IRUSR | S_IWUSR);
+    }
+    g_queue_push_head(open_logs, dated_log);
+
+    va_list arg;
+    va_start(arg, format);
+    vfprintf(dated_log->stream, format, arg);
+    va_end(arg);
+
+    dated_log->last_write = g_get_monotonic_time();
+    dated_log->dirty = TRUE;
+    if (!flush_source) {
+        flush_source = g_idle_add(_chatlog_flush_cb, NULL);
+    }
+}
+
 void
 _chatlog_close(void)
 {
+    if (flush_source) {
+        g_source_remove(flush_source);
+        flush_source = 0;
+    }
+    if (rollover_source) {
+        g_source_remove(rollover_source);
+        rollover_source = 0;
+    }
+    if (maintenance_source) {
+        g_source_remove(maintenance_source);
+        maintenance_source = 0;
+    }
+
+    // closing the streams writes out anything still buffered
     g_hash_table_destroy(logs);
     g_hash_table_destroy(groupchat_logs);
+    g_queue_free(open_logs);
+    open_logs = NULL;
+    if (logs_date) {
+        g_date_time_unref(logs_date);
+        logs_date = NULL;
+    }
 }
 
 void
@@ -66,6 +231,11 @@ chatlog_init(void)
                                  (GDestroyNotify)_free_chat_log);
     groupchat_logs = g_hash_table_new_full(g_str_hash, (GEqualFunc)_key_equals, free,
                                            (GDestroyNotify)_free_chat_log);
+    open_logs = g_queue_new();
+    logs_date = g_date_time_new_now_local();
+
+    _chatlog_schedule_rollover();
+    maintenance_source = g_timeout_add_seconds(LOG_MAINTENANCE_INTERVAL, _chatlog_maintenance_cb, NULL);
 }
 
 void
@@ -221,20 +391,10 @@ _chat_log_chat(const char* const login, const char* const other, const char* msg
 
     struct dated_chat_log* dated_log = g_hash_table_lookup(logs, other_name);
 
-    // no log for user
+    // no log for user, day rollover and removed files are handled by timers
     if (dated_log == NULL) {
         dated_log = _create_chatlog(other_name, login);
         g_hash_table_insert(logs, strdup(other_name), dated_log);
-
-        // log entry exists but file removed
-    } else if (!g_file_test(dated_log->filename, G_FILE_TEST_EXISTS)) {
-        dated_log = _create_chatlog(other_name, login);
-        g_hash_table_replace(logs, strdup(other_name), dated_log);
-
-        // log file needs rolling
-    } else if (_log_roll_needed(dated_log)) {
-        dated_log = _create_chatlog(other_name, login);
-        g_hash_table_replace(logs, strdup(other_name), dated_log);
     }
 
     if (resourcepart) {
@@ -242,34 +402,25 @@ _chat_log_chat(const char* const login, const char* const other, const char* msg
     }
 
     auto_gchar gchar* date_fmt = prof_date_time_format_iso8601(timestamp);
-    FILE* chatlogp = fopen(dated_log->filename, "a");
-    g_chmod(dated_log->filename, S_IRUSR | S_IWUSR);
-    if (chatlogp) {
-        if (direction == PROF_IN_LOG) {
-            if (strncmp(msg, "/me ", 4) == 0) {
-                if (resourcepart) {
-                    fprintf(chatlogp, "%s - *%s %s\n", date_fmt, resourcepart, msg + 4);
-                } else {
-                    fprintf(chatlogp, "%s - *%s %s\n", date_fmt, other, msg + 4);
-                }
+    if (direction == PROF_IN_LOG) {
+        if (strncmp(msg, "/me ", 4) == 0) {
+            if (resourcepart) {
+                _chatlog_write(dated_log, "%s - *%s %s\n", date_fmt, resourcepart, msg + 4);
             } else {
-                if (resourcepart) {
-                    fprintf(chatlogp, "%s - %s: %s\n", date_fmt, resourcepart, msg);
-                } else {
-                    fprintf(chatlogp, "%s - %s: %s\n", date_fmt, other, msg);
-                }
+                _chatlog_write(dated_log, "%s - *%s %s\n", date_fmt, other, msg + 4);
             }
         } else {
-            if (strncmp(msg, "/me ", 4) == 0) {
-                fprintf(chatlogp, "%s - *me %s\n", date_fmt, msg + 4);
+            if (resourcepart) {
+                _chatlog_write(dated_log, "%s - %s: %s\n", date_fmt, resourcepart, msg);
             } else {
-                fprintf(chatlogp, "%s - me: %s\n", date_fmt, msg);
+                _chatlog_write(dated_log, "%s - %s: %s\n", date_fmt, other, msg);
             }
         }
-        fflush(chatlogp);
-        int result = fclose(chatlogp);
-        if (result == EOF) {
-            log_error("Error closing file %s, errno = %d", dated_log->filename, errno);
+    } else {
+        if (strncmp(msg, "/me ", 4) == 0) {
+            _chatlog_write(dated_log, "%s - *me %s\n", date_fmt, msg + 4);
+        } else {
+            _chatlog_write(dated_log, "%s - me: %s\n", date_fmt, msg);
         }
     }
 }
@@ -328,33 +479,18 @@ _groupchat_log_chat(const gchar* const login, const gchar* const room, const gch
 {
     struct dated_chat_log* dated_log = g_hash_table_lookup(groupchat_logs, room);
 
-    // no log for room
+    // no log for room, day rollover is handled by a timer
     if (dated_log == NULL) {
         dated_log = _create_groupchat_log(room, login);
         g_hash_table_insert(groupchat_logs, strdup(room), dated_log);
-
-        // log exists but needs rolling
-    } else if (_log_roll_needed(dated_log)) {
-        dated_log = _create_groupchat_log(room, login);
-        g_hash_table_replace(logs, strdup(room), dated_log);
     }
 
     auto_gchar gchar* date_fmt = prof_date_time_format_iso8601(NULL);
 
-    FILE* grpchatlogp = fopen(dated_log->filename, "a");
-    g_chmod(dated_log->filename, S_IRUSR | S_IWUSR);
-    if (grpchatlogp) {
-        if (strncmp(msg, "/me ", 4) == 0) {
-            fprintf(grpchatlogp, "%s - *%s %s\n", date_fmt, nick, msg + 4);
-        } else {
-            fprintf(grpchatlogp, "%s - %s: %s\n", date_fmt, nick, msg);
-        }
-
-        fflush(grpchatlogp);
-        int result = fclose(grpchatlogp);
-        if (result == EOF) {
-            log_error("Error closing file %s, errno = %d", dated_log->filename, errno);
-        }
+    if (strncmp(msg, "/me ", 4) == 0) {
+        _chatlog_write(dated_log, "%s - *%s %s\n", date_fmt, nick, msg + 4);
+    } else {
+        _chatlog_write(dated_log, "%s - %s: %s\n", date_fmt, nick, msg);
     }
 }
 
@@ -381,7 +517,7 @@ _create_chatlog(const char* const other, const char* const login)
     auto_char char* filename = _get_log_filename(other, login, now, FALSE);
 
     struct dated_chat_log* new_log = g_new0(struct dated_chat_log, 1);
-    new_log->filename = strdup(filename);
+    new_log->filename = filename ? strdup(filename) : NULL;
     new_log->date = now;
 
     return new_log;
@@ -394,18 +530,18 @@ _create_groupchat_log(const char* const room, const char* const login)
     auto_char char* filename = _get_log_filename(room, login, now, TRUE);
 
     struct dated_chat_log* new_log = g_new0(struct dated_chat_log, 1);
-    new_log->filename = strdup(filename);
+    new_log->filename = filename ? strdup(filename) : NULL;
     new_log->date = now;
 
     return new_log;
 }
 
 static gboolean
-_log_roll_needed(struct dated_chat_log* dated_log)
+_log_roll_needed(GDateTime* date)
 {
     gboolean result = FALSE;
     GDateTime* now = g_date_time_new_now_local();
-    if (g_date_time_get_day_of_year(dated_log->date) != g_date_time_get_day_of_year(now)) {
+    if (g_date_time_get_day_of_year(date) != g_date_time_get_day_of_year(now)) {
         result = TRUE;
     }
     g_date_time_unref(now);
@@ -417,6 +553,7 @@ static void
 _free_chat_log(struct dated_chat_log* dated_log)
 {
     if (dated_log) {
+        _chatlog_close_stream(dated_log);
         GFREE_SET_NULL(dated_log->filename);
         if (dated_log->date) {
             g_date_time_unref(dated_log->date);
@@ -74,9 +74,12 @@ static char* _role_autocomplete(ProfWin* window, const char* const input, gboole
 static char* _resource_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _wintitle_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _inpblock_autocomplete(ProfWin* window, const char* const input, gboolean previous);
+static char* _transfers_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _time_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _receipts_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _reconnect_autocomplete(ProfWin* window, const char* const input, gboolean previous);
+static char* _scrollback_autocomplete(ProfWin* window, const char* const input, gboolean previous);
+static char* _history_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _help_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _wins_autocomplete(ProfWin* window, const char* const input, gboolean previous);
 static char* _tls_autocomplete(ProfWin* window, const char* const input, gboolean previous);
@@ -208,8 +211,11 @@ static Autocomplete time_ac;
 static Autocomplete time_format_ac;
 static Autocomplete resource_ac;
 static Autocomplete inpblock_ac;
+static Autocomplete transfers_ac;
 static Autocomplete receipts_ac;
 static Autocomplete reconnect_ac;
+static Autocomplete scrollback_ac;
+static Autocomplete history_ac;
 #ifdef HAVE_LIBGPGME
 static Autocomplete pgp_ac;
 static Autocomplete pgp_log_ac;
@@ -251,6 +257,7 @@ static Autocomplete status_ac;
 static Autocomplete status_state_ac;
 static Autocomplete logging_ac;
 static Autocomplete logging_group_ac;
+static Autocomplete logging_sync_ac;
 static Autocomplete privacy_ac;
 static Autocomplete privacy_log_ac;
 static Autocomplete color_ac;
@@ -371,8 +378,11 @@ static Autocomplete* all_acs[] = {
     &time_format_ac,
     &resource_ac,
     &inpblock_ac,
+    &transfers_ac,
     &receipts_ac,
     &reconnect_ac,
+    &scrollback_ac,
+    &history_ac,
 #ifdef HAVE_LIBGPGME
     &pgp_ac,
     &pgp_log_ac,
@@ -410,6 +420,7 @@ static Autocomplete* all_acs[] = {
     &status_state_ac,
     &logging_ac,
     &logging_group_ac,
+    &logging_sync_ac,
     &privacy_ac,
     &privacy_log_ac,
     &color_ac,
@@ -953,11 +964,26 @@ cmd_ac_init(void)
     autocomplete_add(inpblock_ac, "timeout");
     autocomplete_add(inpblock_ac, "dynamic");
 
+    autocomplete_add(transfers_ac, "clear");
+    autocomplete_add(transfers_ac, "rate");
+    autocomplete_add(transfers_ac, "perhost");
+
     autocomplete_add(receipts_ac, "send");
     autocomplete_add(receipts_ac, "request");
 
     autocomplete_add(reconnect_ac, "now");
 
+    autocomplete_add(scrollback_ac, "chat");
+    autocomplete_add(scrollback_ac, "muc");
+    autocomplete_add(scrollback_ac, "private");
+    autocomplete_add(scrollback_ac, "other");
+    autocomplete_add(scrollback_ac, "memory");
+
+    autocomplete_add(history_ac, "on");
+    autocomplete_add(history_ac, "off");
+    autocomplete_add(history_ac, "search");
+    autocomplete_add(history_ac, "more");
+
 #ifdef HAVE_LIBGPGME
 
     autocomplete_add(pgp_ac, "keys");
@@ -1125,6 +1151,7 @@ cmd_ac_init(void)
 
     autocomplete_add(logging_ac, "chat");
     autocomplete_add(logging_ac, "group");
+    autocomplete_add(logging_ac, "sync");
 
     autocomplete_add(privacy_ac, "logging");
     autocomplete_add(privacy_ac, "os");
@@ -1137,6 +1164,10 @@ cmd_ac_init(void)
     autocomplete_add(logging_group_ac, "off");
     autocomplete_add(logging_group_ac, "color");
 
+    autocomplete_add(logging_sync_ac, "off");
+    autocomplete_add(logging_sync_ac, "normal");
+    autocomplete_add(logging_sync_ac, "full");
+
     autocomplete_add(color_ac, "on");
     autocomplete_add(color_ac, "off");
     autocomplete_add(color_ac, "redgreen");
@@ -1403,6 +1434,8 @@ cmd_ac_init(void)
     g_hash_table_insert(ac_funcs, "/presence", _presence_autocomplete);
     g_hash_table_insert(ac_funcs, "/receipts", _receipts_autocomplete);
     g_hash_table_insert(ac_funcs, "/reconnect", _reconnect_autocomplete);
+    g_hash_table_insert(ac_funcs, "/scrollback", _scrollback_autocomplete);
+    g_hash_table_insert(ac_funcs, "/history", _history_autocomplete);
     g_hash_table_insert(ac_funcs, "/resource", _resource_autocomplete);
     g_hash_table_insert(ac_funcs, "/role", _role_autocomplete);
     g_hash_table_insert(ac_funcs, "/rooms", _rooms_autocomplete);
@@ -1420,6 +1453,7 @@ cmd_ac_init(void)
     g_hash_table_insert(ac_funcs, "/time", _time_autocomplete);
     g_hash_table_insert(ac_funcs, "/titlebar", _titlebar_autocomplete);
     g_hash_table_insert(ac_funcs, "/tls", _tls_autocomplete);
+    g_hash_table_insert(ac_funcs, "/transfers", _transfers_autocomplete);
     g_hash_table_insert(ac_funcs, "/tray", _tray_autocomplete);
     g_hash_table_insert(ac_funcs, "/url", _url_autocomplete);
     g_hash_table_insert(ac_funcs, "/vcard", _vcard_autocomplete);
@@ -1799,7 +1833,7 @@ _cmd_ac_complete_params(ProfWin* window, const char* const input, gboolean previ
 
     // autocomplete boolean settings
     gchar* boolean_choices[] = { "/beep", "/states", "/outtype", "/flash", "/splash",
-                                 "/history", "/vercheck", "/privileges", "/wrap",
+                                 "/vercheck", "/privileges", "/wrap",
                                  "/carbons", "/slashguard", "/silence" };
 
     for (size_t i = 0; i < ARRAY_SIZE(boolean_choices); i++) {
@@ -2942,6 +2976,12 @@ _inpblock_autocomplete(ProfWin* window, const char* const input, gboolean previo
     return NULL;
 }
 
+static char*
+_transfers_autocomplete(ProfWin* window, const char* const input, gboolean previous)
+{
+    return autocomplete_param_with_ac(input, "/transfers", transfers_ac, FALSE, previous);
+}
+
 static char*
 _form_autocomplete(ProfWin* window, const char* const input, gboolean previous)
 {
@@ -3374,6 +3414,22 @@ _reconnect_autocomplete(ProfWin* window, const char* const input, gboolean previ
     return result;
 }
 
+static char*
+_scrollback_autocomplete(ProfWin* window, const char* const input, gboolean previous)
+{
+    char* result = NULL;
+    result = autocomplete_param_with_ac(input, "/scrollback", scrollback_ac, TRUE, previous);
+    return result;
+}
+
+static char*
+_history_autocomplete(ProfWin* window, const char* const input, gboolean previous)
+{
+    char* result = NULL;
+    result = autocomplete_param_with_ac(input, "/history", history_ac, TRUE, previous);
+    return result;
+}
+
 static char*
 _alias_autocomplete(ProfWin* window, const char* const input, gboolean previous)
 {
@@ -4043,6 +4099,11 @@ _logging_autocomplete(ProfWin* window, const char* const input, gboolean previou
     }
 
     result = autocomplete_param_with_ac(input, "/logging group", logging_group_ac, TRUE, previous);
+    if (result) {
+        return result;
+    }
+
+    result = autocomplete_param_with_ac(input, "/logging sync", logging_sync_ac, TRUE, previous);
     return result;
 }
 
@@ -830,6 +830,31 @@ static const struct cmd_t command_defs[] = {
               "/sendfile ~/images/sweet_cat.jpg")
     },
 
+    { CMD_PREAMBLE("/transfers",
+                   parse_args, 0, 2, &cons_transfers_setting)
+      CMD_MAINFUNC(cmd_transfers)
+      CMD_TAGS(
+              CMD_TAG_CHAT,
+              CMD_TAG_GROUPCHAT)
+      CMD_SYN(
+              "/transfers",
+              "/transfers clear",
+              "/transfers rate <kib/s>|off",
+              "/transfers perhost <number>")
+      CMD_DESC(
+              "Show and configure HTTP file uploads and downloads. "
+              "Transfers that are over the limit per host wait in a queue, uploads go first, plugin downloads last. "
+              "Calling with no arguments lists queued, active and recently finished transfers.")
+      CMD_ARGS(
+              { "clear", "Remove finished transfers from the list." },
+              { "rate <kib/s>|off", "Limit the speed of each transfer in KiB per second, or turn the limit off." },
+              { "perhost <number>", "How many transfers may run at the same time to one host, defaults to 2." })
+      CMD_EXAMPLES(
+              "/transfers",
+              "/transfers rate 512",
+              "/transfers perhost 4")
+    },
+
     { CMD_PREAMBLE("/lastactivity",
                    parse_args, 1, 2, NULL)
       CMD_MAINFUNC(cmd_lastactivity)
@@ -1217,6 +1242,41 @@ static const struct cmd_t command_defs[] = {
               { "dynamic on|off", "Start with 0 millis and dynamically increase up to timeout when no activity, default: on." })
     },
 
+    { CMD_PREAMBLE("/framerate",
+                   parse_args, 1, 1, &cons_framerate_setting)
+      CMD_MAINFUNC(cmd_framerate)
+      CMD_TAGS(
+              CMD_TAG_UI)
+      CMD_SYN(
+              "/framerate <fps>")
+      CMD_DESC(
+              "Maximum number of times per second the screen is updated. "
+              "Lower values use less CPU when many messages arrive at once.")
+      CMD_ARGS(
+              { "<fps>", "Updates per second (1-240), default: 30." })
+      CMD_EXAMPLES(
+              "/framerate 10")
+    },
+
+    { CMD_PREAMBLE("/scrollback",
+                   parse_args, 2, 2, &cons_scrollback_setting)
+      CMD_MAINFUNC(cmd_scrollback)
+      CMD_TAGS(
+              CMD_TAG_UI)
+      CMD_SYN(
+              "/scrollback chat|muc|private|other <entries>",
+              "/scrollback memory <megabytes>")
+      CMD_DESC(
+              "How much history each window keeps in memory. "
+              "Older messages are loaded from the database again when scrolling up.")
+      CMD_ARGS(
+              { "chat|muc|private|other <entries>", "Number of entries kept for this type of window, default: 200." },
+              { "memory <megabytes>", "Memory all windows together may use for their history, default: 64." })
+      CMD_EXAMPLES(
+              "/scrollback muc 20000",
+              "/scrollback memory 256")
+    },
+
 
     { CMD_PREAMBLE("/titlebar",
                    parse_args, 1, 3, &cons_titlebar_setting)
@@ -1660,7 +1720,8 @@ static const struct cmd_t command_defs[] = {
       CMD_TAGS(
               CMD_TAG_CHAT)
       CMD_SYN(
-              "/logging chat|group on|off")
+              "/logging chat|group on|off",
+              "/logging sync off|normal|full")
       CMD_DESC(
               "Configure chat logging. "
               "Switch logging on or off. "
@@ -1668,10 +1729,12 @@ static const struct cmd_t command_defs[] = {
               "When disabling this option, /history will also be disabled. ")
       CMD_ARGS(
               { "chat on|off", "Enable/Disable regular chat logging." },
-              { "group on|off", "Enable/Disable groupchat (room) logging." })
+              { "group on|off", "Enable/Disable groupchat (room) logging." },
+              { "sync off|normal|full", "How durable writes to the message database are. 'normal' may lose the last messages on power loss, 'full' syncs every batch to disk, 'off' leaves it to the operating system." })
       CMD_EXAMPLES(
               "/logging chat on",
-              "/logging group off")
+              "/logging group off",
+              "/logging sync full")
     },
 
     { CMD_PREAMBLE("/states",
@@ -1877,18 +1940,30 @@ static const struct cmd_t command_defs[] = {
     },
 
     { CMD_PREAMBLE("/history",
-                   parse_args, 1, 1, &cons_history_setting)
+                   parse_args, 1, 4, &cons_history_setting)
       CMD_MAINFUNC(cmd_history)
       CMD_TAGS(
               CMD_TAG_UI,
               CMD_TAG_CHAT)
       CMD_SYN(
-              "/history on|off")
+              "/history on|off",
+              "/history search <query> [<jid>] [<since>]",
+              "/history more")
       CMD_DESC(
               "Switch chat history on or off, /logging chat will automatically be enabled when this setting is on. "
-              "When history is enabled, previous messages are shown in chat windows.")
-      CMD_ARGS(
-              { "on|off", "Enable or disable showing chat history." })
+              "When history is enabled, previous messages are shown in chat windows. "
+              "Search the message database, best matches are shown first.")
+      CMD_ARGS(
+              { "on|off", "Enable or disable showing chat history." },
+              { "search <query>", "Search logged messages for all words in query, quote it to use several words. A word ending in * matches as a prefix." },
+              { "search <query> <jid>", "Only search the conversation with a contact or room." },
+              { "search <query> [<jid>] <since>", "Only search messages since a date (YYYY-MM-DD) or ISO8601 timestamp." },
+              { "more", "Show the next results of the last search." })
+      CMD_EXAMPLES(
+              "/history on",
+              "/history search release",
+              "/history search \"release notes\" room@conference.example.org",
+              "/history search deploy* 2024-01-01")
     },
 
     { CMD_PREAMBLE("/log",
@@ -35,6 +35,7 @@
 #include "profanity.h"
 #include "log.h"
 #include "common.h"
+#include "database.h"
 #include "command/cmd_funcs.h"
 #include "command/cmd_defs.h"
 #include "command/cmd_ac.h"
@@ -49,6 +50,7 @@
 #include "event/client_events.h"
 #include "tools/http_upload.h"
 #include "tools/http_download.h"
+#include "tools/transfer.h"
 #include "tools/autocomplete.h"
 #include "tools/parser.h"
 #include "tools/plugin_download.h"
@@ -65,6 +67,7 @@
 #include "xmpp/connection.h"
 #include "xmpp/contact.h"
 #include "xmpp/jid.h"
+#include "xmpp/message.h"
 #include "xmpp/muc.h"
 #include "xmpp/roster_list.h"
 #include "xmpp/session.h"
@@ -4907,43 +4910,28 @@ cmd_disco(ProfWin* window, const char* const command, gchar** args)
     return TRUE;
 }
 
-// TODO: Move this into its own tools such as HTTPUpload or AESGCMDownload.
 #ifdef HAVE_OMEMO
-char*
-_add_omemo_stream(int* fd, FILE** fh, char** err)
-{
-    // Create temporary file for writing ciphertext.
-    int tmpfd;
-    auto_char char* tmpname = NULL;
-    if ((tmpfd = g_file_open_tmp("profanity.XXXXXX", &tmpname, NULL)) == -1) {
-        *err = "Unable to create temporary file for encrypted transfer.";
-        return NULL;
+// Encrypts the file while curl reads it for the upload.
+static gboolean
+_omemo_upload_read(HTTPUpload* upload, char* buffer, size_t size, size_t* bytes, void* userdata)
+{
+    gcry_error_t crypt_res = omemo_file_stream_read(userdata, upload->filehandle, buffer, size, bytes);
+    if (crypt_res != GPG_ERR_NO_ERROR) {
+        log_error("[OMEMO] Failed to encrypt '%s': %s", upload->filename, gcry_strerror(crypt_res));
+        return FALSE;
     }
-    FILE* tmpfh = fdopen(tmpfd, "w+b");
-
-    // The temporary ciphertext file should be removed after it has
-    // been closed.
-    remove(tmpname);
+    return TRUE;
+}
 
-    int crypt_res;
-    char* fragment;
-    fragment = omemo_encrypt_file(*fh, tmpfh, file_size(*fd), &crypt_res);
-    if (crypt_res != 0) {
-        fclose(tmpfh);
-        return NULL;
+static gboolean
+_omemo_upload_rewind(HTTPUpload* upload, void* userdata)
+{
+    gcry_error_t crypt_res = omemo_file_stream_rewind(userdata, upload->filehandle);
+    if (crypt_res != GPG_ERR_NO_ERROR) {
+        log_error("[OMEMO] Failed to restart encrypting '%s': %s", upload->filename, gcry_strerror(crypt_res));
+        return FALSE;
     }
-
-    // Force flush as the upload will read from the same stream.
-    fflush(tmpfh);
-    rewind(tmpfh);
-
-    fclose(*fh); // Also closes descriptor.
-
-    // Switch original stream with temporary ciphertext stream.
-    *fd = tmpfd;
-    *fh = tmpfh;
-
-    return fragment;
+    return TRUE;
 }
 #endif
 
@@ -4955,6 +4943,9 @@ cmd_sendfile(ProfWin* window, const char* const command, gchar** args)
     auto_gchar gchar* filename = get_expanded_path(args[0]);
     char* alt_scheme = NULL;
     char* alt_fragment = NULL;
+#ifdef HAVE_OMEMO
+    OmemoFileStream* omemo_stream = NULL;
+#endif
 
     if (access(filename, R_OK) != 0) {
         cons_show_error("Uploading '%s' failed: File not found!", filename);
@@ -5028,15 +5019,13 @@ cmd_sendfile(ProfWin* window, const char* const command, gchar** args)
 
     if (omemo_enabled || (ox_enabled && ox_encryptfile)) {
 #ifdef HAVE_OMEMO
-        char* err = NULL;
+        gcry_error_t crypt_res;
         alt_scheme = OMEMO_AESGCM_URL_SCHEME;
-        alt_fragment = _add_omemo_stream(&fd, &fh, &err);
-        if (err != NULL) {
-            cons_show_error(err);
-            win_println(window, THEME_ERROR, "-", err);
-            if (fh) {
-                fclose(fh);
-            }
+        omemo_stream = omemo_encrypt_file_stream(file_size(fd), &alt_fragment, &crypt_res);
+        if (!omemo_stream) {
+            cons_show_error("Unable to encrypt '%s': %s", filename, gcry_strerror(crypt_res));
+            win_println(window, THEME_ERROR, "-", "Unable to encrypt '%s': %s", filename, gcry_strerror(crypt_res));
+            fclose(fh);
             goto out;
         }
 #else
@@ -5078,6 +5067,17 @@ cmd_sendfile(ProfWin* window, const char* const command, gchar** args)
         goto out;
     }
 
+#ifdef HAVE_OMEMO
+    if (omemo_stream) {
+        upload->filesize += OMEMO_AESGCM_TAG_LENGTH;
+        upload->read_func = _omemo_upload_read;
+        upload->rewind_func = _omemo_upload_rewind;
+        upload->read_data = omemo_stream;
+        upload->read_free = (GDestroyNotify)omemo_file_stream_free;
+        omemo_stream = NULL;
+    }
+#endif
+
     if (alt_scheme != NULL) {
         upload->alt_scheme = strdup(alt_scheme);
     } else {
@@ -5096,11 +5096,66 @@ out:
 #ifdef HAVE_OMEMO
     if (alt_fragment != NULL)
         omemo_free(alt_fragment);
+    omemo_file_stream_free(omemo_stream);
 #endif
 
     return TRUE;
 }
 
+gboolean
+cmd_transfers(ProfWin* window, const char* const command, gchar** args)
+{
+    char* subcmd = args[0];
+    char* value = args[1];
+
+    if (subcmd == NULL) {
+        GList* transfers = transfer_list();
+        cons_show_transfers(transfers);
+        g_list_free(transfers);
+        return TRUE;
+    }
+
+    if (g_strcmp0(subcmd, "clear") == 0) {
+        transfer_clear_finished();
+        cons_show("Finished transfers cleared.");
+        return TRUE;
+    }
+
+    if (value == NULL) {
+        cons_bad_cmd_usage(command);
+        return TRUE;
+    }
+
+    int intval = 0;
+    auto_char char* err_msg = NULL;
+
+    if (g_strcmp0(subcmd, "rate") == 0) {
+        if (g_strcmp0(value, "off") == 0) {
+            prefs_set_transfer_rate(0);
+            cons_show("Transfer speed limit disabled.");
+        } else if (strtoi_range(value, &intval, 1, INT_MAX, &err_msg)) {
+            prefs_set_transfer_rate(intval);
+            cons_show("Transfer speed limit set to %d KiB/s.", intval);
+        } else {
+            cons_show(err_msg);
+        }
+        return TRUE;
+    }
+
+    if (g_strcmp0(subcmd, "perhost") == 0) {
+        if (strtoi_range(value, &intval, 1, TRANSFER_MAX_ACTIVE, &err_msg)) {
+            prefs_set_transfer_host_limit(intval);
+            cons_show("Transfers per host set to %d.", intval);
+        } else {
+            cons_show(err_msg);
+        }
+        return TRUE;
+    }
+
+    cons_bad_cmd_usage(command);
+    return TRUE;
+}
+
 gboolean
 cmd_lastactivity(ProfWin* window, const char* const command, gchar** args)
 {
@@ -5956,6 +6011,61 @@ cmd_inpblock(ProfWin* window, const char* const command, gchar** args)
     return TRUE;
 }
 
+gboolean
+cmd_scrollback(ProfWin* window, const char* const command, gchar** args)
+{
+    char* subcmd = args[0];
+    char* value = args[1];
+
+    int intval = 0;
+    auto_char char* err_msg = NULL;
+
+    if (g_strcmp0(subcmd, "memory") == 0) {
+        if (strtoi_range(value, &intval, 1, 65536, &err_msg)) {
+            prefs_set_scrollback_memory(intval);
+            ui_update_scrollback();
+            cons_show("Scrollback memory set to %d megabytes.", intval);
+        } else {
+            cons_show(err_msg);
+        }
+
+        return TRUE;
+    }
+
+    if (g_strcmp0(subcmd, "chat") == 0 || g_strcmp0(subcmd, "muc") == 0
+        || g_strcmp0(subcmd, "private") == 0 || g_strcmp0(subcmd, "other") == 0) {
+        if (strtoi_range(value, &intval, 1, 1000000, &err_msg)) {
+            prefs_set_scrollback(subcmd, intval);
+            ui_update_scrollback();
+            cons_show("Scrollback for %s windows set to %d entries.", subcmd, intval);
+        } else {
+            cons_show(err_msg);
+        }
+
+        return TRUE;
+    }
+
+    cons_bad_cmd_usage(command);
+
+    return TRUE;
+}
+
+gboolean
+cmd_framerate(ProfWin* window, const char* const command, gchar** args)
+{
+    int intval = 0;
+    auto_char char* err_msg = NULL;
+
+    if (strtoi_range(args[0], &intval, 1, 240, &err_msg)) {
+        prefs_set_framerate(intval);
+        cons_show("Frame rate set to %d updates per second.", intval);
+    } else {
+        cons_show(err_msg);
+    }
+
+    return TRUE;
+}
+
 gboolean
 cmd_titlebar(ProfWin* window, const char* const command, gchar** args)
 {
@@ -6904,6 +7014,7 @@ cmd_privacy(ProfWin* window, const char* const command, gchar** args)
             cons_bad_cmd_usage(command);
             return TRUE;
         }
+        ui_update_scrollback();
         return TRUE;
     }
 
@@ -6930,12 +7041,106 @@ cmd_logging(ProfWin* window, const char* const command, gchar** args)
     } else if (g_strcmp0(args[0], "group") == 0 && args[1] != NULL) {
         _cmd_set_boolean_preference(args[1], "Groupchat logging", PREF_GRLOG);
         return TRUE;
+    } else if (g_strcmp0(args[0], "sync") == 0 && args[1] != NULL) {
+        if (g_strcmp0(args[1], "off") == 0 || g_strcmp0(args[1], "normal") == 0 || g_strcmp0(args[1], "full") == 0) {
+            prefs_set_string(PREF_DBLOG_SYNC, args[1]);
+            log_database_update_synchronous();
+            cons_show("Database sync set to: %s.", args[1]);
+            return TRUE;
+        }
     }
 
     cons_bad_cmd_usage(command);
     return TRUE;
 }
 
+#define HISTORY_SEARCH_PAGE_SIZE 10
+
+// Last /history search, for /history more
+static struct
+{
+    gchar* query;
+    gchar* jid;
+    gchar* since;
+    int offset;
+} history_search;
+
+static void
+_cmd_history_search_page(void)
+{
+    // one result more than a page tells whether there is another one
+    GSList* results = log_database_search(history_search.query, history_search.jid, history_search.since, history_search.offset, HISTORY_SEARCH_PAGE_SIZE + 1);
+    GSList* next_page = g_slist_nth(results, HISTORY_SEARCH_PAGE_SIZE - 1);
+    gboolean more = next_page && next_page->next;
+    if (more) {
+        g_slist_free_full(next_page->next, (GDestroyNotify)message_free);
+        next_page->next = NULL;
+    }
+
+    cons_show_history_search(history_search.query, results, history_search.offset, more);
+    history_search.offset += g_slist_length(results);
+    g_slist_free_full(results, (GDestroyNotify)message_free);
+}
+
+// Accepts a date (YYYY-MM-DD) or an ISO8601 timestamp, returns it in the format messages are logged with
+static gchar*
+_cmd_history_search_since(const char* const arg)
+{
+    if (strlen(arg) == 10 && g_ascii_isdigit(arg[0]) && arg[4] == '-' && arg[7] == '-') {
+        return g_strdup(arg);
+    }
+
+    GTimeZone* local = g_time_zone_new_local();
+    GDateTime* since = g_date_time_new_from_iso8601(arg, local);
+    g_time_zone_unref(local);
+    if (!since) {
+        return NULL;
+    }
+
+    gchar* since_str = prof_date_time_format_iso8601(since);
+    g_date_time_unref(since);
+    return since_str;
+}
+
+static void
+_cmd_history_search(const char* const command, gchar** args)
+{
+    if (args[1] == NULL) {
+        cons_bad_cmd_usage(command);
+        return;
+    }
+
+    if (!log_database_search_available()) {
+        cons_show("History search is not available, it requires the message database.");
+        return;
+    }
+
+    const char* jid = args[2];
+    const char* since_arg = args[3];
+    auto_gchar gchar* since = NULL;
+
+    // the jid may be left out: /history search <query> <since>
+    if (jid && !since_arg && (since = _cmd_history_search_since(jid))) {
+        jid = NULL;
+    } else if (since_arg) {
+        since = _cmd_history_search_since(since_arg);
+        if (!since) {
+            cons_show("Invalid date: %s", since_arg);
+            return;
+        }
+    }
+
+    g_free(history_search.query);
+    g_free(history_search.jid);
+    g_free(history_search.since);
+    history_search.query = g_strdup(args[1]);
+    history_search.jid = g_strdup(jid);
+    history_search.since = g_steal_pointer(&since);
+    history_search.offset = 0;
+
+    _cmd_history_search_page();
+}
+
 gboolean
 cmd_history(ProfWin* window, const char* const command, gchar** args)
 {
@@ -6944,6 +7149,20 @@ cmd_history(ProfWin* window, const char* const command, gchar** args)
         return TRUE;
     }
 
+    if (g_strcmp0(args[0], "search") == 0) {
+        _cmd_history_search(command, args);
+        return TRUE;
+    }
+
+    if (g_strcmp0(args[0], "more") == 0) {
+        if (!history_search.query) {
+            cons_show("No previous search, use /history search <query>.");
+        } else {
+            _cmd_history_search_page();
+        }
+        return TRUE;
+    }
+
     _cmd_set_boolean_preference(args[0], "Chat history", PREF_HISTORY);
 
     // if set to on, set chlog (/logging chat on)
@@ -9555,8 +9774,7 @@ _url_aesgcm_method(ProfWin* window, const char* cmd_template, gchar* url, gchar*
     }
     download->window = window;
 
-    pthread_create(&(download->worker), NULL, &aesgcm_file_get, download);
-    aesgcm_download_add_download(download);
+    aesgcm_download_start(download);
 }
 #endif
 
@@ -9574,8 +9792,7 @@ _download_install_plugin(ProfWin* window, gchar* url, gchar* path)
     download->window = window;
     download->silent = TRUE;
 
-    pthread_create(&(download->worker), NULL, &plugin_download_install, download);
-    plugin_download_add_download(download);
+    plugin_download_start(download);
     return TRUE;
 }
 
@@ -9592,9 +9809,9 @@ _url_http_method(ProfWin* window, const char* cmd_template, gchar* url, gchar* p
     download->cmd_template = cmd_template ? strdup(cmd_template) : NULL;
     download->window = window;
     download->silent = FALSE;
+    download->priority = TRANSFER_PRIORITY_NORMAL;
 
-    pthread_create(&(download->worker), NULL, &http_file_get, download);
-    http_download_add_download(download);
+    http_download_start(download);
 }
 
 static void
@@ -9798,10 +10015,14 @@ cmd_mam(ProfWin* window, const char* const command, gchar** args)
             return TRUE;
         }
 
-        GDateTime* utc_start = g_date_time_to_timezone(first_msg->time, g_time_zone_new_utc());
-        GDateTime* utc_end = g_date_time_to_timezone(last_msg->time, g_time_zone_new_utc());
+        GDateTime* first_time = buffer_entry_get_time(first_msg);
+        GDateTime* last_time = buffer_entry_get_time(last_msg);
+        GDateTime* utc_start = g_date_time_to_utc(first_time);
+        GDateTime* utc_end = g_date_time_to_utc(last_time);
         auto_gchar gchar* start_str = g_date_time_format(utc_start, "%FT%T.%f%:z");
         auto_gchar gchar* end_str = g_date_time_format(utc_end, "%FT%T.%f%:z");
+        g_date_time_unref(first_time);
+        g_date_time_unref(last_time);
         g_date_time_unref(utc_start);
         g_date_time_unref(utc_end);
 
@@ -67,6 +67,7 @@ gboolean cmd_close(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_connect(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_disco(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_sendfile(ProfWin* window, const char* const command, gchar** args);
+gboolean cmd_transfers(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_lastactivity(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_disconnect(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_flash(ProfWin* window, const char* const command, gchar** args);
@@ -130,6 +131,8 @@ gboolean cmd_wrap(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_time(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_resource(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_inpblock(ProfWin* window, const char* const command, gchar** args);
+gboolean cmd_scrollback(ProfWin* window, const char* const command, gchar** args);
+gboolean cmd_framerate(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_titlebar(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_titlebar_show_hide(ProfWin* window, const char* const command, gchar** args);
 gboolean cmd_mainwin(ProfWin* window, const char* const command, gchar** args);
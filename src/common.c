@@ -38,6 +38,7 @@
 #include "log.h"
 #include "common.h"
 #include "config/files.h"
+#include "tools/matcher.h"
 #include "ui/ui.h"
 
 #ifdef HAVE_GIT_VERSION
@@ -724,16 +725,27 @@ get_random_string(int length)
     return rand;
 }
 
+static void
+_add_mention(int id, glong offset, const char* start, gsize len, void* userdata)
+{
+    GSList** mentions = userdata;
+    *mentions = g_slist_prepend(*mentions, GINT_TO_POINTER(offset));
+}
+
 GSList*
 get_mentions(gboolean whole_word, gboolean case_sensitive, const char* const message, const char* const nick)
 {
     GSList* mentions = NULL;
-    auto_gchar gchar* message_search = case_sensitive ? g_strdup(message) : g_utf8_strdown(message, -1);
-    auto_gchar gchar* mynick_search = case_sensitive ? g_strdup(nick) : g_utf8_strdown(nick, -1);
+    if (message == NULL || nick == NULL) {
+        return mentions;
+    }
 
-    mentions = prof_occurrences(mynick_search, message_search, 0, whole_word, &mentions);
+    Matcher matcher = matcher_new();
+    matcher_add(matcher, nick, 0, (whole_word ? MATCHER_WHOLE_WORD : 0) | (case_sensitive ? MATCHER_EXACT_CASE : 0));
+    matcher_scan(matcher, message, _add_mention, &mentions);
+    matcher_free(matcher);
 
-    return mentions;
+    return g_slist_reverse(mentions);
 }
 
 gboolean
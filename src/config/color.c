@@ -37,8 +37,26 @@ static struct color_pair_cache
     }* pairs;
     int size;
     int capacity;
+    // fg and bg packed by _color_pair_key() to the pair's index
+    GHashTable* index;
 } cache = { 0 };
 
+#define NICK_CACHE_SIZE 1024
+
+typedef struct nick_color_t
+{
+    char* str;
+    int pair;
+} NickColor;
+
+// recently hashed strings and their pairs, most recently used first
+static struct nick_cache
+{
+    GHashTable* links;
+    GQueue lru;
+    color_profile profile;
+} nicks = { 0 };
+
 /*
  * xterm default 256 colors
  * XXX: there are many duplicates... (eg blue3)
@@ -403,13 +421,41 @@ out:
     return rc;
 }
 
+static void
+_nick_color_free(NickColor* nick)
+{
+    g_free(nick->str);
+    g_free(nick);
+}
+
+static void
+_nick_cache_clear(void)
+{
+    if (nicks.links) {
+        g_hash_table_destroy(nicks.links);
+        nicks.links = NULL;
+    }
+    g_queue_clear_full(&nicks.lru, (GDestroyNotify)_nick_color_free);
+}
+
 void
 color_pair_cache_free(void)
 {
+    _nick_cache_clear();
+    if (cache.index) {
+        g_hash_table_destroy(cache.index);
+    }
     if (cache.pairs) {
         free(cache.pairs);
-        memset(&cache, 0, sizeof(cache));
     }
+    memset(&cache, 0, sizeof(cache));
+}
+
+// colours range from -1 (terminal default) to 255
+static gpointer
+_color_pair_key(int fg, int bg)
+{
+    return GUINT_TO_POINTER(((guint)(fg + 1) << 16) | (guint)(bg + 1));
 }
 
 void
@@ -427,10 +473,12 @@ color_pair_cache_reset(void)
         cache.capacity = 8;
 
     cache.pairs = g_malloc0(sizeof(*cache.pairs) * cache.capacity);
+    cache.index = g_hash_table_new(g_direct_hash, g_direct_equal);
     if (cache.pairs) {
         /* default_default */
         cache.pairs[0].fg = -1;
         cache.pairs[0].bg = -1;
+        g_hash_table_insert(cache.index, _color_pair_key(-1, -1), GINT_TO_POINTER(0));
         cache.size = 1;
     } else {
         log_error("Color: unable to allocate memory");
@@ -448,10 +496,9 @@ _color_pair_cache_get(int fg, int bg)
     }
 
     /* try to find pair in cache */
-    for (int i = 0; i < cache.size; i++) {
-        if (fg == cache.pairs[i].fg && bg == cache.pairs[i].bg) {
-            return i;
-        }
+    gpointer found;
+    if (cache.index && g_hash_table_lookup_extended(cache.index, _color_pair_key(fg, bg), NULL, &found)) {
+        return GPOINTER_TO_INT(found);
     }
 
     /* otherwise cache new pair */
@@ -467,6 +514,7 @@ _color_pair_cache_get(int fg, int bg)
     cache.pairs[i].bg = bg;
     /* (re-)define the new pair in curses */
     init_pair(i, fg, bg);
+    g_hash_table_insert(cache.index, _color_pair_key(fg, bg), GINT_TO_POINTER(i));
 
     cache.size++;
 
@@ -485,6 +533,21 @@ _color_pair_cache_get(int fg, int bg)
 int
 color_pair_cache_hash_str(const char* str, color_profile profile)
 {
+    if (nicks.links && nicks.profile != profile) {
+        _nick_cache_clear();
+    }
+    if (!nicks.links) {
+        nicks.links = g_hash_table_new(g_str_hash, g_str_equal);
+        nicks.profile = profile;
+    }
+
+    GList* link = g_hash_table_lookup(nicks.links, str);
+    if (link) {
+        g_queue_unlink(&nicks.lru, link);
+        g_queue_push_head_link(&nicks.lru, link);
+        return ((NickColor*)link->data)->pair;
+    }
+
     int fg = color_hash(str, profile);
     int bg = -1;
 
@@ -493,7 +556,24 @@ color_pair_cache_hash_str(const char* str, color_profile profile)
         bg = find_col(bkgnd, strlen(bkgnd));
     }
 
-    return _color_pair_cache_get(fg, bg);
+    int pair = _color_pair_cache_get(fg, bg);
+    if (pair < 0) {
+        return pair;
+    }
+
+    NickColor* nick = g_new0(NickColor, 1);
+    nick->str = g_strdup(str);
+    nick->pair = pair;
+    g_queue_push_head(&nicks.lru, nick);
+    g_hash_table_insert(nicks.links, nick->str, nicks.lru.head);
+
+    if (g_queue_get_length(&nicks.lru) > NICK_CACHE_SIZE) {
+        NickColor* oldest = g_queue_pop_tail(&nicks.lru);
+        g_hash_table_remove(nicks.links, oldest->str);
+        _nick_color_free(oldest);
+    }
+
+    return pair;
 }
 
 /**
@@ -21,6 +21,7 @@
 #include "log.h"
 #include "preferences.h"
 #include "tools/autocomplete.h"
+#include "tools/matcher.h"
 #include "config/files.h"
 #include "config/conflists.h"
 #include "ui/ui.h"
@@ -44,6 +45,9 @@
 #define PREF_GROUP_SPELLCHECK    "spellcheck"
 
 #define INPBLOCK_DEFAULT 1000
+#define SCROLLBACK_DEFAULT        200
+#define SCROLLBACK_MEMORY_DEFAULT 64
+#define FRAMERATE_DEFAULT         30
 
 static prof_keyfile_t prefs_prof_keyfile;
 static GKeyFile* prefs;
@@ -52,15 +56,117 @@ gint log_maxsize = 0;
 static Autocomplete boolean_choice_ac;
 static Autocomplete room_trigger_ac;
 
+// Typed copy of the preference_t settings. Each entry is read from the key
+// file on first use and dropped again when the setting changes, so hot paths
+// get their value without a key file lookup or a copy.
+typedef struct prefs_snapshot_t
+{
+    gboolean has_boolean;
+    gboolean boolean;
+    gboolean has_string;
+    gchar* string;
+} PrefsSnapshot;
+
+static PrefsSnapshot snapshot[PREF_COUNT];
+
+// integer settings read on every input poll or status bar draw
+static struct
+{
+    gint inpblock;
+    gint framerate;
+    gint statusbartabs;
+    gint statusbartablen;
+} snapshot_ints;
+
+typedef struct prefs_listener_t
+{
+    prefs_changed_cb callback;
+    void* userdata;
+} PrefsListener;
+
+static GSList* listeners;
+
+// Mention and trigger patterns of incoming room messages, built for one nick
+// and dropped again when the nick, the mention settings or the triggers change.
+#define MESSAGE_MATCH_MENTION 0
+
+static Matcher message_matcher;
+static gchar* message_matcher_nick;
+static gchar** message_matcher_triggers;
+static gsize message_matcher_triggers_len;
+
 static void _save_prefs(void);
 static const gchar* _get_group(preference_t pref);
 static const gchar* _get_key(preference_t pref);
 static gboolean _get_default_boolean(preference_t pref);
 static gchar* _get_default_string(preference_t pref);
+static gint _read_inpblock(void);
+static gint _read_framerate(void);
+static gint _read_statusbartabs(void);
+static gint _read_statusbartablen(void);
+
+static void
+_snapshot_clear(void)
+{
+    for (int i = 0; i < PREF_COUNT; i++) {
+        g_free(snapshot[i].string);
+    }
+    memset(snapshot, 0, sizeof(snapshot));
+}
+
+static void
+_snapshot_load_ints(void)
+{
+    snapshot_ints.inpblock = _read_inpblock();
+    snapshot_ints.framerate = _read_framerate();
+    snapshot_ints.statusbartabs = _read_statusbartabs();
+    snapshot_ints.statusbartablen = _read_statusbartablen();
+}
+
+static void
+_message_matcher_clear(void)
+{
+    matcher_free(message_matcher);
+    message_matcher = NULL;
+    g_free(message_matcher_nick);
+    message_matcher_nick = NULL;
+    g_strfreev(message_matcher_triggers);
+    message_matcher_triggers = NULL;
+    message_matcher_triggers_len = 0;
+}
+
+static void
+_notify_listeners(preference_t pref)
+{
+    GSList* curr = listeners;
+    while (curr) {
+        PrefsListener* listener = curr->data;
+        // a listener may remove itself
+        curr = g_slist_next(curr);
+        listener->callback(pref, listener->userdata);
+    }
+}
+
+// drop the cached value of pref and tell the listeners about the change
+static void
+_prefs_changed(preference_t pref)
+{
+    g_free(snapshot[pref].string);
+    snapshot[pref] = (PrefsSnapshot){ 0 };
+
+    if (pref == PREF_NOTIFY_MENTION_WHOLE_WORD || pref == PREF_NOTIFY_MENTION_CASE_SENSITIVE) {
+        _message_matcher_clear();
+    }
+
+    _notify_listeners(pref);
+}
 
 static void
 _prefs_load(void)
 {
+    _snapshot_clear();
+    _message_matcher_clear();
+
     GError* err = NULL;
     log_maxsize = g_key_file_get_integer(prefs, PREF_GROUP_LOGGING, "maxsize", &err);
     if (err) {
@@ -231,6 +337,8 @@ _prefs_load(void)
     for (gsize i = 0; i < len; i++) {
         autocomplete_add(room_trigger_ac, triggers[i]);
     }
+
+    _snapshot_load_ints();
 }
 
 /* Clean up after _prefs_load() */
@@ -239,6 +347,8 @@ _prefs_close(void)
 {
     autocomplete_free(boolean_choice_ac);
     autocomplete_free(room_trigger_ac);
+    _snapshot_clear();
+    _message_matcher_clear();
 }
 
 void
@@ -247,6 +357,41 @@ prefs_reload(void)
     auto_gchar gchar* loc = g_strdup(prefs_prof_keyfile.filename);
     prefs_close();
     prefs_load(loc);
+
+    // any setting may differ in the reloaded file
+    if (listeners) {
+        for (int i = 0; i < PREF_COUNT; i++) {
+            _notify_listeners(i);
+        }
+    }
+}
+
+/**
+ * @brief Registers a callback for changes of preference_t settings.
+ *
+ * The callback runs after the new value is in place, so it may read it with
+ * any of the prefs_get_* functions.
+ */
+void
+prefs_add_listener(prefs_changed_cb callback, void* userdata)
+{
+    PrefsListener* listener = g_new0(PrefsListener, 1);
+    listener->callback = callback;
+    listener->userdata = userdata;
+    listeners = g_slist_append(listeners, listener);
+}
+
+void
+prefs_remove_listener(prefs_changed_cb callback, void* userdata)
+{
+    for (GSList* curr = listeners; curr; curr = g_slist_next(curr)) {
+        PrefsListener* listener = curr->data;
+        if (listener->callback == callback && listener->userdata == userdata) {
+            listeners = g_slist_delete_link(listeners, curr);
+            g_free(listener);
+            return;
+        }
+    }
 }
 
 void
@@ -386,23 +531,77 @@ prefs_do_chat_notify(gboolean current_win)
     }
 }
 
-GList*
-prefs_message_get_triggers(const gchar* const message)
+static Matcher
+_message_matcher(const gchar* const mynick)
 {
-    GList* result = NULL;
+    if (message_matcher && g_strcmp0(mynick, message_matcher_nick) == 0) {
+        return message_matcher;
+    }
 
-    auto_gchar gchar* message_lower = g_utf8_strdown(message, -1);
-    gsize len = 0;
-    auto_gcharv gchar** triggers = g_key_file_get_string_list(prefs, PREF_GROUP_NOTIFICATIONS, "room.trigger.list", &len, NULL);
+    _message_matcher_clear();
+    message_matcher = matcher_new();
+    message_matcher_nick = g_strdup(mynick);
 
-    for (gsize i = 0; i < len; i++) {
-        auto_gchar gchar* trigger_lower = g_utf8_strdown(triggers[i], -1);
-        if (g_strrstr(message_lower, trigger_lower)) {
-            result = g_list_append(result, strdup(triggers[i]));
+    if (mynick) {
+        int flags = 0;
+        if (prefs_get_boolean(PREF_NOTIFY_MENTION_WHOLE_WORD)) {
+            flags |= MATCHER_WHOLE_WORD;
+        }
+        if (prefs_get_boolean(PREF_NOTIFY_MENTION_CASE_SENSITIVE)) {
+            flags |= MATCHER_EXACT_CASE;
         }
+        matcher_add(message_matcher, mynick, MESSAGE_MATCH_MENTION, flags);
     }
 
-    return result;
+    message_matcher_triggers = g_key_file_get_string_list(prefs, PREF_GROUP_NOTIFICATIONS, "room.trigger.list", &message_matcher_triggers_len, NULL);
+    for (gsize i = 0; i < message_matcher_triggers_len; i++) {
+        matcher_add(message_matcher, message_matcher_triggers[i], i + 1, 0);
+    }
+
+    return message_matcher;
+}
+
+typedef struct message_matches_t
+{
+    GSList* mentions;
+    gboolean* triggers;
+} MessageMatches;
+
+static void
+_message_match(int id, glong offset, const char* start, gsize len, void* userdata)
+{
+    MessageMatches* matches = userdata;
+
+    if (id == MESSAGE_MATCH_MENTION) {
+        matches->mentions = g_slist_prepend(matches->mentions, GINT_TO_POINTER(offset));
+    } else {
+        matches->triggers[id - 1] = TRUE;
+    }
+}
+
+void
+prefs_message_get_matches(const gchar* const message, const gchar* const mynick, GSList** mentions, GList** triggers)
+{
+    *mentions = NULL;
+    *triggers = NULL;
+    if (message == NULL) {
+        return;
+    }
+
+    Matcher matcher = _message_matcher(mynick);
+
+    MessageMatches matches = { NULL, g_new0(gboolean, message_matcher_triggers_len) };
+    matcher_scan(matcher, message, _message_match, &matches);
+
+    // all mentions have the same length, so they come in order of position
+    *mentions = g_slist_reverse(matches.mentions);
+    for (gsize i = 0; i < message_matcher_triggers_len; i++) {
+        if (matches.triggers[i]) {
+            *triggers = g_list_append(*triggers, strdup(message_matcher_triggers[i]));
+        }
+    }
+
+    g_free(matches.triggers);
 }
 
 gboolean
@@ -559,15 +758,22 @@ prefs_reset_room_notify(const gchar* const roomjid)
 gboolean
 prefs_get_boolean(preference_t pref)
 {
+    PrefsSnapshot* entry = &snapshot[pref];
+    if (entry->has_boolean) {
+        return entry->boolean;
+    }
+
     const gchar* group = _get_group(pref);
     const gchar* key = _get_key(pref);
-    gboolean def = _get_default_boolean(pref);
 
     if (!g_key_file_has_key(prefs, group, key, NULL)) {
-        return def;
+        entry->boolean = _get_default_boolean(pref);
+    } else {
+        entry->boolean = g_key_file_get_boolean(prefs, group, key, NULL);
     }
+    entry->has_boolean = TRUE;
 
-    return g_key_file_get_boolean(prefs, group, key, NULL);
+    return entry->boolean;
 }
 
 void
@@ -576,6 +782,7 @@ prefs_set_boolean(preference_t pref, gboolean value)
     const gchar* group = _get_group(pref);
     const gchar* key = _get_key(pref);
     g_key_file_set_boolean(prefs, group, key, value);
+    _prefs_changed(pref);
 }
 
 /**
@@ -589,21 +796,36 @@ prefs_set_boolean(preference_t pref, gboolean value)
 gchar*
 prefs_get_string(preference_t pref)
 {
+    return g_strdup(prefs_peek_string(pref));
+}
+
+/**
+ * @brief Retrieves a string preference value without copying it.
+ *
+ * @param pref The preference identifier.
+ * @return The string preference value or `NULL` if not found.
+ *
+ * @note The returned string is owned by the preferences and is only valid
+ * until the preference changes, do not free or keep it.
+ */
+const gchar*
+prefs_peek_string(preference_t pref)
+{
+    PrefsSnapshot* entry = &snapshot[pref];
+    if (entry->has_string) {
+        return entry->string;
+    }
+
     const gchar* group = _get_group(pref);
     const gchar* key = _get_key(pref);
-    gchar* def = _get_default_string(pref);
-
-    gchar* result = g_key_file_get_string(prefs, group, key, NULL);
 
-    if (result == NULL) {
-        if (def) {
-            return g_strdup(def);
-        } else {
-            return NULL;
-        }
-    } else {
-        return result;
+    entry->string = g_key_file_get_string(prefs, group, key, NULL);
+    if (entry->string == NULL) {
+        entry->string = g_strdup(_get_default_string(pref));
     }
+    entry->has_string = TRUE;
+
+    return entry->string;
 }
 
 /**
@@ -656,6 +878,7 @@ prefs_set_string(preference_t pref, const gchar* new_value)
     } else {
         g_key_file_set_string(prefs, group, key, new_value);
     }
+    _prefs_changed(pref);
 }
 
 void
@@ -668,6 +891,7 @@ prefs_set_string_with_option(preference_t pref, gchar* option, gchar* value)
     } else {
         g_key_file_set_locale_string(prefs, group, key, option, value);
     }
+    _prefs_changed(pref);
 }
 
 void
@@ -692,6 +916,7 @@ prefs_set_string_list_with_option(preference_t pref, gchar* option, const gchar*
             g_key_file_set_locale_string_list(prefs, group, key, option, values, num_values);
         }
     }
+    _prefs_changed(pref);
 }
 
 gchar*
@@ -771,8 +996,8 @@ prefs_set_max_log_size(gint value)
     g_key_file_set_integer(prefs, PREF_GROUP_LOGGING, "maxsize", value);
 }
 
-gint
-prefs_get_inpblock(void)
+static gint
+_read_inpblock(void)
 {
     int val = g_key_file_get_integer(prefs, PREF_GROUP_UI, "inpblock", NULL);
     if (val == 0) {
@@ -782,10 +1007,81 @@ prefs_get_inpblock(void)
     }
 }
 
+gint
+prefs_get_inpblock(void)
+{
+    return snapshot_ints.inpblock;
+}
+
 void
 prefs_set_inpblock(gint value)
 {
     g_key_file_set_integer(prefs, PREF_GROUP_UI, "inpblock", value);
+    snapshot_ints.inpblock = _read_inpblock();
+}
+
+/* Number of entries kept in a window's buffer, win_type is one of "chat",
+ * "muc", "private" or "other". */
+gint
+prefs_get_scrollback(const char* const win_type)
+{
+    auto_gchar gchar* key = g_strdup_printf("scrollback.%s", win_type);
+    gint val = g_key_file_get_integer(prefs, PREF_GROUP_UI, key, NULL);
+    if (val <= 0) {
+        return SCROLLBACK_DEFAULT;
+    } else {
+        return val;
+    }
+}
+
+void
+prefs_set_scrollback(const char* const win_type, gint value)
+{
+    auto_gchar gchar* key = g_strdup_printf("scrollback.%s", win_type);
+    g_key_file_set_integer(prefs, PREF_GROUP_UI, key, value);
+}
+
+// Memory all window buffers together may use, in megabytes
+gint
+prefs_get_scrollback_memory(void)
+{
+    gint val = g_key_file_get_integer(prefs, PREF_GROUP_UI, "scrollback.memory", NULL);
+    if (val <= 0) {
+        return SCROLLBACK_MEMORY_DEFAULT;
+    } else {
+        return val;
+    }
+}
+
+void
+prefs_set_scrollback_memory(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_UI, "scrollback.memory", value);
+}
+
+static gint
+_read_framerate(void)
+{
+    gint val = g_key_file_get_integer(prefs, PREF_GROUP_UI, "framerate", NULL);
+    if (val <= 0) {
+        return FRAMERATE_DEFAULT;
+    } else {
+        return val;
+    }
+}
+
+// Maximum number of screen updates per second
+gint
+prefs_get_framerate(void)
+{
+    return snapshot_ints.framerate;
+}
+
+void
+prefs_set_framerate(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_UI, "framerate", value);
+    snapshot_ints.framerate = _read_framerate();
 }
 
 gint
@@ -804,6 +1100,36 @@ prefs_set_reconnect(gint value)
     g_key_file_set_integer(prefs, PREF_GROUP_CONNECTION, "reconnect", value);
 }
 
+// Speed limit of each HTTP transfer in KiB/s, 0 for none
+gint
+prefs_get_transfer_rate(void)
+{
+    return g_key_file_get_integer(prefs, PREF_GROUP_CONNECTION, "transfers.rate", NULL);
+}
+
+void
+prefs_set_transfer_rate(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_CONNECTION, "transfers.rate", value);
+}
+
+// Number of HTTP transfers run at the same time to one host
+gint
+prefs_get_transfer_host_limit(void)
+{
+    if (!g_key_file_has_key(prefs, PREF_GROUP_CONNECTION, "transfers.perhost", NULL)) {
+        return 2;
+    } else {
+        return g_key_file_get_integer(prefs, PREF_GROUP_CONNECTION, "transfers.perhost", NULL);
+    }
+}
+
+void
+prefs_set_transfer_host_limit(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_CONNECTION, "transfers.perhost", value);
+}
+
 gint
 prefs_get_autoping(void)
 {
@@ -916,8 +1242,8 @@ prefs_get_tray_timer(void)
     }
 }
 
-gint
-prefs_get_statusbartabs(void)
+static gint
+_read_statusbartabs(void)
 {
     if (!g_key_file_has_key(prefs, PREF_GROUP_UI, "statusbar.tabs", NULL)) {
         return 10;
@@ -926,14 +1252,21 @@ prefs_get_statusbartabs(void)
     }
 }
 
+gint
+prefs_get_statusbartabs(void)
+{
+    return snapshot_ints.statusbartabs;
+}
+
 void
 prefs_set_statusbartabs(gint value)
 {
     g_key_file_set_integer(prefs, PREF_GROUP_UI, "statusbar.tabs", value);
+    snapshot_ints.statusbartabs = _read_statusbartabs();
 }
 
-gint
-prefs_get_statusbartablen(void)
+static gint
+_read_statusbartablen(void)
 {
     if (!g_key_file_has_key(prefs, PREF_GROUP_UI, "statusbar.tablen", NULL)) {
         return 0;
@@ -942,10 +1275,17 @@ prefs_get_statusbartablen(void)
     }
 }
 
+gint
+prefs_get_statusbartablen(void)
+{
+    return snapshot_ints.statusbartablen;
+}
+
 void
 prefs_set_statusbartablen(gint value)
 {
     g_key_file_set_integer(prefs, PREF_GROUP_UI, "statusbar.tablen", value);
+    snapshot_ints.statusbartablen = _read_statusbartablen();
 }
 
 gchar**
@@ -1376,6 +1716,7 @@ prefs_add_room_notify_trigger(const gchar* const text)
 
     if (res) {
         autocomplete_add(room_trigger_ac, text);
+        _message_matcher_clear();
     }
 
     return res;
@@ -1389,6 +1730,7 @@ prefs_remove_room_notify_trigger(const gchar* const text)
 
     if (res) {
         autocomplete_remove(room_trigger_ac, text);
+        _message_matcher_clear();
     }
 
     return res;
@@ -1895,6 +2237,7 @@ _get_group(preference_t pref)
     case PREF_ADV_NOTIFY_DISCO_OR_VERSION:
         return PREF_GROUP_NOTIFICATIONS;
     case PREF_DBLOG:
+    case PREF_DBLOG_SYNC:
     case PREF_CHLOG:
     case PREF_GRLOG:
     case PREF_LOG_ROTATE:
@@ -2049,6 +2392,8 @@ _get_key(preference_t pref)
         return "chlog";
     case PREF_DBLOG:
         return "dblog";
+    case PREF_DBLOG_SYNC:
+        return "dblog.sync";
     case PREF_GRLOG:
         return "grlog";
     case PREF_AUTOAWAY_CHECK:
@@ -2407,6 +2752,8 @@ _get_default_string(preference_t pref)
         return "0";
     case PREF_DBLOG:
         return "on";
+    case PREF_DBLOG_SYNC:
+        return "normal";
     case PREF_SPELLCHECK_LANG:
         return "en_US";
     default:
@@ -101,6 +101,7 @@ typedef enum {
     PREF_NOTIFY_MENTION_WHOLE_WORD,
     PREF_CHLOG,
     PREF_DBLOG,
+    PREF_DBLOG_SYNC,
     PREF_GRLOG,
     PREF_AUTOAWAY_CHECK,
     PREF_AUTOAWAY_MODE,
@@ -164,8 +165,13 @@ typedef enum {
     PREF_STATUSBAR_TABMODE,
     PREF_SPELLCHECK_ENABLE,
     PREF_SPELLCHECK_LANG,
+    PREF_COUNT
 } preference_t;
 
+// called after the value of pref changed through one of the prefs_set_*
+// functions or a reload of the preferences file
+typedef void (*prefs_changed_cb)(preference_t pref, void* userdata);
+
 typedef struct prof_alias_t
 {
     gchar* name;
@@ -203,6 +209,10 @@ gint prefs_get_max_log_size(void);
 gint prefs_get_priority(void);
 void prefs_set_reconnect(gint value);
 gint prefs_get_reconnect(void);
+void prefs_set_transfer_rate(gint value);
+gint prefs_get_transfer_rate(void);
+void prefs_set_transfer_host_limit(gint value);
+gint prefs_get_transfer_host_limit(void);
 void prefs_set_autoping(gint value);
 gint prefs_get_autoping(void);
 void prefs_set_autoping_timeout(gint value);
@@ -213,6 +223,12 @@ void prefs_set_muc_ping_timeout(gint value);
 gint prefs_get_muc_ping_timeout(void);
 gint prefs_get_inpblock(void);
 void prefs_set_inpblock(gint value);
+gint prefs_get_scrollback(const char* const win_type);
+void prefs_set_scrollback(const char* const win_type, gint value);
+gint prefs_get_scrollback_memory(void);
+void prefs_set_scrollback_memory(gint value);
+gint prefs_get_framerate(void);
+void prefs_set_framerate(gint value);
 
 void prefs_set_statusbartabs(gint value);
 gint prefs_get_statusbartabs(void);
@@ -312,18 +328,22 @@ void prefs_save_win_placement(ProfWinPlacement* placement);
 gboolean prefs_get_boolean(preference_t pref);
 void prefs_set_boolean(preference_t pref, gboolean value);
 gchar* prefs_get_string(preference_t pref);
+const gchar* prefs_peek_string(preference_t pref);
 gchar* prefs_get_string_with_locale(preference_t pref, gchar* locale);
 void prefs_set_string(preference_t pref, const gchar* new_value);
 void prefs_set_string_with_option(preference_t pref, char* option, char* value);
 void prefs_set_string_list_with_option(preference_t pref, char* option, const gchar* const* values);
 
+void prefs_add_listener(prefs_changed_cb callback, void* userdata);
+void prefs_remove_listener(prefs_changed_cb callback, void* userdata);
+
 char* prefs_get_tls_certpath(void);
 
 gboolean prefs_do_chat_notify(gboolean current_win);
 gboolean prefs_do_room_notify(gboolean current_win, const char* const roomjid, const char* const mynick,
                               const char* const theirnick, const char* const message, gboolean mention, gboolean trigger_found);
 gboolean prefs_do_room_notify_mention(const char* const roomjid, int unread, gboolean mention, gboolean trigger);
-GList* prefs_message_get_triggers(const char* const message);
+void prefs_message_get_matches(const char* const message, const char* const mynick, GSList** mentions, GList** triggers);
 
 void prefs_set_room_notify(const char* const roomjid, gboolean value);
 void prefs_set_room_notify_mention(const char* const roomjid, gboolean value);
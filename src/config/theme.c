@@ -35,14 +35,25 @@ static GKeyFile* theme;
 static GHashTable* bold_items;
 static GHashTable* defaults;
 
+// resolved theme_attrs() results, -1 until first use after a theme change
+static int attrs_table[THEME_ITEM_COUNT];
+
+// PREF_COLOR_NICK as a profile, -1 until read again
+static int nick_profile = -1;
+
 static void _load_preferences(void);
 static void _theme_list_dir(const gchar* const dir, GSList** result);
 static GString* _theme_find(const char* const theme_name);
 static gboolean _theme_load_file(const char* const theme_name);
+static void _theme_reset_attrs(void);
+static int _theme_resolve_attrs(theme_item_t attrs);
+static void _theme_prefs_changed(preference_t pref, void* userdata);
 
 static void
 _theme_close(void)
 {
+    prefs_remove_listener(_theme_prefs_changed, NULL);
+    _theme_reset_attrs();
     color_pair_cache_free();
     if (theme) {
         g_key_file_free(theme);
@@ -72,7 +83,9 @@ theme_init(const char* const theme_name)
             log_error("Theme initialisation failed.");
         }
     }
+    _theme_reset_attrs();
 
+    prefs_add_listener(_theme_prefs_changed, NULL);
     prof_add_shutdown_routine(_theme_close);
 
     defaults = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
@@ -187,6 +200,7 @@ theme_load(const char* const theme_name, gboolean load_theme_prefs)
         return FALSE;
 
     color_pair_cache_reset();
+    _theme_reset_attrs();
 
     if (_theme_load_file(theme_name)) {
         if (load_theme_prefs) {
@@ -252,6 +266,24 @@ theme_init_colours(void)
 {
     assume_default_colors(-1, -1);
     color_pair_cache_reset();
+    _theme_reset_attrs();
+}
+
+static void
+_theme_reset_attrs(void)
+{
+    for (int i = 0; i < THEME_ITEM_COUNT; i++) {
+        attrs_table[i] = -1;
+    }
+    nick_profile = -1;
+}
+
+static void
+_theme_prefs_changed(preference_t pref, void* userdata)
+{
+    if (pref == PREF_COLOR_NICK) {
+        nick_profile = -1;
+    }
 }
 
 static void
@@ -655,21 +687,38 @@ theme_get_string(char* str)
 int
 theme_hash_attrs(const char* str)
 {
-    color_profile profile = COLOR_PROFILE_DEFAULT;
-
-    auto_gchar gchar* color_pref = prefs_get_string(PREF_COLOR_NICK);
-    if (strcmp(color_pref, "redgreen") == 0) {
-        profile = COLOR_PROFILE_REDGREEN_BLINDNESS;
-    } else if (strcmp(color_pref, "blue") == 0) {
-        profile = COLOR_PROFILE_BLUE_BLINDNESS;
+    if (nick_profile < 0) {
+        nick_profile = COLOR_PROFILE_DEFAULT;
+
+        auto_gchar gchar* color_pref = prefs_get_string(PREF_COLOR_NICK);
+        if (strcmp(color_pref, "redgreen") == 0) {
+            nick_profile = COLOR_PROFILE_REDGREEN_BLINDNESS;
+        } else if (strcmp(color_pref, "blue") == 0) {
+            nick_profile = COLOR_PROFILE_BLUE_BLINDNESS;
+        }
     }
 
-    return COLOR_PAIR(color_pair_cache_hash_str(str, profile));
+    return COLOR_PAIR(color_pair_cache_hash_str(str, nick_profile));
 }
 
 /* returns the colours (fgnd and bknd) for a certain attribute ie main.text */
 int
 theme_attrs(theme_item_t attrs)
+{
+    if (attrs >= THEME_ITEM_COUNT) {
+        return _theme_resolve_attrs(attrs);
+    }
+
+    // resolved once per theme, the colour pair stays valid until the cache is reset
+    if (attrs_table[attrs] < 0) {
+        attrs_table[attrs] = _theme_resolve_attrs(attrs);
+    }
+
+    return attrs_table[attrs];
+}
+
+static int
+_theme_resolve_attrs(theme_item_t attrs)
 {
     int result = 0;
 
@@ -116,6 +116,7 @@ typedef enum {
     THEME_TEXT_HISTORY,
     THEME_CMD_WINS_UNREAD,
     THEME_TRACKBAR,
+    THEME_ITEM_COUNT
 } theme_item_t;
 
 void theme_init(const char* const theme_name);
@@ -13,6 +13,7 @@
 #include <sys/statvfs.h>
 #include <sqlite3.h>
 #include <glib.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +30,66 @@
 
 static sqlite3* g_chatlog_database;
 
+// Statements prepared once on g_chatlog_database
+static sqlite3_stmt* g_archive_id_exists_stmt;
+static sqlite3_stmt* g_archive_id_missing_stmt;
+static sqlite3_stmt* g_max_id_stmt;
+static sqlite3_stmt* g_lmc_original_stmt;
+
+// Inserts are queued and committed in batches on a separate connection by the writer thread.
+// A write stays in the queue until its batch is committed, so lookups can check the queue
+// before reading the database and reads merge in the queued inserts they can't see yet.
+#define DB_WRITE_BATCH_SIZE 256
+
+typedef enum {
+    DB_WRITE_MESSAGE,
+    DB_WRITE_ARCHIVE_ID
+} db_write_type_t;
+
+typedef struct db_write_t
+{
+    db_write_type_t op;
+    char* from_jid;
+    char* from_resource;
+    char* to_jid;
+    char* to_resource;
+    char* message;
+    char* timestamp;
+    char* stanza_id;
+    char* archive_id;
+    char* replace_id;
+    const char* type;
+    const char* enc;
+    // id of the inserted row, set before the batch commits, 0 until then and -1 if nothing was inserted
+    sqlite_int64 rowid;
+} DbWrite;
+
+static struct
+{
+    sqlite3* db;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    // signalled when writes are queued or the writer should stop
+    pthread_cond_t queued;
+    // signalled when the queue runs empty
+    pthread_cond_t drained;
+    GQueue* queue;
+    // queued inserts by archive_id and by stanza_id
+    GHashTable* archive_ids;
+    GHashTable* stanza_ids;
+    gboolean running;
+    gboolean stop;
+    gint synchronous;
+    gint applied_synchronous;
+    sqlite3_stmt* insert_stmt;
+    sqlite3_stmt* lmc_stmt;
+    sqlite3_stmt* archive_id_stmt;
+} db_writer = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .queued = PTHREAD_COND_INITIALIZER,
+    .drained = PTHREAD_COND_INITIALIZER,
+};
+
 static gboolean _add_to_db(ProfMessage* message, char* type, const Jid* const from_jid, const Jid* const to_jid);
 static char* _get_db_filename(ProfAccount* account);
 static prof_msg_type_t _get_message_type_type(const char* const type);
@@ -37,9 +98,39 @@ static prof_enc_t _get_message_enc_type(const char* const encstr);
 static int _get_db_version(void);
 static gboolean _migrate_to_v2(void);
 static gboolean _migrate_to_v3(void);
+static gboolean _migrate_to_v4(void);
+static gboolean _db_fts5_available(void);
+static gboolean _downgrade_to_v3(void);
 static gboolean _check_available_space_for_db_migration(char* path_to_db);
-
-static const int latest_version = 3;
+static gboolean _db_writer_start(const char* const filename);
+static void _db_writer_stop(void);
+static gboolean _db_writer_enqueue(DbWrite* write);
+static DbWrite* _db_writer_find_pending(const char* const stanza_id, const char* const type, const char* const jid_a, const char* const jid_b);
+static gboolean _db_writer_is_pending_archive_id(const char* const archive_id);
+
+static const int latest_version = 4;
+
+// Full-text index over `message`, an external content table kept in sync with ChatLogs by triggers
+static const char* fts_statements[] = {
+    "CREATE VIRTUAL TABLE IF NOT EXISTS `ChatLogs_fts` USING fts5("
+    "`message`, content='ChatLogs', content_rowid='id')",
+    "CREATE TRIGGER IF NOT EXISTS ChatLogs_fts_insert "
+    "AFTER INSERT ON ChatLogs "
+    "BEGIN "
+    "INSERT INTO ChatLogs_fts (rowid, message) VALUES (NEW.id, NEW.message); "
+    "END;",
+    "CREATE TRIGGER IF NOT EXISTS ChatLogs_fts_delete "
+    "AFTER DELETE ON ChatLogs "
+    "BEGIN "
+    "INSERT INTO ChatLogs_fts (ChatLogs_fts, rowid, message) VALUES ('delete', OLD.id, OLD.message); "
+    "END;",
+    "CREATE TRIGGER IF NOT EXISTS ChatLogs_fts_update "
+    "AFTER UPDATE OF message ON ChatLogs "
+    "BEGIN "
+    "INSERT INTO ChatLogs_fts (ChatLogs_fts, rowid, message) VALUES ('delete', OLD.id, OLD.message); "
+    "INSERT INTO ChatLogs_fts (rowid, message) VALUES (NEW.id, NEW.message); "
+    "END;"
+};
 
 static char*
 _db_strdup(const char* str)
@@ -63,6 +154,505 @@ _get_db_filename(ProfAccount* account)
     return files_file_in_account_data_path(DIR_DATABASE, account->jid, "chatlog.db");
 }
 
+// Prepare the statement on first use, reset it otherwise
+static sqlite3_stmt*
+_db_prepare_cached(sqlite3* db, sqlite3_stmt** stmt, const char* const query)
+{
+    if (*stmt) {
+        sqlite3_reset(*stmt);
+        sqlite3_clear_bindings(*stmt);
+        return *stmt;
+    }
+
+    if (sqlite3_prepare_v2(db, query, -1, stmt, NULL) != SQLITE_OK) {
+        *stmt = NULL;
+    }
+    return *stmt;
+}
+
+static void
+_db_finalize_cached(sqlite3_stmt** stmt)
+{
+    sqlite3_finalize(*stmt);
+    *stmt = NULL;
+}
+
+static void
+_db_bind_text(sqlite3_stmt* stmt, int index, const char* const text)
+{
+    sqlite3_bind_text(stmt, index, text, -1, SQLITE_STATIC);
+}
+
+static void
+_db_write_free(DbWrite* write)
+{
+    if (write) {
+        g_free(write->from_jid);
+        g_free(write->from_resource);
+        g_free(write->to_jid);
+        g_free(write->to_resource);
+        g_free(write->message);
+        g_free(write->timestamp);
+        g_free(write->stanza_id);
+        g_free(write->archive_id);
+        g_free(write->replace_id);
+        g_free(write);
+    }
+}
+
+// Errors on the writer thread are reported from the main loop
+typedef struct db_writer_report_t
+{
+    gchar* log_msg;
+    gchar* cons_msg;
+} DbWriterReport;
+
+static gboolean
+_db_writer_report_cb(gpointer userdata)
+{
+    DbWriterReport* report = userdata;
+    log_error("%s", report->log_msg);
+    if (report->cons_msg) {
+        cons_show_error("%s", report->cons_msg);
+    }
+    g_free(report->log_msg);
+    g_free(report->cons_msg);
+    g_free(report);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+_db_writer_report(gchar* log_msg, gchar* cons_msg)
+{
+    DbWriterReport* report = g_new0(DbWriterReport, 1);
+    report->log_msg = log_msg;
+    report->cons_msg = cons_msg;
+    g_idle_add(_db_writer_report_cb, report);
+}
+
+static void
+_db_writer_exec(const char* const query)
+{
+    char* err_msg = NULL;
+    if (SQLITE_OK != sqlite3_exec(db_writer.db, query, NULL, 0, &err_msg)) {
+        _db_writer_report(g_strdup_printf("SQLite error in database writer on '%s': %s", query, err_msg ? err_msg : "unknown"), NULL);
+        sqlite3_free(err_msg);
+    }
+}
+
+// Returns the id of the inserted row, -1 if none was inserted
+static sqlite_int64
+_db_writer_insert(DbWrite* write)
+{
+    sqlite3_stmt* stmt;
+    sqlite_int64 original_message_id = -1;
+
+    // Apply LMC and check its validity (XEP-0308)
+    if (write->replace_id) {
+        stmt = _db_prepare_cached(db_writer.db, &db_writer.lmc_stmt,
+                                  "SELECT `id`, `from_jid`, `replaces_db_id` FROM `ChatLogs` WHERE `stanza_id` = ? ORDER BY `timestamp` DESC LIMIT 1");
+        if (!stmt) {
+            _db_writer_report(g_strdup_printf("SQLite error in database writer on selecting original message: %s", sqlite3_errmsg(db_writer.db)), NULL);
+            return -1;
+        }
+        _db_bind_text(stmt, 1, write->replace_id);
+
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            original_message_id = sqlite3_column_int64(stmt, 0);
+            const char* from_jid_orig = (const char*)sqlite3_column_text(stmt, 1);
+
+            // Handle non-XEP-compliant replacement messages (edit->edit->original)
+            sqlite_int64 tmp = sqlite3_column_int64(stmt, 2);
+            original_message_id = tmp ? tmp : original_message_id;
+
+            if (g_strcmp0(from_jid_orig, write->from_jid) != 0) {
+                _db_writer_report(g_strdup_printf("Mismatch in sender JIDs when trying to do LMC. Corrected message sender: %s. Original message sender: %s. Replace-ID: %s. Message: %s", write->from_jid, from_jid_orig, write->replace_id, write->message),
+                                  g_strdup_printf("%s sent a message correction with mismatched sender. See log for details.", write->from_jid));
+                sqlite3_reset(stmt);
+                return -1;
+            }
+        }
+        sqlite3_reset(stmt);
+    }
+
+    // stanza-id (XEP-0359) doesn't have to be present in the message.
+    // We use archive_id UNIQUE constraint and ON CONFLICT DO NOTHING for deduplication.
+    stmt = _db_prepare_cached(db_writer.db, &db_writer.insert_stmt,
+                              "INSERT INTO `ChatLogs` "
+                              "(`from_jid`, `from_resource`, `to_jid`, `to_resource`, "
+                              "`message`, `timestamp`, `stanza_id`, `archive_id`, "
+                              "`replaces_db_id`, `replace_id`, `type`, `encryption`) "
+                              "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+                              "ON CONFLICT(`archive_id`) DO NOTHING");
+    if (!stmt) {
+        _db_writer_report(g_strdup_printf("SQLite error in database writer (prepare): %s", sqlite3_errmsg(db_writer.db)), NULL);
+        return -1;
+    }
+
+    _db_bind_text(stmt, 1, write->from_jid);
+    _db_bind_text(stmt, 2, write->from_resource);
+    _db_bind_text(stmt, 3, write->to_jid);
+    _db_bind_text(stmt, 4, write->to_resource);
+    _db_bind_text(stmt, 5, write->message);
+    _db_bind_text(stmt, 6, write->timestamp);
+    _db_bind_text(stmt, 7, write->stanza_id);
+    _db_bind_text(stmt, 8, write->archive_id);
+    if (original_message_id != -1) {
+        sqlite3_bind_int64(stmt, 9, original_message_id);
+    }
+    _db_bind_text(stmt, 10, write->replace_id);
+    _db_bind_text(stmt, 11, write->type);
+    _db_bind_text(stmt, 12, write->enc);
+
+    sqlite_int64 rowid = -1;
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        _db_writer_report(g_strdup_printf("SQLite error in database writer (step): %s", sqlite3_errmsg(db_writer.db)), NULL);
+    } else if (sqlite3_changes(db_writer.db) > 0) {
+        rowid = sqlite3_last_insert_rowid(db_writer.db);
+    }
+    sqlite3_reset(stmt);
+
+    return rowid;
+}
+
+static void
+_db_writer_update_archive_id(DbWrite* write)
+{
+    sqlite3_stmt* stmt = _db_prepare_cached(db_writer.db, &db_writer.archive_id_stmt,
+                                            "UPDATE `ChatLogs` "
+                                            "SET `archive_id` = ? "
+                                            "WHERE `stanza_id` = ? "
+                                            "  AND `from_jid` = ? "
+                                            "  AND `to_jid` = ? "
+                                            "  AND `type` = ? "
+                                            "  AND `archive_id` IS NULL");
+    if (!stmt) {
+        _db_writer_report(g_strdup_printf("SQLite error in database writer (prepare): %s", sqlite3_errmsg(db_writer.db)), NULL);
+        return;
+    }
+
+    _db_bind_text(stmt, 1, write->archive_id);
+    _db_bind_text(stmt, 2, write->stanza_id);
+    _db_bind_text(stmt, 3, write->from_jid);
+    _db_bind_text(stmt, 4, write->to_jid);
+    _db_bind_text(stmt, 5, write->type);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        _db_writer_report(g_strdup_printf("SQLite error in database writer (step): %s", sqlite3_errmsg(db_writer.db)), NULL);
+    }
+    sqlite3_reset(stmt);
+}
+
+static void
+_db_writer_commit(GPtrArray* batch)
+{
+    gint synchronous = g_atomic_int_get(&db_writer.synchronous);
+    if (synchronous != db_writer.applied_synchronous) {
+        auto_gchar gchar* pragma = g_strdup_printf("PRAGMA synchronous = %d", synchronous);
+        _db_writer_exec(pragma);
+        db_writer.applied_synchronous = synchronous;
+    }
+
+    GArray* rowids = g_array_sized_new(FALSE, TRUE, sizeof(sqlite_int64), batch->len);
+    g_array_set_size(rowids, batch->len);
+
+    _db_writer_exec("BEGIN TRANSACTION");
+    for (guint i = 0; i < batch->len; i++) {
+        DbWrite* write = g_ptr_array_index(batch, i);
+        if (write->op == DB_WRITE_MESSAGE) {
+            g_array_index(rowids, sqlite_int64, i) = _db_writer_insert(write);
+        } else {
+            _db_writer_update_archive_id(write);
+        }
+    }
+
+    // Readers compare these with the rows they see, so they must be set before the commit
+    pthread_mutex_lock(&db_writer.mutex);
+    for (guint i = 0; i < batch->len; i++) {
+        DbWrite* write = g_ptr_array_index(batch, i);
+        write->rowid = g_array_index(rowids, sqlite_int64, i);
+    }
+    pthread_mutex_unlock(&db_writer.mutex);
+    g_array_free(rowids, TRUE);
+
+    _db_writer_exec("COMMIT TRANSACTION");
+}
+
+// Drop a committed write from the lookup tables, must hold db_writer.mutex
+static void
+_db_writer_unindex(DbWrite* write)
+{
+    if (write->op != DB_WRITE_MESSAGE) {
+        return;
+    }
+    if (write->archive_id && g_hash_table_lookup(db_writer.archive_ids, write->archive_id) == write) {
+        g_hash_table_remove(db_writer.archive_ids, write->archive_id);
+    }
+    if (write->stanza_id && g_hash_table_lookup(db_writer.stanza_ids, write->stanza_id) == write) {
+        g_hash_table_remove(db_writer.stanza_ids, write->stanza_id);
+    }
+}
+
+static void*
+_db_writer_thread(void* userdata)
+{
+    GPtrArray* batch = g_ptr_array_sized_new(DB_WRITE_BATCH_SIZE);
+
+    pthread_mutex_lock(&db_writer.mutex);
+    while (TRUE) {
+        while (g_queue_is_empty(db_writer.queue) && !db_writer.stop) {
+            pthread_cond_wait(&db_writer.queued, &db_writer.mutex);
+        }
+        if (g_queue_is_empty(db_writer.queue)) {
+            break;
+        }
+
+        // only the writer removes from the queue, new writes are appended behind the batch
+        for (GList* curr = db_writer.queue->head; curr && batch->len < DB_WRITE_BATCH_SIZE; curr = g_list_next(curr)) {
+            g_ptr_array_add(batch, curr->data);
+        }
+        pthread_mutex_unlock(&db_writer.mutex);
+
+        _db_writer_commit(batch);
+
+        pthread_mutex_lock(&db_writer.mutex);
+        for (guint i = 0; i < batch->len; i++) {
+            DbWrite* write = g_queue_pop_head(db_writer.queue);
+            _db_writer_unindex(write);
+            _db_write_free(write);
+        }
+        g_ptr_array_set_size(batch, 0);
+        if (g_queue_is_empty(db_writer.queue)) {
+            pthread_cond_broadcast(&db_writer.drained);
+        }
+    }
+    pthread_cond_broadcast(&db_writer.drained);
+    pthread_mutex_unlock(&db_writer.mutex);
+
+    g_ptr_array_free(batch, TRUE);
+    return NULL;
+}
+
+static gboolean
+_db_writer_start(const char* const filename)
+{
+    if (sqlite3_open(filename, &db_writer.db) != SQLITE_OK) {
+        log_error("Error opening SQLite database for writing: %s", sqlite3_errmsg(db_writer.db));
+        sqlite3_close(db_writer.db);
+        db_writer.db = NULL;
+        return FALSE;
+    }
+    sqlite3_busy_timeout(db_writer.db, 5000);
+
+    log_database_update_synchronous();
+    db_writer.applied_synchronous = -1;
+    db_writer.queue = g_queue_new();
+    db_writer.archive_ids = g_hash_table_new(g_str_hash, g_str_equal);
+    db_writer.stanza_ids = g_hash_table_new(g_str_hash, g_str_equal);
+    db_writer.stop = FALSE;
+
+    if (pthread_create(&db_writer.thread, NULL, _db_writer_thread, NULL) != 0) {
+        log_error("Unable to start database writer thread.");
+        _db_writer_stop();
+        return FALSE;
+    }
+    db_writer.running = TRUE;
+
+    return TRUE;
+}
+
+// Flush the queue and stop the writer thread
+static void
+_db_writer_stop(void)
+{
+    if (!db_writer.queue) {
+        return;
+    }
+
+    if (db_writer.running) {
+        pthread_mutex_lock(&db_writer.mutex);
+        db_writer.stop = TRUE;
+        pthread_cond_signal(&db_writer.queued);
+        pthread_mutex_unlock(&db_writer.mutex);
+        pthread_join(db_writer.thread, NULL);
+        db_writer.running = FALSE;
+    }
+
+    g_queue_free_full(db_writer.queue, (GDestroyNotify)_db_write_free);
+    db_writer.queue = NULL;
+    g_hash_table_destroy(db_writer.archive_ids);
+    g_hash_table_destroy(db_writer.stanza_ids);
+    db_writer.archive_ids = NULL;
+    db_writer.stanza_ids = NULL;
+
+    _db_finalize_cached(&db_writer.insert_stmt);
+    _db_finalize_cached(&db_writer.lmc_stmt);
+    _db_finalize_cached(&db_writer.archive_id_stmt);
+    sqlite3_close(db_writer.db);
+    db_writer.db = NULL;
+}
+
+// Returns FALSE if the write was dropped because the writer isn't running
+static gboolean
+_db_writer_enqueue(DbWrite* write)
+{
+    if (!db_writer.running) {
+        _db_write_free(write);
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&db_writer.mutex);
+    g_queue_push_tail(db_writer.queue, write);
+    if (write->op == DB_WRITE_MESSAGE) {
+        if (write->archive_id) {
+            g_hash_table_insert(db_writer.archive_ids, write->archive_id, write);
+        }
+        if (write->stanza_id) {
+            g_hash_table_insert(db_writer.stanza_ids, write->stanza_id, write);
+        }
+    }
+    pthread_cond_signal(&db_writer.queued);
+    pthread_mutex_unlock(&db_writer.mutex);
+
+    return TRUE;
+}
+
+static gboolean
+_db_writer_is_pending_archive_id(const char* const archive_id)
+{
+    if (!db_writer.running) {
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&db_writer.mutex);
+    gboolean pending = g_hash_table_contains(db_writer.archive_ids, archive_id);
+    pthread_mutex_unlock(&db_writer.mutex);
+
+    return pending;
+}
+
+// Latest queued insert with the stanza id exchanged between jid_a and jid_b (in either direction).
+// Fields of the returned write may only be read while holding db_writer.mutex, which the caller must lock.
+static DbWrite*
+_db_writer_find_pending(const char* const stanza_id, const char* const type, const char* const jid_a, const char* const jid_b)
+{
+    if (!db_writer.stanza_ids) {
+        return NULL;
+    }
+
+    DbWrite* write = g_hash_table_lookup(db_writer.stanza_ids, stanza_id);
+    if (!write || g_strcmp0(write->type, type) != 0) {
+        return NULL;
+    }
+    if ((g_strcmp0(write->from_jid, jid_a) == 0 && g_strcmp0(write->to_jid, jid_b) == 0)
+        || (g_strcmp0(write->from_jid, jid_b) == 0 && g_strcmp0(write->to_jid, jid_a) == 0)) {
+        return write;
+    }
+    return NULL;
+}
+
+static DbWrite*
+_db_write_copy(DbWrite* write)
+{
+    DbWrite* copy = g_new0(DbWrite, 1);
+    copy->op = write->op;
+    copy->from_jid = g_strdup(write->from_jid);
+    copy->from_resource = g_strdup(write->from_resource);
+    copy->to_jid = g_strdup(write->to_jid);
+    copy->to_resource = g_strdup(write->to_resource);
+    copy->message = g_strdup(write->message);
+    copy->timestamp = g_strdup(write->timestamp);
+    copy->stanza_id = g_strdup(write->stanza_id);
+    copy->archive_id = g_strdup(write->archive_id);
+    copy->replace_id = g_strdup(write->replace_id);
+    copy->type = write->type;
+    copy->enc = write->enc;
+    copy->rowid = write->rowid;
+    return copy;
+}
+
+// Reads don't wait for the writer. They run in a read transaction on g_chatlog_database and get
+// copies of the queued inserts it doesn't see yet. The queue is locked while the transaction
+// starts: a committed write still in the queue has a row id at most the highest one the
+// transaction sees, and the writer can't drop a write committed after that from the queue.
+static GPtrArray*
+_db_read_begin(void)
+{
+    GPtrArray* pending = g_ptr_array_new_with_free_func((GDestroyNotify)_db_write_free);
+
+    if (db_writer.running) {
+        pthread_mutex_lock(&db_writer.mutex);
+    }
+
+    sqlite_int64 max_id = 0;
+    sqlite3_exec(g_chatlog_database, "BEGIN", NULL, 0, NULL);
+    sqlite3_stmt* stmt = _db_prepare_cached(g_chatlog_database, &g_max_id_stmt, "SELECT MAX(`id`) FROM `ChatLogs`");
+    if (stmt) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            max_id = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_reset(stmt);
+    } else {
+        log_error("SQLite error in _db_read_begin(): %s", sqlite3_errmsg(g_chatlog_database));
+    }
+
+    if (db_writer.running) {
+        for (GList* curr = db_writer.queue->head; curr; curr = g_list_next(curr)) {
+            DbWrite* write = curr->data;
+            if (write->op == DB_WRITE_MESSAGE && (write->rowid == 0 || write->rowid > max_id)) {
+                g_ptr_array_add(pending, _db_write_copy(write));
+            }
+        }
+        pthread_mutex_unlock(&db_writer.mutex);
+    }
+
+    return pending;
+}
+
+static void
+_db_read_end(GPtrArray* pending)
+{
+    sqlite3_exec(g_chatlog_database, "END", NULL, 0, NULL);
+    g_ptr_array_free(pending, TRUE);
+}
+
+static gboolean
+_db_write_in_conversation(DbWrite* write, const char* const type, const char* const jid, const char* const myjid)
+{
+    return g_strcmp0(write->type, type) == 0
+           && ((g_strcmp0(write->from_jid, jid) == 0 && g_strcmp0(write->to_jid, myjid) == 0)
+               || (g_strcmp0(write->from_jid, myjid) == 0 && g_strcmp0(write->to_jid, jid) == 0));
+}
+
+static ProfMessage*
+_db_write_to_message(DbWrite* write)
+{
+    ProfMessage* msg = message_init();
+    msg->id = _db_strdup(write->stanza_id);
+    msg->from_jid = jid_create_from_bare_and_resource(write->from_jid, write->from_resource);
+    msg->to_jid = jid_create_from_bare_and_resource(write->to_jid, write->to_resource);
+    msg->plain = strdup(write->message ?: "");
+    msg->timestamp = g_date_time_new_from_iso8601(write->timestamp, NULL);
+    msg->type = _get_message_type_type(write->type);
+    msg->enc = _get_message_enc_type(write->enc);
+    return msg;
+}
+
+// Apply the /logging sync preference to the writer connection with its next batch
+void
+log_database_update_synchronous(void)
+{
+    auto_gchar gchar* sync_pref = prefs_get_string(PREF_DBLOG_SYNC);
+    gint synchronous = 1;
+    if (g_strcmp0(sync_pref, "off") == 0) {
+        synchronous = 0;
+    } else if (g_strcmp0(sync_pref, "full") == 0) {
+        synchronous = 2;
+    }
+    g_atomic_int_set(&db_writer.synchronous, synchronous);
+}
+
 gboolean
 log_database_init(ProfAccount* account)
 {
@@ -84,10 +674,32 @@ log_database_init(ProfAccount* account)
         return FALSE;
     }
 
+    // WAL lets the writer thread commit while this connection reads
+    sqlite3_busy_timeout(g_chatlog_database, 5000);
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, "PRAGMA journal_mode = WAL", NULL, 0, NULL)) {
+        log_warning("Unable to switch SQLite database to WAL mode: %s", sqlite3_errmsg(g_chatlog_database));
+    }
+
     char* err_msg;
 
+    // without FTS5 in the SQLite library the database stays at version 3, without the search index
+    int target_version = _db_fts5_available() ? latest_version : 3;
+
     int db_version = _get_db_version();
-    if (db_version == latest_version) {
+    if (db_version > target_version) {
+        log_warning("SQLite library lacks FTS5, dropping the full-text search index of the database.");
+        if (!_downgrade_to_v3()) {
+            cons_show_error("Database Initialization Error: Unable to drop the full-text search index. Please, check error logs for details.");
+            log_database_close();
+            return FALSE;
+        }
+        db_version = _get_db_version();
+    }
+    if (db_version == target_version) {
+        if (!_db_writer_start(filename)) {
+            log_database_close();
+            return FALSE;
+        }
         return TRUE;
     }
 
@@ -159,8 +771,17 @@ log_database_init(ProfAccount* account)
         goto out;
     }
 
+    if (db_version == -1 && target_version >= 4) {
+        for (size_t i = 0; i < ARRAY_SIZE(fts_statements); i++) {
+            if (SQLITE_OK != sqlite3_exec(g_chatlog_database, fts_statements[i], NULL, 0, &err_msg)) {
+                log_error("Unable to create full-text search index.");
+                goto out;
+            }
+        }
+    }
+
     if (db_version == -1) {
-        query = sqlite3_mprintf("INSERT INTO `DbVersion` (`version`) VALUES (%d) ON CONFLICT(`version`) DO NOTHING", latest_version);
+        query = sqlite3_mprintf("INSERT INTO `DbVersion` (`version`) VALUES (%d) ON CONFLICT(`version`) DO NOTHING", target_version);
         if (SQLITE_OK != sqlite3_exec(g_chatlog_database, query, NULL, 0, &err_msg)) {
             sqlite3_free(query);
             goto out;
@@ -175,7 +796,7 @@ log_database_init(ProfAccount* account)
         goto out;
     }
 
-    if (db_version < latest_version) {
+    if (db_version < target_version) {
         cons_show("Migrating database schema. This operation may take a while...");
         if (db_version < 2 && (!_check_available_space_for_db_migration(filename) || !_migrate_to_v2())) {
             cons_show_error("Database Initialization Error: Unable to migrate database to version 2. Please, check error logs for details.");
@@ -185,9 +806,18 @@ log_database_init(ProfAccount* account)
             cons_show_error("Database Initialization Error: Unable to migrate database to version 3. Please, check error logs for details.");
             goto out;
         }
+        if (db_version < 4 && target_version >= 4 && (!_check_available_space_for_db_migration(filename) || !_migrate_to_v4())) {
+            cons_show_error("Database Initialization Error: Unable to migrate database to version 4. Please, check error logs for details.");
+            goto out;
+        }
         cons_show("Database schema migration was successful.");
     }
 
+    if (!_db_writer_start(filename)) {
+        log_database_close();
+        return FALSE;
+    }
+
     log_debug("Initialized SQLite database: %s", filename);
     return TRUE;
 
@@ -205,7 +835,13 @@ out:
 void
 log_database_close(void)
 {
+    _db_writer_stop();
+
     if (g_chatlog_database) {
+        _db_finalize_cached(&g_archive_id_exists_stmt);
+        _db_finalize_cached(&g_archive_id_missing_stmt);
+        _db_finalize_cached(&g_max_id_stmt);
+        _db_finalize_cached(&g_lmc_original_stmt);
         sqlite3_close(g_chatlog_database);
         sqlite3_shutdown();
         g_chatlog_database = NULL;
@@ -279,26 +915,48 @@ _db_get_limits_info(prof_msg_type_t type, const char* const jid, gboolean is_las
         return NULL;
     }
 
+    GPtrArray* pending = _db_read_begin();
     int rc = sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("Unknown SQLite error in _db_get_limits_info().");
+        _db_read_end(pending);
         return NULL;
     }
 
-    ProfMessage* msg = message_init();
-
+    auto_gchar gchar* archive_id = NULL;
+    auto_gchar gchar* date = NULL;
+    gboolean found = FALSE;
     if (sqlite3_step(stmt) == SQLITE_ROW) {
-        char* archive_id = (char*)sqlite3_column_text(stmt, 0);
-        char* date = (char*)sqlite3_column_text(stmt, 1);
-
-        msg->stanzaid = _db_strdup(archive_id);
-        msg->timestamp = g_date_time_new_from_iso8601(date, NULL);
-    } else {
-        message_free(msg);
-        msg = NULL;
+        archive_id = g_strdup((char*)sqlite3_column_text(stmt, 0));
+        date = g_strdup((char*)sqlite3_column_text(stmt, 1));
+        found = TRUE;
     }
     sqlite3_finalize(stmt);
 
+    for (guint i = 0; i < pending->len; i++) {
+        DbWrite* write = g_ptr_array_index(pending, i);
+        if (!_db_write_in_conversation(write, type_str, jid, myjid->barejid)) {
+            continue;
+        }
+        int cmp = g_strcmp0(write->timestamp, date);
+        if (!found || (is_last ? cmp > 0 : cmp < 0)) {
+            g_free(archive_id);
+            g_free(date);
+            archive_id = g_strdup(write->archive_id);
+            date = g_strdup(write->timestamp);
+            found = TRUE;
+        }
+    }
+    _db_read_end(pending);
+
+    if (!found) {
+        return NULL;
+    }
+
+    ProfMessage* msg = message_init();
+    msg->stanzaid = _db_strdup(archive_id);
+    msg->timestamp = g_date_time_new_from_iso8601(date, NULL);
+
     return msg;
 }
 
@@ -347,6 +1005,69 @@ _db_parse_history_messages(sqlite3_stmt* stmt)
     return history;
 }
 
+static gint
+_db_compare_timestamps(gconstpointer a, gconstpointer b)
+{
+    const ProfMessage* msg_a = a;
+    const ProfMessage* msg_b = b;
+    if (!msg_a->timestamp || !msg_b->timestamp) {
+        return (msg_a->timestamp != NULL) - (msg_b->timestamp != NULL);
+    }
+    return g_date_time_compare(msg_a->timestamp, msg_b->timestamp);
+}
+
+// Add the queued messages of a conversation to a page of history read from the database and
+// apply queued corrections, the same way the history queries do it.
+static GSList*
+_db_merge_pending_history(GSList* history, GPtrArray* pending, const char* const type, const char* const jid, const char* const myjid,
+                          const char* start_time, const char* end_time, gboolean from_start, gboolean flip)
+{
+    gboolean added = FALSE;
+    for (guint i = 0; i < pending->len; i++) {
+        DbWrite* write = g_ptr_array_index(pending, i);
+        if (write->replace_id || !_db_write_in_conversation(write, type, jid, myjid)) {
+            continue;
+        }
+        if (g_strcmp0(write->timestamp, end_time) >= 0 || (start_time && g_strcmp0(write->timestamp, start_time) <= 0)) {
+            continue;
+        }
+        history = g_slist_prepend(history, _db_write_to_message(write));
+        added = TRUE;
+    }
+
+    if (added) {
+        history = g_slist_sort(history, _db_compare_timestamps);
+        guint excess = MAX((gint)g_slist_length(history) - MESSAGES_TO_RETRIEVE, 0);
+        if (!from_start) {
+            history = g_slist_reverse(history);
+        }
+        for (; excess > 0; excess--) {
+            GSList* last = g_slist_last(history);
+            message_free(last->data);
+            history = g_slist_delete_link(history, last);
+        }
+        if (from_start == flip) {
+            history = g_slist_reverse(history);
+        }
+    }
+
+    for (guint i = 0; i < pending->len; i++) {
+        DbWrite* write = g_ptr_array_index(pending, i);
+        if (!write->replace_id || !_db_write_in_conversation(write, type, jid, myjid)) {
+            continue;
+        }
+        for (GSList* curr = history; curr; curr = g_slist_next(curr)) {
+            ProfMessage* msg = curr->data;
+            if (g_strcmp0(msg->id, write->replace_id) == 0 && g_strcmp0(msg->from_jid->barejid, write->from_jid) == 0) {
+                free(msg->plain);
+                msg->plain = strdup(write->message ?: "");
+            }
+        }
+    }
+
+    return history;
+}
+
 // Query previous chats, constraints start_time and end_time. If end_time is
 // null the current time is used. from_start gets first few messages if true
 // otherwise the last ones. Flip flips the order of the results
@@ -380,14 +1101,18 @@ log_database_get_previous_chat(const gchar* const contact_barejid, const char* s
         return NULL;
     }
 
+    GPtrArray* pending = _db_read_begin();
     int rc = sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("SQLite error in log_database_get_previous_chat(): %s", sqlite3_errmsg(g_chatlog_database));
+        _db_read_end(pending);
         return NULL;
     }
 
     GSList* history = _db_parse_history_messages(stmt);
     sqlite3_finalize(stmt);
+    history = _db_merge_pending_history(history, pending, "chat", contact_barejid, myjid->barejid, start_time, end_date_fmt, from_start, flip);
+    _db_read_end(pending);
 
     return history;
 }
@@ -425,21 +1150,221 @@ log_database_get_previous_muc(const gchar* const room_jid, const char* start_tim
         return NULL;
     }
 
+    GPtrArray* pending = _db_read_begin();
     int rc = sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("SQLite error in log_database_get_previous_muc(): %s", sqlite3_errmsg(g_chatlog_database));
+        _db_read_end(pending);
         return NULL;
     }
 
     GSList* history = _db_parse_history_messages(stmt);
     sqlite3_finalize(stmt);
+    history = _db_merge_pending_history(history, pending, "muc", room_jid, myjid->barejid, start_time, end_date_fmt, from_start, flip);
+    _db_read_end(pending);
 
     return history;
 }
 
+// Turn user input into an FTS5 query, every word is matched as a quoted string.
+// A trailing '*' keeps working as a prefix search.
+static gchar*
+_db_fts_query(const char* const text)
+{
+    GString* query = g_string_new(NULL);
+    auto_gcharv gchar** words = g_strsplit_set(text, " \t", -1);
+
+    for (int i = 0; words[i]; i++) {
+        gchar* word = words[i];
+        size_t len = strlen(word);
+        gboolean prefix = len > 1 && word[len - 1] == '*';
+        if (prefix) {
+            word[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+
+        if (query->len > 0) {
+            g_string_append_c(query, ' ');
+        }
+        g_string_append_c(query, '"');
+        for (const char* c = word; *c; c++) {
+            if (*c == '"') {
+                g_string_append_c(query, '"');
+            }
+            g_string_append_c(query, *c);
+        }
+        g_string_append_c(query, '"');
+        if (prefix) {
+            g_string_append_c(query, '*');
+        }
+    }
+
+    return g_string_free(query, query->len == 0);
+}
+
+// Whether every word of a search is in message, for queued messages that aren't indexed yet
+static gboolean
+_db_text_matches(const char* const message, const char* const text)
+{
+    if (!message) {
+        return FALSE;
+    }
+
+    auto_gchar gchar* haystack = g_utf8_casefold(message, -1);
+    auto_gcharv gchar** words = g_strsplit_set(text, " \t", -1);
+    for (int i = 0; words[i]; i++) {
+        gchar* word = words[i];
+        size_t len = strlen(word);
+        if (len > 1 && word[len - 1] == '*') {
+            word[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+        auto_gchar gchar* needle = g_utf8_casefold(word, -1);
+        if (!strstr(haystack, needle)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+// LIKE patterns for every word of a search, used when the database has no full-text index
+static GPtrArray*
+_db_like_patterns(const char* const text)
+{
+    GPtrArray* patterns = g_ptr_array_new_with_free_func(g_free);
+    auto_gcharv gchar** words = g_strsplit_set(text, " \t", -1);
+
+    for (int i = 0; words[i]; i++) {
+        gchar* word = words[i];
+        size_t len = strlen(word);
+        if (len > 1 && word[len - 1] == '*') {
+            word[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+
+        GString* pattern = g_string_new("%");
+        for (const char* c = word; *c; c++) {
+            if (*c == '%' || *c == '_' || *c == '\\') {
+                g_string_append_c(pattern, '\\');
+            }
+            g_string_append_c(pattern, *c);
+        }
+        g_string_append_c(pattern, '%');
+        g_ptr_array_add(patterns, g_string_free(pattern, FALSE));
+    }
+
+    return patterns;
+}
+
+// Full-text search over logged messages, best matches first. jid limits the search to a
+// contact or room, since to messages at or after that ISO8601 timestamp, both may be NULL.
+// The plain text of each returned message is a snippet around the match. Without the
+// full-text index every word is matched with LIKE instead, newest messages first.
+GSList*
+log_database_search(const char* const text, const char* const jid, const char* const since, int offset, int limit)
+{
+    if (!g_chatlog_database) {
+        return NULL;
+    }
+
+    auto_gchar gchar* match = _db_fts_query(text);
+    if (!match) {
+        return NULL;
+    }
+
+    gboolean indexed = _get_db_version() >= 4;
+    GPtrArray* patterns = indexed ? g_ptr_array_new() : _db_like_patterns(text);
+    GString* query = g_string_new(NULL);
+    if (indexed) {
+        g_string_append(query, "SELECT snippet(`ChatLogs_fts`, 0, '[', ']', '...', 16), "
+                               "A.`timestamp`, A.`from_jid`, A.`from_resource`, A.`to_jid`, A.`to_resource`, A.`type`, A.`encryption`, A.`stanza_id` "
+                               "FROM `ChatLogs_fts` JOIN `ChatLogs` AS A ON A.`id` = `ChatLogs_fts`.`rowid` "
+                               "WHERE `ChatLogs_fts` MATCH ?1 ");
+    } else {
+        g_string_append(query, "SELECT A.`message`, "
+                               "A.`timestamp`, A.`from_jid`, A.`from_resource`, A.`to_jid`, A.`to_resource`, A.`type`, A.`encryption`, A.`stanza_id` "
+                               "FROM `ChatLogs` AS A "
+                               "WHERE A.`message` IS NOT NULL ");
+        for (guint i = 0; i < patterns->len; i++) {
+            g_string_append_printf(query, "AND A.`message` LIKE ?%u ESCAPE '\\' ", i + 6);
+        }
+    }
+    g_string_append(query, "AND (?2 IS NULL OR A.`from_jid` = ?2 OR A.`to_jid` = ?2) "
+                           "AND (?3 IS NULL OR A.`timestamp` >= ?3) ");
+    g_string_append(query, indexed ? "ORDER BY rank LIMIT ?4 OFFSET ?5" : "ORDER BY A.`timestamp` DESC LIMIT ?4 OFFSET ?5");
+
+    GPtrArray* pending = _db_read_begin();
+
+    // Queued messages aren't in the index yet, they are the newest so they come first
+    GSList* results = NULL;
+    int pending_matches = 0;
+    for (guint i = 0; i < pending->len; i++) {
+        DbWrite* write = g_ptr_array_index(pending, i);
+        if (write->replace_id || (jid && g_strcmp0(write->from_jid, jid) != 0 && g_strcmp0(write->to_jid, jid) != 0)
+            || (since && g_strcmp0(write->timestamp, since) < 0) || !_db_text_matches(write->message, text)) {
+            continue;
+        }
+        if (pending_matches >= offset && pending_matches < offset + limit) {
+            results = g_slist_prepend(results, _db_write_to_message(write));
+        }
+        pending_matches++;
+    }
+    results = g_slist_reverse(results);
+
+    int db_limit = limit - (int)g_slist_length(results);
+    int db_offset = MAX(offset - pending_matches, 0);
+
+    sqlite3_stmt* stmt = NULL;
+    int rc = sqlite3_prepare_v2(g_chatlog_database, query->str, -1, &stmt, NULL);
+    g_string_free(query, TRUE);
+    if (rc != SQLITE_OK) {
+        log_error("SQLite error in log_database_search(): %s", sqlite3_errmsg(g_chatlog_database));
+        _db_read_end(pending);
+        g_ptr_array_free(patterns, TRUE);
+        g_slist_free_full(results, (GDestroyNotify)message_free);
+        return NULL;
+    }
+
+    if (indexed) {
+        _db_bind_text(stmt, 1, match);
+    }
+    _db_bind_text(stmt, 2, jid);
+    _db_bind_text(stmt, 3, since);
+    sqlite3_bind_int(stmt, 4, db_limit);
+    sqlite3_bind_int(stmt, 5, db_offset);
+    for (guint i = 0; i < patterns->len; i++) {
+        _db_bind_text(stmt, i + 6, g_ptr_array_index(patterns, i));
+    }
+    g_ptr_array_free(patterns, TRUE);
+
+    results = g_slist_concat(results, _db_parse_history_messages(stmt));
+    sqlite3_finalize(stmt);
+    _db_read_end(pending);
+
+    return results;
+}
+
+gboolean
+log_database_search_available(void)
+{
+    return g_chatlog_database != NULL;
+}
+
+// Counts rows with query, plus the queued messages of type with jid in the time range. With
+// myjid the messages must be between jid and myjid, otherwise jid may be either side.
 static int
-_db_get_int_result(const char* query)
+_db_get_count(const char* query, const char* const type, const char* const jid, const char* const myjid,
+              const char* start_time, const char* end_time)
 {
+    GPtrArray* pending = _db_read_begin();
+
     sqlite3_stmt* stmt = NULL;
     int count = 0;
     int rc = sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL);
@@ -449,6 +1374,17 @@ _db_get_int_result(const char* query)
         }
     }
     sqlite3_finalize(stmt);
+
+    for (guint i = 0; i < pending->len; i++) {
+        DbWrite* write = g_ptr_array_index(pending, i);
+        gboolean in_conversation = myjid ? _db_write_in_conversation(write, type, jid, myjid)
+                                         : g_strcmp0(write->type, type) == 0 && (g_strcmp0(write->from_jid, jid) == 0 || g_strcmp0(write->to_jid, jid) == 0);
+        if (in_conversation && g_strcmp0(write->timestamp, start_time) >= 0 && g_strcmp0(write->timestamp, end_time) <= 0) {
+            count++;
+        }
+    }
+    _db_read_end(pending);
+
     return count;
 }
 
@@ -466,7 +1402,7 @@ log_database_get_chat_count(const gchar* const contact_barejid, const char* star
                                               "AND `timestamp` >= %Q AND `timestamp` <= %Q;",
                                               contact_barejid, myjid->barejid, myjid->barejid, contact_barejid, start_time, end_time);
 
-    return _db_get_int_result(query);
+    return _db_get_count(query, "chat", contact_barejid, myjid->barejid, start_time, end_time);
 }
 
 int
@@ -482,7 +1418,7 @@ log_database_get_muc_count(const gchar* const room_jid, const char* start_time,
                                               "AND `timestamp` >= %Q AND `timestamp` <= %Q;",
                                               room_jid, room_jid, start_time, end_time);
 
-    return _db_get_int_result(query);
+    return _db_get_count(query, "muc", room_jid, NULL, start_time, end_time);
 }
 
 static const char*
@@ -550,11 +1486,59 @@ _get_message_enc_type(const char* const encstr)
     return PROF_MSG_ENC_NONE;
 }
 
+// Check a correction against the message it corrects (XEP-0308), which may still be queued.
+// The writer links the two once it inserts the correction.
+static gboolean
+_db_check_lmc(ProfMessage* message, const Jid* const from_jid)
+{
+    auto_gchar gchar* from_jid_orig = NULL;
+    gboolean found = FALSE;
+
+    if (db_writer.running) {
+        pthread_mutex_lock(&db_writer.mutex);
+        DbWrite* original = g_hash_table_lookup(db_writer.stanza_ids, message->replace_id);
+        if (original) {
+            from_jid_orig = g_strdup(original->from_jid);
+            found = TRUE;
+        }
+        pthread_mutex_unlock(&db_writer.mutex);
+    }
+
+    if (!found) {
+        sqlite3_stmt* stmt = _db_prepare_cached(g_chatlog_database, &g_lmc_original_stmt,
+                                                "SELECT `from_jid` FROM `ChatLogs` WHERE `stanza_id` = ? ORDER BY `timestamp` DESC LIMIT 1");
+        if (!stmt) {
+            log_error("SQLite error in _add_to_db() on selecting original message: %s", sqlite3_errmsg(g_chatlog_database));
+            return FALSE;
+        }
+        _db_bind_text(stmt, 1, message->replace_id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            from_jid_orig = g_strdup((const char*)sqlite3_column_text(stmt, 0));
+            found = TRUE;
+        }
+        sqlite3_reset(stmt);
+    }
+
+    if (!found) {
+        log_warning("Got LMC message that does not have original message counterpart in the database from %s", from_jid->fulljid);
+        return TRUE;
+    }
+
+    if (g_strcmp0(from_jid_orig, from_jid->barejid) != 0) {
+        log_error("Mismatch in sender JIDs when trying to do LMC. Corrected message sender: %s. Original message sender: %s. Replace-ID: %s. Message: %s", from_jid->barejid, from_jid_orig, message->replace_id, message->plain);
+        cons_show_error("%s sent a message correction with mismatched sender. See log for details.", from_jid->barejid);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// Returns TRUE if the message is new and got queued. Duplicates and invalid corrections are
+// rejected here, before queueing. The writer logs when the insert itself fails.
 static gboolean
 _add_to_db(ProfMessage* message, char* type, const Jid* const from_jid, const Jid* const to_jid)
 {
-    auto_gchar gchar* pref_dblog = prefs_get_string(PREF_DBLOG);
-    sqlite_int64 original_message_id = -1;
+    const gchar* pref_dblog = prefs_peek_string(PREF_DBLOG);
 
     if (g_strcmp0(pref_dblog, "off") == 0) {
         return TRUE;
@@ -570,102 +1554,57 @@ _add_to_db(ProfMessage* message, char* type, const Jid* const from_jid, const Ji
         return TRUE;
     }
 
-    auto_gchar gchar* date_fmt = prof_date_time_format_iso8601(message->timestamp);
-    const char* enc = _get_message_enc_str(message->enc);
-
-    if (!type) {
-        type = (char*)_get_message_type_str(message->type);
-    }
-
-    // Apply LMC and check its validity (XEP-0308)
-    if (message->replace_id) {
-        auto_sqlite char* replace_check_query = sqlite3_mprintf("SELECT `id`, `from_jid`, `replaces_db_id` FROM `ChatLogs` WHERE `stanza_id` = %Q ORDER BY `timestamp` DESC LIMIT 1",
-                                                                message->replace_id);
-
-        if (!replace_check_query) {
-            log_error("Could not allocate memory for SQL replace query in log_database_add()");
+    // Messages with an archive_id we already have are not written again.
+    // Check the queue first, a write leaves it only after it is committed.
+    if (message->stanzaid) {
+        if (_db_writer_is_pending_archive_id(message->stanzaid)) {
+            log_debug("Message already queued for the database (archive_id: %s), skipping.", message->stanzaid);
             return FALSE;
         }
 
-        sqlite3_stmt* lmc_stmt = NULL;
-
-        if (SQLITE_OK != sqlite3_prepare_v2(g_chatlog_database, replace_check_query, -1, &lmc_stmt, NULL)) {
-            log_error("SQLite error in _add_to_db() on selecting original message: %s", sqlite3_errmsg(g_chatlog_database));
+        sqlite3_stmt* stmt = _db_prepare_cached(g_chatlog_database, &g_archive_id_exists_stmt,
+                                                "SELECT 1 FROM `ChatLogs` WHERE `archive_id` = ?");
+        if (!stmt) {
+            log_error("SQLite error in _add_to_db() (prepare): %s", sqlite3_errmsg(g_chatlog_database));
             return FALSE;
         }
-
-        if (sqlite3_step(lmc_stmt) == SQLITE_ROW) {
-            original_message_id = sqlite3_column_int64(lmc_stmt, 0);
-            const char* from_jid_orig = (const char*)sqlite3_column_text(lmc_stmt, 1);
-
-            // Handle non-XEP-compliant replacement messages (edit->edit->original)
-            sqlite_int64 tmp = sqlite3_column_int64(lmc_stmt, 2);
-            original_message_id = tmp ? tmp : original_message_id;
-
-            if (g_strcmp0(from_jid_orig, from_jid->barejid) != 0) {
-                log_error("Mismatch in sender JIDs when trying to do LMC. Corrected message sender: %s. Original message sender: %s. Replace-ID: %s. Message: %s", from_jid->barejid, from_jid_orig, message->replace_id, message->plain);
-                cons_show_error("%s sent a message correction with mismatched sender. See log for details.", from_jid->barejid);
-                sqlite3_finalize(lmc_stmt);
-                return FALSE;
-            }
-        } else {
-            log_warning("Got LMC message that does not have original message counterpart in the database from %s", message->from_jid->fulljid);
+        _db_bind_text(stmt, 1, message->stanzaid);
+        gboolean exists = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_reset(stmt);
+        if (exists) {
+            log_debug("Message already exists in database (archive_id: %s), skipping.", message->stanzaid);
+            return FALSE;
         }
-        sqlite3_finalize(lmc_stmt);
     }
 
-    // stanza-id (XEP-0359) doesn't have to be present in the message.
-    // We use archive_id UNIQUE constraint and ON CONFLICT DO NOTHING for deduplication.
-
-    auto_sqlite char* orig_message_id = original_message_id == -1 ? NULL : sqlite3_mprintf("%d", original_message_id);
-
-    auto_sqlite char* query = sqlite3_mprintf("INSERT INTO `ChatLogs` "
-                                              "(`from_jid`, `from_resource`, `to_jid`, `to_resource`, "
-                                              "`message`, `timestamp`, `stanza_id`, `archive_id`, "
-                                              "`replaces_db_id`, `replace_id`, `type`, `encryption`) "
-                                              "VALUES (%Q, %Q, %Q, %Q, %Q, %Q, %Q, %Q, %Q, %Q, %Q, %Q) "
-                                              "ON CONFLICT(`archive_id`) DO NOTHING "
-                                              "RETURNING id",
-                                              from_jid->barejid,
-                                              from_jid->resourcepart,
-                                              to_jid->barejid,
-                                              to_jid->resourcepart,
-                                              message->plain,
-                                              date_fmt,
-                                              message->id,
-                                              message->stanzaid,
-                                              orig_message_id,
-                                              message->replace_id,
-                                              type,
-                                              enc);
-    if (!query) {
-        log_error("Could not allocate memory for SQL insert query in log_database_add()");
+    if (message->replace_id && !_db_check_lmc(message, from_jid)) {
         return FALSE;
     }
 
-    log_debug("Writing to DB. Query: %s", query);
-
-    sqlite3_stmt* stmt = NULL;
-    int rc = sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        log_error("SQLite error in _add_to_db() (prepare): %s", sqlite3_errmsg(g_chatlog_database));
-        return FALSE;
+    if (!type) {
+        type = (char*)_get_message_type_str(message->type);
     }
 
-    gboolean is_new = TRUE;
-    rc = sqlite3_step(stmt);
-    if (rc == SQLITE_ROW) {
-        log_debug("Successfully inserted message into database.");
-    } else if (rc == SQLITE_DONE) {
-        log_debug("Message already exists in database (archive_id: %s), skipping.", message->stanzaid);
-        is_new = FALSE;
-    } else {
-        log_error("SQLite error in _add_to_db() (step): %s", sqlite3_errmsg(g_chatlog_database));
-        is_new = FALSE;
+    DbWrite* write = g_new0(DbWrite, 1);
+    write->op = DB_WRITE_MESSAGE;
+    write->from_jid = g_strdup(from_jid->barejid);
+    write->from_resource = g_strdup(from_jid->resourcepart);
+    write->to_jid = g_strdup(to_jid->barejid);
+    write->to_resource = g_strdup(to_jid->resourcepart);
+    write->message = g_strdup(message->plain);
+    write->timestamp = prof_date_time_format_iso8601(message->timestamp);
+    write->stanza_id = g_strdup(message->id);
+    write->archive_id = g_strdup(message->stanzaid);
+    write->replace_id = g_strdup(message->replace_id);
+    write->type = type;
+    write->enc = _get_message_enc_str(message->enc);
+
+    if (!_db_writer_enqueue(write)) {
+        log_error("Database writer is not running, message not logged.");
+        return FALSE;
     }
 
-    sqlite3_finalize(stmt);
-    return is_new;
+    return TRUE;
 }
 
 static int
@@ -849,6 +1788,109 @@ cleanup:
     return FALSE;
 }
 
+// FTS5 may also come from a loaded extension rather than the SQLite build, so probe for the module
+static gboolean
+_db_fts5_available(void)
+{
+    if (sqlite3_compileoption_used("ENABLE_FTS5") == 1) {
+        return TRUE;
+    }
+
+    const char* probe = "CREATE VIRTUAL TABLE temp.`fts5_probe` USING fts5(`x`); DROP TABLE temp.`fts5_probe`;";
+    return sqlite3_exec(g_chatlog_database, probe, NULL, 0, NULL) == SQLITE_OK;
+}
+
+/**
+ * A version 4 database opened with an SQLite library without FTS5 drops the index triggers, every
+ * insert would fail on them otherwise. The index is rebuilt by _migrate_to_v4() once FTS5 is back.
+ */
+static gboolean
+_downgrade_to_v3(void)
+{
+    char* err_msg = NULL;
+
+    const char* sql_statements[] = {
+        "BEGIN TRANSACTION",
+        "DROP TRIGGER IF EXISTS ChatLogs_fts_insert;",
+        "DROP TRIGGER IF EXISTS ChatLogs_fts_delete;",
+        "DROP TRIGGER IF EXISTS ChatLogs_fts_update;",
+        "DELETE FROM `DbVersion`;",
+        "INSERT INTO `DbVersion` (`version`) VALUES (3);",
+        "END TRANSACTION"
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(sql_statements); i++) {
+        if (SQLITE_OK != sqlite3_exec(g_chatlog_database, sql_statements[i], NULL, 0, &err_msg)) {
+            log_error("SQLite error in _downgrade_to_v3() on statement %zu: %s", i, err_msg);
+            if (err_msg) {
+                sqlite3_free(err_msg);
+                err_msg = NULL;
+            }
+            if (i > 0 && SQLITE_OK != sqlite3_exec(g_chatlog_database, "ROLLBACK;", NULL, 0, &err_msg)) {
+                log_error("[DB Migration] Unable to ROLLBACK: %s", err_msg);
+                if (err_msg) {
+                    sqlite3_free(err_msg);
+                }
+            }
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * Migration to version 4 adds the `ChatLogs_fts` full-text index and fills it from existing messages.
+ */
+static gboolean
+_migrate_to_v4(void)
+{
+    char* err_msg = NULL;
+
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, "BEGIN TRANSACTION", NULL, 0, &err_msg)) {
+        log_error("SQLite error in _migrate_to_v4() on BEGIN: %s", err_msg);
+        sqlite3_free(err_msg);
+        return FALSE;
+    }
+
+    const char* sql_statements[] = {
+        "INSERT INTO `ChatLogs_fts` (`ChatLogs_fts`) VALUES ('rebuild');",
+        "DELETE FROM `DbVersion`;",
+        "INSERT INTO `DbVersion` (`version`) VALUES (4);",
+        "END TRANSACTION"
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(fts_statements); i++) {
+        if (SQLITE_OK != sqlite3_exec(g_chatlog_database, fts_statements[i], NULL, 0, &err_msg)) {
+            log_error("SQLite error in _migrate_to_v4() on index statement %zu: %s", i, err_msg);
+            goto cleanup;
+        }
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(sql_statements); i++) {
+        if (SQLITE_OK != sqlite3_exec(g_chatlog_database, sql_statements[i], NULL, 0, &err_msg)) {
+            log_error("SQLite error in _migrate_to_v4() on statement %zu: %s", i, err_msg);
+            goto cleanup;
+        }
+    }
+
+    return TRUE;
+
+cleanup:
+    if (err_msg) {
+        sqlite3_free(err_msg);
+        err_msg = NULL;
+    }
+    if (SQLITE_OK != sqlite3_exec(g_chatlog_database, "ROLLBACK;", NULL, 0, &err_msg)) {
+        log_error("[DB Migration] Unable to ROLLBACK: %s", err_msg);
+        if (err_msg) {
+            sqlite3_free(err_msg);
+        }
+    }
+
+    return FALSE;
+}
+
 gboolean
 log_database_update_archive_id(const prof_msg_type_t type, const char* const room_or_contact_jid, const char* const stanza_id, const char* const archive_id)
 {
@@ -857,34 +1899,50 @@ log_database_update_archive_id(const prof_msg_type_t type, const char* const roo
     }
 
     const char* our_barejid = connection_get_jid()->barejid;
-    sqlite3_stmt* stmt = NULL;
-    gboolean success = FALSE;
     const char* type_str = _get_message_type_str(type);
 
     if (!type_str) {
         return FALSE;
     }
 
-    auto_sqlite char* query = sqlite3_mprintf(
-        "UPDATE `ChatLogs` "
-        "SET `archive_id` = %Q "
-        "WHERE `stanza_id` = %Q "
-        "  AND `from_jid` = %Q "
-        "  AND `to_jid` = %Q "
-        "  AND `type` = %Q "
-        "  AND `archive_id` IS NULL",
-        archive_id, stanza_id, our_barejid, room_or_contact_jid, type_str);
-
-    if (query) {
-        if (SQLITE_OK == sqlite3_prepare_v2(g_chatlog_database, query, -1, &stmt, NULL)) {
-            if (sqlite3_step(stmt) == SQLITE_DONE) {
-                success = (sqlite3_changes(g_chatlog_database) > 0);
-            }
-            sqlite3_finalize(stmt);
+    // The message may still be queued, otherwise it has been committed already
+    pthread_mutex_lock(&db_writer.mutex);
+    DbWrite* pending = _db_writer_find_pending(stanza_id, type_str, our_barejid, room_or_contact_jid);
+    gboolean found = pending && g_strcmp0(pending->from_jid, our_barejid) == 0 && pending->archive_id == NULL;
+    pthread_mutex_unlock(&db_writer.mutex);
+
+    if (!found) {
+        sqlite3_stmt* stmt = _db_prepare_cached(g_chatlog_database, &g_archive_id_missing_stmt,
+                                                "SELECT 1 FROM `ChatLogs` "
+                                                "WHERE `stanza_id` = ? "
+                                                "  AND `from_jid` = ? "
+                                                "  AND `to_jid` = ? "
+                                                "  AND `type` = ? "
+                                                "  AND `archive_id` IS NULL "
+                                                "LIMIT 1");
+        if (!stmt) {
+            return FALSE;
         }
+        _db_bind_text(stmt, 1, stanza_id);
+        _db_bind_text(stmt, 2, our_barejid);
+        _db_bind_text(stmt, 3, room_or_contact_jid);
+        _db_bind_text(stmt, 4, type_str);
+        found = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_reset(stmt);
+    }
+
+    if (found) {
+        DbWrite* write = g_new0(DbWrite, 1);
+        write->op = DB_WRITE_ARCHIVE_ID;
+        write->from_jid = g_strdup(our_barejid);
+        write->to_jid = g_strdup(room_or_contact_jid);
+        write->stanza_id = g_strdup(stanza_id);
+        write->archive_id = g_strdup(archive_id);
+        write->type = type_str;
+        _db_writer_enqueue(write);
     }
 
-    return success;
+    return found;
 }
 
 char*
@@ -904,6 +1962,16 @@ log_database_get_decrypted_message(const prof_msg_type_t type, const char* const
     }
 
     if (stanza_id && strlen(stanza_id) > 0) {
+        pthread_mutex_lock(&db_writer.mutex);
+        DbWrite* pending = _db_writer_find_pending(stanza_id, type_str, from_jid, to_jid);
+        if (pending) {
+            decrypted_text = _db_strdup(pending->message);
+        }
+        pthread_mutex_unlock(&db_writer.mutex);
+        if (pending) {
+            return decrypted_text;
+        }
+
         query = sqlite3_mprintf(
             "SELECT `message` FROM `ChatLogs` "
             "WHERE `stanza_id` = %Q "
@@ -29,6 +29,9 @@ ProfMessage* log_database_get_limits_info(const gchar* const contact_barejid, gb
 ProfMessage* log_database_get_limits_info_muc(const gchar* const room_jid, gboolean is_last);
 gboolean log_database_update_archive_id(const prof_msg_type_t type, const char* const room_or_contact_jid, const char* const stanza_id, const char* const archive_id);
 char* log_database_get_decrypted_message(const prof_msg_type_t type, const char* const from_jid, const char* const to_jid, const char* const stanza_id, const char* const archive_id);
+GSList* log_database_search(const char* const text, const char* const jid, const char* const since, int offset, int limit);
+gboolean log_database_search_available(void);
+void log_database_update_synchronous(void);
 void log_database_close(void);
 
 #endif // DATABASE_H
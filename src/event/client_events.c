@@ -113,9 +113,8 @@ cl_ev_send_msg_correct(ProfChatWin* chatwin, const char* const msg, const char*
         auto_char char* jid = chat_session_get_jid(chatwin->barejid);
         EntityCapabilities* caps = caps_lookup(jid);
         if (caps != NULL) {
-            GSList* found = g_slist_find_custom(caps->features, XMPP_FEATURE_RECEIPTS, (GCompareFunc)g_strcmp0);
-            request_receipt = (found != NULL);
-            caps_destroy(caps);
+            request_receipt = caps_has_feature(caps, XMPP_FEATURE_RECEIPTS);
+            caps_unref(caps);
         }
     }
 
@@ -345,9 +345,10 @@ sv_ev_room_message(ProfMessage* message)
     if (plugin_msg)
         message->plain = plugin_msg;
 
-    GSList* mentions = get_mentions(prefs_get_boolean(PREF_NOTIFY_MENTION_WHOLE_WORD), prefs_get_boolean(PREF_NOTIFY_MENTION_CASE_SENSITIVE), message->plain, mynick);
+    GSList* mentions = NULL;
+    GList* triggers = NULL;
+    prefs_message_get_matches(message->plain, mynick, &mentions, &triggers);
     gboolean mention = g_slist_length(mentions) > 0;
-    GList* triggers = prefs_message_get_triggers(message->plain);
 
     _clean_incoming_message(message);
 
@@ -298,6 +298,12 @@ log_stderr_handler(void)
     }
 }
 
+int
+log_stderr_get_fd(void)
+{
+    return stderr_inited ? stderr_pipe[0] : -1;
+}
+
 static int
 log_stderr_nonblock_set(int fd)
 {
@@ -49,5 +49,6 @@ const char* log_string_from_level(log_level_t level);
 
 void log_stderr_init(log_level_t level);
 void log_stderr_handler(void);
+int log_stderr_get_fd(void);
 
 #endif
@@ -9,6 +9,8 @@
 #include "config.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
 #ifdef HAVE_LIBOMEMO_C
 #include <omemo/signal_protocol.h>
 #include <omemo/signal_protocol_types.h>
@@ -21,8 +23,8 @@
 #include "omemo/omemo.h"
 #include "omemo/crypto.h"
 
-#define AES256_GCM_TAG_LENGTH  16
-#define AES256_GCM_BUFFER_SIZE 1024
+#define AES256_GCM_TAG_LENGTH         OMEMO_AESGCM_TAG_LENGTH
+#define AES256_GCM_STREAM_BUFFER_SIZE (256 * 1024)
 
 int
 omemo_crypto_init(void)
@@ -366,92 +368,225 @@ out:
     return res;
 }
 
-gcry_error_t
-aes256gcm_crypt_file(FILE* in, FILE* out, off_t file_size,
-                     unsigned char key[], unsigned char nonce[], gboolean encrypt)
+// Every call but the last one has to pass whole blocks in GCM mode, the
+// buffer size is a multiple of the block size so only the end of the file
+// gives a partial one.
+struct omemo_file_stream_t
+{
+    gcry_cipher_hd_t hd;
+    gboolean encrypt;
+    unsigned char nonce[OMEMO_AESGCM_NONCE_LENGTH];
+    off_t file_size;
+    // plaintext that is still to be read when encrypting
+    off_t remaining;
+    gboolean tagged;
+    // Encrypting: the ciphertext from pos to len is still to be read.
+    // Decrypting: the ciphertext that is not decrypted yet, its last
+    // AES256_GCM_TAG_LENGTH bytes may turn out to be the tag.
+    unsigned char* buffer;
+    size_t pos;
+    size_t len;
+};
+
+OmemoFileStream*
+omemo_file_stream_new(const unsigned char key[], const unsigned char nonce[], off_t file_size,
+                      gboolean encrypt, gcry_error_t* res)
 {
-
     if (!gcry_control(GCRYCTL_INITIALIZATION_FINISHED_P)) {
         fputs("libgcrypt has not been initialized\n", stderr);
         abort();
     }
 
-    if (!encrypt) {
-        file_size -= AES256_GCM_TAG_LENGTH;
+    gcry_cipher_hd_t hd;
+    *res = gcry_cipher_open(&hd, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_GCM,
+                            GCRY_CIPHER_SECURE);
+    if (*res != GPG_ERR_NO_ERROR) {
+        return NULL;
     }
 
+    *res = gcry_cipher_setkey(hd, key, OMEMO_AESGCM_KEY_LENGTH);
+    if (*res == GPG_ERR_NO_ERROR) {
+        *res = gcry_cipher_setiv(hd, nonce, OMEMO_AESGCM_NONCE_LENGTH);
+    }
+    if (*res != GPG_ERR_NO_ERROR) {
+        gcry_cipher_close(hd);
+        return NULL;
+    }
+
+    OmemoFileStream* stream = g_new0(OmemoFileStream, 1);
+    stream->hd = hd;
+    stream->encrypt = encrypt;
+    memcpy(stream->nonce, nonce, OMEMO_AESGCM_NONCE_LENGTH);
+    stream->file_size = file_size;
+    stream->remaining = file_size;
+    stream->buffer = g_malloc(AES256_GCM_STREAM_BUFFER_SIZE);
+
+    return stream;
+}
+
+static gcry_error_t
+_file_stream_fill(OmemoFileStream* stream, FILE* in)
+{
     gcry_error_t res;
-    gcry_cipher_hd_t hd;
 
-    res = gcry_cipher_open(&hd, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_GCM,
-                           GCRY_CIPHER_SECURE);
-    if (res != GPG_ERR_NO_ERROR) {
-        goto out;
+    stream->pos = 0;
+    stream->len = 0;
+
+    if (stream->remaining > 0) {
+        size_t read_size = MIN(stream->remaining, (off_t)AES256_GCM_STREAM_BUFFER_SIZE);
+        size_t bytes = fread(stream->buffer, 1, read_size, in);
+        if (bytes != read_size) {
+            // The file got shorter since the upload was requested.
+            return gcry_error_from_errno(ferror(in) ? errno : EIO);
+        }
+
+        stream->remaining -= bytes;
+        if (stream->remaining == 0) {
+            gcry_cipher_final(stream->hd); // Signal last round of bytes.
+        }
+
+        res = gcry_cipher_encrypt(stream->hd, stream->buffer, bytes, NULL, 0);
+        if (res != GPG_ERR_NO_ERROR) {
+            return res;
+        }
+        stream->len = bytes;
     }
 
-    res = gcry_cipher_setkey(hd, key, OMEMO_AESGCM_KEY_LENGTH);
-    if (res != GPG_ERR_NO_ERROR) {
-        goto out;
+    // Append authentication tag after the last ciphertext.
+    if (stream->remaining == 0 && stream->len + AES256_GCM_TAG_LENGTH <= AES256_GCM_STREAM_BUFFER_SIZE) {
+        res = gcry_cipher_gettag(stream->hd, stream->buffer + stream->len, AES256_GCM_TAG_LENGTH);
+        if (res != GPG_ERR_NO_ERROR) {
+            return res;
+        }
+        stream->len += AES256_GCM_TAG_LENGTH;
+        stream->tagged = TRUE;
+    }
+
+    return GPG_ERR_NO_ERROR;
+}
+
+gcry_error_t
+omemo_file_stream_read(OmemoFileStream* stream, FILE* in, char* buffer, size_t size, size_t* bytes)
+{
+    assert(stream->encrypt);
+
+    *bytes = 0;
+    while (*bytes < size) {
+        if (stream->pos == stream->len) {
+            if (stream->tagged) {
+                break;
+            }
+            gcry_error_t res = _file_stream_fill(stream, in);
+            if (res != GPG_ERR_NO_ERROR) {
+                return res;
+            }
+        }
+
+        size_t n = MIN(size - *bytes, stream->len - stream->pos);
+        memcpy(buffer + *bytes, stream->buffer + stream->pos, n);
+        stream->pos += n;
+        *bytes += n;
+    }
+
+    return GPG_ERR_NO_ERROR;
+}
+
+gcry_error_t
+omemo_file_stream_rewind(OmemoFileStream* stream, FILE* in)
+{
+    assert(stream->encrypt);
+
+    if (fseeko(in, 0, SEEK_SET) != 0) {
+        return gcry_error_from_errno(errno);
     }
 
-    res = gcry_cipher_setiv(hd, nonce, OMEMO_AESGCM_NONCE_LENGTH);
+    // Same key and nonce, so the ciphertext is the same as the first time.
+    gcry_cipher_reset(stream->hd);
+    gcry_error_t res = gcry_cipher_setiv(stream->hd, stream->nonce, OMEMO_AESGCM_NONCE_LENGTH);
     if (res != GPG_ERR_NO_ERROR) {
-        goto out;
+        return res;
     }
 
-    unsigned char buffer[AES256_GCM_BUFFER_SIZE];
+    stream->remaining = stream->file_size;
+    stream->tagged = FALSE;
+    stream->pos = 0;
+    stream->len = 0;
 
-    int bytes = 0;
-    off_t bytes_read = 0, bytes_available = 0, read_size = 0;
-    while (bytes_read < file_size) {
-        bytes_available = file_size - bytes_read;
-        if (!bytes_available || ferror(in) != 0) {
-            break;
-        }
+    return GPG_ERR_NO_ERROR;
+}
 
-        if (bytes_available < AES256_GCM_BUFFER_SIZE) {
-            read_size = bytes_available;
-            gcry_cipher_final(hd); // Signal last round of bytes.
-        } else {
-            read_size = AES256_GCM_BUFFER_SIZE;
-        }
+static gcry_error_t
+_file_stream_decrypt(OmemoFileStream* stream, FILE* out, size_t len)
+{
+    gcry_error_t res = gcry_cipher_decrypt(stream->hd, stream->buffer, len, NULL, 0);
+    if (res != GPG_ERR_NO_ERROR) {
+        return res;
+    }
 
-        bytes = fread(buffer, 1, read_size, in);
-        bytes_read += bytes;
+    if (fwrite(stream->buffer, 1, len, out) != len) {
+        return gcry_error_from_errno(errno);
+    }
 
-        if (encrypt) {
-            res = gcry_cipher_encrypt(hd, buffer, bytes, NULL, 0);
-        } else {
-            res = gcry_cipher_decrypt(hd, buffer, bytes, NULL, 0);
-        }
+    return GPG_ERR_NO_ERROR;
+}
 
-        if (res != GPG_ERR_NO_ERROR) {
-            goto out;
+gcry_error_t
+omemo_file_stream_write(OmemoFileStream* stream, FILE* out, const char* data, size_t size)
+{
+    assert(!stream->encrypt);
+
+    while (size > 0) {
+        if (stream->len == AES256_GCM_STREAM_BUFFER_SIZE) {
+            // Keep back what may be the tag, the rest are whole blocks.
+            size_t len = stream->len - AES256_GCM_TAG_LENGTH;
+            gcry_error_t res = _file_stream_decrypt(stream, out, len);
+            if (res != GPG_ERR_NO_ERROR) {
+                return res;
+            }
+            memmove(stream->buffer, stream->buffer + len, AES256_GCM_TAG_LENGTH);
+            stream->len = AES256_GCM_TAG_LENGTH;
         }
 
-        fwrite(buffer, 1, bytes, out);
+        size_t n = MIN(size, AES256_GCM_STREAM_BUFFER_SIZE - stream->len);
+        memcpy(stream->buffer + stream->len, data, n);
+        stream->len += n;
+        data += n;
+        size -= n;
     }
 
-    unsigned char tag[AES256_GCM_TAG_LENGTH];
+    return GPG_ERR_NO_ERROR;
+}
 
-    if (encrypt) {
-        // Append authentication tag at the end of the file.
-        res = gcry_cipher_gettag(hd, tag, AES256_GCM_TAG_LENGTH);
-        if (res != GPG_ERR_NO_ERROR) {
-            goto out;
-        }
+gcry_error_t
+omemo_file_stream_finish(OmemoFileStream* stream, FILE* out)
+{
+    assert(!stream->encrypt);
+
+    if (stream->len < AES256_GCM_TAG_LENGTH) {
+        return gcry_error(GPG_ERR_INV_LENGTH);
+    }
 
-        fwrite(tag, 1, AES256_GCM_TAG_LENGTH, out);
+    size_t len = stream->len - AES256_GCM_TAG_LENGTH;
+    gcry_cipher_final(stream->hd); // Signal last round of bytes.
+    gcry_error_t res = _file_stream_decrypt(stream, out, len);
+    if (res != GPG_ERR_NO_ERROR) {
+        return res;
+    }
 
-    } else {
-        // Read and verify authentication tag stored at the end of the file.
-        bytes = fread(tag, 1, AES256_GCM_TAG_LENGTH, in);
-        res = gcry_cipher_checktag(hd, tag, bytes);
+    // Verify authentication tag stored at the end of the file.
+    return gcry_cipher_checktag(stream->hd, stream->buffer + len, AES256_GCM_TAG_LENGTH);
+}
+
+void
+omemo_file_stream_free(OmemoFileStream* stream)
+{
+    if (!stream) {
+        return;
     }
 
-out:
-    gcry_cipher_close(hd);
-    return res;
+    gcry_cipher_close(stream->hd);
+    g_free(stream->buffer);
+    g_free(stream);
 }
 
 char*
@@ -165,8 +165,10 @@ int aes128gcm_decrypt(unsigned char* plaintext,
                       size_t ciphertext_len, const unsigned char* const iv, size_t iv_len,
                       const unsigned char* const key, const unsigned char* const tag);
 
-gcry_error_t aes256gcm_crypt_file(FILE* in, FILE* out, off_t file_size,
-                                  unsigned char key[], unsigned char nonce[], gboolean encrypt);
+struct omemo_file_stream_t;
+
+struct omemo_file_stream_t* omemo_file_stream_new(const unsigned char key[], const unsigned char nonce[], off_t file_size,
+                                                  gboolean encrypt, gcry_error_t* res);
 
 char* aes256gcm_create_secure_fragment(unsigned char* key,
                                        unsigned char* nonce);
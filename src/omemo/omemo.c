@@ -14,8 +14,10 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <glib.h>
 #include <pthread.h>
+#include <unistd.h>
 
 #ifdef HAVE_LIBOMEMO_C
 #include <omemo/key_helper.h>
@@ -66,9 +68,35 @@ static unsigned char* _omemo_fingerprint_decode(const char* const fingerprint, s
 static char* _omemo_unformat_fingerprint(const char* const fingerprint_formatted);
 static void _cache_device_identity(const char* const jid, uint32_t device_id, ec_public_key* identity);
 static void _acquire_sender_devices_list(void);
+static gboolean _keyfile_load(prof_keyfile_t* keyfile, omemo_journal_t* journal, gchar* filename);
+static void _keyfile_close(prof_keyfile_t* keyfile, omemo_journal_t* journal);
+static gboolean _journal_compact(omemo_journal_t* journal, prof_keyfile_t* keyfile);
 
 typedef gboolean (*OmemoDeviceListHandler)(const char* const jid, GList* device_list);
 
+// Records changed since the keyfile was last written, appended to
+// "<keyfile>.journal". A commit syncs the journal; the keyfile itself is only
+// rewritten when the journal gets long, when loading and when disconnecting.
+typedef struct omemo_journal_t
+{
+    gchar* filename;
+    int fd;
+    guint records;
+    gboolean unsynced;
+} omemo_journal_t;
+
+#define JOURNAL_OPEN(journal) ((journal)->filename != NULL && (journal)->fd >= 0)
+
+#define OMEMO_JOURNAL_COMPACT_RECORDS 1000
+
+// session_cipher keeps a pointer to its address, so both live here
+typedef struct omemo_cipher_t
+{
+    gchar* name;
+    signal_protocol_address address;
+    session_cipher* cipher;
+} omemo_cipher_t;
+
 typedef struct omemo_context
 {
     signal_context* signal;
@@ -88,7 +116,11 @@ typedef struct omemo_context
     prof_keyfile_t trust;
     prof_keyfile_t sessions;
     prof_keyfile_t knowndevices;
+    omemo_journal_t identity_journal;
+    omemo_journal_t trust_journal;
+    omemo_journal_t sessions_journal;
     GHashTable* known_devices;
+    GHashTable* ciphers; // barejid -> device id -> omemo_cipher_t
     gboolean loaded;
     gboolean notifying;
 } omemo_context;
@@ -142,11 +174,11 @@ _omemo_finalize_identity_load(ProfAccount* account)
         return FALSE;
     }
 
-    if (load_custom_keyfile(&omemo_ctx.trust, g_strdup_printf("%s/%s", omemo_dir, "trust.txt"))) {
+    if (_keyfile_load(&omemo_ctx.trust, &omemo_ctx.trust_journal, g_strdup_printf("%s/%s", omemo_dir, "trust.txt"))) {
         _load_trust();
     }
 
-    if (load_custom_keyfile(&omemo_ctx.sessions, g_strdup_printf("%s/%s", omemo_dir, "sessions.txt"))) {
+    if (_keyfile_load(&omemo_ctx.sessions, &omemo_ctx.sessions_journal, g_strdup_printf("%s/%s", omemo_dir, "sessions.txt"))) {
         _load_sessions();
     }
 
@@ -248,6 +280,7 @@ omemo_on_connect(ProfAccount* account)
     omemo_ctx.device_list = g_hash_table_new_full(g_str_hash, g_str_equal, free, (GDestroyNotify)g_list_free);
     omemo_ctx.device_list_handler = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
     omemo_ctx.known_devices = g_hash_table_new_full(g_str_hash, g_str_equal, free, (GDestroyNotify)g_hash_table_destroy);
+    omemo_ctx.ciphers = g_hash_table_new_full(g_str_hash, g_str_equal, free, (GDestroyNotify)g_hash_table_destroy);
 
     auto_gchar gchar* omemo_dir = files_file_in_account_data_path(DIR_OMEMO, account->jid, NULL);
     if (!omemo_dir) {
@@ -255,7 +288,7 @@ omemo_on_connect(ProfAccount* account)
         return;
     }
 
-    if (load_custom_keyfile(&omemo_ctx.identity, g_strdup_printf("%s/%s", omemo_dir, "identity.txt"))) {
+    if (_keyfile_load(&omemo_ctx.identity, &omemo_ctx.identity_journal, g_strdup_printf("%s/%s", omemo_dir, "identity.txt"))) {
         if (!_load_identity())
             return;
     }
@@ -270,8 +303,8 @@ omemo_on_disconnect(void)
 {
     if (omemo_ctx.loaded) {
         free_keyfile(&omemo_ctx.knowndevices);
-        free_keyfile(&omemo_ctx.sessions);
-        free_keyfile(&omemo_ctx.trust);
+        _keyfile_close(&omemo_ctx.sessions, &omemo_ctx.sessions_journal);
+        _keyfile_close(&omemo_ctx.trust, &omemo_ctx.trust_journal);
 
         ec_public_key* pub = ratchet_identity_key_pair_get_public(omemo_ctx.identity_key_pair);
         ec_private_key* priv = ratchet_identity_key_pair_get_private(omemo_ctx.identity_key_pair);
@@ -280,10 +313,11 @@ omemo_on_disconnect(void)
         ec_public_key_destroy((signal_type_base*)pub);
     }
 
-    free_keyfile(&omemo_ctx.identity);
+    _keyfile_close(&omemo_ctx.identity, &omemo_ctx.identity_journal);
     g_hash_table_destroy(omemo_ctx.known_devices);
     g_hash_table_destroy(omemo_ctx.device_list_handler);
     g_hash_table_destroy(omemo_ctx.device_list);
+    g_hash_table_destroy(omemo_ctx.ciphers);
     signal_protocol_store_context_destroy(omemo_ctx.store);
     signal_context_destroy(omemo_ctx.signal);
     memset(&omemo_ctx, 0, sizeof(omemo_ctx));
@@ -330,7 +364,8 @@ omemo_generate_crypto_materials(ProfAccount* account)
     /* Signed pre key */
     _generate_signed_pre_key();
 
-    omemo_identity_keyfile_save();
+    // the identity was set in the keyfile directly, so write all of it
+    _journal_compact(&omemo_ctx.identity_journal, &omemo_ctx.identity);
 
     if ((omemo_ctx.loaded = _omemo_finalize_identity_load(account)) == FALSE)
         return;
@@ -597,16 +632,180 @@ omemo_set_device_list(const char* const from, GList* device_list)
     wins_omemo_trust_changed(jid->barejid);
 }
 
+static void
+_journal_append(omemo_journal_t* journal, const char* const op, const char* const group, const char* const key, const char* const value)
+{
+    if (!JOURNAL_OPEN(journal)) {
+        return;
+    }
+
+    auto_gchar gchar* group_esc = g_strescape(group, NULL);
+    auto_gchar gchar* key_esc = g_strescape(key, NULL);
+    auto_gchar gchar* value_esc = value ? g_strescape(value, NULL) : NULL;
+    auto_gchar gchar* line = value_esc ? g_strdup_printf("%s\t%s\t%s\t%s\n", op, group_esc, key_esc, value_esc)
+                                       : g_strdup_printf("%s\t%s\t%s\n", op, group_esc, key_esc);
+
+    gsize len = strlen(line);
+    gsize written = 0;
+    while (written < len) {
+        ssize_t res = write(journal->fd, line + written, len - written);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_error("[OMEMO][STORE] cannot append to %s: %s", journal->filename, g_strerror(errno));
+            // rewrite the keyfile on the next commit, that drops the torn record too
+            journal->records = OMEMO_JOURNAL_COMPACT_RECORDS;
+            return;
+        }
+        written += res;
+    }
+
+    journal->records++;
+    journal->unsynced = TRUE;
+}
+
+// apply the complete lines of the journal, a torn last line from a crash is
+// ignored, end is set to the size of the complete lines and length to the
+// size of the journal
+static guint
+_journal_replay(omemo_journal_t* journal, GKeyFile* keyfile, gsize* end, gsize* length)
+{
+    auto_gchar gchar* contents = NULL;
+    *end = 0;
+    *length = 0;
+    if (!g_file_get_contents(journal->filename, &contents, length, NULL)) {
+        return 0;
+    }
+
+    gchar* last = g_strrstr_len(contents, *length, "\n");
+    *end = last ? last - contents + 1 : 0;
+
+    guint records = 0;
+    auto_gcharv gchar** lines = g_strsplit(contents, "\n", -1);
+    for (int i = 0; lines[i] && lines[i + 1]; i++) {
+        auto_gcharv gchar** fields = g_strsplit(lines[i], "\t", 4);
+        guint count = g_strv_length(fields);
+        if (count < 3) {
+            continue;
+        }
+
+        auto_gchar gchar* group = g_strcompress(fields[1]);
+        auto_gchar gchar* key = g_strcompress(fields[2]);
+        if (g_strcmp0(fields[0], "set") == 0 && count == 4) {
+            auto_gchar gchar* value = g_strcompress(fields[3]);
+            g_key_file_set_string(keyfile, group, key, value);
+        } else if (g_strcmp0(fields[0], "remove") == 0) {
+            g_key_file_remove_key(keyfile, group, key, NULL);
+        } else {
+            continue;
+        }
+        records++;
+    }
+
+    return records;
+}
+
+// write the whole keyfile, it replaces the journal
+static gboolean
+_journal_compact(omemo_journal_t* journal, prof_keyfile_t* keyfile)
+{
+    if (!save_keyfile(keyfile)) {
+        return FALSE;
+    }
+
+    if (JOURNAL_OPEN(journal) && ftruncate(journal->fd, 0) != 0) {
+        log_error("[OMEMO][STORE] cannot truncate %s: %s", journal->filename, g_strerror(errno));
+    }
+    journal->records = 0;
+    journal->unsynced = FALSE;
+    return TRUE;
+}
+
+static void
+_journal_commit(omemo_journal_t* journal, prof_keyfile_t* keyfile)
+{
+    if (!JOURNAL_OPEN(journal) || journal->records >= OMEMO_JOURNAL_COMPACT_RECORDS) {
+        _journal_compact(journal, keyfile);
+    } else if (journal->unsynced) {
+        if (fsync(journal->fd) != 0) {
+            log_error("[OMEMO][STORE] cannot sync %s: %s", journal->filename, g_strerror(errno));
+        }
+        journal->unsynced = FALSE;
+    }
+}
+
+static gboolean
+_keyfile_load(prof_keyfile_t* keyfile, omemo_journal_t* journal, gchar* filename)
+{
+    gboolean loaded = load_custom_keyfile(keyfile, filename);
+
+    journal->filename = g_strdup_printf("%s.journal", keyfile->filename);
+    journal->fd = open(journal->filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (journal->fd < 0) {
+        log_error("[OMEMO][STORE] cannot open %s: %s", journal->filename, g_strerror(errno));
+    }
+
+    // changes that didn't make it into the keyfile before the last exit
+    gsize end, length;
+    guint replayed = _journal_replay(journal, keyfile->keyfile, &end, &length);
+    gboolean compacted = FALSE;
+    if (replayed > 0) {
+        log_debug("[OMEMO][STORE] replayed %u records from %s", replayed, journal->filename);
+        compacted = _journal_compact(journal, keyfile);
+    }
+
+    // drop a torn record, new records would be appended to its partial line,
+    // the complete ones stay when they couldn't be written to the keyfile
+    gsize keep = replayed > 0 ? end : 0;
+    if (!compacted && length > keep && JOURNAL_OPEN(journal)) {
+        if (ftruncate(journal->fd, keep) != 0) {
+            log_error("[OMEMO][STORE] cannot truncate %s: %s", journal->filename, g_strerror(errno));
+        }
+    }
+
+    return loaded || replayed > 0;
+}
+
+static void
+_keyfile_close(prof_keyfile_t* keyfile, omemo_journal_t* journal)
+{
+    if (JOURNAL_OPEN(journal)) {
+        if (journal->records > 0) {
+            _journal_compact(journal, keyfile);
+        }
+        close(journal->fd);
+    }
+    g_free(journal->filename);
+    memset(journal, 0, sizeof(omemo_journal_t));
+
+    free_keyfile(keyfile);
+}
+
 GKeyFile*
 omemo_identity_keyfile(void)
 {
     return omemo_ctx.identity.keyfile;
 }
 
+void
+omemo_identity_keyfile_set(const char* const group, const char* const key, const char* const value)
+{
+    g_key_file_set_string(omemo_ctx.identity.keyfile, group, key, value);
+    _journal_append(&omemo_ctx.identity_journal, "set", group, key, value);
+}
+
+void
+omemo_identity_keyfile_remove(const char* const group, const char* const key)
+{
+    g_key_file_remove_key(omemo_ctx.identity.keyfile, group, key, NULL);
+    _journal_append(&omemo_ctx.identity_journal, "remove", group, key, NULL);
+}
+
 void
 omemo_identity_keyfile_save(void)
 {
-    save_keyfile(&omemo_ctx.identity);
+    _journal_commit(&omemo_ctx.identity_journal, &omemo_ctx.identity);
 }
 
 GKeyFile*
@@ -615,10 +814,24 @@ omemo_trust_keyfile(void)
     return omemo_ctx.trust.keyfile;
 }
 
+void
+omemo_trust_keyfile_set(const char* const group, const char* const key, const char* const value)
+{
+    g_key_file_set_string(omemo_ctx.trust.keyfile, group, key, value);
+    _journal_append(&omemo_ctx.trust_journal, "set", group, key, value);
+}
+
+void
+omemo_trust_keyfile_remove(const char* const group, const char* const key)
+{
+    g_key_file_remove_key(omemo_ctx.trust.keyfile, group, key, NULL);
+    _journal_append(&omemo_ctx.trust_journal, "remove", group, key, NULL);
+}
+
 void
 omemo_trust_keyfile_save(void)
 {
-    save_keyfile(&omemo_ctx.trust);
+    _journal_commit(&omemo_ctx.trust_journal, &omemo_ctx.trust);
 }
 
 GKeyFile*
@@ -627,6 +840,20 @@ omemo_sessions_keyfile(void)
     return omemo_ctx.sessions.keyfile;
 }
 
+void
+omemo_sessions_keyfile_set(const char* const group, const char* const key, const char* const value)
+{
+    g_key_file_set_string(omemo_ctx.sessions.keyfile, group, key, value);
+    _journal_append(&omemo_ctx.sessions_journal, "set", group, key, value);
+}
+
+void
+omemo_sessions_keyfile_remove(const char* const group, const char* const key)
+{
+    g_key_file_remove_key(omemo_ctx.sessions.keyfile, group, key, NULL);
+    _journal_append(&omemo_ctx.sessions_journal, "remove", group, key, NULL);
+}
+
 static gboolean omemo_sessions_keyfile_save_disable = FALSE;
 
 void
@@ -634,7 +861,7 @@ omemo_sessions_keyfile_save(void)
 {
     if (omemo_sessions_keyfile_save_disable)
         return;
-    save_keyfile(&omemo_ctx.sessions);
+    _journal_commit(&omemo_ctx.sessions_journal, &omemo_ctx.sessions);
 }
 
 void
@@ -759,6 +986,115 @@ out:
     SIGNAL_UNREF(identity_key);
 }
 
+static void
+_omemo_cipher_free(omemo_cipher_t* entry)
+{
+    session_cipher_free(entry->cipher);
+    g_free(entry->name);
+    g_free(entry);
+}
+
+// session ciphers read the session from the store on every use, so one
+// created for an address stays valid for the whole connection
+static session_cipher*
+_session_cipher(const char* const name, uint32_t device_id)
+{
+    GHashTable* devices = g_hash_table_lookup(omemo_ctx.ciphers, name);
+    if (!devices) {
+        devices = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_omemo_cipher_free);
+        g_hash_table_insert(omemo_ctx.ciphers, strdup(name), devices);
+    }
+
+    omemo_cipher_t* entry = g_hash_table_lookup(devices, GINT_TO_POINTER(device_id));
+    if (entry) {
+        return entry->cipher;
+    }
+
+    entry = g_new0(omemo_cipher_t, 1);
+    entry->name = g_strdup(name);
+    entry->address.name = entry->name;
+    entry->address.name_len = strlen(entry->name);
+    entry->address.device_id = device_id;
+
+    int res = session_cipher_create(&entry->cipher, omemo_ctx.store, &entry->address, omemo_ctx.signal);
+    if (res != SG_SUCCESS) {
+        log_error("[OMEMO][SEND] cannot create cipher for %s device id %d - code: %d", name, device_id, res);
+        g_free(entry->name);
+        g_free(entry);
+        return NULL;
+    }
+
+    g_hash_table_insert(devices, GINT_TO_POINTER(device_id), entry);
+    return entry->cipher;
+}
+
+static omemo_key_t*
+_encrypt_key_for_device(const char* const name, uint32_t device_id, const unsigned char* const key_tag)
+{
+    session_cipher* cipher = _session_cipher(name, device_id);
+    if (!cipher) {
+        return NULL;
+    }
+
+    ciphertext_message* ciphertext;
+    int res = session_cipher_encrypt(cipher, key_tag, AES128_GCM_KEY_LENGTH + AES128_GCM_TAG_LENGTH, &ciphertext);
+    if (res != SG_SUCCESS) {
+        log_info("[OMEMO][SEND] cannot encrypt key for %s device id %d - code: %d", name, device_id, res);
+        return NULL;
+    }
+
+    signal_buffer* buffer = ciphertext_message_get_serialized(ciphertext);
+    omemo_key_t* key = malloc(sizeof(omemo_key_t));
+    if (!key) {
+        SIGNAL_UNREF(ciphertext);
+        return NULL;
+    }
+    key->length = signal_buffer_len(buffer);
+    key->data = malloc(key->length);
+    if (!key->data) {
+        free(key);
+        SIGNAL_UNREF(ciphertext);
+        return NULL;
+    }
+    memcpy(key->data, signal_buffer_data(buffer), key->length);
+    key->device_id = device_id;
+    key->prekey = ciphertext_message_get_type(ciphertext) == CIPHERTEXT_PREKEY_TYPE;
+    SIGNAL_UNREF(ciphertext);
+
+    return key;
+}
+
+// barejids of the recipients of a message, each once even if several
+// occupants of a room share it
+static GList*
+_message_recipients(ProfWin* win, gboolean muc)
+{
+    GList* recipients = NULL;
+    if (muc) {
+        ProfMucWin* mucwin = (ProfMucWin*)win;
+        assert(mucwin->memcheck == PROFMUCWIN_MEMCHECK);
+        GHashTable* seen = g_hash_table_new(g_str_hash, g_str_equal);
+        GList* members = muc_members(mucwin->roomjid);
+        for (GList* iter = members; iter != NULL; iter = iter->next) {
+            auto_jid Jid* jidp = jid_create(iter->data);
+            if (jidp && !g_hash_table_contains(seen, jidp->barejid)) {
+                char* barejid = strdup(jidp->barejid);
+                g_hash_table_add(seen, barejid);
+                recipients = g_list_prepend(recipients, barejid);
+            }
+        }
+        g_list_free(members);
+        g_hash_table_destroy(seen);
+        recipients = g_list_reverse(recipients);
+    } else {
+        ProfChatWin* chatwin = (ProfChatWin*)win;
+        assert(chatwin->memcheck == PROFCHATWIN_MEMCHECK);
+        recipients = g_list_append(recipients, strdup(chatwin->barejid));
+    }
+
+    return recipients;
+}
+
 char*
 omemo_on_message_send(ProfWin* win, const char* const message, gboolean request_receipt, gboolean muc, const char* const replace_id)
 {
@@ -797,23 +1133,7 @@ omemo_on_message_send(ProfWin* win, const char* const message, gboolean request_
     memcpy(key_tag, key, AES128_GCM_KEY_LENGTH);
     memcpy(key_tag + AES128_GCM_KEY_LENGTH, tag, AES128_GCM_TAG_LENGTH);
 
-    // List of barejids of the recipients of this message
-    GList* recipients = NULL;
-    if (muc) {
-        ProfMucWin* mucwin = (ProfMucWin*)win;
-        assert(mucwin->memcheck == PROFMUCWIN_MEMCHECK);
-        GList* members = muc_members(mucwin->roomjid);
-        GList* iter;
-        for (iter = members; iter != NULL; iter = iter->next) {
-            auto_jid Jid* jidp = jid_create(iter->data);
-            recipients = g_list_append(recipients, strdup(jidp->barejid));
-        }
-        g_list_free(members);
-    } else {
-        ProfChatWin* chatwin = (ProfChatWin*)win;
-        assert(chatwin->memcheck == PROFCHATWIN_MEMCHECK);
-        recipients = g_list_append(recipients, strdup(chatwin->barejid));
-    }
+    GList* recipients = _message_recipients(win, muc);
 
     GList* device_ids_iter;
 
@@ -834,57 +1154,23 @@ omemo_on_message_send(ProfWin* win, const char* const message, gboolean request_
             continue;
         }
 
+        gboolean ours = equals_our_barejid(recipients_iter->data);
         for (device_ids_iter = recipient_device_id; device_ids_iter != NULL; device_ids_iter = device_ids_iter->next) {
-            int res;
-            ciphertext_message* ciphertext;
-            session_cipher* cipher;
-            signal_protocol_address address = {
-                .name = recipients_iter->data,
-                .name_len = strlen(recipients_iter->data),
-                .device_id = GPOINTER_TO_INT(device_ids_iter->data)
-            };
+            uint32_t device_id = GPOINTER_TO_INT(device_ids_iter->data);
 
             // Don't encrypt for this device (according to
             // <https://xmpp.org/extensions/xep-0384.html#encrypt>).
             // Yourself as recipients in case of MUC
-            if (equals_our_barejid(recipients_iter->data)) {
-                if ((uint32_t)GPOINTER_TO_INT(device_ids_iter->data) == omemo_ctx.device_id) {
-                    log_debug("[OMEMO][SEND] Skipping %d (my device) ", GPOINTER_TO_INT(device_ids_iter->data));
-                    continue;
-                }
-            }
-
-            log_debug("[OMEMO][SEND] recipients with device id %d for %s", GPOINTER_TO_INT(device_ids_iter->data), recipients_iter->data);
-            res = session_cipher_create(&cipher, omemo_ctx.store, &address, omemo_ctx.signal);
-            if (res != SG_SUCCESS) {
-                log_error("[OMEMO][SEND] cannot create cipher for %s device id %d - code: %d", address.name, address.device_id, res);
+            if (ours && device_id == omemo_ctx.device_id) {
+                log_debug("[OMEMO][SEND] Skipping %d (my device) ", device_id);
                 continue;
             }
 
-            res = session_cipher_encrypt(cipher, key_tag, AES128_GCM_KEY_LENGTH + AES128_GCM_TAG_LENGTH, &ciphertext);
-            session_cipher_free(cipher);
-            if (res != SG_SUCCESS) {
-                log_info("[OMEMO][SEND] cannot encrypt key for %s device id %d - code: %d", address.name, address.device_id, res);
-                continue;
+            log_debug("[OMEMO][SEND] recipients with device id %d for %s", device_id, recipients_iter->data);
+            omemo_key_t* key = _encrypt_key_for_device(recipients_iter->data, device_id, key_tag);
+            if (key) {
+                keys = g_list_prepend(keys, key);
             }
-            signal_buffer* buffer = ciphertext_message_get_serialized(ciphertext);
-            omemo_key_t* key = malloc(sizeof(omemo_key_t));
-            if (!key) {
-                SIGNAL_UNREF(ciphertext);
-                continue;
-            }
-            key->length = signal_buffer_len(buffer);
-            key->data = malloc(key->length);
-            if (!key->data) {
-                free(key);
-                SIGNAL_UNREF(ciphertext);
-                continue;
-            }
-            memcpy(key->data, signal_buffer_data(buffer), key->length);
-            key->device_id = GPOINTER_TO_INT(device_ids_iter->data);
-            key->prekey = ciphertext_message_get_type(ciphertext) == CIPHERTEXT_PREKEY_TYPE;
-            keys = g_list_append(keys, key);
-            SIGNAL_UNREF(ciphertext);
         }
     }
 
@@ -896,20 +1182,7 @@ omemo_on_message_send(ProfWin* win, const char* const message, gboolean request_
         win_println(win, THEME_ERROR, "!", "This message cannot be encrypted for any recipient.");
 
         // Check for untrusted fingerprints for each recipient
-        GList* recipients = NULL;
-        if (muc) {
-            ProfMucWin* mucwin = (ProfMucWin*)win;
-            GList* members = muc_members(mucwin->roomjid);
-            GList* iter;
-            for (iter = members; iter != NULL; iter = iter->next) {
-                auto_jid Jid* jidp = jid_create(iter->data);
-                recipients = g_list_append(recipients, strdup(jidp->barejid));
-            }
-            g_list_free(members);
-        } else {
-            ProfChatWin* chatwin = (ProfChatWin*)win;
-            recipients = g_list_append(recipients, strdup(chatwin->barejid));
-        }
+        GList* recipients = _message_recipients(win, muc);
 
         GList* rec_iter;
         for (rec_iter = recipients; rec_iter != NULL; rec_iter = rec_iter->next) {
@@ -937,54 +1210,23 @@ omemo_on_message_send(ProfWin* win, const char* const message, gboolean request_
         GList* sender_device_id = g_hash_table_lookup(omemo_ctx.device_list, jid->barejid);
 
         for (device_ids_iter = sender_device_id; device_ids_iter != NULL; device_ids_iter = device_ids_iter->next) {
-            int res;
-            ciphertext_message* ciphertext;
-            session_cipher* cipher;
-            signal_protocol_address address = {
-                .name = jid->barejid,
-                .name_len = strlen(jid->barejid),
-                .device_id = GPOINTER_TO_INT(device_ids_iter->data)
-            };
-            log_debug("[OMEMO][SEND][Sender] Sending to device %d for %s ", address.device_id, address.name);
+            uint32_t device_id = GPOINTER_TO_INT(device_ids_iter->data);
+            log_debug("[OMEMO][SEND][Sender] Sending to device %d for %s ", device_id, jid->barejid);
             // Don't encrypt for this device (according to
             // <https://xmpp.org/extensions/xep-0384.html#encrypt>).
-            if ((uint32_t)address.device_id == omemo_ctx.device_id) {
-                continue;
-            }
-
-            res = session_cipher_create(&cipher, omemo_ctx.store, &address, omemo_ctx.signal);
-            if (res != 0) {
-                log_info("[OMEMO][SEND][Sender] cannot create cipher for %s device id %d", address.name, address.device_id);
+            if (device_id == omemo_ctx.device_id) {
                 continue;
             }
 
-            res = session_cipher_encrypt(cipher, key_tag, AES128_GCM_KEY_LENGTH + AES128_GCM_TAG_LENGTH, &ciphertext);
-            session_cipher_free(cipher);
-            if (res != 0) {
-                log_info("[OMEMO][SEND][Sender] cannot encrypt key for %s device id %d", address.name, address.device_id);
-                continue;
+            omemo_key_t* key = _encrypt_key_for_device(jid->barejid, device_id, key_tag);
+            if (key) {
+                keys = g_list_prepend(keys, key);
             }
-            signal_buffer* buffer = ciphertext_message_get_serialized(ciphertext);
-            omemo_key_t* key = malloc(sizeof(omemo_key_t));
-            if (!key) {
-                SIGNAL_UNREF(ciphertext);
-                continue;
-            }
-            key->length = signal_buffer_len(buffer);
-            key->data = malloc(key->length);
-            if (!key->data) {
-                free(key);
-                SIGNAL_UNREF(ciphertext);
-                continue;
-            }
-            memcpy(key->data, signal_buffer_data(buffer), key->length);
-            key->device_id = GPOINTER_TO_INT(device_ids_iter->data);
-            key->prekey = ciphertext_message_get_type(ciphertext) == CIPHERTEXT_PREKEY_TYPE;
-            keys = g_list_append(keys, key);
-            SIGNAL_UNREF(ciphertext);
         }
     }
 
+    keys = g_list_reverse(keys);
+
     // Send the message
     if (muc) {
         ProfMucWin* mucwin = (ProfMucWin*)win;
@@ -1575,7 +1817,7 @@ omemo_untrust(const char* const jid, const char* const fingerprint_formatted)
 
     /* Remove from keyfile */
     auto_gchar gchar* device_id_str = g_strdup_printf("%d", device_id);
-    g_key_file_remove_key(omemo_ctx.trust.keyfile, jid, device_id_str, NULL);
+    omemo_trust_keyfile_remove(jid, device_id_str);
     omemo_trust_keyfile_save();
 
     wins_omemo_trust_changed(jid);
@@ -2024,8 +2266,8 @@ omemo_free(void* a)
     gcry_free(a);
 }
 
-char*
-omemo_encrypt_file(FILE* in, FILE* out, off_t file_size, int* gcry_res)
+OmemoFileStream*
+omemo_encrypt_file_stream(off_t file_size, char** fragment, gcry_error_t* gcry_res)
 {
     unsigned char* key = gcry_random_bytes_secure(
         OMEMO_AESGCM_KEY_LENGTH,
@@ -2035,17 +2277,12 @@ omemo_encrypt_file(FILE* in, FILE* out, off_t file_size, int* gcry_res)
     unsigned char nonce[OMEMO_AESGCM_NONCE_LENGTH];
     gcry_create_nonce(nonce, OMEMO_AESGCM_NONCE_LENGTH);
 
-    char* fragment = aes256gcm_create_secure_fragment(key, nonce);
-    *gcry_res = aes256gcm_crypt_file(in, out, file_size, key, nonce, TRUE);
-
-    if (*gcry_res != GPG_ERR_NO_ERROR) {
-        gcry_free(fragment);
-        fragment = NULL;
-    }
+    OmemoFileStream* stream = omemo_file_stream_new(key, nonce, file_size, TRUE, gcry_res);
+    *fragment = stream ? aes256gcm_create_secure_fragment(key, nonce) : NULL;
 
     gcry_free(key);
 
-    return fragment;
+    return stream;
 }
 
 void
@@ -2074,8 +2311,8 @@ _bytes_from_hex(const char* hex, size_t hex_size,
     }
 }
 
-gcry_error_t
-omemo_decrypt_file(FILE* in, FILE* out, off_t file_size, const char* fragment)
+OmemoFileStream*
+omemo_decrypt_file_stream(const char* fragment, gcry_error_t* gcry_res)
 {
     char nonce_hex[AESGCM_URL_NONCE_LEN];
     char key_hex[AESGCM_URL_KEY_LEN];
@@ -2094,12 +2331,11 @@ omemo_decrypt_file(FILE* in, FILE* out, off_t file_size, const char* fragment)
     _bytes_from_hex(key_hex, AESGCM_URL_KEY_LEN,
                     key, OMEMO_AESGCM_KEY_LENGTH);
 
-    gcry_error_t crypt_res;
-    crypt_res = aes256gcm_crypt_file(in, out, file_size, key, nonce, FALSE);
+    OmemoFileStream* stream = omemo_file_stream_new(key, nonce, 0, FALSE, gcry_res);
 
     gcry_free(key);
 
-    return crypt_res;
+    return stream;
 }
 
 int
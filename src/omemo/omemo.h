@@ -17,6 +17,7 @@
 
 #define OMEMO_AESGCM_NONCE_LENGTH AES128_GCM_IV_LENGTH
 #define OMEMO_AESGCM_KEY_LENGTH   32
+#define OMEMO_AESGCM_TAG_LENGTH   16
 #define OMEMO_AESGCM_URL_SCHEME   "aesgcm"
 
 typedef enum {
@@ -47,11 +48,19 @@ void omemo_signed_prekey(unsigned char** output, size_t* length);
 void omemo_signed_prekey_signature(unsigned char** output, size_t* length);
 void omemo_prekeys(GList** prekeys, GList** ids, GList** lengths);
 void omemo_set_device_list(const char* const jid, GList* device_list);
+// The _set and _remove functions record a change, _save commits the changes
+// recorded so far.
 GKeyFile* omemo_identity_keyfile(void);
+void omemo_identity_keyfile_set(const char* const group, const char* const key, const char* const value);
+void omemo_identity_keyfile_remove(const char* const group, const char* const key);
 void omemo_identity_keyfile_save(void);
 GKeyFile* omemo_trust_keyfile(void);
+void omemo_trust_keyfile_set(const char* const group, const char* const key, const char* const value);
+void omemo_trust_keyfile_remove(const char* const group, const char* const key);
 void omemo_trust_keyfile_save(void);
 GKeyFile* omemo_sessions_keyfile(void);
+void omemo_sessions_keyfile_set(const char* const group, const char* const key, const char* const value);
+void omemo_sessions_keyfile_remove(const char* const group, const char* const key);
 void omemo_sessions_keyfile_save(void);
 char* omemo_format_fingerprint(const char* const fingerprint);
 char* omemo_own_fingerprint(gboolean formatted);
@@ -76,8 +85,19 @@ gboolean omemo_loaded(void);
 char* omemo_on_message_send(ProfWin* win, const char* const message, gboolean request_receipt, gboolean muc, const char* const replace_id);
 char* omemo_on_message_recv(const char* const from, uint32_t sid, const unsigned char* const iv, size_t iv_len, GList* keys, const unsigned char* const payload, size_t payload_len, gboolean muc, gboolean* trusted, omemo_error_t* error) __attribute__((nonnull(9, 10)));
 
-char* omemo_encrypt_file(FILE* in, FILE* out, off_t file_size, int* gcry_res);
-gcry_error_t omemo_decrypt_file(FILE* in, FILE* out, off_t file_size, const char* fragment);
+// XEP-0454 file encryption while the file is transferred, the ciphertext
+// is followed by the authentication tag.
+typedef struct omemo_file_stream_t OmemoFileStream;
+OmemoFileStream* omemo_encrypt_file_stream(off_t file_size, char** fragment, gcry_error_t* gcry_res);
+OmemoFileStream* omemo_decrypt_file_stream(const char* fragment, gcry_error_t* gcry_res);
+// Encrypt the next bytes from in, *bytes is less than size only at the end.
+gcry_error_t omemo_file_stream_read(OmemoFileStream* stream, FILE* in, char* buffer, size_t size, size_t* bytes);
+// Encrypt from the start of in again, the same ciphertext is produced.
+gcry_error_t omemo_file_stream_rewind(OmemoFileStream* stream, FILE* in);
+// Decrypt received ciphertext to out, finish once all of it was written.
+gcry_error_t omemo_file_stream_write(OmemoFileStream* stream, FILE* out, const char* data, size_t size);
+gcry_error_t omemo_file_stream_finish(OmemoFileStream* stream, FILE* out);
+void omemo_file_stream_free(OmemoFileStream* stream);
 void omemo_free(void* a);
 int omemo_parse_aesgcm_url(const char* aesgcm_url, char** https_url, char** fragment);
 
@@ -124,7 +124,7 @@ store_session(const signal_protocol_address* address,
 
     auto_gchar gchar* record_b64 = g_base64_encode(record, record_len);
     auto_gchar gchar* device_id = g_strdup_printf("%d", address->device_id);
-    g_key_file_set_string(omemo_sessions_keyfile(), address->name, device_id, record_b64);
+    omemo_sessions_keyfile_set(address->name, device_id, record_b64);
 
     omemo_sessions_keyfile_save();
 
@@ -165,7 +165,7 @@ delete_session(const signal_protocol_address* address, void* user_data)
     g_hash_table_remove(device_store, GINT_TO_POINTER(address->device_id));
 
     auto_gchar gchar* device_id_str = g_strdup_printf("%d", address->device_id);
-    g_key_file_remove_key(omemo_sessions_keyfile(), address->name, device_id_str, NULL);
+    omemo_sessions_keyfile_remove(address->name, device_id_str);
     omemo_sessions_keyfile_save();
 
     return SG_SUCCESS;
@@ -216,7 +216,7 @@ store_pre_key(uint32_t pre_key_id, uint8_t* record, size_t record_len,
     /* Long term storage */
     auto_gchar gchar* pre_key_id_str = g_strdup_printf("%d", pre_key_id);
     auto_gchar gchar* record_b64 = g_base64_encode(record, record_len);
-    g_key_file_set_string(omemo_identity_keyfile(), OMEMO_STORE_GROUP_PREKEYS, pre_key_id_str, record_b64);
+    omemo_identity_keyfile_set(OMEMO_STORE_GROUP_PREKEYS, pre_key_id_str, record_b64);
 
     omemo_identity_keyfile_save();
 
@@ -240,7 +240,7 @@ remove_pre_key(uint32_t pre_key_id, void* user_data)
 
     /* Long term storage */
     auto_gchar gchar* pre_key_id_str = g_strdup_printf("%d", pre_key_id);
-    g_key_file_remove_key(omemo_identity_keyfile(), OMEMO_STORE_GROUP_PREKEYS, pre_key_id_str, NULL);
+    omemo_identity_keyfile_remove(OMEMO_STORE_GROUP_PREKEYS, pre_key_id_str);
 
     omemo_identity_keyfile_save();
 
@@ -281,7 +281,7 @@ store_signed_pre_key(uint32_t signed_pre_key_id, uint8_t* record,
     /* Long term storage */
     auto_gchar gchar* signed_pre_key_id_str = g_strdup_printf("%d", signed_pre_key_id);
     auto_gchar gchar* record_b64 = g_base64_encode(record, record_len);
-    g_key_file_set_string(omemo_identity_keyfile(), OMEMO_STORE_GROUP_SIGNED_PREKEYS, signed_pre_key_id_str, record_b64);
+    omemo_identity_keyfile_set(OMEMO_STORE_GROUP_SIGNED_PREKEYS, signed_pre_key_id_str, record_b64);
 
     omemo_identity_keyfile_save();
 
@@ -305,7 +305,7 @@ remove_signed_pre_key(uint32_t signed_pre_key_id, void* user_data)
 
     /* Long term storage */
     auto_gchar gchar* signed_pre_key_id_str = g_strdup_printf("%d", signed_pre_key_id);
-    g_key_file_remove_key(omemo_identity_keyfile(), OMEMO_STORE_GROUP_PREKEYS, signed_pre_key_id_str, NULL);
+    omemo_identity_keyfile_remove(OMEMO_STORE_GROUP_SIGNED_PREKEYS, signed_pre_key_id_str);
 
     omemo_identity_keyfile_save();
 
@@ -365,7 +365,7 @@ save_identity(const signal_protocol_address* address, uint8_t* key_data,
     /* Long term storage */
     auto_gchar gchar* key_b64 = g_base64_encode(key_data, key_len);
     auto_gchar gchar* device_id = g_strdup_printf("%d", address->device_id);
-    g_key_file_set_string(omemo_trust_keyfile(), address->name, device_id, key_b64);
+    omemo_trust_keyfile_set(address->name, device_id, key_b64);
 
     omemo_trust_keyfile_save();
 
@@ -39,9 +39,52 @@
 
 static GHashTable* plugins;
 
+// plugins implementing each stanza hook, so the xmpp layer only serializes
+// stanzas when somebody is listening
+static GList* stanza_hooks[STANZA_HOOK_COUNT];
+
+static const char* const stanza_hook_names[STANZA_HOOK_COUNT] = {
+    [STANZA_HOOK_MESSAGE_SEND] = "prof_on_message_stanza_send",
+    [STANZA_HOOK_MESSAGE_RECEIVE] = "prof_on_message_stanza_receive",
+    [STANZA_HOOK_PRESENCE_SEND] = "prof_on_presence_stanza_send",
+    [STANZA_HOOK_PRESENCE_RECEIVE] = "prof_on_presence_stanza_receive",
+    [STANZA_HOOK_IQ_SEND] = "prof_on_iq_stanza_send",
+    [STANZA_HOOK_IQ_RECEIVE] = "prof_on_iq_stanza_receive",
+};
+
+static void
+_plugins_clear_stanza_hooks(void)
+{
+    for (int i = 0; i < STANZA_HOOK_COUNT; i++) {
+        g_list_free(stanza_hooks[i]);
+        stanza_hooks[i] = NULL;
+    }
+}
+
+static void
+_plugins_update_stanza_hooks(void)
+{
+    _plugins_clear_stanza_hooks();
+
+    GList* values = g_hash_table_get_values(plugins);
+    GList* curr = values;
+    while (curr) {
+        ProfPlugin* plugin = curr->data;
+        for (int i = 0; i < STANZA_HOOK_COUNT; i++) {
+            if (plugin->contains_hook(plugin, stanza_hook_names[i])) {
+                stanza_hooks[i] = g_list_append(stanza_hooks[i], plugin);
+            }
+        }
+        curr = g_list_next(curr);
+    }
+    g_list_free(values);
+}
+
 static void
 _plugins_shutdown(void)
 {
+    _plugins_clear_stanza_hooks();
+
     GList* values = g_hash_table_get_values(plugins);
     GList *curr = values, *next;
 
@@ -128,6 +171,8 @@ plugins_init(void)
         }
     }
 
+    _plugins_update_stanza_hooks();
+
     // initialise plugins
     GList* values = g_hash_table_get_values(plugins);
     GList* curr = values;
@@ -263,6 +308,7 @@ plugins_load(const char* const name, GString* error_message)
     }
     if (plugin) {
         g_hash_table_insert(plugins, g_strdup(name), plugin);
+        _plugins_update_stanza_hooks();
         if (connection_get_status() == JABBER_CONNECTED) {
             plugin->init_func(plugin, PACKAGE_VERSION, PACKAGE_STATUS, session_get_account_name(), connection_get_fulljid());
         } else {
@@ -309,6 +355,9 @@ plugins_unload(const char* const name)
     ProfPlugin* plugin = g_hash_table_lookup(plugins, name);
     if (plugin) {
         plugin->on_unload_func(plugin);
+        for (int i = 0; i < STANZA_HOOK_COUNT; i++) {
+            stanza_hooks[i] = g_list_remove(stanza_hooks[i], plugin);
+        }
 #ifdef HAVE_PYTHON
         if (plugin->lang == LANG_PYTHON) {
             python_plugin_destroy(plugin);
@@ -760,28 +809,30 @@ plugins_post_priv_message_send(const char* const fulljid, const char* const mess
     g_list_free(values);
 }
 
+gboolean
+plugins_has_stanza_hook(stanza_hook_t hook)
+{
+    return stanza_hooks[hook] != NULL;
+}
+
 char*
 plugins_on_message_stanza_send(const char* const text)
 {
-    GList* values = g_hash_table_get_values(plugins);
-    if (!values) {
+    if (!stanza_hooks[STANZA_HOOK_MESSAGE_SEND]) {
         return NULL;
     }
 
     gchar* new_stanza = NULL;
     gchar* curr_stanza = g_strdup(text);
 
-    GList* curr = values;
-    while (curr) {
+    for (GList* curr = stanza_hooks[STANZA_HOOK_MESSAGE_SEND]; curr; curr = g_list_next(curr)) {
         ProfPlugin* plugin = curr->data;
         new_stanza = plugin->on_message_stanza_send(plugin, curr_stanza);
         if (new_stanza) {
             g_free(curr_stanza);
             curr_stanza = new_stanza;
         }
-        curr = g_list_next(curr);
     }
-    g_list_free(values);
 
     return curr_stanza;
 }
@@ -791,17 +842,13 @@ plugins_on_message_stanza_receive(const char* const text)
 {
     gboolean cont = TRUE;
 
-    GList* values = g_hash_table_get_values(plugins);
-    GList* curr = values;
-    while (curr) {
+    for (GList* curr = stanza_hooks[STANZA_HOOK_MESSAGE_RECEIVE]; curr; curr = g_list_next(curr)) {
         ProfPlugin* plugin = curr->data;
         gboolean res = plugin->on_message_stanza_receive(plugin, text);
         if (res == FALSE) {
             cont = FALSE;
         }
-        curr = g_list_next(curr);
     }
-    g_list_free(values);
 
     return cont;
 }
@@ -809,25 +856,21 @@ plugins_on_message_stanza_receive(const char* const text)
 char*
 plugins_on_presence_stanza_send(const char* const text)
 {
-    GList* values = g_hash_table_get_values(plugins);
-    if (!values) {
+    if (!stanza_hooks[STANZA_HOOK_PRESENCE_SEND]) {
         return NULL;
     }
 
     gchar* new_stanza = NULL;
     gchar* curr_stanza = g_strdup(text);
 
-    GList* curr = values;
-    while (curr) {
+    for (GList* curr = stanza_hooks[STANZA_HOOK_PRESENCE_SEND]; curr; curr = g_list_next(curr)) {
         ProfPlugin* plugin = curr->data;
         new_stanza = plugin->on_presence_stanza_send(plugin, curr_stanza);
         if (new_stanza) {
             g_free(curr_stanza);
             curr_stanza = new_stanza;
         }
-        curr = g_list_next(curr);
     }
-    g_list_free(values);
 
     return curr_stanza;
 }
@@ -837,17 +880,13 @@ plugins_on_presence_stanza_receive(const char* const text)
 {
     gboolean cont = TRUE;
 
-    GList* values = g_hash_table_get_values(plugins);
-    GList* curr = values;
-    while (curr) {
+    for (GList* curr = stanza_hooks[STANZA_HOOK_PRESENCE_RECEIVE]; curr; curr = g_list_next(curr)) {
         ProfPlugin* plugin = curr->data;
         gboolean res = plugin->on_presence_stanza_receive(plugin, text);
         if (res == FALSE) {
             cont = FALSE;
         }
-        curr = g_list_next(curr);
     }
-    g_list_free(values);
 
     return cont;
 }
@@ -855,25 +894,21 @@ plugins_on_presence_stanza_receive(const char* const text)
 char*
 plugins_on_iq_stanza_send(const char* const text)
 {
-    GList* values = g_hash_table_get_values(plugins);
-    if (!values) {
+    if (!stanza_hooks[STANZA_HOOK_IQ_SEND]) {
         return NULL;
     }
 
     char* new_stanza = NULL;
     char* curr_stanza = g_strdup(text);
 
-    GList* curr = values;
-    while (curr) {
+    for (GList* curr = stanza_hooks[STANZA_HOOK_IQ_SEND]; curr; curr = g_list_next(curr)) {
         ProfPlugin* plugin = curr->data;
         new_stanza = plugin->on_iq_stanza_send(plugin, curr_stanza);
         if (new_stanza) {
             g_free(curr_stanza);
             curr_stanza = new_stanza;
         }
-        curr = g_list_next(curr);
     }
-    g_list_free(values);
 
     return curr_stanza;
 }
@@ -883,17 +918,13 @@ plugins_on_iq_stanza_receive(const char* const text)
 {
     gboolean cont = TRUE;
 
-    GList* values = g_hash_table_get_values(plugins);
-    GList* curr = values;
-    while (curr) {
+    for (GList* curr = stanza_hooks[STANZA_HOOK_IQ_RECEIVE]; curr; curr = g_list_next(curr)) {
         ProfPlugin* plugin = curr->data;
         gboolean res = plugin->on_iq_stanza_receive(plugin, text);
         if (res == FALSE) {
             cont = FALSE;
         }
-        curr = g_list_next(curr);
     }
-    g_list_free(values);
 
     return cont;
 }
@@ -17,6 +17,16 @@ typedef enum {
     LANG_C
 } lang_t;
 
+typedef enum {
+    STANZA_HOOK_MESSAGE_SEND,
+    STANZA_HOOK_MESSAGE_RECEIVE,
+    STANZA_HOOK_PRESENCE_SEND,
+    STANZA_HOOK_PRESENCE_RECEIVE,
+    STANZA_HOOK_IQ_SEND,
+    STANZA_HOOK_IQ_RECEIVE,
+    STANZA_HOOK_COUNT
+} stanza_hook_t;
+
 typedef struct prof_plugins_install_t
 {
     GSList* installed;
@@ -126,6 +136,8 @@ void plugins_post_priv_message_send(const char* const fulljid, const char* const
 void plugins_win_process_line(char* win, const char* const line);
 void plugins_close_win(const char* const plugin_name, const char* const tag);
 
+gboolean plugins_has_stanza_hook(stanza_hook_t hook);
+
 char* plugins_on_message_stanza_send(const char* const text);
 gboolean plugins_on_message_stanza_receive(const char* const text);
 
@@ -31,6 +31,7 @@
 #include "config/preferences.h"
 #include "config/theme.h"
 #include "tools/spellcheck.h"
+#include "tools/transfer.h"
 #include "config/tlscerts.h"
 #include "config/scripts.h"
 #include "command/cmd_defs.h"
@@ -137,8 +138,10 @@ prof_run(gchar* log_level, gchar* account_name, gchar* config_file, gchar* log_f
         plugins_run_timed();
         notify_remind();
         session_process_events();
+        transfer_process();
+        spellcheck_process();
         iq_autoping_check();
-        ui_update();
+        ui_frame();
         while (g_main_context_iteration(NULL, FALSE))
             ;
 #ifdef HAVE_GTK
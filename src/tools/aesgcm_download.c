@@ -17,7 +17,7 @@
 #include <sys/types.h>
 #include <curl/curl.h>
 #include <gio/gio.h>
-#include <pthread.h>
+#include <unistd.h>
 #include <assert.h>
 #include <errno.h>
 
@@ -31,98 +31,64 @@
 #include "ui/window.h"
 #include "common.h"
 
-void*
-aesgcm_file_get(void* userdata)
+static void
+_aesgcm_download_free(AESGCMDownload* aesgcm_dl)
 {
-    AESGCMDownload* aesgcm_dl = (AESGCMDownload*)userdata;
-
-    auto_char char* https_url = NULL;
-    auto_char char* fragment = NULL;
-
-    // Convert the aesgcm:// URL to a https:// URL and extract the encoded key
-    // and tag stored in the URL fragment.
-    if (omemo_parse_aesgcm_url(aesgcm_dl->url, &https_url, &fragment) != 0) {
-        cons_show_error("Download failed: Cannot parse URL '%s'.", aesgcm_dl->url);
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->id, THEME_ERROR, ENTRY_ERROR,
-                                   "Download failed: Cannot parse URL '%s'.",
-                                   aesgcm_dl->url);
-        return NULL;
-    }
+    free(aesgcm_dl->id);
+    free(aesgcm_dl->filename);
+    free(aesgcm_dl->url);
+    free(aesgcm_dl->cmd_template);
+    free(aesgcm_dl->fragment);
+    omemo_file_stream_free(aesgcm_dl->stream);
+    free(aesgcm_dl);
+}
 
-    // Create a temporary file used for storing the ciphertext that is to be
-    // retrieved from the https:// URL.
-    auto_gchar gchar* tmpname = NULL;
-    auto_gfd gint tmpfd = 0;
-    if ((tmpfd = g_file_open_tmp("profanity.XXXXXX", &tmpname, NULL)) == -1) {
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->id, THEME_ERROR, ENTRY_ERROR,
-                                   "Downloading '%s' failed: Unable to create "
-                                   "temporary ciphertext file for writing "
-                                   "(%s).",
-                                   https_url, g_strerror(errno));
-        return NULL;
-    }
+static gboolean
+_aesgcm_download_write(HTTPDownload* http_dl, const char* data, size_t size, void* userdata)
+{
+    AESGCMDownload* aesgcm_dl = (AESGCMDownload*)userdata;
 
-    // Open the target file for storing the cleartext.
-    auto_FILE FILE* outfh = fopen(aesgcm_dl->filename, "wb");
-    if (outfh == NULL) {
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->id, THEME_ERROR, ENTRY_ERROR,
-                                   "Downloading '%s' failed: Unable to open "
-                                   "output file at '%s' for writing (%s).",
-                                   https_url, aesgcm_dl->filename,
-                                   g_strerror(errno));
-        return NULL;
+    gcry_error_t crypt_res = omemo_file_stream_write(aesgcm_dl->stream, http_dl->filehandle, data, size);
+    if (crypt_res != GPG_ERR_NO_ERROR) {
+        http_dl->error = g_strdup_printf("Failed to decrypt file (%s).",
+                                         gcry_strerror(crypt_res));
+        return FALSE;
     }
 
-    // We wrap the HTTPDownload tool and use it for retrieving the ciphertext
-    // and storing it in the temporary file previously opened.
-    HTTPDownload* http_dl = g_new0(HTTPDownload, 1);
-    http_dl->window = aesgcm_dl->window;
-    http_dl->worker = aesgcm_dl->worker;
-    http_dl->id = strdup(aesgcm_dl->id);
-    http_dl->url = strdup(https_url);
-    http_dl->display_url = strdup(aesgcm_dl->url);
-    http_dl->filename = strdup(tmpname);
-    http_dl->cmd_template = NULL;
-    http_dl->silent = FALSE;
-    http_dl->silent_done = TRUE;
-    http_dl->return_bytes_received = TRUE;
-    aesgcm_dl->http_dl = http_dl;
+    return TRUE;
+}
 
-    ssize_t* p_bytes_received = http_file_get(http_dl);
-    if (!p_bytes_received) {
-        return NULL;
-    }
-    ssize_t bytes_received = *p_bytes_received;
-    free(p_bytes_received);
+static void
+_aesgcm_download_flush(HTTPDownload* http_dl, void* userdata)
+{
+    AESGCMDownload* aesgcm_dl = (AESGCMDownload*)userdata;
 
-    FILE* tmpfh = fopen(tmpname, "rb");
-    if (tmpfh == NULL) {
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->id, THEME_ERROR, ENTRY_ERROR,
-                                   "Downloading '%s' failed: Unable to open "
-                                   "temporary file at '%s' for reading (%s).",
-                                   aesgcm_dl->url, tmpname,
-                                   g_strerror(errno));
-        return NULL;
+    gcry_error_t crypt_res = omemo_file_stream_finish(aesgcm_dl->stream, http_dl->filehandle);
+    if (crypt_res != GPG_ERR_NO_ERROR) {
+        http_dl->error = g_strdup_printf("Failed to decrypt file (%s).",
+                                         gcry_strerror(crypt_res));
     }
+}
 
-    gcry_error_t crypt_res;
-    crypt_res = omemo_decrypt_file(tmpfh, outfh,
-                                   bytes_received, fragment);
-    fclose(tmpfh);
-    remove(tmpname);
+static void
+_aesgcm_download_done(HTTPDownload* http_dl, void* userdata)
+{
+    AESGCMDownload* aesgcm_dl = (AESGCMDownload*)userdata;
 
-    if (crypt_res != GPG_ERR_NO_ERROR) {
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->id, THEME_ERROR, ENTRY_ERROR,
-                                   "Downloading '%s' failed: Failed to decrypt "
-                                   "file (%s).",
-                                   aesgcm_dl->url, gcry_strerror(crypt_res));
-    } else {
-        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->id, THEME_ONLINE, ENTRY_COMPLETED,
-                                   "Downloading '%s': done\nSaved to '%s'",
-                                   aesgcm_dl->url, aesgcm_dl->filename);
-        win_mark_received(aesgcm_dl->window, aesgcm_dl->id);
+    if (!http_download_report(http_dl)) {
+        // Don't leave plaintext behind that failed to authenticate or that
+        // was cut off.
+        if (http_dl->created) {
+            remove(aesgcm_dl->filename);
+        }
+        goto out;
     }
 
+    http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->id, THEME_ONLINE, ENTRY_COMPLETED,
+                               "Downloading '%s': done\nSaved to '%s'",
+                               aesgcm_dl->url, aesgcm_dl->filename);
+    win_mark_received(aesgcm_dl->window, aesgcm_dl->id);
+
     if (aesgcm_dl->cmd_template != NULL) {
         gchar** argv = format_call_external_argv(aesgcm_dl->cmd_template,
                                                  aesgcm_dl->filename,
@@ -140,25 +106,63 @@ aesgcm_file_get(void* userdata)
         }
 
         g_strfreev(argv);
-        free(aesgcm_dl->cmd_template);
     }
 
-    free(aesgcm_dl->id);
-    free(aesgcm_dl->filename);
-    free(aesgcm_dl->url);
-    free(aesgcm_dl);
-
-    return NULL;
+out:
+    http_download_free(http_dl);
+    _aesgcm_download_free(aesgcm_dl);
 }
 
 void
-aesgcm_download_cancel_processes(ProfWin* window)
+aesgcm_download_start(AESGCMDownload* aesgcm_dl)
 {
-    http_download_cancel_processes(window);
+    auto_char char* https_url = NULL;
+
+    // Convert the aesgcm:// URL to a https:// URL and extract the encoded key
+    // and tag stored in the URL fragment.
+    if (omemo_parse_aesgcm_url(aesgcm_dl->url, &https_url, &aesgcm_dl->fragment) != 0) {
+        cons_show_error("Download failed: Cannot parse URL '%s'.", aesgcm_dl->url);
+        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->id, THEME_ERROR, ENTRY_ERROR,
+                                   "Download failed: Cannot parse URL '%s'.",
+                                   aesgcm_dl->url);
+        _aesgcm_download_free(aesgcm_dl);
+        return;
+    }
+
+    gcry_error_t crypt_res;
+    aesgcm_dl->stream = omemo_decrypt_file_stream(aesgcm_dl->fragment, &crypt_res);
+    if (!aesgcm_dl->stream) {
+        http_print_transfer_update(aesgcm_dl->window, aesgcm_dl->id, THEME_ERROR, ENTRY_ERROR,
+                                   "Downloading '%s' failed: Failed to decrypt file (%s).",
+                                   aesgcm_dl->url, gcry_strerror(crypt_res));
+        _aesgcm_download_free(aesgcm_dl);
+        return;
+    }
+
+    // We wrap the HTTPDownload tool and decrypt the ciphertext on its way
+    // from the https:// URL into the output file.
+    HTTPDownload* http_dl = g_new0(HTTPDownload, 1);
+    http_dl->window = aesgcm_dl->window;
+    http_dl->id = strdup(aesgcm_dl->id);
+    http_dl->url = strdup(https_url);
+    http_dl->display_url = strdup(aesgcm_dl->url);
+    http_dl->filename = strdup(aesgcm_dl->filename);
+    http_dl->cmd_template = NULL;
+    http_dl->silent = FALSE;
+    http_dl->silent_done = TRUE;
+    http_dl->priority = TRANSFER_PRIORITY_NORMAL;
+    http_dl->done = _aesgcm_download_done;
+    http_dl->done_data = aesgcm_dl;
+    http_dl->write_func = _aesgcm_download_write;
+    http_dl->flush_func = _aesgcm_download_flush;
+    http_dl->write_data = aesgcm_dl;
+    aesgcm_dl->http_dl = http_dl;
+
+    http_download_start(http_dl);
 }
 
 void
-aesgcm_download_add_download(AESGCMDownload* aesgcm_dl)
+aesgcm_download_cancel_processes(ProfWin* window)
 {
-    http_download_add_download(aesgcm_dl->http_dl);
+    http_download_cancel_processes(window);
 }
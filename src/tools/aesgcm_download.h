@@ -29,13 +29,16 @@ typedef struct aesgcm_download_t
     char* filename;
     char* cmd_template;
     ProfWin* window;
-    pthread_t worker;
     HTTPDownload* http_dl;
+    // key and tag from the URL fragment
+    char* fragment;
+    struct omemo_file_stream_t* stream;
 } AESGCMDownload;
 
-void* aesgcm_file_get(void* userdata);
+// Takes ownership of the download, fetches it with the transfer manager and
+// decrypts it into filename while it is received.
+void aesgcm_download_start(AESGCMDownload* aesgcm_dl);
 
 void aesgcm_download_cancel_processes(ProfWin* window);
-void aesgcm_download_add_download(AESGCMDownload* download);
 
 #endif
@@ -24,29 +24,124 @@ typedef enum {
     NEXT
 } search_direction;
 
+typedef struct autocomplete_item_t
+{
+    char* value;
+    // matching forms of value, computed on the first search that reaches it
+    gchar* fold;
+    gchar* ascii_lower;
+} AutocompleteItem;
+
 struct autocomplete_t
 {
-    GList* items;
-    GList* last_found;
+    // sorted by strcmp() unless items were added with autocomplete_add_unsorted()
+    GPtrArray* items;
+    // value -> AutocompleteItem, for membership tests
+    GHashTable* index;
+    gboolean unsorted;
+    AutocompleteItem* last_found;
     gchar* search_str;
 };
 
-static gchar* _search(Autocomplete ac, GList* curr, gboolean quote, search_direction direction);
+static gchar* _search(Autocomplete ac, gint curr, gboolean quote, search_direction direction);
+
+static void
+_item_free(AutocompleteItem* item)
+{
+    if (item) {
+        free(item->value);
+        g_free(item->fold);
+        g_free(item->ascii_lower);
+        g_free(item);
+    }
+}
+
+static AutocompleteItem*
+_item_new(const char* value)
+{
+    AutocompleteItem* item = g_new0(AutocompleteItem, 1);
+    item->value = strdup(value);
+    return item;
+}
+
+static gint
+_item_cmp(gconstpointer a, gconstpointer b)
+{
+    const AutocompleteItem* item_a = *(AutocompleteItem* const*)a;
+    const AutocompleteItem* item_b = *(AutocompleteItem* const*)b;
+    return strcmp(item_a->value, item_b->value);
+}
+
+// position of the first item not less than value in a sorted autocompleter
+static guint
+_lower_bound(Autocomplete ac, const char* value)
+{
+    guint lo = 0;
+    guint hi = ac->items->len;
+
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        AutocompleteItem* item = g_ptr_array_index(ac->items, mid);
+        if (strcmp(item->value, value) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+static gint
+_index_of(Autocomplete ac, AutocompleteItem* item)
+{
+    if (!ac->unsorted) {
+        guint pos = _lower_bound(ac, item->value);
+        if (pos < ac->items->len && g_ptr_array_index(ac->items, pos) == item) {
+            return pos;
+        }
+        return -1;
+    }
+
+    for (guint i = 0; i < ac->items->len; i++) {
+        if (g_ptr_array_index(ac->items, i) == item) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void
+_remove_index(Autocomplete ac, guint pos)
+{
+    AutocompleteItem* item = g_ptr_array_index(ac->items, pos);
+
+    // reset last found if it points to the item to be removed
+    if (ac->last_found == item) {
+        ac->last_found = NULL;
+    }
+
+    g_hash_table_remove(ac->index, item->value);
+    g_ptr_array_remove_index(ac->items, pos);
+}
 
 Autocomplete
 autocomplete_new(void)
 {
-    return g_new0(struct autocomplete_t, 1);
+    Autocomplete ac = g_new0(struct autocomplete_t, 1);
+    ac->items = g_ptr_array_new_with_free_func((GDestroyNotify)_item_free);
+    ac->index = g_hash_table_new(g_str_hash, g_str_equal);
+    return ac;
 }
 
 void
 autocomplete_clear(Autocomplete ac)
 {
     if (ac) {
-        if (ac->items) {
-            g_list_free_full(ac->items, free);
-            ac->items = NULL;
-        }
+        g_hash_table_remove_all(ac->index);
+        g_ptr_array_set_size(ac->items, 0);
+        ac->unsorted = FALSE;
 
         autocomplete_reset(ac);
     }
@@ -64,6 +159,8 @@ autocomplete_free(Autocomplete ac)
 {
     if (ac) {
         autocomplete_clear(ac);
+        g_hash_table_destroy(ac->index);
+        g_ptr_array_free(ac->items, TRUE);
         free(ac);
     }
 }
@@ -73,10 +170,8 @@ autocomplete_length(Autocomplete ac)
 {
     if (!ac) {
         return 0;
-    } else if (!ac->items) {
-        return 0;
     } else {
-        return g_list_length(ac->items);
+        return ac->items->len;
     }
 }
 
@@ -87,7 +182,7 @@ autocomplete_update(Autocomplete ac, char** items)
     auto_gchar gchar* search_str = NULL;
 
     if (ac->last_found) {
-        last_found = strdup(ac->last_found->data);
+        last_found = strdup(ac->last_found->value);
     }
 
     if (ac->search_str) {
@@ -99,7 +194,7 @@ autocomplete_update(Autocomplete ac, char** items)
 
     if (last_found) {
         // NULL if last_found was removed on update.
-        ac->last_found = g_list_find_custom(ac->items, last_found, (GCompareFunc)strcmp);
+        ac->last_found = g_hash_table_lookup(ac->index, last_found);
     }
 
     if (search_str) {
@@ -111,20 +206,19 @@ void
 autocomplete_add_unsorted(Autocomplete ac, const char* item, const gboolean is_reversed)
 {
     if (ac) {
-        char* item_cpy;
-        GList* curr = g_list_find_custom(ac->items, item, (GCompareFunc)strcmp);
-
         // if item already exists
-        if (curr) {
+        if (g_hash_table_contains(ac->index, item)) {
             return;
         }
 
-        item_cpy = strdup(item);
+        AutocompleteItem* new_item = _item_new(item);
+        g_hash_table_insert(ac->index, new_item->value, new_item);
+        ac->unsorted = TRUE;
 
         if (is_reversed) {
-            ac->items = g_list_prepend(ac->items, item_cpy);
+            g_ptr_array_insert(ac->items, 0, new_item);
         } else {
-            ac->items = g_list_append(ac->items, item_cpy);
+            g_ptr_array_add(ac->items, new_item);
         }
     }
 }
@@ -133,24 +227,61 @@ void
 autocomplete_add(Autocomplete ac, const char* item)
 {
     if (ac) {
-        char* item_cpy;
-        GList* curr = g_list_find_custom(ac->items, item, (GCompareFunc)strcmp);
-
         // if item already exists
-        if (curr) {
+        if (g_hash_table_contains(ac->index, item)) {
             return;
         }
 
-        item_cpy = strdup(item);
-        ac->items = g_list_insert_sorted(ac->items, item_cpy, (GCompareFunc)strcmp);
+        AutocompleteItem* new_item = _item_new(item);
+        g_hash_table_insert(ac->index, new_item->value, new_item);
+
+        guint pos = 0;
+        if (ac->unsorted) {
+            // before the first greater item, like an insert into a sorted list
+            while (pos < ac->items->len) {
+                AutocompleteItem* curr = g_ptr_array_index(ac->items, pos);
+                if (strcmp(curr->value, item) > 0) {
+                    break;
+                }
+                pos++;
+            }
+        } else {
+            pos = _lower_bound(ac, item);
+        }
+        g_ptr_array_insert(ac->items, pos, new_item);
     }
 }
 
+/* Add a NULL terminated list of items. The items are appended and sorted once
+ * instead of being inserted one by one. */
 void
 autocomplete_add_all(Autocomplete ac, char** items)
 {
-    for (guint i = 0; i < g_strv_length(items); i++) {
-        autocomplete_add(ac, items[i]);
+    if (!ac || !items) {
+        return;
+    }
+
+    if (ac->unsorted) {
+        for (guint i = 0; items[i]; i++) {
+            autocomplete_add(ac, items[i]);
+        }
+        return;
+    }
+
+    guint added = 0;
+    for (guint i = 0; items[i]; i++) {
+        if (g_hash_table_contains(ac->index, items[i])) {
+            continue;
+        }
+
+        AutocompleteItem* new_item = _item_new(items[i]);
+        g_hash_table_insert(ac->index, new_item->value, new_item);
+        g_ptr_array_add(ac->items, new_item);
+        added++;
+    }
+
+    if (added > 0) {
+        g_ptr_array_sort(ac->items, _item_cmp);
     }
 }
 
@@ -158,19 +289,16 @@ void
 autocomplete_remove(Autocomplete ac, const char* const item)
 {
     if (ac) {
-        GList* curr = g_list_find_custom(ac->items, item, (GCompareFunc)strcmp);
+        AutocompleteItem* found = g_hash_table_lookup(ac->index, item);
 
-        if (!curr) {
+        if (!found) {
             return;
         }
 
-        // reset last found if it points to the item to be removed
-        if (ac->last_found == curr) {
-            ac->last_found = NULL;
+        gint pos = _index_of(ac, found);
+        if (pos >= 0) {
+            _remove_index(ac, pos);
         }
-
-        free(curr->data);
-        ac->items = g_list_delete_link(ac->items, curr);
     }
 
     return;
@@ -188,11 +316,10 @@ GList*
 autocomplete_create_list(Autocomplete ac)
 {
     GList* copy = NULL;
-    GList* curr = ac->items;
 
-    while (curr) {
-        copy = g_list_append(copy, strdup(curr->data));
-        curr = g_list_next(curr);
+    for (guint i = ac->items->len; i > 0; i--) {
+        AutocompleteItem* item = g_ptr_array_index(ac->items, i - 1);
+        copy = g_list_prepend(copy, strdup(item->value));
     }
 
     return copy;
@@ -201,16 +328,7 @@ autocomplete_create_list(Autocomplete ac)
 gboolean
 autocomplete_contains(Autocomplete ac, const char* value)
 {
-    GList* curr = ac->items;
-
-    while (curr) {
-        if (strcmp(curr->data, value) == 0) {
-            return TRUE;
-        }
-        curr = g_list_next(curr);
-    }
-
-    return FALSE;
+    return g_hash_table_contains(ac->index, value);
 }
 
 gchar*
@@ -224,7 +342,7 @@ autocomplete_complete(Autocomplete ac, const gchar* search_str, gboolean quote,
     }
 
     // no items to search
-    if (!ac->items) {
+    if (ac->items->len == 0) {
         return NULL;
     }
 
@@ -244,21 +362,23 @@ autocomplete_complete(Autocomplete ac, const gchar* search_str, gboolean quote,
         }
         ac->search_str = g_string_free(unescaped, FALSE);
 
-        found = _search(ac, ac->items, quote, NEXT);
+        found = _search(ac, 0, quote, NEXT);
 
         return found;
 
         // subsequent search attempt
     } else {
+        gint last = _index_of(ac, ac->last_found);
+
         if (previous) {
             // search from here-1 to beginning
-            found = _search(ac, g_list_previous(ac->last_found), quote, PREVIOUS);
+            found = _search(ac, last - 1, quote, PREVIOUS);
             if (found) {
                 return found;
             }
         } else {
             // search from here+1 to end
-            found = _search(ac, g_list_next(ac->last_found), quote, NEXT);
+            found = _search(ac, last + 1, quote, NEXT);
             if (found) {
                 return found;
             }
@@ -266,13 +386,13 @@ autocomplete_complete(Autocomplete ac, const gchar* search_str, gboolean quote,
 
         if (previous) {
             // search from end
-            found = _search(ac, g_list_last(ac->items), quote, PREVIOUS);
+            found = _search(ac, ac->items->len - 1, quote, PREVIOUS);
             if (found) {
                 return found;
             }
         } else {
             // search from beginning
-            found = _search(ac, ac->items, quote, NEXT);
+            found = _search(ac, 0, quote, NEXT);
             if (found) {
                 return found;
             }
@@ -368,52 +488,52 @@ void
 autocomplete_remove_older_than_max_reverse(Autocomplete ac, int maxsize)
 {
     if (autocomplete_length(ac) > maxsize) {
-        GList* last = g_list_last(ac->items);
-        if (last) {
-            free(last->data);
-            ac->items = g_list_delete_link(ac->items, last);
-        }
+        _remove_index(ac, ac->items->len - 1);
     }
 }
 
 static gchar*
-_search(Autocomplete ac, GList* curr, gboolean quote, search_direction direction)
+_search(Autocomplete ac, gint curr, gboolean quote, search_direction direction)
 {
     auto_gchar gchar* search_str_fold = g_utf8_casefold(ac->search_str, -1);
     auto_gchar gchar* search_str_ascii = g_str_to_ascii(ac->search_str, NULL);
     auto_gchar gchar* search_str_ascii_lower = g_ascii_strdown(search_str_ascii, -1);
 
-    while (curr) {
+    // We only use transliterated match if the search string conversion didn't result
+    // in unknown characters ('?'), to avoid false matches between different scripts.
+    gboolean use_ascii = strchr(search_str_ascii_lower, '?') == NULL;
+
+    while (curr >= 0 && (guint)curr < ac->items->len) {
+        AutocompleteItem* item = g_ptr_array_index(ac->items, curr);
         gboolean match = FALSE;
 
         // Try exact UTF-8 case insensitive match
-        auto_gchar gchar* curr_fold = g_utf8_casefold(curr->data, -1);
-        if (g_str_has_prefix(curr_fold, search_str_fold)) {
+        if (!item->fold) {
+            item->fold = g_utf8_casefold(item->value, -1);
+        }
+        if (g_str_has_prefix(item->fold, search_str_fold)) {
             match = TRUE;
         }
 
         // Try transliterated match (allow typing 'e' for 'è')
-        if (!match) {
-            auto_gchar gchar* curr_ascii = g_str_to_ascii(curr->data, NULL);
-            auto_gchar gchar* curr_ascii_lower = g_ascii_strdown(curr_ascii, -1);
-
-            // We only use transliterated match if the search string conversion didn't result
-            // in unknown characters ('?'), to avoid false matches between different scripts.
-            if (strchr(search_str_ascii_lower, '?') == NULL) {
-                if (g_str_has_prefix(curr_ascii_lower, search_str_ascii_lower)) {
-                    match = TRUE;
-                }
+        if (!match && use_ascii) {
+            if (!item->ascii_lower) {
+                auto_gchar gchar* curr_ascii = g_str_to_ascii(item->value, NULL);
+                item->ascii_lower = g_ascii_strdown(curr_ascii, -1);
+            }
+            if (g_str_has_prefix(item->ascii_lower, search_str_ascii_lower)) {
+                match = TRUE;
             }
         }
 
         if (match) {
             // set pointer to last found
-            ac->last_found = curr;
+            ac->last_found = item;
 
             // if contains space, quote before returning
-            if (quote && g_strrstr(curr->data, " ")) {
+            if (quote && g_strrstr(item->value, " ")) {
                 GString* escaped = g_string_new("\"");
-                for (const char* p = curr->data; *p; p++) {
+                for (const char* p = item->value; *p; p++) {
                     if (*p == '"' || *p == '\\') {
                         g_string_append_c(escaped, '\\');
                     }
@@ -423,14 +543,14 @@ _search(Autocomplete ac, GList* curr, gboolean quote, search_direction direction
                 return g_string_free(escaped, FALSE);
                 // otherwise just return the string
             } else {
-                return strdup(curr->data);
+                return strdup(item->value);
             }
         }
 
         if (direction == PREVIOUS) {
-            curr = g_list_previous(curr);
+            curr--;
         } else {
-            curr = g_list_next(curr);
+            curr++;
         }
     }
 
@@ -20,8 +20,14 @@
 
 #include "ui/win_types.h"
 #include "tools/http_common.h"
+#include "tools/transfer.h"
 
-typedef struct http_download_t
+typedef struct http_download_t HTTPDownload;
+
+typedef void (*http_download_func)(HTTPDownload* download, void* userdata);
+typedef gboolean (*http_download_write_func)(HTTPDownload* download, const char* data, size_t size, void* userdata);
+
+struct http_download_t
 {
     char* id;
     char* url;
@@ -29,17 +35,39 @@ typedef struct http_download_t
     char* filename;
     char* cmd_template;
     curl_off_t bytes_received;
+    unsigned int percent;
     ProfWin* window;
-    pthread_t worker;
-    int cancel;
+    gboolean cancel;
     gboolean silent;
     gboolean silent_done;
-    gboolean return_bytes_received;
-} HTTPDownload;
+    transfer_priority_t priority;
+    // If set it is called instead of reporting the result once the download
+    // ended, and then owns the download.
+    http_download_func done;
+    void* done_data;
+    // If set the received data goes through write_func into filehandle
+    // instead of being written as is, e.g. to decrypt it on the fly, and
+    // flush is called once the transfer completed, before the file gets
+    // closed. Both set error when they fail.
+    http_download_write_func write_func;
+    http_download_func flush_func;
+    void* write_data;
+    // owned by the download
+    FILE* filehandle;
+    // filename was opened for writing, a failed download leaves it behind
+    gboolean created;
+    Transfer* transfer;
+    // why the download failed, NULL if it didn't
+    gchar* error;
+};
+
+// Takes ownership of the download and queues it on the transfer manager.
+void http_download_start(HTTPDownload* download);
 
-void* http_file_get(void* userdata);
+// Print how the download ended, returns TRUE if it succeeded.
+gboolean http_download_report(HTTPDownload* download);
+void http_download_free(HTTPDownload* download);
 
 void http_download_cancel_processes(ProfWin* window);
-void http_download_add_download(HTTPDownload* download);
 
 #endif
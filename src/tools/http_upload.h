@@ -18,34 +18,53 @@
 #include <curl/curl.h>
 
 #include "ui/win_types.h"
+#include "tools/transfer.h"
 
-typedef struct http_upload_t
+typedef struct http_upload_t HTTPUpload;
+
+typedef gboolean (*http_upload_read_func)(HTTPUpload* upload, char* buffer, size_t size, size_t* bytes, void* userdata);
+typedef gboolean (*http_upload_rewind_func)(HTTPUpload* upload, void* userdata);
+
+struct http_upload_t
 {
     char* filename;
     FILE* filehandle;
     off_t filesize;
     curl_off_t bytes_sent;
+    unsigned int percent;
     char* mime_type;
     char* get_url;
     char* put_url;
     char* alt_scheme;
     char* alt_fragment;
     ProfWin* window;
-    pthread_t worker;
-    int cancel;
+    gboolean cancel;
     // Additional headers
     // (NULL if they shouldn't be send in the PUT)
     char* authorization;
     char* cookie;
     char* expires;
-} HTTPUpload;
+    // If set the body is produced by read_func from filehandle instead of
+    // sending the file as is, e.g. to encrypt it on the fly. filesize is the
+    // size of what it produces and read_data is freed with read_free.
+    // rewind_func starts it over when curl has to send the body again, e.g.
+    // after a redirect, without it such a request fails.
+    http_upload_read_func read_func;
+    http_upload_rewind_func rewind_func;
+    void* read_data;
+    GDestroyNotify read_free;
+    // owned by the upload
+    struct curl_slist* headers;
+    Transfer* transfer;
+};
 
-void* http_file_put(void* userdata);
+// Takes ownership of the upload, sends the file with the transfer manager and
+// the link to the window once it is done.
+void http_upload_start(HTTPUpload* upload);
 
 char* file_mime_type(const char* const filename);
 off_t file_size(int filedes);
 
 void http_upload_cancel_processes(ProfWin* window);
-void http_upload_add_upload(HTTPUpload* upload);
 
 #endif
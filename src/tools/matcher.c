@@ -0,0 +1,310 @@
+/*
+ * matcher.c
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 Michael Vetter <jubalh@iodoru.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later WITH OpenSSL-exception
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "tools/matcher.h"
+
+// An Aho-Corasick automaton over the UTF-8 bytes of the lower cased patterns.
+// The text is lower cased one character at a time while it is fed in, so
+// scanning needs no copy of it.
+
+typedef struct matcher_edge_t
+{
+    guchar byte;
+    guint next;
+} MatcherEdge;
+
+typedef struct matcher_node_t
+{
+    GArray* edges; // MatcherEdge
+    guint fail;
+    gint pattern; // first pattern ending here, -1 if none
+    guint output; // nearest node on the fail chain where a pattern ends, 0 if none
+} MatcherNode;
+
+typedef struct matcher_pattern_t
+{
+    gchar* text;
+    gsize len;
+    glong chars;
+    int id;
+    int flags;
+    gint next; // next pattern with the same lower cased text, -1 if none
+} MatcherPattern;
+
+struct matcher_t
+{
+    GArray* nodes; // MatcherNode, the root is node 0
+    GArray* patterns;
+    glong max_chars;
+    gboolean compiled;
+};
+
+// a character of the scanned text, kept for the length of the longest pattern
+typedef struct matcher_char_t
+{
+    gunichar ch;
+    const char* pos;
+} MatcherChar;
+
+typedef struct matcher_pending_t
+{
+    gint pattern;
+    glong offset;
+    const char* start;
+    gsize len;
+} MatcherPending;
+
+#define NODE(matcher, i) (&g_array_index((matcher)->nodes, MatcherNode, (i)))
+#define PATTERN(matcher, i) (&g_array_index((matcher)->patterns, MatcherPattern, (i)))
+
+static guint
+_node_new(Matcher matcher)
+{
+    MatcherNode node = { 0 };
+    node.edges = g_array_new(FALSE, FALSE, sizeof(MatcherEdge));
+    node.pattern = -1;
+    g_array_append_val(matcher->nodes, node);
+    return matcher->nodes->len - 1;
+}
+
+static gboolean
+_node_child(Matcher matcher, guint node, guchar byte, guint* child)
+{
+    GArray* edges = NODE(matcher, node)->edges;
+    for (guint i = 0; i < edges->len; i++) {
+        MatcherEdge* edge = &g_array_index(edges, MatcherEdge, i);
+        if (edge->byte == byte) {
+            *child = edge->next;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static guint
+_node_step(Matcher matcher, guint node, guchar byte)
+{
+    guint child;
+    while (!_node_child(matcher, node, byte, &child)) {
+        if (node == 0) {
+            return 0;
+        }
+        node = NODE(matcher, node)->fail;
+    }
+    return child;
+}
+
+// breadth first, so the fail target of a node is always done before the node
+static void
+_compile(Matcher matcher)
+{
+    GQueue queue = G_QUEUE_INIT;
+
+    GArray* root_edges = NODE(matcher, 0)->edges;
+    for (guint i = 0; i < root_edges->len; i++) {
+        guint child = g_array_index(root_edges, MatcherEdge, i).next;
+        NODE(matcher, child)->fail = 0;
+        NODE(matcher, child)->output = 0;
+        g_queue_push_tail(&queue, GUINT_TO_POINTER(child));
+    }
+
+    while (!g_queue_is_empty(&queue)) {
+        guint node = GPOINTER_TO_UINT(g_queue_pop_head(&queue));
+        GArray* edges = NODE(matcher, node)->edges;
+
+        for (guint i = 0; i < edges->len; i++) {
+            MatcherEdge edge = g_array_index(edges, MatcherEdge, i);
+            guint fail = _node_step(matcher, NODE(matcher, node)->fail, edge.byte);
+
+            MatcherNode* child = NODE(matcher, edge.next);
+            child->fail = fail;
+            child->output = NODE(matcher, fail)->pattern >= 0 ? fail : NODE(matcher, fail)->output;
+            g_queue_push_tail(&queue, GUINT_TO_POINTER(edge.next));
+        }
+    }
+
+    matcher->compiled = TRUE;
+}
+
+static gboolean
+_is_url_char(gunichar ch)
+{
+    if (ch == 0) {
+        return FALSE;
+    }
+    if (g_unichar_isalnum(ch) || g_unichar_ismark(ch) || ch == '_') {
+        return TRUE;
+    }
+    return ch < 128 && strchr("-.~:/?#[]@!$&'()*+,;=%", (int)ch) != NULL;
+}
+
+Matcher
+matcher_new(void)
+{
+    Matcher matcher = g_new0(struct matcher_t, 1);
+    matcher->nodes = g_array_new(FALSE, FALSE, sizeof(MatcherNode));
+    matcher->patterns = g_array_new(FALSE, FALSE, sizeof(MatcherPattern));
+    _node_new(matcher);
+    return matcher;
+}
+
+void
+matcher_free(Matcher matcher)
+{
+    if (!matcher) {
+        return;
+    }
+
+    for (guint i = 0; i < matcher->nodes->len; i++) {
+        g_array_free(NODE(matcher, i)->edges, TRUE);
+    }
+    for (guint i = 0; i < matcher->patterns->len; i++) {
+        g_free(PATTERN(matcher, i)->text);
+    }
+    g_array_free(matcher->nodes, TRUE);
+    g_array_free(matcher->patterns, TRUE);
+    g_free(matcher);
+}
+
+void
+matcher_add(Matcher matcher, const char* const pattern, int id, int flags)
+{
+    if (!matcher || !pattern || *pattern == '\0') {
+        return;
+    }
+
+    guint node = 0;
+    glong chars = 0;
+    for (const char* p = pattern; *p; p = g_utf8_next_char(p)) {
+        gchar buf[6];
+        gint n = g_unichar_to_utf8(g_unichar_tolower(g_utf8_get_char(p)), buf);
+        for (gint i = 0; i < n; i++) {
+            guint child;
+            if (!_node_child(matcher, node, buf[i], &child)) {
+                child = _node_new(matcher);
+                MatcherEdge edge = { buf[i], child };
+                g_array_append_val(NODE(matcher, node)->edges, edge);
+            }
+            node = child;
+        }
+        chars++;
+    }
+
+    MatcherPattern new_pattern = {
+        .text = g_strdup(pattern),
+        .len = strlen(pattern),
+        .chars = chars,
+        .id = id,
+        .flags = flags,
+        .next = NODE(matcher, node)->pattern,
+    };
+    g_array_append_val(matcher->patterns, new_pattern);
+    NODE(matcher, node)->pattern = matcher->patterns->len - 1;
+
+    matcher->max_chars = MAX(matcher->max_chars, chars);
+    matcher->compiled = FALSE;
+}
+
+void
+matcher_scan(Matcher matcher, const char* const text, matcher_func func, void* userdata)
+{
+    if (!matcher || !text || matcher->patterns->len == 0) {
+        return;
+    }
+    if (!matcher->compiled) {
+        _compile(matcher);
+    }
+
+    // the longest match plus the character before it
+    guint ring_size = matcher->max_chars + 1;
+    MatcherChar* ring = g_new0(MatcherChar, ring_size);
+    GArray* pending = g_array_new(FALSE, FALSE, sizeof(MatcherPending));
+
+    gint url = -1;
+    glong url_offset = 0;
+    const char* url_start = NULL;
+    const char* url_body = NULL;
+
+    guint state = 0;
+    glong index = 0;
+    for (const char* p = text;; p = g_utf8_next_char(p)) {
+        gunichar ch = *p ? g_utf8_get_char(p) : 0;
+
+        // whole word matches of the previous character can be decided now
+        if (!g_unichar_isalnum(ch)) {
+            for (guint i = 0; i < pending->len; i++) {
+                MatcherPending* match = &g_array_index(pending, MatcherPending, i);
+                func(PATTERN(matcher, match->pattern)->id, match->offset, match->start, match->len, userdata);
+            }
+        }
+        g_array_set_size(pending, 0);
+
+        if (url >= 0 && !_is_url_char(ch)) {
+            if (p > url_body) {
+                func(PATTERN(matcher, url)->id, url_offset, url_start, p - url_start, userdata);
+            }
+            url = -1;
+        }
+
+        if (*p == '\0') {
+            break;
+        }
+
+        ring[index % ring_size] = (MatcherChar){ ch, p };
+
+        gchar buf[6];
+        gint n = g_unichar_to_utf8(g_unichar_tolower(ch), buf);
+        for (gint i = 0; i < n; i++) {
+            state = _node_step(matcher, state, buf[i]);
+        }
+
+        const char* end = g_utf8_next_char(p);
+        guint node = NODE(matcher, state)->pattern >= 0 ? state : NODE(matcher, state)->output;
+        for (; node != 0; node = NODE(matcher, node)->output) {
+            for (gint i = NODE(matcher, node)->pattern; i >= 0; i = PATTERN(matcher, i)->next) {
+                MatcherPattern* pattern = PATTERN(matcher, i);
+                glong offset = index - pattern->chars + 1;
+                const char* start = ring[offset % ring_size].pos;
+
+                if ((pattern->flags & MATCHER_EXACT_CASE)
+                    && ((gsize)(end - start) != pattern->len || memcmp(start, pattern->text, pattern->len) != 0)) {
+                    continue;
+                }
+
+                if (pattern->flags & MATCHER_URL) {
+                    // URLs don't overlap, a scheme inside one is part of it
+                    if (url < 0) {
+                        url = i;
+                        url_offset = offset;
+                        url_start = start;
+                        url_body = end;
+                    }
+                } else if (pattern->flags & MATCHER_WHOLE_WORD) {
+                    gunichar before = offset > 0 ? ring[(offset - 1) % ring_size].ch : 0;
+                    if (!g_unichar_isalnum(before)) {
+                        MatcherPending match = { i, offset, start, end - start };
+                        g_array_append_val(pending, match);
+                    }
+                } else {
+                    func(pattern->id, offset, start, end - start, userdata);
+                }
+            }
+        }
+
+        index++;
+    }
+
+    g_array_free(pending, TRUE);
+    g_free(ring);
+}
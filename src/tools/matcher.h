@@ -0,0 +1,40 @@
+/*
+ * matcher.h
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 Michael Vetter <jubalh@iodoru.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later WITH OpenSSL-exception
+ */
+
+#ifndef TOOLS_MATCHER_H
+#define TOOLS_MATCHER_H
+
+#include <glib.h>
+
+// Finds any number of patterns in one pass over a text. Matching folds case
+// unless a pattern asks for MATCHER_EXACT_CASE.
+typedef struct matcher_t* Matcher;
+
+typedef enum {
+    // only match when not preceded or followed by a letter or digit
+    MATCHER_WHOLE_WORD = 1 << 0,
+    MATCHER_EXACT_CASE = 1 << 1,
+    // the pattern is a URL scheme like "https://", the match extends over
+    // the URL characters following it
+    MATCHER_URL = 1 << 2,
+} matcher_flags_t;
+
+// offset is the match position in characters, start and len give its bytes
+typedef void (*matcher_func)(int id, glong offset, const char* start, gsize len, void* userdata);
+
+Matcher matcher_new(void);
+void matcher_free(Matcher matcher);
+
+// empty patterns are ignored, id is passed back to the matcher_func
+void matcher_add(Matcher matcher, const char* const pattern, int id, int flags);
+
+// call func for every match in text, ordered by where the match ends
+void matcher_scan(Matcher matcher, const char* const text, matcher_func func, void* userdata);
+
+#endif
@@ -17,7 +17,6 @@
 #include <sys/types.h>
 #include <curl/curl.h>
 #include <gio/gio.h>
-#include <pthread.h>
 #include <assert.h>
 #include <errno.h>
 
@@ -31,38 +30,33 @@
 #include "ui/window.h"
 #include "common.h"
 
-void*
-plugin_download_install(void* userdata)
+static void
+_plugin_download_done(HTTPDownload* plugin_dl, void* userdata)
 {
-    HTTPDownload* plugin_dl = (HTTPDownload*)userdata;
-
-    /* We need to dup those, because they're free'd inside `http_file_get()` */
-    auto_char char* path = strdup(plugin_dl->filename);
-    auto_char char* https_url = strdup(plugin_dl->url);
-
-    http_file_get(plugin_dl);
-
-    if (is_regular_file(path)) {
-        GString* error_message = g_string_new(NULL);
-        auto_char char* plugin_name = basename_from_url(https_url);
-        gboolean result = plugins_install(plugin_name, path, error_message);
-        if (result) {
-            cons_show("Plugin installed and loaded: %s", plugin_name);
+    if (http_download_report(plugin_dl)) {
+        if (is_regular_file(plugin_dl->filename)) {
+            GString* error_message = g_string_new(NULL);
+            auto_char char* plugin_name = basename_from_url(plugin_dl->url);
+            gboolean result = plugins_install(plugin_name, plugin_dl->filename, error_message);
+            if (result) {
+                cons_show("Plugin installed and loaded: %s", plugin_name);
+            } else {
+                cons_show("Failed to install plugin: %s. %s", plugin_name, error_message->str);
+            }
+            g_string_free(error_message, TRUE);
         } else {
-            cons_show("Failed to install plugin: %s. %s", plugin_name, error_message->str);
+            cons_show_error("Downloaded file is not a file (?)");
         }
-        g_string_free(error_message, TRUE);
-    } else {
-        cons_show_error("Downloaded file is not a file (?)");
     }
 
-    remove(path);
-
-    return NULL;
+    remove(plugin_dl->filename);
+    http_download_free(plugin_dl);
 }
 
 void
-plugin_download_add_download(HTTPDownload* plugin_dl)
+plugin_download_start(HTTPDownload* plugin_dl)
 {
-    http_download_add_download(plugin_dl);
+    plugin_dl->priority = TRANSFER_PRIORITY_LOW;
+    plugin_dl->done = _plugin_download_done;
+    http_download_start(plugin_dl);
 }
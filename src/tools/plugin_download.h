@@ -22,8 +22,7 @@
 
 #include "ui/win_types.h"
 
-void* plugin_download_install(void* userdata);
-
-void plugin_download_add_download(HTTPDownload* download);
+// Takes ownership of the download and installs the plugin once it arrived.
+void plugin_download_start(HTTPDownload* plugin_dl);
 
 #endif
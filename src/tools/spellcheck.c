@@ -24,6 +24,127 @@ static EnchantBroker* broker = NULL;
 static EnchantDict* dict = NULL;
 static char* current_lang = NULL;
 
+typedef struct spellcheck_entry_t
+{
+    gchar* word;
+    gboolean misspelled;
+} SpellcheckEntry;
+
+static GHashTable* cache; // word -> link in lru
+static GQueue lru = G_QUEUE_INIT; // SpellcheckEntry, most recently used first
+static GString* scratch;
+
+static GQueue pending = G_QUEUE_INIT; // words to look up
+static GHashTable* pending_set;
+// word -> misspelled for the words looked up since the queue was last empty, so
+// the redraw from ready_cb finds them even if the cache dropped them again
+static GHashTable* checked;
+static spellcheck_ready_cb ready_cb;
+
+static void
+_entry_free(SpellcheckEntry* entry)
+{
+    g_free(entry->word);
+    g_free(entry);
+}
+
+static void
+_cache_clear(void)
+{
+    if (cache) {
+        g_hash_table_destroy(cache);
+        cache = NULL;
+    }
+    g_queue_clear_full(&lru, (GDestroyNotify)_entry_free);
+
+    if (pending_set) {
+        g_hash_table_destroy(pending_set);
+        pending_set = NULL;
+    }
+    g_queue_clear_full(&pending, g_free);
+    if (checked) {
+        g_hash_table_destroy(checked);
+        checked = NULL;
+    }
+}
+
+static gboolean
+_cache_lookup(const char* word, gboolean* misspelled)
+{
+    GList* link = cache ? g_hash_table_lookup(cache, word) : NULL;
+    if (!link) {
+        return FALSE;
+    }
+
+    g_queue_unlink(&lru, link);
+    g_queue_push_head_link(&lru, link);
+    *misspelled = ((SpellcheckEntry*)link->data)->misspelled;
+    return TRUE;
+}
+
+static void
+_cache_add(const char* word, gboolean misspelled)
+{
+    if (!cache) {
+        cache = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+
+    SpellcheckEntry* entry = g_new(SpellcheckEntry, 1);
+    entry->word = g_strdup(word);
+    entry->misspelled = misspelled;
+    g_queue_push_head(&lru, entry);
+    g_hash_table_insert(cache, entry->word, lru.head);
+
+    if (lru.length > SPELLCHECK_CACHE_SIZE) {
+        SpellcheckEntry* oldest = g_queue_pop_tail(&lru);
+        g_hash_table_remove(cache, oldest->word);
+        _entry_free(oldest);
+    }
+}
+
+static gboolean
+_dict_check(const char* word)
+{
+    gboolean misspelled = enchant_dict_check(dict, word, strlen(word)) != 0;
+    _cache_add(word, misspelled);
+    return misspelled;
+}
+
+gboolean
+spellcheck_has_pending(void)
+{
+    return !g_queue_is_empty(&pending);
+}
+
+void
+spellcheck_process(void)
+{
+    if (g_queue_is_empty(&pending)) {
+        return;
+    }
+
+    if (!checked) {
+        checked = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    }
+
+    for (int i = 0; i < SPELLCHECK_BATCH && !g_queue_is_empty(&pending); i++) {
+        gchar* word = g_queue_pop_head(&pending);
+        g_hash_table_remove(pending_set, word);
+        gboolean misspelled = FALSE;
+        if (dict && !_cache_lookup(word, &misspelled)) {
+            misspelled = _dict_check(word);
+        }
+        g_hash_table_insert(checked, word, GINT_TO_POINTER(misspelled));
+    }
+
+    if (g_queue_is_empty(&pending)) {
+        if (ready_cb) {
+            ready_cb();
+        }
+        g_hash_table_remove_all(checked);
+    }
+}
+
 void
 spellcheck_init(void)
 {
@@ -47,6 +168,12 @@ spellcheck_init(void)
 void
 spellcheck_deinit(void)
 {
+    _cache_clear();
+    if (scratch) {
+        g_string_free(scratch, TRUE);
+        scratch = NULL;
+    }
+    ready_cb = NULL;
     if (dict) {
         enchant_broker_free_dict(broker, dict);
         dict = NULL;
@@ -81,6 +208,7 @@ spellcheck_set_lang(const char* lang)
     }
 
     dict = new_dict;
+    _cache_clear();
     g_free(current_lang);
     current_lang = g_strdup(lang);
 
@@ -121,12 +249,53 @@ spellcheck_get_available_langs(void)
 gboolean
 spellcheck_is_misspelled(const char* word)
 {
-    if (!dict || !word || word[0] == '\0') {
+    if (!word) {
         return FALSE;
     }
 
-    int result = enchant_dict_check(dict, word, strlen(word));
-    return (result != 0);
+    return spellcheck_check_word(word, strlen(word), FALSE) == SPELLCHECK_MISSPELLED;
+}
+
+spellcheck_result_t
+spellcheck_check_word(const char* word, gsize len, gboolean defer)
+{
+    if (!dict || !word || len == 0) {
+        return SPELLCHECK_CORRECT;
+    }
+
+    if (!scratch) {
+        scratch = g_string_sized_new(64);
+    }
+    g_string_truncate(scratch, 0);
+    g_string_append_len(scratch, word, len);
+
+    gboolean misspelled;
+    gpointer checked_misspelled;
+    if (checked && g_hash_table_lookup_extended(checked, scratch->str, NULL, &checked_misspelled)) {
+        misspelled = GPOINTER_TO_INT(checked_misspelled);
+    } else if (!_cache_lookup(scratch->str, &misspelled)) {
+        if (!defer) {
+            misspelled = _dict_check(scratch->str);
+        } else {
+            if (!pending_set) {
+                pending_set = g_hash_table_new(g_str_hash, g_str_equal);
+            }
+            if (!g_hash_table_contains(pending_set, scratch->str)) {
+                gchar* pending_word = g_strdup(scratch->str);
+                g_queue_push_tail(&pending, pending_word);
+                g_hash_table_add(pending_set, pending_word);
+            }
+            return SPELLCHECK_PENDING;
+        }
+    }
+
+    return misspelled ? SPELLCHECK_MISSPELLED : SPELLCHECK_CORRECT;
+}
+
+void
+spellcheck_set_ready_cb(spellcheck_ready_cb callback)
+{
+    ready_cb = callback;
 }
 
 #endif
@@ -13,11 +13,32 @@
 #include "config.h"
 #include <glib.h>
 
+typedef enum {
+    SPELLCHECK_CORRECT,
+    SPELLCHECK_MISSPELLED,
+    // not known yet, the ready callback runs once it is
+    SPELLCHECK_PENDING,
+} spellcheck_result_t;
+
+typedef void (*spellcheck_ready_cb)(void);
+
+// words remembered, least recently used ones are dropped first
+#define SPELLCHECK_CACHE_SIZE 4096
+// deferred words looked up per main loop iteration
+#define SPELLCHECK_BATCH 64
+
 #ifdef HAVE_SPELLCHECK
 
 void spellcheck_init(void);
 void spellcheck_deinit(void);
 gboolean spellcheck_is_misspelled(const char* word);
+// check the len bytes at word, with defer a word that isn't cached yet is
+// looked up by spellcheck_process() instead of now
+spellcheck_result_t spellcheck_check_word(const char* word, gsize len, gboolean defer);
+// look up a batch of deferred words, called once per main loop iteration
+void spellcheck_process(void);
+gboolean spellcheck_has_pending(void);
+void spellcheck_set_ready_cb(spellcheck_ready_cb callback);
 gboolean spellcheck_set_lang(const char* lang);
 const char* spellcheck_get_lang(void);
 GList* spellcheck_get_available_langs(void);
@@ -37,6 +58,24 @@ spellcheck_is_misspelled(const char* word)
 {
     return FALSE;
 }
+static inline spellcheck_result_t
+spellcheck_check_word(const char* word, gsize len, gboolean defer)
+{
+    return SPELLCHECK_CORRECT;
+}
+static inline void
+spellcheck_process(void)
+{
+}
+static inline gboolean
+spellcheck_has_pending(void)
+{
+    return FALSE;
+}
+static inline void
+spellcheck_set_ready_cb(spellcheck_ready_cb callback)
+{
+}
 static inline gboolean
 spellcheck_set_lang(const char* lang)
 {
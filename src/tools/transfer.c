@@ -0,0 +1,418 @@
+/*
+ * transfer.c
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 Michael Vetter <jubalh@iodoru.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later WITH OpenSSL-exception
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "log.h"
+#include "common.h"
+#include "config/accounts.h"
+#include "config/cafile.h"
+#include "config/preferences.h"
+#include "tools/transfer.h"
+#include "xmpp/xmpp.h"
+
+static CURLM* multi = NULL;
+static CURLSH* share = NULL;
+
+static GQueue queued[TRANSFER_PRIORITY_LOW + 1];
+static GQueue active = G_QUEUE_INIT;
+// couldn't be started, finished by the next transfer_process()
+static GQueue failed = G_QUEUE_INIT;
+static GQueue finished = G_QUEUE_INIT;
+// host -> number of active transfers
+static GHashTable* host_active = NULL;
+
+typedef struct transfer_tls_t
+{
+    gboolean loaded;
+    gchar* cafile;
+    gchar* cert_path;
+    gboolean insecure;
+} TransferTLS;
+
+static void
+_transfer_free(Transfer* transfer)
+{
+    g_free(transfer->description);
+    g_free(transfer->host);
+    g_free(transfer->error);
+    g_free(transfer);
+}
+
+static void
+_transfer_close(void)
+{
+    Transfer* transfer;
+    while ((transfer = g_queue_pop_head(&active))) {
+        curl_multi_remove_handle(multi, transfer->handle);
+        curl_easy_cleanup(transfer->handle);
+        _transfer_free(transfer);
+    }
+    for (int i = 0; i <= TRANSFER_PRIORITY_LOW; i++) {
+        while ((transfer = g_queue_pop_head(&queued[i]))) {
+            curl_easy_cleanup(transfer->handle);
+            _transfer_free(transfer);
+        }
+    }
+    while ((transfer = g_queue_pop_head(&failed))) {
+        curl_easy_cleanup(transfer->handle);
+        _transfer_free(transfer);
+    }
+    g_queue_clear_full(&finished, (GDestroyNotify)_transfer_free);
+
+    curl_multi_cleanup(multi);
+    multi = NULL;
+    curl_share_cleanup(share);
+    share = NULL;
+    g_hash_table_destroy(host_active);
+    host_active = NULL;
+    curl_global_cleanup();
+}
+
+static void
+_transfer_init(void)
+{
+    if (multi) {
+        return;
+    }
+
+    curl_global_init(CURL_GLOBAL_ALL);
+    multi = curl_multi_init();
+
+    // everything runs on the main thread, so the share needs no locking
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    for (int i = 0; i <= TRANSFER_PRIORITY_LOW; i++) {
+        g_queue_init(&queued[i]);
+    }
+    host_active = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    prof_add_shutdown_routine(_transfer_close);
+}
+
+static void
+_tls_load(TransferTLS* tls)
+{
+    tls->cert_path = prefs_get_string(PREF_TLS_CERTPATH);
+    tls->cafile = cafile_get_name();
+    ProfAccount* account = accounts_get_account(session_get_account_name());
+    if (account) {
+        tls->insecure = account->tls_policy && strcmp(account->tls_policy, "trust") == 0;
+    }
+    account_free(account);
+    tls->loaded = TRUE;
+}
+
+static int
+_xferinfo(void* userdata, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+    Transfer* transfer = (Transfer*)userdata;
+
+    if (transfer->canceled) {
+        return 1;
+    }
+
+    curl_off_t now = transfer->upload ? ulnow : dlnow;
+    curl_off_t total = transfer->upload ? ultotal : dltotal;
+    if (now == transfer->now && total == transfer->total) {
+        return 0;
+    }
+    transfer->now = now;
+    transfer->total = total;
+
+    if (transfer->progress) {
+        transfer->progress(transfer, transfer->userdata);
+    }
+
+    return 0;
+}
+
+static void
+_activate(Transfer* transfer, TransferTLS* tls, curl_off_t rate)
+{
+    CURL* handle = transfer->handle;
+
+    curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    curl_easy_setopt(handle, CURLOPT_PRIVATE, transfer);
+    curl_easy_setopt(handle, CURLOPT_USERAGENT, "profanity");
+
+    curl_easy_setopt(handle, CURLOPT_XFERINFOFUNCTION, _xferinfo);
+    curl_easy_setopt(handle, CURLOPT_XFERINFODATA, transfer);
+    curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 0L);
+
+    if (tls->cafile) {
+        curl_easy_setopt(handle, CURLOPT_CAINFO, tls->cafile);
+    }
+    if (tls->cert_path) {
+        curl_easy_setopt(handle, CURLOPT_CAPATH, tls->cert_path);
+    }
+    if (tls->insecure) {
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 0L);
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L);
+    }
+
+    if (rate > 0) {
+        curl_easy_setopt(handle, transfer->upload ? CURLOPT_MAX_SEND_SPEED_LARGE : CURLOPT_MAX_RECV_SPEED_LARGE, rate);
+    }
+
+    CURLMcode res = curl_multi_add_handle(multi, handle);
+    if (res != CURLM_OK) {
+        log_error("[Transfer] unable to start '%s': %s", transfer->description, curl_multi_strerror(res));
+        // done must not run yet, the caller of transfer_start() has no transfer yet
+        transfer->error = g_strdup(curl_multi_strerror(res));
+        g_queue_push_tail(&failed, transfer);
+        return;
+    }
+
+    transfer->state = TRANSFER_ACTIVE;
+    g_queue_push_tail(&active, transfer);
+    gint count = GPOINTER_TO_INT(g_hash_table_lookup(host_active, transfer->host));
+    g_hash_table_replace(host_active, g_strdup(transfer->host), GINT_TO_POINTER(count + 1));
+}
+
+// start queued transfers, highest priority first, as far as the limits allow
+static void
+_schedule(void)
+{
+    TransferTLS tls = { 0 };
+    gint host_limit = MAX(prefs_get_transfer_host_limit(), 1);
+    curl_off_t rate = (curl_off_t)prefs_get_transfer_rate() * 1024;
+
+    for (int i = 0; i <= TRANSFER_PRIORITY_LOW && active.length < TRANSFER_MAX_ACTIVE; i++) {
+        GList* link = queued[i].head;
+        while (link && active.length < TRANSFER_MAX_ACTIVE) {
+            GList* next = link->next;
+            Transfer* transfer = link->data;
+
+            if (!transfer->canceled && GPOINTER_TO_INT(g_hash_table_lookup(host_active, transfer->host)) < host_limit) {
+                if (!tls.loaded) {
+                    _tls_load(&tls);
+                }
+                g_queue_delete_link(&queued[i], link);
+                _activate(transfer, &tls, rate);
+            }
+
+            link = next;
+        }
+    }
+
+    g_free(tls.cafile);
+    g_free(tls.cert_path);
+}
+
+static void
+_finish(Transfer* transfer, transfer_state_t state)
+{
+    if (transfer->state == TRANSFER_ACTIVE) {
+        curl_multi_remove_handle(multi, transfer->handle);
+        g_queue_remove(&active, transfer);
+        gint count = GPOINTER_TO_INT(g_hash_table_lookup(host_active, transfer->host));
+        if (count > 1) {
+            g_hash_table_replace(host_active, g_strdup(transfer->host), GINT_TO_POINTER(count - 1));
+        } else {
+            g_hash_table_remove(host_active, transfer->host);
+        }
+    } else {
+        g_queue_remove(&queued[transfer->priority], transfer);
+    }
+    curl_easy_cleanup(transfer->handle);
+    transfer->handle = NULL;
+    transfer->state = state;
+
+    if (transfer->done) {
+        transfer->done(transfer, transfer->userdata);
+    }
+    transfer->progress = NULL;
+    transfer->done = NULL;
+    transfer->userdata = NULL;
+
+    g_queue_push_tail(&finished, transfer);
+    while (finished.length > TRANSFER_HISTORY) {
+        _transfer_free(g_queue_pop_head(&finished));
+    }
+}
+
+// A canceled transfer stays in its queue until the next transfer_process().
+// The done callbacks may start new transfers, so pick them out first.
+static void
+_finish_canceled(GQueue* queue)
+{
+    GSList* canceled = NULL;
+    for (GList* curr = queue->head; curr; curr = curr->next) {
+        Transfer* transfer = curr->data;
+        if (transfer->canceled) {
+            canceled = g_slist_prepend(canceled, transfer);
+        }
+    }
+
+    canceled = g_slist_reverse(canceled);
+    for (GSList* curr = canceled; curr; curr = curr->next) {
+        _finish(curr->data, TRANSFER_CANCELED);
+    }
+    g_slist_free(canceled);
+}
+
+static void
+_finish_failed(void)
+{
+    Transfer* transfer;
+    while ((transfer = g_queue_pop_head(&failed))) {
+        _finish(transfer, TRANSFER_FAILED);
+    }
+}
+
+Transfer*
+transfer_start(CURL* handle, const char* const url, gboolean upload, const char* const description,
+               transfer_priority_t priority, transfer_func progress, transfer_func done, void* userdata)
+{
+    _transfer_init();
+
+    Transfer* transfer = g_new0(Transfer, 1);
+    transfer->description = g_strdup(description);
+    transfer->upload = upload;
+    transfer->priority = priority;
+    transfer->state = TRANSFER_QUEUED;
+    transfer->handle = handle;
+    transfer->progress = progress;
+    transfer->done = done;
+    transfer->userdata = userdata;
+
+    curl_easy_setopt(handle, CURLOPT_URL, url);
+
+    char* host = NULL;
+    CURLU* h = curl_url();
+    if (curl_url_set(h, CURLUPART_URL, url, 0) == CURLUE_OK && curl_url_get(h, CURLUPART_HOST, &host, 0) == CURLUE_OK) {
+        transfer->host = g_strdup(host);
+        curl_free(host);
+    } else {
+        transfer->host = g_strdup("");
+    }
+    curl_url_cleanup(h);
+
+    g_queue_push_tail(&queued[priority], transfer);
+    _schedule();
+
+    return transfer;
+}
+
+void
+transfer_cancel(Transfer* transfer)
+{
+    if (transfer->state == TRANSFER_QUEUED || transfer->state == TRANSFER_ACTIVE) {
+        transfer->canceled = TRUE;
+    }
+}
+
+void
+transfer_fdset(fd_set* read_fds, fd_set* write_fds, int* max_fd, gint* timeout)
+{
+    if (multi && failed.length > 0) {
+        *timeout = 0;
+    }
+    if (!multi || active.length == 0) {
+        return;
+    }
+
+    fd_set exc_fds;
+    FD_ZERO(&exc_fds);
+    int curl_max_fd = -1;
+    curl_multi_fdset(multi, read_fds, write_fds, &exc_fds, &curl_max_fd);
+    *max_fd = MAX(*max_fd, curl_max_fd);
+
+    long curl_timeout = -1;
+    curl_multi_timeout(multi, &curl_timeout);
+    if (curl_timeout >= 0 && curl_timeout < *timeout) {
+        *timeout = curl_timeout;
+    }
+
+    // no socket yet, e.g. while resolving, curl has to be polled
+    if (curl_max_fd < 0) {
+        *timeout = MIN(*timeout, 100);
+    }
+}
+
+void
+transfer_process(void)
+{
+    if (!multi) {
+        return;
+    }
+
+    for (int i = 0; i <= TRANSFER_PRIORITY_LOW; i++) {
+        _finish_canceled(&queued[i]);
+    }
+    _finish_canceled(&active);
+    _finish_failed();
+
+    if (active.length > 0) {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg* msg;
+        int left = 0;
+        while ((msg = curl_multi_info_read(multi, &left))) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            // msg is gone once the handle is removed
+            CURL* handle = msg->easy_handle;
+            CURLcode result = msg->data.result;
+
+            Transfer* transfer = NULL;
+            curl_easy_getinfo(handle, CURLINFO_PRIVATE, (char**)&transfer);
+            curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &transfer->response_code);
+
+            if (result == CURLE_OK) {
+                _finish(transfer, TRANSFER_COMPLETED);
+            } else if (transfer->canceled) {
+                _finish(transfer, TRANSFER_CANCELED);
+            } else {
+                transfer->error = g_strdup(curl_easy_strerror(result));
+                _finish(transfer, TRANSFER_FAILED);
+            }
+        }
+    }
+
+    _schedule();
+}
+
+GList*
+transfer_list(void)
+{
+    GList* transfers = NULL;
+
+    for (int i = 0; i <= TRANSFER_PRIORITY_LOW; i++) {
+        for (GList* curr = queued[i].head; curr; curr = curr->next) {
+            transfers = g_list_prepend(transfers, curr->data);
+        }
+    }
+    for (GList* curr = failed.head; curr; curr = curr->next) {
+        transfers = g_list_prepend(transfers, curr->data);
+    }
+    for (GList* curr = active.head; curr; curr = curr->next) {
+        transfers = g_list_prepend(transfers, curr->data);
+    }
+    for (GList* curr = finished.head; curr; curr = curr->next) {
+        transfers = g_list_prepend(transfers, curr->data);
+    }
+
+    return g_list_reverse(transfers);
+}
+
+void
+transfer_clear_finished(void)
+{
+    g_queue_clear_full(&finished, (GDestroyNotify)_transfer_free);
+}
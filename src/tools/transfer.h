@@ -0,0 +1,87 @@
+/*
+ * transfer.h
+ * vim: expandtab:ts=4:sts=4:sw=4
+ *
+ * Copyright (C) 2026 Michael Vetter <jubalh@iodoru.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later WITH OpenSSL-exception
+ */
+
+#ifndef TOOLS_TRANSFER_H
+#define TOOLS_TRANSFER_H
+
+#ifdef PLATFORM_CYGWIN
+#define SOCKET int
+#endif
+
+#include <sys/select.h>
+#include <curl/curl.h>
+#include <glib.h>
+
+// Runs the HTTP transfers on one curl multi handle driven by the main loop.
+// Transfers to the same host share connections and TLS sessions, at most
+// prefs_get_transfer_host_limit() of them run at once per host and the rest
+// wait in a queue by priority. All callbacks run on the main thread.
+
+#define TRANSFER_MAX_ACTIVE 8
+#define TRANSFER_HISTORY    20
+
+typedef enum {
+    TRANSFER_PRIORITY_HIGH,
+    TRANSFER_PRIORITY_NORMAL,
+    TRANSFER_PRIORITY_LOW,
+} transfer_priority_t;
+
+typedef enum {
+    TRANSFER_QUEUED,
+    TRANSFER_ACTIVE,
+    TRANSFER_COMPLETED,
+    TRANSFER_FAILED,
+    TRANSFER_CANCELED,
+} transfer_state_t;
+
+typedef struct transfer_t Transfer;
+
+typedef void (*transfer_func)(Transfer* transfer, void* userdata);
+
+struct transfer_t
+{
+    gchar* description;
+    gchar* host;
+    gboolean upload;
+    transfer_priority_t priority;
+    transfer_state_t state;
+    // bytes in the direction of the transfer, total is 0 while unknown
+    curl_off_t now;
+    curl_off_t total;
+    long response_code;
+    // why it failed, NULL unless the state is TRANSFER_FAILED
+    gchar* error;
+
+    // owned by the transfer manager
+    CURL* handle;
+    gboolean canceled;
+    transfer_func progress;
+    transfer_func done;
+    void* userdata;
+};
+
+// Queue a transfer. The handle has the request specific options set, the
+// manager takes it over and adds the URL, TLS, user agent and speed limit.
+// progress may be NULL. done is called exactly once when the transfer ended,
+// after that the Transfer only remains in the list of finished transfers.
+Transfer* transfer_start(CURL* handle, const char* const url, gboolean upload, const char* const description,
+                         transfer_priority_t priority, transfer_func progress, transfer_func done, void* userdata);
+
+// done is called from the next transfer_process()
+void transfer_cancel(Transfer* transfer);
+
+// add the sockets to wait on and lower timeout (ms) to when curl wants to run
+void transfer_fdset(fd_set* read_fds, fd_set* write_fds, int* max_fd, gint* timeout);
+void transfer_process(void);
+
+// queued, active and finished transfers, in that order
+GList* transfer_list(void);
+void transfer_clear_finished(void);
+
+#endif
@@ -28,41 +28,135 @@
 #include "ui/window.h"
 #include "ui/buffer.h"
 
-#define MAX_BUFFER_SIZE     200
-#define STRDUP_OR_NULL(str) ((str) ? strdup(str) : NULL)
+#define DEFAULT_BUFFER_SIZE  200
+#define DEFAULT_MEMORY_LIMIT (64 * 1024 * 1024)
+#define MIN_BUFFER_CAPACITY  16
 
+/* Entries are kept in a ring, entries[(head + i) % capacity] being the i-th
+ * entry, so indexed access, appending and prepending are all O(1). Every
+ * entry gets a sequence number that grows from the first to the last one,
+ * which finds its position again. */
 struct prof_buff_t
 {
-    GSList* entries;
+    ProfBuffEntry** entries;
+    unsigned int capacity;
+    unsigned int head;
+    unsigned int size;
+    unsigned int max_size;
+    // entries dropped for the memory limit can be loaded from the database again
+    gboolean reloadable;
     int lines;
+    gsize memory;
+    // sequence numbers of the next appended and the last prepended entry
+    gint64 next_seq;
+    gint64 first_seq;
+    // message id -> BufferId with the entries carrying it
+    GHashTable* by_id;
+    // display_from and from_jid of the entries, shared between them
+    GHashTable* names;
 };
 
-static void _free_entry(ProfBuffEntry* entry);
-static ProfBuffEntry* _create_entry(const char* show_char, int pad_indent, GDateTime* time, int flags, theme_item_t theme_item, const char* const display_from, const char* const from_jid, const char* const message, DeliveryReceipt* receipt, const char* const id, int y_start_pos, int y_end_pos);
+typedef struct buffer_id_t
+{
+    // in buffer order, ids are rarely shared
+    GQueue entries;
+    char id[];
+} BufferId;
+
+typedef struct buffer_name_t
+{
+    unsigned int refs;
+    gsize size;
+    char name[];
+} BufferName;
+
+// all live buffers, to enforce the memory limit across windows
+static GSList* buffers = NULL;
+static gsize buffers_memory = 0;
+static gsize memory_limit = DEFAULT_MEMORY_LIMIT;
+
+static void _free_entry(ProfBuff buffer, ProfBuffEntry* entry);
+static ProfBuffEntry* _create_entry(ProfBuff buffer, const char* show_char, int pad_indent, gint64 time, gint32 utc_offset, int flags, theme_item_t theme_item, const char* const display_from, const char* const from_jid, const char* const message, DeliveryReceipt* receipt, const char* const id, int y_start_pos, int y_end_pos);
 static void _buffer_add(ProfBuff buffer, const char* show_char, int pad_indent, GDateTime* time, int flags, theme_item_t theme_item, const char* const display_from, const char* const from_jid, const char* const message, DeliveryReceipt* receipt, const char* const id, int y_start_pos, int y_end_pos, gboolean append);
+static void _buffer_grow(ProfBuff buffer);
+static void _buffer_delete(ProfBuff buffer, unsigned int entry);
+static unsigned int _buffer_position(ProfBuff buffer, ProfBuffEntry* e);
+static void _buffer_id_free(BufferId* id);
+static void _buffer_index_add(ProfBuff buffer, ProfBuffEntry* e, gboolean append);
+static void _buffer_index_remove(ProfBuff buffer, ProfBuffEntry* e);
+static void _buffers_enforce_memory_limit(ProfBuff current, gboolean append);
+
+#define BUFFER_AT(buffer, i) ((buffer)->entries[((buffer)->head + (i)) % (buffer)->capacity])
 
 ProfBuff
 buffer_create(void)
 {
     ProfBuff new_buff = malloc(sizeof(struct prof_buff_t));
     new_buff->entries = NULL;
+    new_buff->capacity = 0;
+    new_buff->head = 0;
+    new_buff->size = 0;
+    new_buff->max_size = DEFAULT_BUFFER_SIZE;
+    new_buff->reloadable = FALSE;
     new_buff->lines = 0;
+    new_buff->memory = 0;
+    new_buff->next_seq = 0;
+    new_buff->first_seq = 0;
+    new_buff->by_id = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)_buffer_id_free);
+    new_buff->names = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+    buffers = g_slist_prepend(buffers, new_buff);
     return new_buff;
 }
 
 unsigned int
 buffer_size(ProfBuff buffer)
 {
-    return g_slist_length(buffer->entries);
+    return buffer->size;
 }
 
 void
 buffer_free(ProfBuff buffer)
 {
-    g_slist_free_full(buffer->entries, (GDestroyNotify)_free_entry);
+    for (unsigned int i = 0; i < buffer->size; i++) {
+        _free_entry(buffer, BUFFER_AT(buffer, i));
+    }
+    buffers_memory -= buffer->memory;
+    buffers = g_slist_remove(buffers, buffer);
+    g_hash_table_destroy(buffer->by_id);
+    g_hash_table_destroy(buffer->names);
+    free(buffer->entries);
     free(buffer);
 }
 
+void
+buffer_set_max_size(ProfBuff buffer, unsigned int max_size)
+{
+    buffer->max_size = max_size > 0 ? max_size : 1;
+
+    while (buffer->size > buffer->max_size) {
+        _buffer_delete(buffer, 0);
+    }
+}
+
+void
+buffer_set_reloadable(ProfBuff buffer, gboolean reloadable)
+{
+    buffer->reloadable = reloadable;
+}
+
+void
+buffer_set_memory_limit(gsize bytes)
+{
+    memory_limit = bytes;
+    _buffers_enforce_memory_limit(NULL, TRUE);
+}
+
+gsize
+buffer_get_memory_usage(void)
+{
+    return buffers_memory;
+}
+
 void
 buffer_append(ProfBuff buffer, const char* show_char, int pad_indent, GDateTime* time, int flags, theme_item_t theme_item, const char* const display_from, const char* const from_jid, const char* const message, DeliveryReceipt* receipt, const char* const id, int y_start_pos, int y_end_pos)
 {
@@ -78,64 +172,109 @@ buffer_prepend(ProfBuff buffer, const char* show_char, int pad_indent, GDateTime
 static void
 _buffer_add(ProfBuff buffer, const char* show_char, int pad_indent, GDateTime* time, int flags, theme_item_t theme_item, const char* const display_from, const char* const from_jid, const char* const message, DeliveryReceipt* receipt, const char* const id, int y_start_pos, int y_end_pos, gboolean append)
 {
-    ProfBuffEntry* e = _create_entry(show_char, pad_indent, time, flags, theme_item, display_from, from_jid, message, receipt, id, y_start_pos, y_end_pos);
+    gint64 unix_usec = g_date_time_to_unix(time) * G_USEC_PER_SEC + g_date_time_get_microsecond(time);
+    gint32 utc_offset = g_date_time_get_utc_offset(time) / G_USEC_PER_SEC;
+    ProfBuffEntry* e = _create_entry(buffer, show_char, pad_indent, unix_usec, utc_offset, flags, theme_item, display_from, from_jid, message, receipt, id, y_start_pos, y_end_pos);
 
     buffer->lines += e->_lines;
 
-    while (g_slist_length(buffer->entries) >= MAX_BUFFER_SIZE) {
-        GSList* buffer_entry_to_delete = append ? buffer->entries : g_slist_last(buffer->entries);
-        ProfBuffEntry* entry_to_delete = (ProfBuffEntry*)buffer_entry_to_delete->data;
-        buffer->lines -= entry_to_delete->_lines;
-        _free_entry(entry_to_delete);
-        buffer->entries = g_slist_delete_link(buffer->entries, buffer_entry_to_delete);
+    while (buffer->size >= buffer->max_size) {
+        _buffer_delete(buffer, append ? 0 : buffer->size - 1);
     }
 
-    if (from_jid && y_end_pos == y_start_pos) {
+    // entries added with negative positions are laid out later by win_redraw()
+    if (from_jid && y_start_pos >= 0 && y_end_pos == y_start_pos) {
         log_warning("Ncurses Overflow! From: %s, pos: %d, ID: %s, message: %s", from_jid, y_end_pos, id, message);
     }
 
-    buffer->entries = append ? g_slist_append(buffer->entries, e) : g_slist_prepend(buffer->entries, e);
+    if (buffer->size == buffer->capacity) {
+        _buffer_grow(buffer);
+    }
+
+    if (append) {
+        e->_seq = buffer->next_seq++;
+        BUFFER_AT(buffer, buffer->size) = e;
+    } else {
+        e->_seq = --buffer->first_seq;
+        buffer->head = (buffer->head + buffer->capacity - 1) % buffer->capacity;
+        buffer->entries[buffer->head] = e;
+    }
+    buffer->size++;
+    buffer->memory += e->_size;
+    buffers_memory += e->_size;
+
+    _buffer_index_add(buffer, e, append);
+    _buffers_enforce_memory_limit(buffer, append);
+}
+
+ProfBuffEntry*
+buffer_update_entry(ProfBuff buffer, ProfBuffEntry* entry, const char* const show_char, const char* const message)
+{
+    unsigned int i = _buffer_position(buffer, entry);
+
+    ProfBuffEntry* e = _create_entry(buffer, show_char ? show_char : entry->show_char, entry->pad_indent, entry->time, entry->utc_offset,
+                                     entry->flags, entry->theme_item, entry->display_from, entry->from_jid,
+                                     message ? message : entry->message, NULL, entry->id, entry->y_start_pos, entry->y_end_pos);
+    if (entry->receipt) {
+        e->_receipt = *entry->receipt;
+        e->receipt = &e->_receipt;
+    }
+
+    e->_seq = entry->_seq;
+    e->_id_link = entry->_id_link;
+    if (e->_id_link) {
+        e->_id_link->data = e;
+    }
+
+    BUFFER_AT(buffer, i) = e;
+    buffer->memory += e->_size - entry->_size;
+    buffers_memory += e->_size - entry->_size;
+    _free_entry(buffer, entry);
+
+    return e;
 }
 
 void
 buffer_remove_entry_by_id(ProfBuff buffer, const char* const id)
 {
-    GSList* entries = buffer->entries;
-    while (entries) {
-        ProfBuffEntry* entry = entries->data;
-        if (entry->id && (g_strcmp0(entry->id, id) == 0)) {
-            buffer->lines -= entry->_lines;
-            _free_entry(entry);
-            buffer->entries = g_slist_delete_link(buffer->entries, entries);
-            break;
-        }
-        entries = g_slist_next(entries);
+    if (!id) {
+        return;
     }
+
+    ProfBuffEntry* entry = buffer_get_entry_by_id(buffer, id);
+    if (!entry) {
+        return;
+    }
+
+    _buffer_delete(buffer, _buffer_position(buffer, entry));
 }
 
 void
 buffer_remove_entry(ProfBuff buffer, unsigned int entry)
 {
-    GSList* node = g_slist_nth(buffer->entries, entry);
-    ProfBuffEntry* e = node->data;
-    buffer->lines -= e->_lines;
-    _free_entry(e);
-    buffer->entries = g_slist_delete_link(buffer->entries, node);
+    assert(entry < buffer->size);
+    _buffer_delete(buffer, entry);
 }
 
 gboolean
 buffer_mark_received(ProfBuff buffer, const char* const id)
 {
-    GSList* entries = buffer->entries;
-    while (entries) {
-        ProfBuffEntry* entry = entries->data;
-        if (entry->receipt && g_strcmp0(entry->id, id) == 0) {
-            if (!entry->receipt->received) {
-                entry->receipt->received = TRUE;
-                return TRUE;
-            }
+    if (!id) {
+        return FALSE;
+    }
+
+    BufferId* entries = g_hash_table_lookup(buffer->by_id, id);
+    if (!entries) {
+        return FALSE;
+    }
+
+    // the id may be shared, the first entry still awaiting its receipt gets it
+    for (GList* curr = entries->entries.head; curr; curr = curr->next) {
+        ProfBuffEntry* entry = curr->data;
+        if (entry->receipt && !entry->receipt->received) {
+            entry->receipt->received = TRUE;
+            return TRUE;
         }
-        entries = g_slist_next(entries);
     }
 
     return FALSE;
@@ -144,55 +283,337 @@ buffer_mark_received(ProfBuff buffer, const char* const id)
 ProfBuffEntry*
 buffer_get_entry(ProfBuff buffer, unsigned int entry)
 {
-    GSList* node = g_slist_nth(buffer->entries, entry);
-    return node->data;
+    assert(entry < buffer->size);
+    return BUFFER_AT(buffer, entry);
 }
 
 ProfBuffEntry*
 buffer_get_entry_by_id(ProfBuff buffer, const char* const id)
 {
-    GSList* entries = buffer->entries;
-    while (entries) {
-        ProfBuffEntry* entry = entries->data;
-        if (g_strcmp0(entry->id, id) == 0) {
-            return entry;
+    if (!id) {
+        return NULL;
+    }
+
+    BufferId* entries = g_hash_table_lookup(buffer->by_id, id);
+    return entries ? g_queue_peek_head(&entries->entries) : NULL;
+}
+
+/* Returns the index of the first entry of the run of entries with a pad
+ * position that ends before 'end'. */
+unsigned int
+buffer_first_positioned(ProfBuff buffer, unsigned int end)
+{
+    unsigned int i = MIN(end, buffer->size);
+    while (i > 0 && BUFFER_AT(buffer, i - 1)->y_start_pos >= 0) {
+        i--;
+    }
+
+    return i;
+}
+
+/* Returns the index of the entry in [first, end) that starts the line the
+ * given pad row belongs to, entries printed with NO_EOL continue the line of
+ * the entry before them. 'first' when the row lies above all of them. */
+unsigned int
+buffer_line_at_row(ProfBuff buffer, unsigned int first, unsigned int end, int row)
+{
+    unsigned int line = first;
+    for (unsigned int i = first + 1; i < end; i++) {
+        if (BUFFER_AT(buffer, i)->y_start_pos > row) {
+            break;
+        }
+        if (!(BUFFER_AT(buffer, i - 1)->flags & NO_EOL)) {
+            line = i;
+        }
+    }
+
+    return line;
+}
+
+/* Returns the index of the first entry in (first, end) that starts a line on
+ * or below the given pad row, 'end' when there is none. */
+unsigned int
+buffer_line_from_row(ProfBuff buffer, unsigned int first, unsigned int end, int row)
+{
+    unsigned int line = end;
+    for (unsigned int i = end; i > first + 1; i--) {
+        if (BUFFER_AT(buffer, i - 1)->y_start_pos < row) {
+            break;
+        }
+        if (!(BUFFER_AT(buffer, i - 2)->flags & NO_EOL)) {
+            line = i - 1;
         }
-        entries = g_slist_next(entries);
     }
 
-    return NULL;
+    return line;
+}
+
+/* Returns a new reference, in the timezone of the timestamp the entry was
+ * created with. */
+GDateTime*
+buffer_entry_get_time(const ProfBuffEntry* const entry)
+{
+    GDateTime* utc = g_date_time_new_from_unix_utc(entry->time / G_USEC_PER_SEC);
+    GDateTime* precise = g_date_time_add(utc, entry->time % G_USEC_PER_SEC);
+    g_date_time_unref(utc);
+
+    // prefer the local timezone, it knows its abbreviation
+    GDateTime* local = g_date_time_to_local(precise);
+    if (g_date_time_get_utc_offset(local) / G_USEC_PER_SEC == entry->utc_offset) {
+        g_date_time_unref(precise);
+        return local;
+    }
+    g_date_time_unref(local);
+
+    GTimeZone* tz = g_time_zone_new_offset(entry->utc_offset);
+    GDateTime* ret = g_date_time_to_timezone(precise, tz);
+    g_time_zone_unref(tz);
+    g_date_time_unref(precise);
+
+    return ret;
+}
+
+static void
+_buffer_grow(ProfBuff buffer)
+{
+    unsigned int capacity = buffer->capacity ? buffer->capacity * 2 : MIN_BUFFER_CAPACITY;
+    ProfBuffEntry** entries = malloc(capacity * sizeof(ProfBuffEntry*));
+
+    for (unsigned int i = 0; i < buffer->size; i++) {
+        entries[i] = BUFFER_AT(buffer, i);
+    }
+
+    free(buffer->entries);
+    buffer->entries = entries;
+    buffer->capacity = capacity;
+    buffer->head = 0;
+}
+
+// the entry with the sequence number of e, sequence numbers grow along the ring
+static unsigned int
+_buffer_position(ProfBuff buffer, ProfBuffEntry* e)
+{
+    unsigned int low = 0;
+    unsigned int high = buffer->size;
+    while (low < high) {
+        unsigned int mid = low + (high - low) / 2;
+        if (BUFFER_AT(buffer, mid)->_seq < e->_seq) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    assert(low < buffer->size && BUFFER_AT(buffer, low) == e);
+
+    return low;
+}
+
+// move count entries starting at from one slot towards the end of the ring
+static void
+_buffer_shift_up(ProfBuff buffer, unsigned int from, unsigned int count)
+{
+    while (count > 0) {
+        unsigned int src = (buffer->head + from + count - 1) % buffer->capacity;
+        unsigned int dst = (src + 1) % buffer->capacity;
+        unsigned int n = MIN(count, MIN(src, dst) + 1);
+        memmove(&buffer->entries[dst + 1 - n], &buffer->entries[src + 1 - n], n * sizeof(ProfBuffEntry*));
+        count -= n;
+    }
+}
+
+// move count entries starting at from one slot towards the start of the ring
+static void
+_buffer_shift_down(ProfBuff buffer, unsigned int from, unsigned int count)
+{
+    while (count > 0) {
+        unsigned int src = (buffer->head + from) % buffer->capacity;
+        unsigned int dst = (src + buffer->capacity - 1) % buffer->capacity;
+        unsigned int n = MIN(count, buffer->capacity - MAX(src, dst));
+        memmove(&buffer->entries[dst], &buffer->entries[src], n * sizeof(ProfBuffEntry*));
+        from += n;
+        count -= n;
+    }
+}
+
+static void
+_buffer_delete(ProfBuff buffer, unsigned int entry)
+{
+    ProfBuffEntry* e = BUFFER_AT(buffer, entry);
+
+    // close the gap from whichever end is closer
+    if (entry < buffer->size / 2) {
+        _buffer_shift_up(buffer, 0, entry);
+        buffer->head = (buffer->head + 1) % buffer->capacity;
+    } else {
+        _buffer_shift_down(buffer, entry + 1, buffer->size - entry - 1);
+    }
+    buffer->size--;
+
+    buffer->lines -= e->_lines;
+    buffer->memory -= e->_size;
+    buffers_memory -= e->_size;
+    _buffer_index_remove(buffer, e);
+    _free_entry(buffer, e);
+}
+
+static void
+_buffer_id_free(BufferId* id)
+{
+    g_queue_clear(&id->entries);
+    g_free(id);
+}
+
+static void
+_buffer_index_add(ProfBuff buffer, ProfBuffEntry* e, gboolean append)
+{
+    if (!e->id) {
+        return;
+    }
+
+    BufferId* id = g_hash_table_lookup(buffer->by_id, e->id);
+    if (!id) {
+        gsize len = strlen(e->id) + 1;
+        id = g_malloc(sizeof(BufferId) + len);
+        g_queue_init(&id->entries);
+        memcpy(id->id, e->id, len);
+        g_hash_table_insert(buffer->by_id, id->id, id);
+    }
+
+    // lookups return the oldest entry with a given id
+    if (append) {
+        g_queue_push_tail(&id->entries, e);
+        e->_id_link = id->entries.tail;
+    } else {
+        g_queue_push_head(&id->entries, e);
+        e->_id_link = id->entries.head;
+    }
+}
+
+static void
+_buffer_index_remove(ProfBuff buffer, ProfBuffEntry* e)
+{
+    if (!e->_id_link) {
+        return;
+    }
+
+    BufferId* id = g_hash_table_lookup(buffer->by_id, e->id);
+    g_queue_delete_link(&id->entries, e->_id_link);
+    e->_id_link = NULL;
+    if (g_queue_is_empty(&id->entries)) {
+        g_hash_table_remove(buffer->by_id, e->id);
+    }
+}
+
+/* Drop the oldest entries of the biggest reloadable buffers until we are
+ * within the limit. They can be fetched from the database again when
+ * scrolling up, other buffers only lose entries to their max_size.
+ * The buffer that is just being filled loses entries from the other end. */
+static void
+_buffers_enforce_memory_limit(ProfBuff current, gboolean append)
+{
+    while (buffers_memory > memory_limit) {
+        ProfBuff biggest = NULL;
+        for (GSList* curr = buffers; curr; curr = g_slist_next(curr)) {
+            ProfBuff buffer = curr->data;
+            if (buffer->reloadable && buffer->size > 1 && (!biggest || buffer->memory > biggest->memory)) {
+                biggest = buffer;
+            }
+        }
+
+        if (!biggest) {
+            break;
+        }
+
+        _buffer_delete(biggest, (biggest == current && !append) ? biggest->size - 1 : 0);
+    }
+}
+
+static const char*
+_buffer_name_ref(ProfBuff buffer, const char* const name)
+{
+    if (!name) {
+        return NULL;
+    }
+
+    BufferName* entry = g_hash_table_lookup(buffer->names, name);
+    if (!entry) {
+        gsize len = strlen(name) + 1;
+        entry = g_malloc(sizeof(BufferName) + len);
+        entry->refs = 0;
+        entry->size = sizeof(BufferName) + len;
+        memcpy(entry->name, name, len);
+        g_hash_table_insert(buffer->names, entry->name, entry);
+        buffer->memory += entry->size;
+        buffers_memory += entry->size;
+    }
+    entry->refs++;
+
+    return entry->name;
+}
+
+static void
+_buffer_name_unref(ProfBuff buffer, const char* const name)
+{
+    if (!name) {
+        return;
+    }
+
+    BufferName* entry = g_hash_table_lookup(buffer->names, name);
+    if (--entry->refs == 0) {
+        buffer->memory -= entry->size;
+        buffers_memory -= entry->size;
+        g_hash_table_remove(buffer->names, name);
+    }
 }
 
 static ProfBuffEntry*
-_create_entry(const char* show_char, int pad_indent, GDateTime* time, int flags, theme_item_t theme_item, const char* const display_from, const char* const from_jid, const char* const message, DeliveryReceipt* receipt, const char* const id, int y_start_pos, int y_end_pos)
+_create_entry(ProfBuff buffer, const char* show_char, int pad_indent, gint64 time, gint32 utc_offset, int flags, theme_item_t theme_item, const char* const display_from, const char* const from_jid, const char* const message, DeliveryReceipt* receipt, const char* const id, int y_start_pos, int y_end_pos)
 {
-    ProfBuffEntry* e = g_new0(ProfBuffEntry, 1);
-    e->show_char = STRDUP_OR_NULL(show_char);
+    gsize show_char_len = show_char ? strlen(show_char) + 1 : 0;
+    gsize message_len = message ? strlen(message) + 1 : 0;
+    gsize id_len = id ? strlen(id) + 1 : 0;
+    gsize size = sizeof(ProfBuffEntry) + show_char_len + message_len + id_len;
+
+    ProfBuffEntry* e = malloc(size);
+    char* data = e->_data;
+
+    e->show_char = show_char ? memcpy(data, show_char, show_char_len) : NULL;
+    data += show_char_len;
+    e->message = message ? memcpy(data, message, message_len) : NULL;
+    data += message_len;
+    e->id = id ? memcpy(data, id, id_len) : NULL;
+
     e->pad_indent = pad_indent;
     e->flags = flags;
     e->theme_item = theme_item;
-    e->time = g_date_time_ref(time);
-    e->display_from = STRDUP_OR_NULL(display_from);
-    e->from_jid = STRDUP_OR_NULL(from_jid);
-    e->message = STRDUP_OR_NULL(message);
-    e->receipt = receipt;
-    e->id = STRDUP_OR_NULL(id);
+    e->time = time;
+    e->utc_offset = utc_offset;
+    e->display_from = _buffer_name_ref(buffer, display_from);
+    e->from_jid = _buffer_name_ref(buffer, from_jid);
+    e->receipt = NULL;
+    e->_receipt.received = FALSE;
+    // the buffer takes ownership of the receipt
+    if (receipt) {
+        e->_receipt = *receipt;
+        e->receipt = &e->_receipt;
+        free(receipt);
+    }
     e->y_start_pos = y_start_pos;
     e->y_end_pos = y_end_pos;
     e->_lines = e->y_end_pos - e->y_start_pos;
+    e->_layout_cols = 0;
+    e->_layout_lines = 0;
+    e->_seq = 0;
+    e->_id_link = NULL;
+    e->_size = size;
 
     return e;
 }
 
 static void
-_free_entry(ProfBuffEntry* entry)
-{
-    free(entry->id);
-    free(entry->message);
-    free(entry->from_jid);
-    free(entry->display_from);
-    g_date_time_unref(entry->time);
-    free(entry->show_char);
-    free(entry->receipt);
+_free_entry(ProfBuff buffer, ProfBuffEntry* entry)
+{
+    _buffer_name_unref(buffer, entry->display_from);
+    _buffer_name_unref(buffer, entry->from_jid);
     free(entry);
 }
@@ -29,30 +29,53 @@ typedef struct prof_buff_entry_t
     int y_start_pos;
     int y_end_pos;
     int _lines;
-    GDateTime* time;
+    // wrapped height of the entry when it was last laid out at _layout_cols
+    int _layout_cols;
+    int _layout_lines;
+    // microseconds since the epoch, use buffer_entry_get_time()
+    gint64 time;
+    // UTC offset of the original timestamp in seconds
+    gint32 utc_offset;
     int flags;
     theme_item_t theme_item;
     // from as it is displayed
     // might be nick, jid..
-    char* display_from;
-    char* from_jid;
+    // both are shared by the entries of a buffer and counted in its memory
+    const char* display_from;
+    const char* from_jid;
     char* message;
     DeliveryReceipt* receipt;
     // message id, in case we have it
     char* id;
+    // position in the buffer and among the entries with the same id
+    gint64 _seq;
+    GList* _id_link;
+    // show_char, message and id point into _data, the whole entry is one allocation
+    DeliveryReceipt _receipt;
+    gsize _size;
+    char _data[];
 } ProfBuffEntry;
 
 typedef struct prof_buff_t* ProfBuff;
 
 ProfBuff buffer_create();
 void buffer_free(ProfBuff buffer);
+void buffer_set_max_size(ProfBuff buffer, unsigned int max_size);
+void buffer_set_reloadable(ProfBuff buffer, gboolean reloadable);
+void buffer_set_memory_limit(gsize bytes);
+gsize buffer_get_memory_usage(void);
 void buffer_append(ProfBuff buffer, const char* show_char, int pad_indent, GDateTime* time, int flags, theme_item_t theme_item, const char* const display_from, const char* const barejid, const char* const message, DeliveryReceipt* receipt, const char* const id, int y_start_pos, int y_end_pos);
 void buffer_prepend(ProfBuff buffer, const char* show_char, int pad_indent, GDateTime* time, int flags, theme_item_t theme_item, const char* const display_from, const char* const barejid, const char* const message, DeliveryReceipt* receipt, const char* const id, int y_start_pos, int y_end_pos);
+ProfBuffEntry* buffer_update_entry(ProfBuff buffer, ProfBuffEntry* entry, const char* const show_char, const char* const message);
 void buffer_remove_entry_by_id(ProfBuff buffer, const char* const id);
 void buffer_remove_entry(ProfBuff buffer, unsigned int entry);
 unsigned int buffer_size(ProfBuff buffer);
 ProfBuffEntry* buffer_get_entry(ProfBuff buffer, unsigned int entry);
 ProfBuffEntry* buffer_get_entry_by_id(ProfBuff buffer, const char* const id);
 gboolean buffer_mark_received(ProfBuff buffer, const char* const id);
+unsigned int buffer_first_positioned(ProfBuff buffer, unsigned int end);
+unsigned int buffer_line_at_row(ProfBuff buffer, unsigned int first, unsigned int end, int row);
+unsigned int buffer_line_from_row(ProfBuff buffer, unsigned int first, unsigned int end, int row);
+GDateTime* buffer_entry_get_time(const ProfBuffEntry* const entry);
 
 #endif
@@ -570,7 +570,9 @@ chatwin_db_history(ProfChatWin* chatwin, const char* start_time, const char* end
 {
     auto_gchar gchar* end_time_ = NULL;
     if (!end_time && buffer_size(((ProfWin*)chatwin)->layout->buffer) != 0) {
-        end_time = end_time_ = g_date_time_format_iso8601(buffer_get_entry(((ProfWin*)chatwin)->layout->buffer, 0)->time);
+        GDateTime* first_time = buffer_entry_get_time(buffer_get_entry(((ProfWin*)chatwin)->layout->buffer, 0));
+        end_time = end_time_ = g_date_time_format_iso8601(first_time);
+        g_date_time_unref(first_time);
     }
 
     GSList* history = log_database_get_previous_chat(chatwin->barejid, start_time, end_time, !flip, flip);
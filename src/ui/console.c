@@ -39,6 +39,7 @@
 #include "xmpp/xmpp.h"
 #include "xmpp/muc.h"
 #include "xmpp/roster_list.h"
+#include "tools/transfer.h"
 
 static void _cons_splash_logo(void);
 static void _show_roster_contacts(GSList* list, gboolean show_groups);
@@ -548,7 +549,7 @@ cons_show_caps(const char* const fulljid, resource_presence_t presence)
                 feature = g_slist_next(feature);
             }
         }
-        caps_destroy(caps);
+        caps_unref(caps);
 
     } else {
         cons_show("No capabilities found for %s", fulljid);
@@ -767,6 +768,57 @@ cons_show_disco_items(GSList* items, const char* const jid)
     cons_alert(NULL);
 }
 
+void
+cons_show_transfers(GList* transfers)
+{
+    ProfWin* console = wins_get_console();
+    cons_show("");
+    if (!transfers) {
+        cons_show("No file transfers.");
+        cons_alert(NULL);
+        return;
+    }
+
+    cons_show("File transfers:");
+    for (GList* curr = transfers; curr; curr = g_list_next(curr)) {
+        Transfer* transfer = curr->data;
+        const char* state = "";
+        switch (transfer->state) {
+        case TRANSFER_QUEUED:
+            state = "queued";
+            break;
+        case TRANSFER_ACTIVE:
+            state = "active";
+            break;
+        case TRANSFER_COMPLETED:
+            state = "done";
+            break;
+        case TRANSFER_FAILED:
+            state = "failed";
+            break;
+        case TRANSFER_CANCELED:
+            state = "canceled";
+            break;
+        }
+
+        auto_gchar gchar* now = g_format_size(transfer->now);
+        win_print(console, THEME_DEFAULT, "-", "  %s %s (%s, %s", transfer->upload ? "upload" : "download",
+                  transfer->description, transfer->host, state);
+        if (transfer->total > 0) {
+            auto_gchar gchar* total = g_format_size(transfer->total);
+            win_append(console, THEME_DEFAULT, ", %s of %s", now, total);
+        } else if (transfer->now > 0) {
+            win_append(console, THEME_DEFAULT, ", %s", now);
+        }
+        if (transfer->error) {
+            win_append(console, THEME_DEFAULT, ": %s", transfer->error);
+        }
+        win_appendln(console, THEME_DEFAULT, ")");
+    }
+
+    cons_alert(NULL);
+}
+
 static void
 _cons_print_contact_information_item(gpointer data, gpointer user_data)
 {
@@ -1089,7 +1141,7 @@ cons_show_account(ProfAccount* account)
                     }
                 }
 
-                caps_destroy(caps);
+                caps_unref(caps);
             }
 
             curr = g_list_next(curr);
@@ -1618,6 +1670,8 @@ cons_show_ui_prefs(void)
     cons_wintitle_setting();
     cons_presence_setting();
     cons_inpblock_setting();
+    cons_scrollback_setting();
+    cons_framerate_setting();
     cons_titlebar_setting();
     cons_statusbar_setting();
     cons_mood_setting();
@@ -1774,6 +1828,38 @@ cons_gone_setting(void)
     }
 }
 
+void
+cons_show_history_search(const char* const query, GSList* results, int offset, gboolean more)
+{
+    ProfWin* console = wins_get_console();
+
+    cons_show("");
+    if (results == NULL) {
+        if (offset == 0) {
+            cons_show("No messages found for: %s", query);
+        } else {
+            cons_show("No more messages found for: %s", query);
+        }
+        return;
+    }
+
+    cons_show("Messages matching: %s", query);
+    int num = offset;
+    for (GSList* curr = results; curr; curr = g_slist_next(curr)) {
+        ProfMessage* msg = curr->data;
+        auto_gchar gchar* date = msg->timestamp ? g_date_time_format(msg->timestamp, "%Y-%m-%d %H:%M") : g_strdup("");
+        const char* from = msg->type == PROF_MSG_TYPE_MUC && msg->from_jid->resourcepart ? msg->from_jid->fulljid : msg->from_jid->barejid;
+
+        num++;
+        win_print(console, THEME_TEXT, "-", "  %d. %s %s: ", num, date, from);
+        win_append(console, THEME_TEXT, "%s", msg->plain);
+        win_newline(console);
+    }
+    if (more) {
+        cons_show("Use '/history more' for more results.");
+    }
+}
+
 void
 cons_history_setting(void)
 {
@@ -1835,6 +1921,23 @@ cons_inpblock_setting(void)
     }
 }
 
+void
+cons_framerate_setting(void)
+{
+    cons_show("Frame rate (/framerate)             : %d updates per second", prefs_get_framerate());
+}
+
+void
+cons_scrollback_setting(void)
+{
+    cons_show("Chat scrollback (/scrollback)       : %d entries", prefs_get_scrollback("chat"));
+    cons_show("Room scrollback (/scrollback)       : %d entries", prefs_get_scrollback("muc"));
+    cons_show("Private scrollback (/scrollback)    : %d entries", prefs_get_scrollback("private"));
+    cons_show("Other scrollback (/scrollback)      : %d entries", prefs_get_scrollback("other"));
+    cons_show("Scrollback memory (/scrollback)     : %d megabytes (%" G_GSIZE_FORMAT " kilobytes in use)",
+              prefs_get_scrollback_memory(), buffer_get_memory_usage() / 1024);
+}
+
 void
 cons_statusbar_setting(void)
 {
@@ -1925,6 +2028,9 @@ cons_logging_setting(void)
         cons_show("Groupchat logging (/logging group)          : ON");
     else
         cons_show("Groupchat logging (/logging group)          : OFF");
+
+    auto_gchar gchar* dblog_sync = prefs_get_string(PREF_DBLOG_SYNC);
+    cons_show("Database sync (/logging sync)               : %s", dblog_sync);
 }
 
 void
@@ -2175,6 +2281,7 @@ cons_show_connection_prefs(void)
     cons_autoconnect_setting();
     cons_rooms_cache_setting();
     cons_strophe_setting();
+    cons_transfers_setting();
 
     cons_alert(NULL);
 }
@@ -2840,6 +2947,18 @@ cons_strophe_setting(void)
     cons_show("libstrophe Verbosity                      : %s", verbosity);
 }
 
+void
+cons_transfers_setting(void)
+{
+    gint rate = prefs_get_transfer_rate();
+    if (rate > 0) {
+        cons_show("File transfer speed limit (/transfers)    : %d KiB/s", rate);
+    } else {
+        cons_show("File transfer speed limit (/transfers)    : OFF");
+    }
+    cons_show("File transfers per host (/transfers)      : %d", prefs_get_transfer_host_limit());
+}
+
 void
 cons_privacy_setting(void)
 {
@@ -57,6 +57,13 @@ static gboolean perform_resize = FALSE;
 static GTimer* ui_idle_time;
 static WINDOW* main_scr;
 
+// frame scheduling for ui_frame()
+static gint64 last_frame = 0;
+static gboolean frame_pending = FALSE;
+
+// last title written to the terminal
+static gchar* term_title = NULL;
+
 #ifdef HAVE_LIBXSS
 static Display* display;
 #endif
@@ -67,6 +74,7 @@ static void
 _ui_close(void)
 {
     g_timer_destroy(ui_idle_time);
+    GFREE_SET_NULL(term_title);
     notifier_uninit();
     cons_clear_alerts();
     wins_destroy();
@@ -96,6 +104,7 @@ ui_init(void)
     status_bar_active(1, WIN_CONSOLE, "console");
     create_input_window();
     wins_init();
+    ui_update_scrollback();
     notifier_initialise();
     cons_about();
 #ifdef HAVE_LIBXSS
@@ -130,22 +139,65 @@ ui_update(void)
         win_move_to_end(current);
     }
 
+    rosterwin_update();
+    occupantswin_update();
     win_update_virtual(current);
 
     if (prefs_get_boolean(PREF_WINTITLE_SHOW)) {
         _ui_draw_term_title();
     }
     title_bar_update_virtual();
-    status_bar_draw();
+    status_bar_update_virtual();
     inp_put_back();
     doupdate();
 
+    last_frame = g_get_monotonic_time();
+    frame_pending = FALSE;
+
     if (perform_resize) {
         perform_resize = FALSE;
         ui_resize();
     }
 }
 
+static gint64
+_ui_frame_remaining(void)
+{
+    gint64 interval = G_USEC_PER_SEC / prefs_get_framerate();
+    return last_frame + interval - g_get_monotonic_time();
+}
+
+/* Called once per main loop iteration. Draws a frame unless the last one
+ * was less than 1/framerate seconds ago, so a flood of stanzas redraws the
+ * screen a bounded number of times instead of once per stanza. */
+void
+ui_frame(void)
+{
+    if (!perform_resize && _ui_frame_remaining() > 0) {
+        frame_pending = TRUE;
+        return;
+    }
+
+    ui_update();
+}
+
+/* Milliseconds until a skipped frame is due, so input polling doesn't
+ * block past it. G_MAXINT when no frame is waiting. */
+gint
+ui_frame_delay(void)
+{
+    if (!frame_pending) {
+        return G_MAXINT;
+    }
+
+    gint64 remaining = _ui_frame_remaining();
+    if (remaining <= 0) {
+        return 0;
+    }
+
+    return (gint)((remaining + 999) / 1000);
+}
+
 unsigned long
 ui_get_idle_time(void)
 {
@@ -207,6 +259,13 @@ ui_flash(void)
     }
 }
 
+void
+ui_update_scrollback(void)
+{
+    buffer_set_memory_limit((gsize)prefs_get_scrollback_memory() * 1024 * 1024);
+    wins_update_scrollback();
+}
+
 void
 ui_resize(void)
 {
@@ -227,6 +286,8 @@ ui_resize(void)
     status_bar_resize();
     inp_win_resize();
     ProfWin* window = wins_get_current();
+    rosterwin_update();
+    occupantswin_update();
     win_update_virtual(window);
 }
 
@@ -1104,6 +1165,7 @@ ui_contact_offline(char* barejid, char* resource, char* status)
 void
 ui_clear_win_title(void)
 {
+    GFREE_SET_NULL(term_title);
     fputs("\e]0;\a", stdout);
     fflush(stdout);
 }
@@ -1111,6 +1173,7 @@ ui_clear_win_title(void)
 void
 ui_goodbye_title(void)
 {
+    GFREE_SET_NULL(term_title);
     fputs("\e]0;Thanks for using Profanity\a", stdout);
     fflush(stdout);
 }
@@ -1119,19 +1182,30 @@ static void
 _ui_draw_term_title(void)
 {
     jabber_conn_status_t status = connection_get_status();
+    gchar* title;
 
     if (status == JABBER_CONNECTED) {
         const char* const jid = connection_get_fulljid();
         gint unread = wins_get_total_unread();
 
         if (unread != 0) {
-            fprintf(stdout, "\e]0;Profanity (%d) - %s\a", unread, jid);
+            title = g_strdup_printf("Profanity (%d) - %s", unread, jid);
         } else {
-            fprintf(stdout, "\e]0;Profanity - %s\a", jid);
+            title = g_strdup_printf("Profanity - %s", jid);
         }
     } else {
-        fputs("\e]0;Profanity\a", stdout);
+        title = g_strdup("Profanity");
     }
+
+    // only talk to the terminal when the title actually changed
+    if (g_strcmp0(title, term_title) == 0) {
+        g_free(title);
+        return;
+    }
+    g_free(term_title);
+    term_title = title;
+
+    fprintf(stdout, "\e]0;%s\a", term_title);
     fflush(stdout);
 }
 
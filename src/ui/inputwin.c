@@ -19,6 +19,7 @@
 #include <sys/time.h>
 #include <errno.h>
 #include <pthread.h>
+#include <unistd.h>
 
 #include <readline/readline.h>
 #include <readline/history.h>
@@ -51,10 +52,21 @@
 #include "xmpp/chat_state.h"
 #include "tools/editor.h"
 #include "tools/spellcheck.h"
+#include "tools/transfer.h"
 
 static WINDOW* inp_win;
 static int pad_start = 0;
 
+// longer input gets unknown words spellchecked after the keystroke is drawn
+#define INP_SPELLCHECK_DEFER_LEN 1024
+
+// terminal bracketed paste, the pasted text comes between these
+#define INP_PASTE_ENABLE  "\033[?2004h"
+#define INP_PASTE_DISABLE "\033[?2004l"
+#define INP_PASTE_END     "\033[201~"
+// give up waiting for the end of a paste after this long
+#define INP_PASTE_TIMEOUT_MS 1000
+
 static struct timeval p_rl_timeout;
 /* Timeout in ms. Shows how long select() may block. */
 static gint inp_timeout = 0;
@@ -73,6 +85,7 @@ static void _inp_win_handle_scroll(void);
 static int _inp_offset_to_col(char* str, int offset);
 static void _inp_write(char* line, int offset);
 static void _inp_redisplay(void);
+static void _inp_spellcheck_ready(void);
 
 static void _inp_rl_addfuncs(void);
 static int _inp_rl_getc(FILE* stream);
@@ -115,6 +128,8 @@ static int _inp_rl_down_arrow_handler(int count, int key);
 static int _inp_rl_scroll_handler(int count, int key);
 static int _inp_rl_send_to_editor(int count, int key);
 static int _inp_rl_print_newline_symbol(int count, int key);
+static int _inp_rl_bracketed_paste_handler(int count, int key);
+static void _inp_bracketed_paste(gboolean enable);
 
 void
 create_input_window(void)
@@ -137,6 +152,8 @@ create_input_window(void)
     rl_redisplay_function = _inp_redisplay;
     rl_startup_hook = _inp_rl_startup_hook;
     rl_callback_handler_install(NULL, _inp_rl_linehandler);
+    spellcheck_set_ready_cb(_inp_spellcheck_ready);
+    _inp_bracketed_paste(TRUE);
 
     inp_win = newpad(1, INP_WIN_MAX);
     wbkgd(inp_win, theme_attrs(THEME_INPUT_TEXT));
@@ -178,13 +195,37 @@ inp_readline(void)
         return NULL;
     }
 
-    p_rl_timeout.tv_sec = inp_timeout / 1000;
-    p_rl_timeout.tv_usec = inp_timeout % 1000 * 1000;
+    /* Wait for keyboard input, data on the XMPP socket, output on the
+     * stderr pipe or a running HTTP transfer, whichever comes first. The
+     * timeout only bounds how late the timed tasks of the main loop may run. */
+    int in_fd = fileno(rl_instream);
+    int xmpp_fd = connection_get_fd();
+    int stderr_fd = log_stderr_get_fd();
+    int max_fd = in_fd;
+    fd_set write_fds;
+
+    gint timeout = MIN(inp_timeout, ui_frame_delay());
     FD_ZERO(&fds);
-    FD_SET(fileno(rl_instream), &fds);
+    FD_ZERO(&write_fds);
+    FD_SET(in_fd, &fds);
+    if (xmpp_fd >= 0) {
+        FD_SET(xmpp_fd, &fds);
+        max_fd = MAX(max_fd, xmpp_fd);
+    }
+    if (stderr_fd >= 0) {
+        FD_SET(stderr_fd, &fds);
+        max_fd = MAX(max_fd, stderr_fd);
+    }
+    transfer_fdset(&fds, &write_fds, &max_fd, &timeout);
+    // deferred spellchecks go on with the next batch right away
+    if (spellcheck_has_pending()) {
+        timeout = 0;
+    }
+    p_rl_timeout.tv_sec = timeout / 1000;
+    p_rl_timeout.tv_usec = timeout % 1000 * 1000;
     errno = 0;
     pthread_mutex_unlock(&lock);
-    r = select(FD_SETSIZE, &fds, NULL, NULL, &p_rl_timeout);
+    r = select(max_fd + 1, &fds, &write_fds, NULL, &p_rl_timeout);
     pthread_mutex_lock(&lock);
     if (r < 0) {
         if (errno != EINTR) {
@@ -194,7 +235,11 @@ inp_readline(void)
         return NULL;
     }
 
-    if (FD_ISSET(fileno(rl_instream), &fds)) {
+    if (stderr_fd >= 0 && FD_ISSET(stderr_fd, &fds)) {
+        log_stderr_handler();
+    }
+
+    if (FD_ISSET(in_fd, &fds)) {
         rl_callback_read_char();
 
         if (rl_line_buffer && rl_line_buffer[0] != '/' && rl_line_buffer[0] != '\0' && rl_line_buffer[0] != '\n') {
@@ -203,6 +248,10 @@ inp_readline(void)
 
         ui_reset_idle_time();
         inp_nonblocking(TRUE);
+    } else if (xmpp_fd >= 0 && FD_ISSET(xmpp_fd, &fds)) {
+        // stanzas tend to arrive in bursts, stay responsive until it settles
+        inp_nonblocking(TRUE);
+        chat_state_idle();
     } else {
         inp_nonblocking(FALSE);
         chat_state_idle();
@@ -266,6 +315,8 @@ inp_nonblocking(gboolean reset)
 void
 inp_close(void)
 {
+    spellcheck_set_ready_cb(NULL);
+    _inp_bracketed_paste(FALSE);
     rl_callback_handler_remove();
     delwin(inp_win);
     inp_win = NULL;
@@ -277,6 +328,7 @@ void
 inp_suspend(void)
 {
     is_suspended = TRUE;
+    _inp_bracketed_paste(FALSE);
     rl_callback_handler_remove();
     rl_deprep_terminal();
 }
@@ -287,6 +339,7 @@ inp_resume(void)
     is_suspended = FALSE;
     rl_callback_handler_install(NULL, _inp_rl_linehandler);
     rl_prep_terminal(0);
+    _inp_bracketed_paste(TRUE);
 }
 
 char*
@@ -352,6 +405,7 @@ _inp_write(char* line, int offset)
     col += x;
 
     gboolean do_spell = prefs_get_boolean(PREF_SPELLCHECK_ENABLE) && (line[0] != '/');
+    gboolean defer_spell = do_spell && strlen(line) > INP_SPELLCHECK_DEFER_LEN;
 
     for (size_t i = 0; line[i] != '\0'; i++) {
         char* c = &line[i];
@@ -390,9 +444,7 @@ _inp_write(char* line, int offset)
                     end += next_ch_len;
                 }
 
-                char* word = g_strndup(&line[start], end - start);
-                gboolean misspelled = spellcheck_is_misspelled(word);
-                g_free(word);
+                gboolean misspelled = spellcheck_check_word(&line[start], end - start, defer_spell) == SPELLCHECK_MISSPELLED;
 
                 if (misspelled) {
                     wattron(inp_win, theme_attrs(THEME_INPUT_MISSPELLED));
@@ -544,6 +596,7 @@ _inp_rl_addfuncs(void)
     rl_add_funmap_entry("prof_send_to_editor", _inp_rl_send_to_editor);
     rl_add_funmap_entry("prof_cut_to_history", _inp_rl_down_arrow_handler);
     rl_add_funmap_entry("prof_print_newline_symbol", _inp_rl_print_newline_symbol);
+    rl_add_funmap_entry("prof_bracketed_paste", _inp_rl_bracketed_paste_handler);
 }
 
 // Readline callbacks
@@ -621,6 +674,8 @@ _inp_rl_startup_hook(void)
 
     rl_bind_keyseq("\\e\\C-\r", _inp_rl_print_newline_symbol); // alt+enter
 
+    rl_bind_keyseq("\\e[200~", _inp_rl_bracketed_paste_handler);
+
     // unbind unwanted mappings
     rl_bind_keyseq("\\e=", NULL);
 
@@ -691,6 +746,15 @@ _inp_redisplay(void)
     }
 }
 
+// deferred spellcheck results arrived, draw their squiggles
+static void
+_inp_spellcheck_ready(void)
+{
+    if (inp_win && rl_line_buffer) {
+        _inp_redisplay();
+    }
+}
+
 static int
 _inp_rl_win_clear_handler(int count, int key)
 {
@@ -1049,3 +1113,91 @@ _inp_rl_print_newline_symbol(int count, int key)
     rl_insert_text("\n");
     return 0;
 }
+
+// readline writes its own bracketed paste switch to rl_outstream, which is
+// discarded, so it is sent to the terminal here
+static void
+_inp_bracketed_paste(gboolean enable)
+{
+    const char* setting = rl_variable_value("enable-bracketed-paste");
+    if (setting && g_strcmp0(setting, "off") == 0) {
+        return;
+    }
+
+    fputs(enable ? INP_PASTE_ENABLE : INP_PASTE_DISABLE, stdout);
+    fflush(stdout);
+}
+
+// Read the whole paste at once and insert it in one go, rather than
+// feeding readline a byte per select() wakeup and redrawing after each.
+static int
+_inp_rl_bracketed_paste_handler(int count, int key)
+{
+    int fd = fileno(rl_instream ? rl_instream : stdin);
+    GString* paste = g_string_new(NULL);
+    const char* end = NULL;
+    char buf[4096];
+
+    while (!end) {
+        fd_set paste_fds;
+        FD_ZERO(&paste_fds);
+        FD_SET(fd, &paste_fds);
+        struct timeval timeout = { .tv_sec = INP_PASTE_TIMEOUT_MS / 1000, .tv_usec = INP_PASTE_TIMEOUT_MS % 1000 * 1000 };
+        int ready = select(fd + 1, &paste_fds, NULL, NULL, &timeout);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            log_warning("Bracketed paste did not end, inserting %zu bytes", paste->len);
+            break;
+        }
+
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        // the end marker may be split over two reads
+        gsize from = paste->len >= strlen(INP_PASTE_END) ? paste->len - strlen(INP_PASTE_END) + 1 : 0;
+        g_string_append_len(paste, buf, n);
+        end = g_strstr_len(paste->str + from, paste->len - from, INP_PASTE_END);
+    }
+
+    if (end) {
+        // whatever was typed after the paste goes back to readline
+        for (const char* p = end + strlen(INP_PASTE_END); p < paste->str + paste->len; p++) {
+            rl_stuff_char((unsigned char)*p);
+        }
+        g_string_truncate(paste, end - paste->str);
+    }
+
+    // terminals send line breaks as carriage returns
+    GString* text = g_string_sized_new(paste->len);
+    for (gsize i = 0; i < paste->len; i++) {
+        if (paste->str[i] == '\r') {
+            g_string_append_c(text, '\n');
+            if (i + 1 < paste->len && paste->str[i + 1] == '\n') {
+                i++;
+            }
+        } else if (paste->str[i] != '\0') {
+            g_string_append_c(text, paste->str[i]);
+        }
+    }
+    g_string_free(paste, TRUE);
+
+    if (text->len > 0) {
+        rl_insert_text(text->str);
+
+        ProfWin* window = wins_get_current();
+        cmd_ac_reset(window);
+        if ((window->type == WIN_CHAT || window->type == WIN_MUC || window->type == WIN_PRIVATE) && window->quotes_ac != NULL) {
+            autocomplete_reset(window->quotes_ac);
+        }
+    }
+    g_string_free(text, TRUE);
+
+    return 0;
+}
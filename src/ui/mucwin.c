@@ -344,8 +344,9 @@ mucwin_history(ProfMucWin* mucwin, const ProfMessage* const message)
 
     char* nick = message->from_jid->resourcepart;
     const char* const mynick = muc_nick(mucwin->roomjid);
-    GSList* mentions = get_mentions(prefs_get_boolean(PREF_NOTIFY_MENTION_WHOLE_WORD), prefs_get_boolean(PREF_NOTIFY_MENTION_CASE_SENSITIVE), message->plain, mynick);
-    GList* triggers = prefs_message_get_triggers(message->plain);
+    GSList* mentions = NULL;
+    GList* triggers = NULL;
+    prefs_message_get_matches(message->plain, mynick, &mentions, &triggers);
 
     mucwin_incoming_msg(mucwin, message, mentions, triggers, FALSE);
 
@@ -995,7 +996,9 @@ mucwin_db_history(ProfMucWin* mucwin, const char* start_time, const char* end_ti
 {
     auto_gchar gchar* end_time_ = NULL;
     if (!end_time && buffer_size(((ProfWin*)mucwin)->layout->buffer) != 0) {
-        end_time = end_time_ = g_date_time_format_iso8601(buffer_get_entry(((ProfWin*)mucwin)->layout->buffer, 0)->time);
+        GDateTime* first_time = buffer_entry_get_time(buffer_get_entry(((ProfWin*)mucwin)->layout->buffer, 0));
+        end_time = end_time_ = g_date_time_format_iso8601(first_time);
+        g_date_time_unref(first_time);
     }
 
     GSList* history = log_database_get_previous_muc(mucwin->roomjid, start_time, end_time, !flip, flip);
@@ -12,6 +12,7 @@
 
 #include <assert.h>
 
+#include "common.h"
 #include "config/preferences.h"
 #include "ui/ui.h"
 #include "ui/window.h"
@@ -89,142 +90,143 @@ _occuptantswin_occupant(ProfLayoutSplit* layout, GList* item, gboolean showjid,
     }
 }
 
-void
-occupantswin_occupants(const char* const roomjid)
+static void
+_occupantswin_header(ProfLayoutSplit* layout, GString* prefix, const char* const title)
+{
+    GString* role = g_string_new(prefix->str);
+    g_string_append(role, title);
+
+    wattron(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
+    win_sub_newline_lazy(layout->subwin);
+    win_sub_print(layout->subwin, role->str, TRUE, FALSE, 0);
+    wattroff(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
+    g_string_free(role, TRUE);
+}
+
+static void
+_occupantswin_draw(const char* const roomjid)
 {
     ProfMucWin* mucwin = wins_get_muc(roomjid);
-    if (mucwin) {
-        GList* occupants = muc_roster(roomjid);
-        if (occupants) {
-            ProfLayoutSplit* layout = (ProfLayoutSplit*)mucwin->window.layout;
-            assert(layout->memcheck == LAYOUT_SPLIT_MEMCHECK);
+    if (!mucwin) {
+        return;
+    }
 
-            werase(layout->subwin);
+    ProfLayoutSplit* layout = (ProfLayoutSplit*)mucwin->window.layout;
+    assert(layout->memcheck == LAYOUT_SPLIT_MEMCHECK);
+    if (!layout->subwin) {
+        return;
+    }
 
-            GString* prefix = g_string_new(" ");
+    gboolean privileges = prefs_get_boolean(PREF_MUC_PRIVILEGES);
 
-            auto_gchar gchar* ch = prefs_get_occupants_header_char();
-            if (ch) {
-                g_string_append_printf(prefix, "%s", ch);
-            }
+    // ordered by role then nick, so each role section is one run of the list
+    GList* occupants = privileges ? muc_roster_by_role(roomjid) : muc_roster(roomjid);
+    if (!occupants) {
+        return;
+    }
 
-            if (prefs_get_boolean(PREF_MUC_PRIVILEGES)) {
+    werase(layout->subwin);
 
-                GList* online_occupants = { NULL };
+    GString* prefix = g_string_new(" ");
 
-                GString* role = g_string_new(prefix->str);
-                g_string_append(role, "Moderators");
+    auto_gchar gchar* ch = prefs_get_occupants_header_char();
+    if (ch) {
+        g_string_append_printf(prefix, "%s", ch);
+    }
 
-                wattron(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
-                win_sub_newline_lazy(layout->subwin);
-                win_sub_print(layout->subwin, role->str, TRUE, FALSE, 0);
-                wattroff(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
-                g_string_free(role, TRUE);
-                GList* roster_curr = occupants;
-                while (roster_curr) {
-                    Occupant* occupant = roster_curr->data;
-                    if (occupant->role == MUC_ROLE_MODERATOR) {
-                        _occuptantswin_occupant(layout, roster_curr, mucwin->showjid, false);
-                    }
-                    roster_curr = g_list_next(roster_curr);
-                    online_occupants = g_list_append(online_occupants, occupant->jid);
-                }
+    if (privileges) {
+        const muc_role_t roles[] = { MUC_ROLE_MODERATOR, MUC_ROLE_PARTICIPANT, MUC_ROLE_VISITOR };
+        const char* const titles[] = { "Moderators", "Participants", "Visitors" };
 
-                role = g_string_new(prefix->str);
-                g_string_append(role, "Participants");
-
-                wattron(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
-                win_sub_newline_lazy(layout->subwin);
-                win_sub_print(layout->subwin, role->str, TRUE, FALSE, 0);
-                wattroff(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
-                g_string_free(role, TRUE);
-                roster_curr = occupants;
-                while (roster_curr) {
-                    Occupant* occupant = roster_curr->data;
-                    if (occupant->role == MUC_ROLE_PARTICIPANT) {
-                        _occuptantswin_occupant(layout, roster_curr, mucwin->showjid, false);
-                    }
-                    roster_curr = g_list_next(roster_curr);
-                    online_occupants = g_list_append(online_occupants, occupant->jid);
-                }
+        GList* roster_curr = occupants;
+        for (size_t i = 0; i < G_N_ELEMENTS(roles); i++) {
+            _occupantswin_header(layout, prefix, titles[i]);
+            while (roster_curr && ((Occupant*)roster_curr->data)->role == roles[i]) {
+                _occuptantswin_occupant(layout, roster_curr, mucwin->showjid, false);
+                roster_curr = g_list_next(roster_curr);
+            }
+        }
 
-                role = g_string_new(prefix->str);
-                g_string_append(role, "Visitors");
-
-                wattron(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
-                win_sub_newline_lazy(layout->subwin);
-                win_sub_print(layout->subwin, role->str, TRUE, FALSE, 0);
-                wattroff(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
-                g_string_free(role, TRUE);
-                roster_curr = occupants;
-                while (roster_curr) {
-                    Occupant* occupant = roster_curr->data;
-                    if (occupant->role == MUC_ROLE_VISITOR) {
-                        _occuptantswin_occupant(layout, roster_curr, mucwin->showjid, false);
+        if (mucwin->showoffline) {
+            // bare JIDs of the occupants, and of the offline members already shown
+            // so an account on multiple devices is listed once
+            GHashTable* shown = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+            for (GList* curr = occupants; curr; curr = g_list_next(curr)) {
+                Occupant* occupant = curr->data;
+                if (occupant->jid) {
+                    auto_jid Jid* jid = jid_create(occupant->jid);
+                    if (jid) {
+                        g_hash_table_add(shown, g_strdup(jid->barejid));
                     }
-                    roster_curr = g_list_next(roster_curr);
-                    online_occupants = g_list_append(online_occupants, occupant->jid);
                 }
+            }
 
-                if (mucwin->showoffline) {
-                    GList* members = muc_members(roomjid);
-                    // offline_occupants is used to display the same account on multiple devices once
-                    GList* offline_occupants = { NULL };
-
-                    role = g_string_new(prefix->str);
-                    g_string_append(role, "Offline");
-
-                    wattron(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
-                    win_sub_newline_lazy(layout->subwin);
-                    win_sub_print(layout->subwin, role->str, TRUE, FALSE, 0);
-                    wattroff(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
-                    g_string_free(role, TRUE);
-                    roster_curr = members;
-                    while (roster_curr) {
-                        auto_jid Jid* jid = jid_create(roster_curr->data);
-                        gboolean found = false;
-                        GList* iter = online_occupants;
-                        for (; iter != NULL; iter = iter->next) {
-                            if (strstr(iter->data, jid->barejid)) {
-                                found = true;
-                                break;
-                            }
-                        }
-
-                        if (!found && g_list_index(offline_occupants, jid->barejid) == -1) {
-                            _occuptantswin_occupant(layout, roster_curr, mucwin->showjid, true);
-                            offline_occupants = g_list_append(offline_occupants, jid->barejid);
-                        }
-
-                        roster_curr = g_list_next(roster_curr);
-                    }
-                    g_list_free(members);
-                    g_list_free(offline_occupants);
-                }
-                g_list_free(online_occupants);
-
-            } else {
-                GString* role = g_string_new(prefix->str);
-                g_string_append(role, "Occupants\n");
-
-                wattron(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
-                win_sub_newline_lazy(layout->subwin);
-                win_sub_print(layout->subwin, role->str, TRUE, FALSE, 0);
-                wattroff(layout->subwin, theme_attrs(THEME_OCCUPANTS_HEADER));
-                g_string_free(role, TRUE);
-
-                GList* roster_curr = occupants;
-                while (roster_curr) {
-                    _occuptantswin_occupant(layout, roster_curr, mucwin->showjid, false);
-                    roster_curr = g_list_next(roster_curr);
+            _occupantswin_header(layout, prefix, "Offline");
+
+            GList* members = muc_members(roomjid);
+            for (GList* curr = members; curr; curr = g_list_next(curr)) {
+                auto_jid Jid* jid = jid_create(curr->data);
+                if (jid && !g_hash_table_contains(shown, jid->barejid)) {
+                    _occuptantswin_occupant(layout, curr, mucwin->showjid, true);
+                    g_hash_table_add(shown, g_strdup(jid->barejid));
                 }
             }
+            g_list_free(members);
+            g_hash_table_destroy(shown);
+        }
+
+    } else {
+        _occupantswin_header(layout, prefix, "Occupants\n");
 
-            g_string_free(prefix, TRUE);
+        GList* roster_curr = occupants;
+        while (roster_curr) {
+            _occuptantswin_occupant(layout, roster_curr, mucwin->showjid, false);
+            roster_curr = g_list_next(roster_curr);
         }
+    }
+
+    g_string_free(prefix, TRUE);
+    g_list_free(occupants);
+}
+
+// rooms whose panel changed since the last occupantswin_update()
+static GHashTable* dirty_rooms = NULL;
+
+static void
+_occupantswin_close(void)
+{
+    if (dirty_rooms) {
+        g_hash_table_destroy(dirty_rooms);
+        dirty_rooms = NULL;
+    }
+}
+
+void
+occupantswin_occupants(const char* const roomjid)
+{
+    if (!dirty_rooms) {
+        dirty_rooms = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        prof_add_shutdown_routine(_occupantswin_close);
+    }
+    g_hash_table_add(dirty_rooms, g_strdup(roomjid));
+}
+
+/* Draw the occupant panels marked by occupantswin_occupants(), once per
+ * ui_update() however many presences arrived in between. */
+void
+occupantswin_update(void)
+{
+    if (!dirty_rooms || g_hash_table_size(dirty_rooms) == 0) {
+        return;
+    }
 
-        g_list_free(occupants);
+    GHashTableIter iter;
+    gpointer roomjid;
+    g_hash_table_iter_init(&iter, dirty_rooms);
+    while (g_hash_table_iter_next(&iter, &roomjid, NULL)) {
+        _occupantswin_draw(roomjid);
     }
+    g_hash_table_remove_all(dirty_rooms);
 }
 
 void
@@ -56,9 +56,23 @@ static theme_item_t _get_roster_theme(roster_contact_theme_t theme_type, const c
 static int _compare_rooms_name(ProfMucWin* a, ProfMucWin* b);
 static int _compare_rooms_unread(ProfMucWin* a, ProfMucWin* b);
 
+// set by rosterwin_roster(), the panel is drawn once per ui_update()
+static gboolean roster_dirty = FALSE;
+
 void
 rosterwin_roster(void)
 {
+    roster_dirty = TRUE;
+}
+
+void
+rosterwin_update(void)
+{
+    if (!roster_dirty) {
+        return;
+    }
+    roster_dirty = FALSE;
+
     ProfWin* console = wins_get_console();
     if (!console) {
         return;
@@ -1148,7 +1162,7 @@ _filter_contacts(GSList* contacts)
     if (prefs_get_boolean(PREF_ROSTER_OFFLINE)) {
         GSList* curr = contacts;
         while (curr) {
-            filtered_contacts = g_slist_append(filtered_contacts, curr->data);
+            filtered_contacts = g_slist_prepend(filtered_contacts, curr->data);
             curr = g_slist_next(curr);
         }
         // if dont show offline
@@ -1162,18 +1176,18 @@ _filter_contacts(GSList* contacts)
             if (g_strcmp0(presence, "offline") == 0) {
                 ProfChatWin* chatwin = wins_get_chat(p_contact_barejid(contact));
                 if (chatwin && chatwin->unread > 0) {
-                    filtered_contacts = g_slist_append(filtered_contacts, contact);
+                    filtered_contacts = g_slist_prepend(filtered_contacts, contact);
                 }
 
                 // include if not offline
             } else {
-                filtered_contacts = g_slist_append(filtered_contacts, contact);
+                filtered_contacts = g_slist_prepend(filtered_contacts, contact);
             }
             curr = g_slist_next(curr);
         }
     }
 
-    return filtered_contacts;
+    return g_slist_reverse(filtered_contacts);
 }
 
 static GSList*
@@ -1188,7 +1202,7 @@ _filter_contacts_with_presence(GSList* contacts, const char* const presence)
         if (prefs_get_boolean(PREF_ROSTER_OFFLINE)) {
             GSList* curr = contacts;
             while (curr) {
-                filtered_contacts = g_slist_append(filtered_contacts, curr->data);
+                filtered_contacts = g_slist_prepend(filtered_contacts, curr->data);
                 curr = g_slist_next(curr);
             }
 
@@ -1199,7 +1213,7 @@ _filter_contacts_with_presence(GSList* contacts, const char* const presence)
                 PContact contact = curr->data;
                 ProfChatWin* chatwin = wins_get_chat(p_contact_barejid(contact));
                 if (chatwin && chatwin->unread > 0) {
-                    filtered_contacts = g_slist_append(filtered_contacts, contact);
+                    filtered_contacts = g_slist_prepend(filtered_contacts, contact);
                 }
                 curr = g_slist_next(curr);
             }
@@ -1209,10 +1223,10 @@ _filter_contacts_with_presence(GSList* contacts, const char* const presence)
     } else {
         GSList* curr = contacts;
         while (curr) {
-            filtered_contacts = g_slist_append(filtered_contacts, curr->data);
+            filtered_contacts = g_slist_prepend(filtered_contacts, curr->data);
             curr = g_slist_next(curr);
         }
     }
 
-    return filtered_contacts;
+    return g_slist_reverse(filtered_contacts);
 }
@@ -53,6 +53,10 @@ static GTimeZone* tz;
 static StatusBar* statusbar;
 static WINDOW* statusbar_win;
 
+// set when the contents changed, see status_bar_update_virtual()
+static gboolean statusbar_dirty;
+static gint64 statusbar_drawn;
+
 void _get_range_bounds(guint* start, guint* end, gboolean is_static);
 static guint _status_bar_draw_time(guint pos);
 static guint _status_bar_draw_maintext(guint pos);
@@ -66,6 +70,7 @@ static guint _count_digits(guint number);
 static guint _count_digits_in_range(guint start, guint end);
 static char* _display_name(StatusBarTab* tab);
 static gboolean _tabmode_is_actlist(void);
+static void _status_bar_prefs_changed(preference_t pref, void* userdata);
 
 void
 status_bar_init(void)
@@ -88,12 +93,15 @@ status_bar_init(void)
     int cols = getmaxx(stdscr);
     statusbar_win = newwin(1, cols, row, 0);
 
+    prefs_add_listener(_status_bar_prefs_changed, NULL);
+
     status_bar_draw();
 }
 
 void
 status_bar_close(void)
 {
+    prefs_remove_listener(_status_bar_prefs_changed, NULL);
     delwin(statusbar_win);
     statusbar_win = NULL;
     if (statusbar) {
@@ -133,6 +141,7 @@ void
 status_bar_set_all_inactive(void)
 {
     g_hash_table_remove_all(statusbar->tabs);
+    status_bar_invalidate();
 }
 
 void
@@ -144,7 +153,7 @@ status_bar_current(guint i)
         statusbar->current_tab = i;
     }
 
-    status_bar_draw();
+    status_bar_invalidate();
 }
 
 void
@@ -157,7 +166,7 @@ status_bar_inactive(const int win)
 
     g_hash_table_remove(statusbar->tabs, GINT_TO_POINTER(true_win));
 
-    status_bar_draw();
+    status_bar_invalidate();
 }
 
 void
@@ -177,7 +186,7 @@ _create_tab(const int win, win_type_t wintype, char* identifier, gboolean highli
             contact = roster_get_contact(tab->identifier);
         }
         const char* pcontact_name = contact ? p_contact_name(contact) : NULL;
-        auto_gchar gchar* pref = prefs_get_string(PREF_STATUSBAR_CHAT);
+        const gchar* pref = prefs_peek_string(PREF_STATUSBAR_CHAT);
         if (g_strcmp0("user", pref) == 0) {
             if (pcontact_name) {
                 tab->display_name = strdup(pcontact_name);
@@ -196,7 +205,7 @@ _create_tab(const int win, win_type_t wintype, char* identifier, gboolean highli
 
     g_hash_table_replace(statusbar->tabs, GINT_TO_POINTER(true_win), tab);
 
-    status_bar_draw();
+    status_bar_invalidate();
 }
 
 void
@@ -243,7 +252,7 @@ status_bar_set_fulljid(const char* const fulljid)
     }
     statusbar->fulljid = strdup(fulljid);
 
-    status_bar_draw();
+    status_bar_invalidate();
 }
 
 void
@@ -254,12 +263,51 @@ status_bar_clear_fulljid(void)
         statusbar->fulljid = NULL;
     }
 
-    status_bar_draw();
+    status_bar_invalidate();
+}
+
+void
+status_bar_invalidate(void)
+{
+    statusbar_dirty = TRUE;
+}
+
+static void
+_status_bar_prefs_changed(preference_t pref, void* userdata)
+{
+    switch (pref) {
+    case PREF_STATUSBAR_SHOW_NAME:
+    case PREF_STATUSBAR_SHOW_NUMBER:
+    case PREF_STATUSBAR_SHOW_READ:
+    case PREF_STATUSBAR_SELF:
+    case PREF_STATUSBAR_CHAT:
+    case PREF_STATUSBAR_ROOM_TITLE:
+    case PREF_STATUSBAR_TABMODE:
+    case PREF_TIME_STATUSBAR:
+        status_bar_invalidate();
+        break;
+    default:
+        break;
+    }
+}
+
+/* Redraw the status bar if something changed since the last draw. It is
+ * also redrawn every second for the clock and for titles of rooms or
+ * contacts that changed without telling the status bar. */
+void
+status_bar_update_virtual(void)
+{
+    if (statusbar_dirty || g_get_monotonic_time() - statusbar_drawn >= G_USEC_PER_SEC) {
+        status_bar_draw();
+    }
 }
 
 void
 status_bar_draw(void)
 {
+    statusbar_dirty = FALSE;
+    statusbar_drawn = g_get_monotonic_time();
+
     werase(statusbar_win);
     wbkgd(statusbar_win, theme_attrs(THEME_STATUS_TEXT));
 
@@ -278,7 +326,7 @@ status_bar_draw(void)
 static guint
 _status_bar_draw_tabs(guint pos)
 {
-    auto_gchar gchar* tabmode = prefs_get_string(PREF_STATUSBAR_TABMODE);
+    const gchar* tabmode = prefs_peek_string(PREF_STATUSBAR_TABMODE);
 
     if (g_strcmp0(tabmode, "actlist") != 0) {
         guint start, end;
@@ -467,7 +515,7 @@ _status_bar_draw_bracket(gboolean current, guint pos, const char* ch)
 static guint
 _status_bar_draw_time(guint pos)
 {
-    auto_gchar gchar* time_pref = prefs_get_string(PREF_TIME_STATUSBAR);
+    const gchar* time_pref = prefs_peek_string(PREF_TIME_STATUSBAR);
     if (g_strcmp0(time_pref, "off") == 0) {
         return pos;
     }
@@ -502,7 +550,7 @@ _status_bar_draw_time(guint pos)
 static gboolean
 _tabmode_is_actlist(void)
 {
-    auto_gchar gchar* tabmode = prefs_get_string(PREF_STATUSBAR_TABMODE);
+    const gchar* tabmode = prefs_peek_string(PREF_STATUSBAR_TABMODE);
     return g_strcmp0(tabmode, "actlist") == 0;
 }
 
@@ -511,7 +559,7 @@ _status_bar_draw_maintext(guint pos)
 {
     const char* maintext = NULL;
     auto_jid Jid* jidp = NULL;
-    auto_gchar gchar* self = prefs_get_string(PREF_STATUSBAR_SELF);
+    const gchar* self = prefs_peek_string(PREF_STATUSBAR_SELF);
 
     if (statusbar->prompt) {
         mvwprintw(statusbar_win, 0, pos, "%s", statusbar->prompt);
@@ -12,6 +12,8 @@
 
 void status_bar_init(void);
 void status_bar_draw(void);
+void status_bar_invalidate(void);
+void status_bar_update_virtual(void);
 void status_bar_close(void);
 void status_bar_resize(void);
 void status_bar_set_prompt(const char* const prompt);
@@ -40,8 +40,11 @@ void ui_suspend(void);
 void ui_resume(void);
 void ui_load_colours(void);
 void ui_update(void);
+void ui_frame(void);
+gint ui_frame_delay(void);
 void ui_redraw(void);
 void ui_resize(void);
+void ui_update_scrollback(void);
 void ui_focus_win(ProfWin* window);
 void ui_sigwinch_handler(int sig);
 void ui_handle_otr_error(const char* const barejid, const char* const message);
@@ -263,8 +266,10 @@ void cons_show_account_list(gchar** accounts);
 void cons_show_room_list(GSList* room, const char* const conference_node);
 void cons_show_bookmark(Bookmark* item);
 void cons_show_bookmarks(const GList* list);
+void cons_show_history_search(const char* const query, GSList* results, int offset, gboolean more);
 void cons_show_bookmarks_ignore(gchar** list, gsize len);
 void cons_show_disco_items(GSList* items, const char* const jid);
+void cons_show_transfers(GList* transfers);
 void cons_show_disco_info(const char* from, GSList* identities, GSList* features);
 
 void cons_show_disco_contact_information(GHashTable* addresses);
@@ -316,6 +321,8 @@ void cons_mucping_setting(void);
 void cons_autoconnect_setting(void);
 void cons_room_cache_setting(void);
 void cons_inpblock_setting(void);
+void cons_scrollback_setting(void);
+void cons_framerate_setting(void);
 void cons_statusbar_setting(void);
 void cons_winpos_setting(void);
 void cons_color_setting(void);
@@ -326,6 +333,7 @@ void cons_mam_setting(void);
 void cons_silence_setting(void);
 void cons_mood_setting(void);
 void cons_strophe_setting(void);
+void cons_transfers_setting(void);
 void cons_privacy_setting(void);
 void cons_show_contact_online(PContact contact, Resource* resource, GDateTime* last_activity);
 void cons_show_contact_offline(PContact contact, char* resource, char* status);
@@ -350,9 +358,11 @@ void status_bar_set_all_inactive(void);
 
 // roster window
 void rosterwin_roster(void);
+void rosterwin_update(void);
 
 // occupants window
 void occupantswin_occupants(const char* const room);
+void occupantswin_update(void);
 void occupantswin_occupants_all(void);
 
 // window interface
@@ -369,6 +379,7 @@ void win_free(ProfWin* window);
 gboolean win_notify_remind(ProfWin* window);
 int win_unread(ProfWin* window);
 void win_resize(ProfWin* window);
+void win_update_scrollback(ProfWin* window);
 void win_hide_subwin(ProfWin* window);
 void win_show_subwin(ProfWin* window);
 void win_refresh_without_subwin(ProfWin* window);
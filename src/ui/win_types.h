@@ -94,6 +94,8 @@ typedef struct prof_layout_t
     ProfBuff buffer;
     int y_pos;
     int paged;
+    // entries at the end of the buffer that are not rendered into the pad, it is cut short while paged up
+    unsigned int unrendered;
 } ProfLayout;
 
 typedef struct prof_layout_simple_t
@@ -42,9 +42,12 @@
 static const int PAD_MIN_HEIGHT = 100;
 static const int PAD_THRESHOLD = 3000;
 static gboolean _in_redraw = FALSE;
+// off-screen pad used to lay out entries before they are copied into a window pad
+static WINDOW* _scratch_pad = NULL;
+static int _scratch_attrs = 0;
 
 static void
-_win_ensure_pad_capacity(ProfWin* window, WINDOW* win, int lines_needed)
+_win_ensure_pad_capacity(WINDOW* win, int lines_needed)
 {
     if (!win) {
         return;
@@ -53,17 +56,36 @@ _win_ensure_pad_capacity(ProfWin* window, WINDOW* win, int lines_needed)
     int cur_height = getmaxy(win);
     int cur_width = getmaxx(win);
     if (lines_needed >= cur_height - 1) {
-        // If we are getting too large, trigger a redraw to clean up old lines
-        // but only if we are not already in a redraw process.
-        if (window && cur_height >= PAD_THRESHOLD && !_in_redraw) {
-            win_redraw(window);
-        } else {
-            // resize to required lines + some buffer for next messages
-            int new_height = lines_needed + 100;
-            wresize(win, new_height, cur_width);
-        }
+        // resize to required lines + some buffer for next messages
+        int new_height = lines_needed + 100;
+        wresize(win, new_height, cur_width);
     }
 }
+
+static WINDOW*
+_win_scratch_pad(int cols)
+{
+    int attrs = theme_attrs(THEME_TEXT);
+    if (!_scratch_pad) {
+        _scratch_pad = newpad(PAD_MIN_HEIGHT, cols);
+        wbkgd(_scratch_pad, attrs);
+        _scratch_attrs = attrs;
+    } else if (getmaxx(_scratch_pad) != cols || getmaxy(_scratch_pad) >= PAD_THRESHOLD) {
+        wresize(_scratch_pad, PAD_MIN_HEIGHT, cols);
+    }
+    if (attrs != _scratch_attrs) {
+        wbkgd(_scratch_pad, attrs);
+        _scratch_attrs = attrs;
+    }
+
+    // only the rows down to the cursor were written by the last layout
+    for (int y = getcury(_scratch_pad); y >= 0; y--) {
+        wmove(_scratch_pad, y, 0);
+        wclrtoeol(_scratch_pad);
+    }
+
+    return _scratch_pad;
+}
 static const char* LOADING_MESSAGE = "Loading older messages…";
 static const char* END_OF_ARCHIVE_MESSAGE = "End of archive reached";
 static const char* CONS_WIN_TITLE = "Profanity. Type /help for help information.";
@@ -76,6 +98,15 @@ _win_printf(ProfWin* window, const char* show_char, int pad_indent, GDateTime* t
 static void _win_print_internal(ProfWin* window, const char* show_char, int pad_indent, GDateTime* time,
                                 int flags, theme_item_t theme_item, const char* const from, const char* const message, DeliveryReceipt* receipt);
 static void _win_print_wrapped(WINDOW* win, const char* const message, size_t indent, int pad_indent);
+static int _win_entry_start(ProfWin* window);
+static void _win_entry_end(ProfWin* window);
+static unsigned int _win_first_rendered(ProfWin* window);
+static unsigned int _win_end_rendered(ProfWin* window);
+static int _win_render_before(ProfWin* window, unsigned int from);
+static int _win_render_earlier(ProfWin* window, int lines_needed);
+static void _win_render_later(ProfWin* window, int lines_needed);
+static void _win_trim_before(ProfWin* window);
+static void _win_trim_after(ProfWin* window);
 
 int
 win_roster_cols(void)
@@ -105,6 +136,7 @@ _win_create_simple_layout(void)
     layout->base.buffer = buffer_create();
     layout->base.y_pos = 0;
     layout->base.paged = 0;
+    layout->base.unrendered = 0;
     scrollok(layout->base.win, TRUE);
 
     return &layout->base;
@@ -122,6 +154,7 @@ _win_create_split_layout(void)
     layout->base.buffer = buffer_create();
     layout->base.y_pos = 0;
     layout->base.paged = 0;
+    layout->base.unrendered = 0;
     scrollok(layout->base.win, TRUE);
     layout->subwin = NULL;
     layout->sub_y_pos = 0;
@@ -138,6 +171,8 @@ win_create_console(void)
     new_win->window.scroll_state = WIN_SCROLL_INNER;
     new_win->window.layout = _win_create_split_layout();
 
+    win_update_scrollback(&new_win->window);
+
     return &new_win->window;
 }
 
@@ -171,6 +206,8 @@ win_create_chat(const char* const barejid)
     new_win->has_attention = FALSE;
     new_win->memcheck = PROFCHATWIN_MEMCHECK;
 
+    win_update_scrollback(&new_win->window);
+
     return &new_win->window;
 }
 
@@ -201,6 +238,7 @@ win_create_muc(const char* const roomjid)
     layout->base.buffer = buffer_create();
     layout->base.y_pos = 0;
     layout->base.paged = 0;
+    layout->base.unrendered = 0;
     scrollok(layout->base.win, TRUE);
     new_win->window.layout = (ProfLayout*)layout;
 
@@ -231,6 +269,8 @@ win_create_muc(const char* const roomjid)
 
     new_win->memcheck = PROFMUCWIN_MEMCHECK;
 
+    win_update_scrollback(&new_win->window);
+
     return &new_win->window;
 }
 
@@ -249,6 +289,8 @@ win_create_config(const char* const roomjid, DataForm* form, ProfConfWinCallback
 
     new_win->memcheck = PROFCONFWIN_MEMCHECK;
 
+    win_update_scrollback(&new_win->window);
+
     return &new_win->window;
 }
 
@@ -266,6 +308,8 @@ win_create_private(const char* const fulljid)
 
     new_win->memcheck = PROFPRIVATEWIN_MEMCHECK;
 
+    win_update_scrollback(&new_win->window);
+
     return &new_win->window;
 }
 
@@ -279,6 +323,8 @@ win_create_xmlconsole(void)
 
     new_win->memcheck = PROFXMLWIN_MEMCHECK;
 
+    win_update_scrollback(&new_win->window);
+
     return &new_win->window;
 }
 
@@ -295,6 +341,8 @@ win_create_plugin(const char* const plugin_name, const char* const tag)
 
     new_win->memcheck = PROFPLUGINWIN_MEMCHECK;
 
+    win_update_scrollback(&new_win->window);
+
     return &new_win->window;
 }
 
@@ -309,9 +357,37 @@ win_create_vcard(vCard* vcard)
     new_win->vcard = vcard;
     new_win->memcheck = PROFVCARDWIN_MEMCHECK;
 
+    win_update_scrollback(&new_win->window);
+
     return &new_win->window;
 }
 
+void
+win_update_scrollback(ProfWin* window)
+{
+    const char* win_type;
+    switch (window->type) {
+    case WIN_CHAT:
+        win_type = "chat";
+        break;
+    case WIN_MUC:
+        win_type = "muc";
+        break;
+    case WIN_PRIVATE:
+        win_type = "private";
+        break;
+    default:
+        win_type = "other";
+        break;
+    }
+
+    buffer_set_max_size(window->layout->buffer, prefs_get_scrollback(win_type));
+
+    // only chat and MUC windows load older messages from the database when scrolling up
+    gboolean in_db = g_strcmp0(prefs_peek_string(PREF_DBLOG), "off") != 0;
+    buffer_set_reloadable(window->layout->buffer, in_db && (window->type == WIN_CHAT || window->type == WIN_MUC));
+}
+
 gchar*
 win_get_title(ProfWin* window)
 {
@@ -689,6 +765,13 @@ win_page_up(ProfWin* window, int scroll_size)
     *scroll_state = (*scroll_state == WIN_SCROLL_REACHED_BOTTOM) ? WIN_SCROLL_INNER : *scroll_state;
     *page_start -= scroll_size;
 
+    // scrolled above the pad, render the entries preceding it first
+    if (*page_start < 0) {
+        int rows = _win_render_earlier(window, -*page_start);
+        page_start_initial += rows;
+        total_rows += rows;
+    }
+
     if (*page_start == -scroll_size && (window->type == WIN_CHAT || window->type == WIN_MUC)) {
         ProfBuffEntry* first_entry = buffer_size(window->layout->buffer) != 0 ? buffer_get_entry(window->layout->buffer, 0) : NULL;
 
@@ -708,6 +791,10 @@ win_page_up(ProfWin* window, int scroll_size)
                 iq_mam_request_older(window);
             }
 
+            // the entries just fetched are not in the pad yet
+            _win_render_before(window, 0);
+            total_rows = getcury(window->layout->win);
+
             unsigned int buff_size = buffer_size(window->layout->buffer);
             int offset_entry_id = buff_size > 10 ? 10 : buff_size - 1;
             int offset = buffer_get_entry(window->layout->buffer, offset_entry_id)->y_end_pos;
@@ -721,6 +808,7 @@ win_page_up(ProfWin* window, int scroll_size)
     }
 
     window->layout->paged = 1;
+    _win_trim_after(window);
 
     // update only if position has changed
     if (page_start_initial != *page_start) {
@@ -728,7 +816,7 @@ win_page_up(ProfWin* window, int scroll_size)
     }
 
     // switch off page if last line and space line visible
-    if ((total_rows) - *page_start == page_space) {
+    if (!window->layout->unrendered && (total_rows) - *page_start == page_space) {
         window->layout->paged = 0;
     }
 }
@@ -747,12 +835,20 @@ win_page_down(ProfWin* window, int scroll_size)
 
     *page_start += scroll_size;
 
+    // scrolled below the pad, render the entries that were cut off it first
+    if (window->layout->unrendered) {
+        _win_render_later(window, *page_start + 2 * page_space - total_rows);
+        total_rows = getcury(window->layout->win);
+    }
+
     // Scrolled down after reaching the bottom of the page
     if ((*page_start > total_rows - page_space || (*page_start == page_space && *page_start >= total_rows)) && (window->type == WIN_CHAT || window->type == WIN_MUC)) {
         unsigned int bf_size = buffer_size(window->layout->buffer);
         if (bf_size != 0) {
             ProfBuffEntry* last_entry = buffer_get_entry(window->layout->buffer, bf_size - 1);
-            auto_gchar gchar* start = g_date_time_format_iso8601(last_entry->time);
+            GDateTime* last_time = buffer_entry_get_time(last_entry);
+            auto_gchar gchar* start = g_date_time_format_iso8601(last_time);
+            g_date_time_unref(last_time);
             auto_gchar gchar* end_date = prof_date_time_format_iso8601(NULL);
             if (*scroll_state != WIN_SCROLL_REACHED_BOTTOM) {
                 gboolean has_items;
@@ -789,9 +885,11 @@ win_page_down(ProfWin* window, int scroll_size)
     }
 
     // switch off page if last line and space line visible
-    if (total_rows - *page_start == page_space) {
+    if (!window->layout->unrendered && total_rows - *page_start == page_space) {
         window->layout->paged = 0;
     }
+
+    _win_trim_before(window);
 }
 
 void
@@ -844,9 +942,16 @@ win_clear(ProfWin* window)
         werase(window->layout->win);
         buffer_free(window->layout->buffer);
         window->layout->buffer = buffer_create();
+        window->layout->unrendered = 0;
+        win_update_scrollback(window);
         return;
     }
 
+    if (window->layout->unrendered) {
+        window->layout->paged = 0;
+        win_redraw(window);
+    }
+
     int y = getcury(window->layout->win);
     int* page_start = &(window->layout->y_pos);
     *page_start = y;
@@ -956,6 +1061,11 @@ win_move_to_end(ProfWin* window)
 {
     window->layout->paged = 0;
 
+    // the pad was cut short while paged up, lay out its end again
+    if (window->layout->unrendered) {
+        win_redraw(window);
+    }
+
     int rows = getmaxy(stdscr);
     int y = getcury(window->layout->win);
     int size = rows - 3;
@@ -1100,7 +1210,7 @@ win_show_occupant_info(ProfWin* window, const char* const room, Occupant* occupa
             }
         }
 
-        caps_destroy(caps);
+        caps_unref(caps);
     }
 
     win_println(window, THEME_DEFAULT, "-", "");
@@ -1222,7 +1332,7 @@ win_show_info(ProfWin* window, PContact contact)
                 }
             }
 
-            caps_destroy(caps);
+            caps_unref(caps);
         }
 
         curr = g_list_next(curr);
@@ -1456,13 +1566,8 @@ _win_correct(ProfWin* window, const char* const message, const char* const id, c
     entry->date = buffer_date_new_now();
     */
 
-    g_free(entry->show_char);
-    entry->show_char = prefs_get_correction_char();
-
-    if (entry->message) {
-        free(entry->message);
-    }
-    entry->message = strdup(message);
+    auto_gchar gchar* correction_char = prefs_get_correction_char();
+    buffer_update_entry(window->layout->buffer, entry, correction_char, message);
 
     // LMC requires original message ID, hence ID remains the same
 
@@ -1557,9 +1662,10 @@ win_print_history(ProfWin* window, const ProfMessage* const message)
 
     wins_add_urls_ac(window, message, FALSE);
     wins_add_quotes_ac(window, message->plain, FALSE);
-    int y_start_pos = getcury(window->layout->win);
+    int y_start_pos = _win_entry_start(window);
     _win_print_internal(window, ch, 0, message->timestamp, flags, THEME_TEXT_HISTORY, display_name, message->plain, NULL);
     buffer_append(window->layout->buffer, ch, 0, message->timestamp, flags, THEME_TEXT_HISTORY, display_name, message->from_jid->barejid, message->plain, NULL, message->id, y_start_pos, getcury(window->layout->win));
+    _win_entry_end(window);
 
     inp_nonblocking(TRUE);
     g_date_time_unref(message->timestamp);
@@ -1575,11 +1681,10 @@ win_print_old_history(ProfWin* window, const ProfMessage* const message)
 
     auto_char char* ch = get_show_char(message->enc);
 
-    int y_start_pos = getcury(window->layout->win);
     wins_add_urls_ac(window, message, TRUE);
     wins_add_quotes_ac(window, message->plain, TRUE);
-    _win_print_internal(window, ch, 0, message->timestamp, flags, THEME_TEXT_HISTORY, display_name, message->plain, NULL);
-    buffer_prepend(window->layout->buffer, ch, 0, message->timestamp, flags, THEME_TEXT_HISTORY, display_name, message->from_jid->barejid, message->plain, NULL, message->id, y_start_pos, getcury(window->layout->win));
+    // not rendered here, win_redraw() lays it out when it is scrolled into view
+    buffer_prepend(window->layout->buffer, ch, 0, message->timestamp, flags, THEME_TEXT_HISTORY, display_name, message->from_jid->barejid, message->plain, NULL, message->id, -1, -1);
 
     inp_nonblocking(TRUE);
     g_date_time_unref(message->timestamp);
@@ -1596,9 +1701,10 @@ win_println_va_internal_with_timestamp(ProfWin* window, theme_item_t theme_item,
 
     auto_gchar gchar* msg = g_strdup_vprintf(message, arg);
 
-    int y_start_pos = getcury(window->layout->win);
+    int y_start_pos = _win_entry_start(window);
     _win_print_internal(window, show_char, pad, timestamp, flags, theme_item, "", msg, NULL);
     buffer_append(window->layout->buffer, show_char, pad, timestamp, flags, theme_item, "", NULL, msg, NULL, NULL, y_start_pos, getcury(window->layout->win));
+    _win_entry_end(window);
 
     inp_nonblocking(TRUE);
     if (created_timestamp) {
@@ -1699,9 +1805,10 @@ win_print_outgoing_with_receipt(ProfWin* window, const char* show_char, const ch
     if (_win_correct(window, message, id, replace_id, myjid)) {
         free(receipt); // TODO: probably we should use this in _win_correct()
     } else {
-        int y_start_pos = getcury(window->layout->win);
+        int y_start_pos = _win_entry_start(window);
         _win_print_internal(window, show_char, 0, time, 0, THEME_TEXT_ME, from, message, receipt);
         buffer_append(window->layout->buffer, show_char, 0, time, 0, THEME_TEXT_ME, from, myjid, message, receipt, id, y_start_pos, getcury(window->layout->win));
+        _win_entry_end(window);
     }
 
     // TODO: cross-reference.. this should be replaced by a real event-based system
@@ -1727,8 +1834,7 @@ win_update_entry_message(ProfWin* window, const char* const id, const char* cons
         return;
     ProfBuffEntry* entry = buffer_get_entry_by_id(window->layout->buffer, id);
     if (entry) {
-        free(entry->message);
-        entry->message = strdup(message);
+        buffer_update_entry(window->layout->buffer, entry, NULL, message);
         win_redraw(window);
     }
 }
@@ -1741,8 +1847,7 @@ win_update_entry(ProfWin* window, const char* const id, const char* const messag
     ProfBuffEntry* entry = buffer_get_entry_by_id(window->layout->buffer, id);
     if (entry) {
         if (message) {
-            free(entry->message);
-            entry->message = strdup(message);
+            entry = buffer_update_entry(window->layout->buffer, entry, NULL, message);
         }
         entry->theme_item = theme_item;
         entry->flags |= flags;
@@ -1754,9 +1859,10 @@ void
 win_print_status_with_id(ProfWin* window, const char* const message, char* id, theme_item_t theme_item, int flags)
 {
     GDateTime* time = g_date_time_new_now_local();
-    int y_start_pos = getcury(window->layout->win);
+    int y_start_pos = _win_entry_start(window);
     _win_print_internal(window, "!", 0, time, flags, theme_item, NULL, message, NULL);
     buffer_append(window->layout->buffer, "!", 0, time, flags, theme_item, NULL, NULL, message, NULL, id, y_start_pos, getcury(window->layout->win));
+    _win_entry_end(window);
     g_date_time_unref(time);
 }
 
@@ -1787,9 +1893,10 @@ _win_printf(ProfWin* window, const char* show_char, int pad_indent, GDateTime* t
 
     auto_gchar gchar* msg = g_strdup_vprintf(message, arg);
 
-    int y_start_pos = getcury(window->layout->win);
+    int y_start_pos = _win_entry_start(window);
     _win_print_internal(window, show_char, pad_indent, timestamp, flags, theme_item, display_from, msg, NULL);
     buffer_append(window->layout->buffer, show_char, pad_indent, timestamp, flags, theme_item, display_from, from_jid, msg, NULL, message_id, y_start_pos, getcury(window->layout->win));
+    _win_entry_end(window);
 
     inp_nonblocking(TRUE);
     g_date_time_unref(timestamp);
@@ -1812,25 +1919,25 @@ _win_print_internal(ProfWin* window, const char* show_char, int pad_indent, GDat
     int colour = theme_attrs(THEME_ME);
     size_t indent = 0;
 
-    auto_gchar gchar* time_pref = NULL;
+    const gchar* time_pref = NULL;
     switch (window->type) {
     case WIN_CHAT:
-        time_pref = prefs_get_string(PREF_TIME_CHAT);
+        time_pref = prefs_peek_string(PREF_TIME_CHAT);
         break;
     case WIN_MUC:
-        time_pref = prefs_get_string(PREF_TIME_MUC);
+        time_pref = prefs_peek_string(PREF_TIME_MUC);
         break;
     case WIN_CONFIG:
-        time_pref = prefs_get_string(PREF_TIME_CONFIG);
+        time_pref = prefs_peek_string(PREF_TIME_CONFIG);
         break;
     case WIN_PRIVATE:
-        time_pref = prefs_get_string(PREF_TIME_PRIVATE);
+        time_pref = prefs_peek_string(PREF_TIME_PRIVATE);
         break;
     case WIN_XML:
-        time_pref = prefs_get_string(PREF_TIME_XMLCONSOLE);
+        time_pref = prefs_peek_string(PREF_TIME_XMLCONSOLE);
         break;
     default:
-        time_pref = prefs_get_string(PREF_TIME_CONSOLE);
+        time_pref = prefs_peek_string(PREF_TIME_CONSOLE);
         break;
     }
 
@@ -1864,7 +1971,7 @@ _win_print_internal(ProfWin* window, const char* show_char, int pad_indent, GDat
             colour = theme_attrs(THEME_THEM);
         }
 
-        auto_gchar gchar* color_pref = prefs_get_string(PREF_COLOR_NICK);
+        const gchar* color_pref = prefs_peek_string(PREF_COLOR_NICK);
         if (color_pref != NULL && (strcmp(color_pref, "false") != 0)) {
             if ((flags & NO_ME) || (!(flags & NO_ME) && prefs_get_boolean(PREF_COLOR_NICK_OWN))) {
                 colour = theme_hash_attrs(from);
@@ -1904,7 +2011,7 @@ _win_print_internal(ProfWin* window, const char* show_char, int pad_indent, GDat
         }
     }
 
-    _win_ensure_pad_capacity(window, window->layout->win, getcury(window->layout->win));
+    _win_ensure_pad_capacity(window->layout->win, getcury(window->layout->win));
 
     if (prefs_get_boolean(PREF_WRAP)) {
         _win_print_wrapped(window->layout->win, message + offset, indent, pad_indent);
@@ -2058,7 +2165,7 @@ _win_print_wrapped(WINDOW* win, const char* const message, size_t indent, int pa
 void
 win_print_trackbar(ProfWin* window)
 {
-    _win_ensure_pad_capacity(window, window->layout->win, getcury(window->layout->win));
+    _win_ensure_pad_capacity(window->layout->win, getcury(window->layout->win));
     int cols = getmaxx(window->layout->win);
 
     wbkgdset(window->layout->win, theme_attrs(THEME_TRACKBAR));
@@ -2071,35 +2178,355 @@ win_print_trackbar(ProfWin* window)
     wattroff(window->layout->win, theme_attrs(THEME_TRACKBAR));
 }
 
+static void
+_win_render_entry(ProfWin* window, ProfBuffEntry* e)
+{
+    WINDOW* win = window->layout->win;
+
+    // check if we need more space before printing
+    _win_ensure_pad_capacity(win, getcury(win));
+
+    int y_start_pos = getcury(win);
+    if (e->display_from == NULL && e->message && e->message[0] == '-') {
+        // just an indicator to print the trackbar/separator not the actual message
+        win_print_trackbar(window);
+    } else {
+        // regular thing to print
+        GDateTime* time = buffer_entry_get_time(e);
+        _win_print_internal(window, e->show_char, e->pad_indent, time, e->flags, e->theme_item, e->display_from, e->message, e->receipt);
+        g_date_time_unref(time);
+    }
+    e->y_start_pos = y_start_pos;
+    e->y_end_pos = getcury(win);
+    e->_layout_cols = getmaxx(win);
+    e->_layout_lines = e->y_end_pos - e->y_start_pos;
+}
+
+// Number of rows the entry wraps to at the given width, laid out off-screen when not cached
+static int
+_win_entry_lines(ProfWin* window, ProfBuffEntry* e, int cols)
+{
+    if (e->_layout_cols != cols) {
+        WINDOW* win = window->layout->win;
+        int y_start_pos = e->y_start_pos;
+        int y_end_pos = e->y_end_pos;
+        gboolean in_redraw = _in_redraw;
+
+        _in_redraw = TRUE;
+        window->layout->win = _win_scratch_pad(cols);
+        _win_render_entry(window, e);
+        window->layout->win = win;
+        _in_redraw = in_redraw;
+
+        e->y_start_pos = y_start_pos;
+        e->y_end_pos = y_end_pos;
+    }
+
+    return e->_layout_lines;
+}
+
+// Index of the first buffer entry that is rendered into the pad, only a slice of the buffer is
+static unsigned int
+_win_first_rendered(ProfWin* window)
+{
+    return buffer_first_positioned(window->layout->buffer, _win_end_rendered(window));
+}
+
+// Index past the last buffer entry that is rendered into the pad
+static unsigned int
+_win_end_rendered(ProfWin* window)
+{
+    unsigned int size = buffer_size(window->layout->buffer);
+    return window->layout->unrendered < size ? size - window->layout->unrendered : 0;
+}
+
+// Render entries from index 'from' up to the first rendered one on top of the pad, returns the rows added
+static int
+_win_render_before(ProfWin* window, unsigned int from)
+{
+    ProfBuff buffer = window->layout->buffer;
+    unsigned int first = _win_first_rendered(window);
+    while (from > 0 && (buffer_get_entry(buffer, from - 1)->flags & NO_EOL)) {
+        from--;
+    }
+    if (from >= first) {
+        return 0;
+    }
+
+    WINDOW* win = window->layout->win;
+    int cols = getmaxx(win);
+    WINDOW* scratch = _win_scratch_pad(cols);
+
+    gboolean in_redraw = _in_redraw;
+    _in_redraw = TRUE;
+    window->layout->win = scratch;
+    for (unsigned int i = from; i < first; i++) {
+        _win_render_entry(window, buffer_get_entry(buffer, i));
+    }
+    if (getcurx(scratch) != 0) {
+        _win_ensure_pad_capacity(scratch, getcury(scratch) + 1);
+        waddch(scratch, '\n');
+    }
+    window->layout->win = win;
+    _in_redraw = in_redraw;
+
+    int rows = getcury(scratch);
+    if (rows == 0) {
+        return 0;
+    }
+
+    // make room at the top of the pad and copy the new rows in
+    int cur_y = getcury(win);
+    int cur_x = getcurx(win);
+    _win_ensure_pad_capacity(win, cur_y + rows);
+    wmove(win, 0, 0);
+    winsdelln(win, rows);
+    copywin(scratch, win, 0, 0, 0, 0, rows - 1, cols - 1, FALSE);
+    wmove(win, cur_y + rows, cur_x);
+
+    unsigned int end = _win_end_rendered(window);
+    for (unsigned int i = first; i < end; i++) {
+        ProfBuffEntry* e = buffer_get_entry(buffer, i);
+        e->y_start_pos += rows;
+        e->y_end_pos += rows;
+    }
+    window->layout->y_pos += rows;
+
+    return rows;
+}
+
+// Render at least lines_needed rows of the entries preceding the pad contents, returns the rows added
+static int
+_win_render_earlier(ProfWin* window, int lines_needed)
+{
+    unsigned int from = _win_first_rendered(window);
+    int cols = getmaxx(window->layout->win);
+    int lines = 0;
+    while (from > 0 && lines < lines_needed) {
+        from--;
+        lines += _win_entry_lines(window, buffer_get_entry(window->layout->buffer, from), cols);
+    }
+
+    return _win_render_before(window, from);
+}
+
+// Render the entries cut off the bottom of the pad until at least lines_needed rows were added
+static void
+_win_render_later(ProfWin* window, int lines_needed)
+{
+    ProfBuff buffer = window->layout->buffer;
+    WINDOW* win = window->layout->win;
+    unsigned int size = buffer_size(buffer);
+    unsigned int end = _win_end_rendered(window);
+    int start = getcury(win);
+
+    gboolean in_redraw = _in_redraw;
+    _in_redraw = TRUE;
+    while (end < size && (getcury(win) - start < lines_needed || (end > 0 && (buffer_get_entry(buffer, end - 1)->flags & NO_EOL)))) {
+        _win_render_entry(window, buffer_get_entry(buffer, end));
+        end++;
+    }
+    _in_redraw = in_redraw;
+
+    window->layout->unrendered = size - end;
+}
+
+// Shrink the pad to what is left of it after rows were dropped
+static void
+_win_shrink_pad(WINDOW* win)
+{
+    int height = MAX(getcury(win) + 1, PAD_MIN_HEIGHT);
+    if (getmaxy(win) > height) {
+        wresize(win, height, getmaxx(win));
+    }
+}
+
+// Drop the rows more than a page above the viewport off the top of the pad
+static void
+_win_trim_before(ProfWin* window)
+{
+    ProfBuff buffer = window->layout->buffer;
+    int page_space = getmaxy(stdscr) - 4;
+    unsigned int first = _win_first_rendered(window);
+    unsigned int end = _win_end_rendered(window);
+    if (first >= end) {
+        return;
+    }
+
+    unsigned int keep = buffer_line_at_row(buffer, first, end, window->layout->y_pos - page_space);
+    int rows = buffer_get_entry(buffer, keep)->y_start_pos;
+    if (rows <= 0) {
+        return;
+    }
+
+    for (unsigned int i = first; i < keep; i++) {
+        ProfBuffEntry* e = buffer_get_entry(buffer, i);
+        e->y_start_pos = -1;
+        e->y_end_pos = -1;
+    }
+    for (unsigned int i = keep; i < end; i++) {
+        ProfBuffEntry* e = buffer_get_entry(buffer, i);
+        e->y_start_pos -= rows;
+        e->y_end_pos -= rows;
+    }
+
+    WINDOW* win = window->layout->win;
+    int cur_y = getcury(win);
+    int cur_x = getcurx(win);
+    wmove(win, 0, 0);
+    winsdelln(win, -rows);
+    wmove(win, cur_y - rows, cur_x);
+    _win_shrink_pad(win);
+    window->layout->y_pos -= rows;
+}
+
+// Cut the rows more than a page below the viewport off the bottom of the pad, paging down renders them again
+static void
+_win_trim_after(ProfWin* window)
+{
+    ProfBuff buffer = window->layout->buffer;
+    int page_space = getmaxy(stdscr) - 4;
+    unsigned int first = _win_first_rendered(window);
+    unsigned int end = _win_end_rendered(window);
+    unsigned int cut = buffer_line_from_row(buffer, first, end, window->layout->y_pos + 2 * page_space);
+    if (cut >= end) {
+        return;
+    }
+
+    WINDOW* win = window->layout->win;
+    int row = buffer_get_entry(buffer, cut)->y_start_pos;
+    for (unsigned int i = cut; i < end; i++) {
+        ProfBuffEntry* e = buffer_get_entry(buffer, i);
+        e->y_start_pos = -1;
+        e->y_end_pos = -1;
+    }
+    window->layout->unrendered += end - cut;
+
+    wmove(win, row, 0);
+    _win_shrink_pad(win);
+    wclrtobot(win);
+}
+
+// Returns the row the next entry starts on, a pad that grew large is cut back to its last pages first
+static int
+_win_entry_start(ProfWin* window)
+{
+    if (!window->layout->paged && !_in_redraw && getcury(window->layout->win) >= PAD_THRESHOLD) {
+        win_redraw(window);
+    }
+
+    return getcury(window->layout->win);
+}
+
+// Called once the entry printed at _win_entry_start() is in the buffer, keeps a paged pad from growing
+static void
+_win_entry_end(ProfWin* window)
+{
+    if (_in_redraw) {
+        return;
+    }
+
+    if (window->layout->unrendered > 0) {
+        // the pad ends above the entry, it is rendered with the others when paging down
+        ProfBuff buffer = window->layout->buffer;
+        ProfBuffEntry* e = buffer_get_entry(buffer, buffer_size(buffer) - 1);
+        wmove(window->layout->win, e->y_start_pos, 0);
+        wclrtobot(window->layout->win);
+        e->y_start_pos = -1;
+        e->y_end_pos = -1;
+        window->layout->unrendered++;
+    } else if (window->layout->paged) {
+        _win_trim_after(window);
+    }
+}
+
 void
 win_redraw(ProfWin* window)
 {
-    unsigned int size = buffer_size(window->layout->buffer);
+    ProfBuff buffer = window->layout->buffer;
+    unsigned int size = buffer_size(buffer);
+    unsigned int rendered = _win_first_rendered(window);
+    unsigned int rendered_end = _win_end_rendered(window);
+    int cols = getmaxx(window->layout->win);
+    int page_space = getmaxy(stdscr) - 4;
+
+    // only a slice of the buffer goes into the pad, the rest is rendered when paging
+    unsigned int first = size;
+    ProfBuffEntry* anchor = NULL;
+    unsigned int anchor_index = 0;
+    int anchor_offset = 0;
+    if (window->layout->paged) {
+        // keep the entry at the top of the viewport where it is
+        first = rendered;
+        for (unsigned int i = rendered_end; i > rendered; i--) {
+            ProfBuffEntry* e = buffer_get_entry(buffer, i - 1);
+            if (e->y_start_pos <= window->layout->y_pos) {
+                first = i - 1;
+                anchor_offset = window->layout->y_pos - e->y_start_pos;
+                break;
+            }
+        }
+        if (first < size) {
+            anchor = buffer_get_entry(buffer, first);
+            anchor_index = first;
+        }
+    } else {
+        int lines = 0;
+        while (first > 0 && lines < 2 * page_space) {
+            first--;
+            lines += _win_entry_lines(window, buffer_get_entry(buffer, first), cols);
+        }
+    }
+    while (first > 0 && (buffer_get_entry(buffer, first - 1)->flags & NO_EOL)) {
+        first--;
+    }
+
+    // entries dropping out of the pad no longer have a position
+    for (unsigned int i = MIN(first, rendered_end); i > 0; i--) {
+        ProfBuffEntry* e = buffer_get_entry(buffer, i - 1);
+        if (e->y_start_pos < 0) {
+            break;
+        }
+        e->y_start_pos = -1;
+        e->y_end_pos = -1;
+    }
+
     _in_redraw = TRUE;
 
     // shrink pad back to minimum size and erase it
-    int cols = getmaxx(window->layout->win);
     wresize(window->layout->win, PAD_MIN_HEIGHT, cols);
     werase(window->layout->win);
 
-    for (unsigned int i = 0; i < size; i++) {
-        ProfBuffEntry* e = buffer_get_entry(window->layout->buffer, i);
-
-        // check if we need more space before printing
-        _win_ensure_pad_capacity(window, window->layout->win, getcury(window->layout->win));
-
-        e->y_start_pos = getcury(window->layout->win);
-        if (e->display_from == NULL && e->message && e->message[0] == '-') {
-            // just an indicator to print the trackbar/separator not the actual message
-            win_print_trackbar(window);
-        } else {
-            // regular thing to print
-            _win_print_internal(window, e->show_char, e->pad_indent, e->time, e->flags, e->theme_item, e->display_from, e->message, e->receipt);
+    // a paged pad ends a page below the viewport
+    unsigned int end = first;
+    for (; end < size; end++) {
+        if (anchor && end > anchor_index && !(buffer_get_entry(buffer, end - 1)->flags & NO_EOL)
+            && getcury(window->layout->win) >= anchor->y_start_pos + anchor_offset + 2 * page_space) {
+            break;
         }
-        e->y_end_pos = getcury(window->layout->win);
+        _win_render_entry(window, buffer_get_entry(buffer, end));
+    }
+    for (unsigned int i = end; i < rendered_end; i++) {
+        ProfBuffEntry* e = buffer_get_entry(buffer, i);
+        e->y_start_pos = -1;
+        e->y_end_pos = -1;
     }
+    window->layout->unrendered = size - end;
 
     _in_redraw = FALSE;
+
+    if (anchor) {
+        int anchor_lines = anchor->y_end_pos - anchor->y_start_pos;
+        window->layout->y_pos = anchor->y_start_pos + MAX(MIN(anchor_offset, anchor_lines - 1), 0);
+    } else if (window->layout->paged) {
+        window->layout->y_pos = 0;
+    }
+
+    // not enough to fill the screen, bring in what precedes it
+    int rows = getcury(window->layout->win);
+    if (rows < page_space) {
+        _win_render_earlier(window, page_space - rows);
+    }
 }
 
 void
@@ -2109,16 +2536,14 @@ win_print_loading_history(ProfWin* window)
     gboolean is_buffer_empty = buffer_size(window->layout->buffer) == 0;
 
     if (!is_buffer_empty) {
-        timestamp = buffer_get_entry(window->layout->buffer, 0)->time;
+        timestamp = buffer_entry_get_time(buffer_get_entry(window->layout->buffer, 0));
     } else {
         timestamp = g_date_time_new_now_local();
     }
 
-    int cur_y = getcury(window->layout->win);
-    buffer_prepend(window->layout->buffer, "-", 0, timestamp, NO_DATE, THEME_ROOMINFO, NULL, NULL, LOADING_MESSAGE, NULL, NULL, cur_y, cur_y + 1);
+    buffer_prepend(window->layout->buffer, "-", 0, timestamp, NO_DATE, THEME_ROOMINFO, NULL, NULL, LOADING_MESSAGE, NULL, NULL, -1, -1);
 
-    if (is_buffer_empty)
-        g_date_time_unref(timestamp);
+    g_date_time_unref(timestamp);
 
     win_redraw(window);
 }
@@ -2133,27 +2558,20 @@ win_print_end_of_archive(ProfWin* window)
     window->layout->y_pos = 0;
     window->layout->paged = 0;
 
-    if (!is_buffer_empty) {
-        timestamp = buffer_get_entry(window->layout->buffer, 0)->time;
-    } else {
-        timestamp = g_date_time_new_now_local();
-    }
-
     if (!is_buffer_empty) {
         ProfBuffEntry* first_entry = buffer_get_entry(window->layout->buffer, 0);
         if (first_entry->theme_item == THEME_ROOMINFO && g_strcmp0(first_entry->message, END_OF_ARCHIVE_MESSAGE) == 0) {
-            if (is_buffer_empty)
-                g_date_time_unref(timestamp);
             win_redraw(window);
             return;
         }
+        timestamp = buffer_entry_get_time(first_entry);
+    } else {
+        timestamp = g_date_time_new_now_local();
     }
 
-    int cur_y = getcury(window->layout->win);
-    buffer_prepend(window->layout->buffer, "-", 0, timestamp, NO_DATE, THEME_ROOMINFO, NULL, NULL, END_OF_ARCHIVE_MESSAGE, NULL, NULL, cur_y, cur_y + 1);
+    buffer_prepend(window->layout->buffer, "-", 0, timestamp, NO_DATE, THEME_ROOMINFO, NULL, NULL, END_OF_ARCHIVE_MESSAGE, NULL, NULL, -1, -1);
 
-    if (is_buffer_empty)
-        g_date_time_unref(timestamp);
+    g_date_time_unref(timestamp);
 
     win_redraw(window);
 }
@@ -2262,7 +2680,7 @@ win_toggle_attention(ProfWin* window)
 void
 win_sub_print(WINDOW* win, char* msg, gboolean newline, gboolean wrap, int indent)
 {
-    _win_ensure_pad_capacity(NULL, win, getcury(win));
+    _win_ensure_pad_capacity(win, getcury(win));
     int maxx = getmaxx(win);
     int curx = getcurx(win);
     int cury = getcury(win);
@@ -2351,17 +2769,9 @@ win_handle_command_exec_result_note(ProfWin* window, const char* const type, con
 void
 win_insert_last_read_position_marker(ProfWin* window, char* id)
 {
-    unsigned int size = buffer_size(window->layout->buffer);
-
-    // TODO: this is somewhat costly. We should improve this later.
-    // check if we already have a separator present
-    for (unsigned int i = 0; i < size; i++) {
-        ProfBuffEntry* e = buffer_get_entry(window->layout->buffer, i);
-
-        // if yes, don't print a new one
-        if (e->id && (g_strcmp0(e->id, id) == 0)) {
-            return;
-        }
+    // check if we already have a separator present, if yes don't print a new one
+    if (buffer_get_entry_by_id(window->layout->buffer, id)) {
+        return;
     }
 
     GDateTime* time = g_date_time_new_now_local();
@@ -2369,8 +2779,9 @@ win_insert_last_read_position_marker(ProfWin* window, char* id)
     // the trackbar/separator will actually be print in win_redraw().
     // this only puts it in the buffer and win_redraw() will interpret it.
     // so that we have the correct length even when resizing.
-    int y_start_pos = getcury(window->layout->win);
+    int y_start_pos = _win_entry_start(window);
     buffer_append(window->layout->buffer, " ", 0, time, 0, THEME_TEXT, NULL, NULL, "-", NULL, id, y_start_pos, getcury(window->layout->win));
+    _win_entry_end(window);
     win_redraw(window);
 
     g_date_time_unref(time);
@@ -25,6 +25,8 @@
 #include "xmpp/xmpp.h"
 #include "xmpp/roster_list.h"
 #include "tools/http_upload.h"
+#include "tools/http_download.h"
+#include "tools/matcher.h"
 
 #ifdef HAVE_OMEMO
 #include "omemo/omemo.h"
@@ -36,9 +38,105 @@ static int current;
 static Autocomplete wins_ac;
 static Autocomplete wins_close_ac;
 
+// window lookup by identifier, the keys are owned by the windows
+static GHashTable* chat_index;    // barejid, ASCII case insensitive
+static GHashTable* muc_index;     // roomjid, ASCII case insensitive
+static GHashTable* conf_index;    // roomjid, ASCII case insensitive
+static GHashTable* private_index; // fulljid
+static GHashTable* plugin_index;  // tag
+
+// URL schemes collected for /url autocompletion, built on first use
+static Matcher urls_matcher;
+
 static int _wins_cmp_num(gconstpointer a, gconstpointer b);
 static int _wins_get_next_available_num(GList* used);
 
+static guint
+_ascii_case_hash(gconstpointer key)
+{
+    guint hash = 5381;
+    for (const char* p = key; *p; p++) {
+        hash = (hash << 5) + hash + g_ascii_tolower(*p);
+    }
+    return hash;
+}
+
+static gboolean
+_ascii_case_equal(gconstpointer a, gconstpointer b)
+{
+    return g_ascii_strcasecmp(a, b) == 0;
+}
+
+// the index window belongs in and its key there, NULL for unindexed types
+static GHashTable*
+_wins_index(ProfWin* window, const char** key)
+{
+    switch (window->type) {
+    case WIN_CHAT:
+        *key = ((ProfChatWin*)window)->barejid;
+        return chat_index;
+    case WIN_MUC:
+        *key = ((ProfMucWin*)window)->roomjid;
+        return muc_index;
+    case WIN_CONFIG:
+        *key = ((ProfConfWin*)window)->roomjid;
+        return conf_index;
+    case WIN_PRIVATE:
+        *key = ((ProfPrivateWin*)window)->fulljid;
+        return private_index;
+    case WIN_PLUGIN:
+        *key = ((ProfPluginWin*)window)->tag;
+        return plugin_index;
+    default:
+        *key = NULL;
+        return NULL;
+    }
+}
+
+static gpointer
+_wins_lookup(GHashTable* index, const char* const key)
+{
+    if (!index || !key) {
+        return NULL;
+    }
+
+    return g_hash_table_lookup(index, key);
+}
+
+static void
+_wins_index_add(ProfWin* window)
+{
+    const char* key = NULL;
+    GHashTable* index = _wins_index(window, &key);
+
+    // keep the first window for an identifier, like the list scan did
+    if (index && key && !g_hash_table_contains(index, key)) {
+        g_hash_table_insert(index, (gpointer)key, window);
+    }
+}
+
+static void
+_wins_index_remove(ProfWin* window)
+{
+    const char* key = NULL;
+    GHashTable* index = _wins_index(window, &key);
+
+    if (!index || !key || g_hash_table_lookup(index, key) != window) {
+        return;
+    }
+
+    g_hash_table_remove(index, key);
+
+    // another window may have the same identifier, adding is a no-op for
+    // the ones already indexed
+    for (GList* curr = values; curr; curr = g_list_next(curr)) {
+        ProfWin* other = curr->data;
+        if (other != window && other->type == window->type) {
+            _wins_index_add(other);
+        }
+    }
+}
+
 static void
 _wins_htable_update(void)
 {
@@ -65,6 +163,11 @@ void
 wins_init(void)
 {
     windows = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)win_free);
+    chat_index = g_hash_table_new(_ascii_case_hash, _ascii_case_equal);
+    muc_index = g_hash_table_new(_ascii_case_hash, _ascii_case_equal);
+    conf_index = g_hash_table_new(_ascii_case_hash, _ascii_case_equal);
+    private_index = g_hash_table_new(g_str_hash, g_str_equal);
+    plugin_index = g_hash_table_new(g_str_hash, g_str_equal);
 
     ProfWin* console = win_create_console();
     _wins_htable_insert(windows, GINT_TO_POINTER(1), console);
@@ -95,20 +198,7 @@ wins_chat_exists(const char* const barejid)
 ProfChatWin*
 wins_get_chat(const char* const barejid)
 {
-    GList* curr = values;
-
-    while (curr) {
-        ProfWin* window = curr->data;
-        if (window->type == WIN_CHAT) {
-            ProfChatWin* chatwin = (ProfChatWin*)window;
-            if (str_ascii_casecmp0(chatwin->barejid, barejid) == 0) {
-                return chatwin;
-            }
-        }
-        curr = g_list_next(curr);
-    }
-
-    return NULL;
+    return _wins_lookup(chat_index, barejid);
 }
 
 static gint
@@ -141,77 +231,25 @@ wins_get_chat_unsubscribed(void)
 ProfConfWin*
 wins_get_conf(const char* const roomjid)
 {
-    GList* curr = values;
-
-    while (curr) {
-        ProfWin* window = curr->data;
-        if (window->type == WIN_CONFIG) {
-            ProfConfWin* confwin = (ProfConfWin*)window;
-            if (str_ascii_casecmp0(confwin->roomjid, roomjid) == 0) {
-                return confwin;
-            }
-        }
-        curr = g_list_next(curr);
-    }
-
-    return NULL;
+    return _wins_lookup(conf_index, roomjid);
 }
 
 ProfMucWin*
 wins_get_muc(const char* const roomjid)
 {
-    GList* curr = values;
-
-    while (curr) {
-        ProfWin* window = curr->data;
-        if (window->type == WIN_MUC) {
-            ProfMucWin* mucwin = (ProfMucWin*)window;
-            if (str_ascii_casecmp0(mucwin->roomjid, roomjid) == 0) {
-                return mucwin;
-            }
-        }
-        curr = g_list_next(curr);
-    }
-
-    return NULL;
+    return _wins_lookup(muc_index, roomjid);
 }
 
 ProfPrivateWin*
 wins_get_private(const char* const fulljid)
 {
-    GList* curr = values;
-
-    while (curr) {
-        ProfWin* window = curr->data;
-        if (window->type == WIN_PRIVATE) {
-            ProfPrivateWin* privatewin = (ProfPrivateWin*)window;
-            if (g_strcmp0(privatewin->fulljid, fulljid) == 0) {
-                return privatewin;
-            }
-        }
-        curr = g_list_next(curr);
-    }
-
-    return NULL;
+    return _wins_lookup(private_index, fulljid);
 }
 
 ProfPluginWin*
 wins_get_plugin(const char* const tag)
 {
-    GList* curr = values;
-
-    while (curr) {
-        ProfWin* window = curr->data;
-        if (window->type == WIN_PLUGIN) {
-            ProfPluginWin* pluginwin = (ProfPluginWin*)window;
-            if (g_strcmp0(pluginwin->tag, tag) == 0) {
-                return pluginwin;
-            }
-        }
-        curr = g_list_next(curr);
-    }
-
-    return NULL;
+    return _wins_lookup(plugin_index, tag);
 }
 
 void
@@ -256,10 +294,12 @@ wins_private_nick_change(const char* const roomjid, const char* const oldnick, c
 
     ProfPrivateWin* privwin = wins_get_private(oldjid->fulljid);
     if (privwin) {
+        _wins_index_remove((ProfWin*)privwin);
         free(privwin->fulljid);
 
         auto_jid Jid* newjid = jid_create_from_bare_and_resource(roomjid, newnick);
         privwin->fulljid = strdup(newjid->fulljid);
+        _wins_index_add((ProfWin*)privwin);
         win_println((ProfWin*)privwin, THEME_THEM, "!", "** %s is now known as %s.", oldjid->resourcepart, newjid->resourcepart);
 
         autocomplete_remove(wins_ac, oldjid->fulljid);
@@ -487,8 +527,10 @@ wins_close_by_num(int i)
 
         ProfWin* window = wins_get_by_num(i);
         if (window) {
-            // cancel upload processes of this window
+            // cancel transfers of this window, they must not report to it anymore
             http_upload_cancel_processes(window);
+            http_download_cancel_processes(window);
+            _wins_index_remove(window);
 
             switch (window->type) {
             case WIN_CHAT:
@@ -589,6 +631,7 @@ wins_new_chat(const char* const barejid)
     int result = _wins_get_next_available_num(keys);
     ProfWin* newwin = win_create_chat(barejid);
     _wins_htable_insert(windows, GINT_TO_POINTER(result), newwin);
+    _wins_index_add(newwin);
 
     autocomplete_add(wins_ac, barejid);
     autocomplete_add(wins_close_ac, barejid);
@@ -612,6 +655,7 @@ wins_new_muc(const char* const roomjid)
     int result = _wins_get_next_available_num(keys);
     ProfWin* newwin = win_create_muc(roomjid);
     _wins_htable_insert(windows, GINT_TO_POINTER(result), newwin);
+    _wins_index_add(newwin);
     autocomplete_add(wins_ac, roomjid);
     autocomplete_add(wins_close_ac, roomjid);
     newwin->urls_ac = autocomplete_new();
@@ -626,6 +670,7 @@ wins_new_config(const char* const roomjid, DataForm* form, ProfConfWinCallback s
     int result = _wins_get_next_available_num(keys);
     ProfWin* newwin = win_create_config(roomjid, form, submit, cancel, userdata);
     _wins_htable_insert(windows, GINT_TO_POINTER(result), newwin);
+    _wins_index_add(newwin);
 
     return newwin;
 }
@@ -636,6 +681,7 @@ wins_new_private(const char* const fulljid)
     int result = _wins_get_next_available_num(keys);
     ProfWin* newwin = win_create_private(fulljid);
     _wins_htable_insert(windows, GINT_TO_POINTER(result), newwin);
+    _wins_index_add(newwin);
     autocomplete_add(wins_ac, fulljid);
     autocomplete_add(wins_close_ac, fulljid);
     newwin->urls_ac = autocomplete_new();
@@ -650,6 +696,7 @@ wins_new_plugin(const char* const plugin_name, const char* const tag)
     int result = _wins_get_next_available_num(keys);
     ProfWin* newwin = win_create_plugin(plugin_name, tag);
     _wins_htable_insert(windows, GINT_TO_POINTER(result), newwin);
+    _wins_index_add(newwin);
     autocomplete_add(wins_ac, tag);
     autocomplete_add(wins_close_ac, tag);
     return newwin;
@@ -708,6 +755,17 @@ wins_resize_all(void)
     win_update_virtual(current_win);
 }
 
+void
+wins_update_scrollback(void)
+{
+    GList* curr = values;
+    while (curr) {
+        ProfWin* window = curr->data;
+        win_update_scrollback(window);
+        curr = g_list_next(curr);
+    }
+}
+
 void
 wins_hide_subwin(ProfWin* window)
 {
@@ -1149,12 +1207,20 @@ wins_destroy(void)
     if (keys)
         g_list_free(keys);
     values = keys = NULL;
+    g_hash_table_destroy(chat_index);
+    g_hash_table_destroy(muc_index);
+    g_hash_table_destroy(conf_index);
+    g_hash_table_destroy(private_index);
+    g_hash_table_destroy(plugin_index);
+    chat_index = muc_index = conf_index = private_index = plugin_index = NULL;
     g_hash_table_destroy(windows);
     windows = NULL;
     autocomplete_free(wins_ac);
     wins_ac = NULL;
     autocomplete_free(wins_close_ac);
     wins_close_ac = NULL;
+    matcher_free(urls_matcher);
+    urls_matcher = NULL;
 }
 
 ProfWin*
@@ -1222,32 +1288,39 @@ wins_get_next_attention(void)
     return NULL;
 }
 
-void
-wins_add_urls_ac(const ProfWin* const win, const ProfMessage* const message, const gboolean flip)
+typedef struct urls_ac_match_t
 {
-    GRegex* regex;
-    GMatchInfo* match_info;
+    const ProfWin* win;
+    gboolean flip;
+} UrlsAcMatch;
 
-    // https://stackoverflow.com/questions/43588699/regex-for-matching-any-url-character
-    regex = g_regex_new("(https?|aesgcm)://[\\w\\-.~:/?#\\[\\]@!$&'()*+,;=%]+", 0, 0, NULL);
-    g_regex_match(regex, message->plain, 0, &match_info);
-
-    while (g_match_info_matches(match_info)) {
-        auto_gchar gchar* word = g_match_info_fetch(match_info, 0);
+static void
+_wins_add_url(int id, glong offset, const char* start, gsize len, void* userdata)
+{
+    UrlsAcMatch* match = userdata;
+    auto_gchar gchar* word = g_strndup(start, len);
 
-        if (flip) {
-            autocomplete_add_unsorted(win->urls_ac, word, FALSE);
-        } else {
-            autocomplete_add_unsorted(win->urls_ac, word, TRUE);
-        }
-        // for people who run profanity a long time, we don't want to waste a lot of memory
-        autocomplete_remove_older_than_max_reverse(win->urls_ac, 20);
+    if (match->flip) {
+        autocomplete_add_unsorted(match->win->urls_ac, word, FALSE);
+    } else {
+        autocomplete_add_unsorted(match->win->urls_ac, word, TRUE);
+    }
+    // for people who run profanity a long time, we don't want to waste a lot of memory
+    autocomplete_remove_older_than_max_reverse(match->win->urls_ac, 20);
+}
 
-        g_match_info_next(match_info, NULL);
+void
+wins_add_urls_ac(const ProfWin* const win, const ProfMessage* const message, const gboolean flip)
+{
+    if (!urls_matcher) {
+        urls_matcher = matcher_new();
+        matcher_add(urls_matcher, "http://", 0, MATCHER_URL | MATCHER_EXACT_CASE);
+        matcher_add(urls_matcher, "https://", 0, MATCHER_URL | MATCHER_EXACT_CASE);
+        matcher_add(urls_matcher, "aesgcm://", 0, MATCHER_URL | MATCHER_EXACT_CASE);
     }
 
-    g_match_info_free(match_info);
-    g_regex_unref(regex);
+    UrlsAcMatch match = { win, flip };
+    matcher_scan(urls_matcher, message->plain, _wins_add_url, &match);
 }
 
 void
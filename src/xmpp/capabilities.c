@@ -32,25 +32,38 @@ static gchar* cache_loc;
 static prof_keyfile_t caps_prof_keyfile;
 static GKeyFile* cache;
 
+// seconds a changed cache waits before it is written, so the disco#info
+// replies that arrive together after login are saved in one go
+#define CAPS_SAVE_DELAY 10
+
+static guint save_timeout;
+
 static GHashTable* jid_to_ver;
 static GHashTable* jid_to_caps;
+static GHashTable* ver_to_caps; // decoded cache entries
 
 static GHashTable* prof_features;
 static gchar* my_sha1;
 
 static void _save_cache(void);
+static void _schedule_save(void);
 static EntityCapabilities* _caps_by_ver(const char* const ver);
 static EntityCapabilities* _caps_by_jid(const char* const jid);
-static EntityCapabilities* _caps_copy(EntityCapabilities* caps);
 
 static void
 _caps_close(void)
 {
     caps_reset_ver();
+    if (save_timeout) {
+        g_source_remove(save_timeout);
+        save_timeout = 0;
+        _save_cache();
+    }
     free_keyfile(&caps_prof_keyfile);
     cache = NULL;
     g_hash_table_destroy(jid_to_ver);
     g_hash_table_destroy(jid_to_caps);
+    g_hash_table_destroy(ver_to_caps);
     g_free(cache_loc);
     cache_loc = NULL;
     g_hash_table_destroy(prof_features);
@@ -68,7 +81,8 @@ caps_init(void)
     cache = caps_prof_keyfile.keyfile;
 
     jid_to_ver = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
-    jid_to_caps = g_hash_table_new_full(g_str_hash, g_str_equal, free, (GDestroyNotify)caps_destroy);
+    jid_to_caps = g_hash_table_new_full(g_str_hash, g_str_equal, free, (GDestroyNotify)caps_unref);
+    ver_to_caps = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)caps_unref);
 
     prof_features = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
     g_hash_table_add(prof_features, strdup(STANZA_NS_CAPS));
@@ -164,6 +178,7 @@ caps_create(const char* const category, const char* const type, const char* cons
             GSList* features)
 {
     EntityCapabilities* result = g_new0(EntityCapabilities, 1);
+    result->refcount = 1;
 
     if (category || type || name) {
         DiscoIdentity* identity = g_new0(DiscoIdentity, 1);
@@ -187,11 +202,15 @@ caps_create(const char* const category, const char* const type, const char* cons
     }
 
     result->features = NULL;
+    result->feature_set = g_hash_table_new(g_str_hash, g_str_equal);
     GSList* curr = features;
     while (curr) {
-        result->features = g_slist_append(result->features, strdup(curr->data));
+        gchar* feature = g_strdup(curr->data);
+        result->features = g_slist_prepend(result->features, feature);
+        g_hash_table_add(result->feature_set, feature);
         curr = g_slist_next(curr);
     }
+    result->features = g_slist_reverse(result->features);
 
     return result;
 }
@@ -208,6 +227,8 @@ caps_add_by_ver(const char* const ver, EntityCapabilities* caps)
         return;
     }
 
+    g_hash_table_insert(ver_to_caps, g_strdup(ver), caps_ref(caps));
+
     if (caps->identity) {
         DiscoIdentity* identity = caps->identity;
         if (identity->name) {
@@ -249,7 +270,7 @@ caps_add_by_ver(const char* const ver, EntityCapabilities* caps)
         g_key_file_set_string_list(cache, ver, "features", features_list, num);
     }
 
-    _save_cache();
+    _schedule_save();
 }
 
 void
@@ -278,13 +299,13 @@ caps_lookup(const char* const jid)
         EntityCapabilities* caps = _caps_by_ver(ver);
         if (caps) {
             log_debug("Capabilities lookup %s, found by verification string %s.", jid, ver);
-            return caps;
+            return caps_ref(caps);
         }
     } else {
         EntityCapabilities* caps = _caps_by_jid(jid);
         if (caps) {
             log_debug("Capabilities lookup %s, found by JID.", jid);
-            return _caps_copy(caps);
+            return caps_ref(caps);
         }
     }
 
@@ -293,20 +314,22 @@ caps_lookup(const char* const jid)
 }
 
 gboolean
-caps_jid_has_feature(const char* const jid, const char* const feature)
+caps_has_feature(EntityCapabilities* caps, const char* const feature)
 {
-    EntityCapabilities* caps = caps_lookup(jid);
-
-    if (caps == NULL) {
+    if (caps == NULL || feature == NULL) {
         return FALSE;
     }
 
-    GSList* found = g_slist_find_custom(caps->features, feature, (GCompareFunc)g_strcmp0);
-    gboolean result = found != NULL;
+    return g_hash_table_contains(caps->feature_set, feature);
+}
 
-    caps_destroy(caps);
+gboolean
+caps_jid_has_feature(const char* const jid, const char* const feature)
+{
+    char* ver = g_hash_table_lookup(jid_to_ver, jid);
+    EntityCapabilities* caps = ver ? _caps_by_ver(ver) : _caps_by_jid(jid);
 
-    return result;
+    return caps_has_feature(caps, feature);
 }
 
 char*
@@ -330,9 +353,15 @@ caps_reset_ver(void)
     }
 }
 
+// decodes the cache entry on first use, the result is owned by ver_to_caps
 static EntityCapabilities*
 _caps_by_ver(const char* const ver)
 {
+    EntityCapabilities* caps = g_hash_table_lookup(ver_to_caps, ver);
+    if (caps) {
+        return caps;
+    }
+
     if (!g_key_file_has_group(cache, ver)) {
         return NULL;
     }
@@ -362,6 +391,8 @@ _caps_by_ver(const char* const ver)
 
     g_slist_free(features);
 
+    g_hash_table_insert(ver_to_caps, g_strdup(ver), result);
+
     return result;
 }
 
@@ -371,25 +402,6 @@ _caps_by_jid(const char* const jid)
     return g_hash_table_lookup(jid_to_caps, jid);
 }
 
-static EntityCapabilities*
-_caps_copy(EntityCapabilities* caps)
-{
-    if (!caps) {
-        return NULL;
-    }
-
-    const char* const categoty = caps->identity ? caps->identity->category : NULL;
-    const char* const type = caps->identity ? caps->identity->type : NULL;
-    const char* const name = caps->identity ? caps->identity->name : NULL;
-
-    const char* const software = caps->software_version ? caps->software_version->software : NULL;
-    const char* const software_version = caps->software_version ? caps->software_version->software_version : NULL;
-    const char* const os = caps->software_version ? caps->software_version->os : NULL;
-    const char* const os_version = caps->software_version ? caps->software_version->os_version : NULL;
-
-    return caps_create(categoty, type, name, software, software_version, os, os_version, caps->features);
-}
-
 static void
 _disco_identity_destroy(DiscoIdentity* disco_identity)
 {
@@ -413,15 +425,25 @@ _software_version_destroy(SoftwareVersion* software_version)
     }
 }
 
-void
-caps_destroy(EntityCapabilities* caps)
+EntityCapabilities*
+caps_ref(EntityCapabilities* caps)
 {
     if (caps) {
+        caps->refcount++;
+    }
+
+    return caps;
+}
+
+// drops a reference, the last one frees caps
+void
+caps_unref(EntityCapabilities* caps)
+{
+    if (caps && --caps->refcount == 0) {
         _disco_identity_destroy(caps->identity);
         _software_version_destroy(caps->software_version);
-        if (caps->features) {
-            g_slist_free_full(caps->features, free);
-        }
+        g_hash_table_destroy(caps->feature_set);
+        g_slist_free_full(caps->features, g_free);
         free(caps);
     }
 }
@@ -431,3 +453,20 @@ _save_cache(void)
 {
     save_keyfile(&caps_prof_keyfile);
 }
+
+static gboolean
+_save_cache_timeout(gpointer data)
+{
+    save_timeout = 0;
+    _save_cache();
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+_schedule_save(void)
+{
+    if (save_timeout == 0) {
+        save_timeout = g_timeout_add_seconds(CAPS_SAVE_DELAY, _save_cache_timeout, NULL);
+    }
+}
@@ -34,6 +34,7 @@ typedef struct prof_conn_t
 {
     xmpp_ctx_t* xmpp_ctx;
     xmpp_conn_t* xmpp_conn;
+    int xmpp_fd;
     xmpp_sm_state_t* sm_state;
     char** queued_messages;
     gboolean xmpp_in_event_loop;
@@ -65,6 +66,7 @@ static void _connection_handler(xmpp_conn_t* const xmpp_conn, const xmpp_conn_ev
 
 static TLSCertificate* _xmppcert_to_profcert(const xmpp_tlscert_t* xmpptlscert);
 static int _connection_certfail_cb(const xmpp_tlscert_t* xmpptlscert, const char* errormsg);
+static int _connection_sockopt_cb(xmpp_conn_t* xmpp_conn, void* sock);
 
 static void _random_bytes_init(void);
 static void _random_bytes_close(void);
@@ -125,6 +127,7 @@ connection_init(void)
         cons_show(err_msg);
     }
     conn.xmpp_conn = xmpp_conn_new(conn.xmpp_ctx);
+    conn.xmpp_fd = -1;
 
     _random_bytes_init();
 }
@@ -133,10 +136,22 @@ void
 connection_check_events(void)
 {
     conn.xmpp_in_event_loop = TRUE;
-    xmpp_run_once(conn.xmpp_ctx, 10);
+    /* When the socket is known, the main loop has already waited for it
+     * to become readable, so don't block in libstrophe a second time. */
+    xmpp_run_once(conn.xmpp_ctx, connection_get_fd() < 0 ? 10 : 0);
     conn.xmpp_in_event_loop = FALSE;
 }
 
+int
+connection_get_fd(void)
+{
+    // while connecting libstrophe also waits for writability, leave that to it
+    if (conn.conn_status != JABBER_CONNECTED && conn.conn_status != JABBER_RAW_CONNECTED) {
+        return -1;
+    }
+    return conn.xmpp_fd;
+}
+
 void
 connection_shutdown(void)
 {
@@ -224,6 +239,7 @@ _conn_apply_settings(const char* const jid, const char* const passwd, const char
     }
 
     xmpp_conn_set_certfail_handler(conn.xmpp_conn, _connection_certfail_cb);
+    xmpp_conn_set_sockopt_callback(conn.xmpp_conn, _connection_sockopt_cb);
     if (conn.sm_state) {
         if (xmpp_conn_set_sm_state(conn.xmpp_conn, conn.sm_state)) {
             log_warning("Had Stream Management state, but libstrophe didn't accept it");
@@ -478,6 +494,7 @@ _register_handler(xmpp_conn_t* xmpp_conn,
     case XMPP_CONN_DISCONNECT:
         log_debug("Disconnected");
         conn.conn_status = JABBER_DISCONNECTED;
+        conn.xmpp_fd = -1;
         break;
 
     default:
@@ -555,6 +572,7 @@ connection_set_disconnected(void)
     FREE_SET_NULL(conn.presence_message);
     FREE_SET_NULL(conn.domain);
     conn.conn_status = JABBER_DISCONNECTED;
+    conn.xmpp_fd = -1;
 }
 
 void
@@ -999,6 +1017,7 @@ _connection_handler(xmpp_conn_t* const xmpp_conn, const xmpp_conn_event_t status
     // disconnected
     case XMPP_CONN_DISCONNECT:
         log_debug("Connection handler: XMPP_CONN_DISCONNECT");
+        conn.xmpp_fd = -1;
 
         // lost connection for unknown reason
         if (conn.conn_status == JABBER_CONNECTED || conn.conn_status == JABBER_DISCONNECTING) {
@@ -1064,6 +1083,17 @@ _connection_certfail_cb(const xmpp_tlscert_t* xmpptlscert, const char* errormsg)
     return res;
 }
 
+/* libstrophe calls this for every socket it creates, which is the only
+ * way to learn the fd the main loop has to wait on. */
+static int
+_connection_sockopt_cb(xmpp_conn_t* xmpp_conn, void* sock)
+{
+    conn.xmpp_fd = *(int*)sock;
+    log_debug("Connection socket: fd %d", conn.xmpp_fd);
+
+    return 0;
+}
+
 TLSCertificate*
 _xmppcert_to_profcert(const xmpp_tlscert_t* xmpptlscert)
 {
@@ -155,12 +155,17 @@ _iq_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* const us
     log_debug("iq stanza handler fired");
     autoping_timer_extend();
 
-    char* text;
-    size_t text_size;
-    xmpp_stanza_to_text(stanza, &text, &text_size);
-    gboolean cont = plugins_on_iq_stanza_receive(text);
-    xmpp_free(connection_get_ctx(), text);
-    if (!cont || !id_handlers) {
+    if (plugins_has_stanza_hook(STANZA_HOOK_IQ_RECEIVE)) {
+        char* text;
+        size_t text_size;
+        xmpp_stanza_to_text(stanza, &text, &text_size);
+        gboolean cont = plugins_on_iq_stanza_receive(text);
+        xmpp_free(connection_get_ctx(), text);
+        if (!cont) {
+            return 1;
+        }
+    }
+    if (!id_handlers) {
         return 1;
     }
 
@@ -951,7 +956,7 @@ _caps_response_id_handler(xmpp_stanza_t* const stanza, void* const userdata)
             EntityCapabilities* capabilities = stanza_create_caps_from_query_element(query);
 
             caps_add_by_ver(given_sha1, capabilities);
-            caps_destroy(capabilities);
+            caps_unref(capabilities);
         }
 
         caps_map_jid_to_ver(from, given_sha1);
@@ -1074,7 +1079,7 @@ _caps_response_legacy_id_handler(xmpp_stanza_t* const stanza, void* const userda
             log_debug("Capabilities not cached: %s, storing", node);
             EntityCapabilities* capabilities = stanza_create_caps_from_query_element(query);
             caps_add_by_ver(node, capabilities);
-            caps_destroy(capabilities);
+            caps_unref(capabilities);
         }
 
         caps_map_jid_to_ver(from, node);
@@ -2598,8 +2603,7 @@ _http_upload_response_id_handler(xmpp_stanza_t* const stanza, void* const userda
                 }
             }
 
-            pthread_create(&(upload->worker), NULL, &http_file_put, upload);
-            http_upload_add_upload(upload);
+            http_upload_start(upload);
         } else {
             log_error("Invalid XML in HTTP Upload slot");
             return 1;
@@ -2681,11 +2685,16 @@ iq_feature_retrieval_complete_handler(void)
 void
 iq_send_stanza(xmpp_stanza_t* const stanza)
 {
+    xmpp_conn_t* conn = connection_get_conn();
+    if (!plugins_has_stanza_hook(STANZA_HOOK_IQ_SEND)) {
+        xmpp_send(conn, stanza);
+        return;
+    }
+
     char* text;
     size_t text_size;
     xmpp_stanza_to_text(stanza, &text, &text_size);
 
-    xmpp_conn_t* conn = connection_get_conn();
     auto_char char* plugin_text = plugins_on_iq_stanza_send(text);
     if (plugin_text) {
         xmpp_send_raw_string(conn, "%s", plugin_text);
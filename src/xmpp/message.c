@@ -104,6 +104,10 @@ get_display_name(const ProfMessage* const message, int* flags)
 static gboolean
 _handled_by_plugin(xmpp_stanza_t* const stanza)
 {
+    if (!plugins_has_stanza_hook(STANZA_HOOK_MESSAGE_RECEIVE)) {
+        return FALSE;
+    }
+
     char* text;
     size_t text_size;
 
@@ -1014,7 +1018,7 @@ _room_config_handler(xmpp_stanza_t* const stanza, void* const userdata)
     if (mucwin_set_room_name(from, capabilities->identity->name)) {
         muc_set_features(from, capabilities->features);
     }
-    caps_destroy(capabilities);
+    caps_unref(capabilities);
 
     return 0;
 }
@@ -1683,11 +1687,16 @@ _handle_pubsub(xmpp_stanza_t* const stanza, xmpp_stanza_t* const event)
 static void
 _send_message_stanza(xmpp_stanza_t* const stanza)
 {
+    xmpp_conn_t* conn = connection_get_conn();
+    if (!plugins_has_stanza_hook(STANZA_HOOK_MESSAGE_SEND)) {
+        xmpp_send(conn, stanza);
+        return;
+    }
+
     char* text;
     size_t text_size;
     xmpp_stanza_to_text(stanza, &text, &text_size);
 
-    xmpp_conn_t* conn = connection_get_conn();
     auto_char char* plugin_text = plugins_on_message_stanza_send(text);
     if (plugin_text) {
         xmpp_send_raw_string(conn, "%s", plugin_text);
@@ -41,6 +41,7 @@ typedef struct _muc_room_t
     gboolean autojoin;
     gboolean pending_nick_change;
     GHashTable* roster;
+    GSequence* occupants; // roster values by role, then nick, see _compare_occupants_by_role()
     GHashTable* members;
     Autocomplete nick_ac;
     Autocomplete jid_ac;
@@ -60,6 +61,8 @@ Autocomplete confservers_ac = NULL;
 
 static void _free_room(ChatRoom* room);
 static gint _compare_occupants(Occupant* a, Occupant* b);
+static gint _compare_occupants_by_role(gconstpointer a, gconstpointer b, gpointer data);
+static void _occupants_index_remove(ChatRoom* chat_room, Occupant* occupant);
 static muc_role_t _role_from_string(const char* const role);
 static muc_affiliation_t _affiliation_from_string(const char* const affiliation);
 static char* _role_to_string(muc_role_t role);
@@ -206,6 +209,7 @@ muc_join(const char* const room, const char* const nick, const char* const passw
     new_room->pending_broadcasts = NULL;
     new_room->pending_config = FALSE;
     new_room->roster = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)_occupant_free);
+    new_room->occupants = g_sequence_new(NULL);
     new_room->members = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
     new_room->nick_ac = autocomplete_new();
     new_room->jid_ac = autocomplete_new();
@@ -450,6 +454,10 @@ muc_nick_change_complete(const char* const room, const char* const nick)
 {
     ChatRoom* chat_room = g_hash_table_lookup(rooms, room);
     if (chat_room) {
+        Occupant* occupant = g_hash_table_lookup(chat_room->roster, chat_room->nick);
+        if (occupant) {
+            _occupants_index_remove(chat_room, occupant);
+        }
         g_hash_table_remove(chat_room->roster, chat_room->nick);
         autocomplete_remove(chat_room->nick_ac, chat_room->nick);
         free(chat_room->nick);
@@ -500,6 +508,15 @@ muc_password(const char* const room)
     }
 }
 
+static void
+_occupants_index_remove(ChatRoom* chat_room, Occupant* occupant)
+{
+    GSequenceIter* iter = g_sequence_lookup(chat_room->occupants, occupant, _compare_occupants_by_role, NULL);
+    if (iter) {
+        g_sequence_remove(iter);
+    }
+}
+
 /*
  * Returns TRUE if the specified nick exists in the room's roster
  */
@@ -532,8 +549,11 @@ muc_roster_add(const char* const room, const char* const nick, const char* const
         if (!old) {
             updated = TRUE;
             autocomplete_add(chat_room->nick_ac, nick);
-        } else if (old->presence != new_presence || (g_strcmp0(old->status, status) != 0)) {
-            updated = TRUE;
+        } else {
+            if (old->presence != new_presence || (g_strcmp0(old->status, status) != 0)) {
+                updated = TRUE;
+            }
+            _occupants_index_remove(chat_room, old);
         }
 
         resource_presence_t presence = resource_presence_from_string(show);
@@ -541,6 +561,7 @@ muc_roster_add(const char* const room, const char* const nick, const char* const
         muc_affiliation_t affiliation_t = _affiliation_from_string(affiliation);
         Occupant* occupant = _muc_occupant_new(nick, jid, role_t, affiliation_t, presence, status);
         g_hash_table_replace(chat_room->roster, strdup(nick), occupant);
+        g_sequence_insert_sorted(chat_room->occupants, occupant, _compare_occupants_by_role, NULL);
 
         if (jid) {
             auto_jid Jid* jidp = jid_create(jid);
@@ -561,6 +582,10 @@ muc_roster_remove(const char* const room, const char* const nick)
 {
     ChatRoom* chat_room = g_hash_table_lookup(rooms, room);
     if (chat_room) {
+        Occupant* occupant = g_hash_table_lookup(chat_room->roster, nick);
+        if (occupant) {
+            _occupants_index_remove(chat_room, occupant);
+        }
         g_hash_table_remove(chat_room->roster, nick);
         autocomplete_remove(chat_room->nick_ac, nick);
     }
@@ -586,23 +611,35 @@ muc_roster(const char* const room)
 {
     ChatRoom* chat_room = g_hash_table_lookup(rooms, room);
     if (chat_room) {
-        GList* result = NULL;
         GList* occupants = g_hash_table_get_values(chat_room->roster);
-
-        GList* curr = occupants;
-        while (curr) {
-            result = g_list_insert_sorted(result, curr->data, (GCompareFunc)_compare_occupants);
-            curr = g_list_next(curr);
-        }
-
-        g_list_free(occupants);
-
-        return result;
+        return g_list_sort(occupants, (GCompareFunc)_compare_occupants);
     } else {
         return NULL;
     }
 }
 
+/*
+ * Return the room's occupants ordered by role (moderators, participants,
+ * visitors, none) and then by nick. The occupants are owned by the room.
+ */
+GList*
+muc_roster_by_role(const char* const room)
+{
+    ChatRoom* chat_room = g_hash_table_lookup(rooms, room);
+    if (!chat_room) {
+        return NULL;
+    }
+
+    GList* result = NULL;
+    GSequenceIter* iter = g_sequence_get_end_iter(chat_room->occupants);
+    while (!g_sequence_iter_is_begin(iter)) {
+        iter = g_sequence_iter_prev(iter);
+        result = g_list_prepend(result, g_sequence_get(iter));
+    }
+
+    return result;
+}
+
 /*
  * Return a Autocomplete representing the room member's in the roster
  */
@@ -678,18 +715,19 @@ muc_occupants_by_role(const char* const room, muc_role_t role)
     ChatRoom* chat_room = g_hash_table_lookup(rooms, room);
     if (chat_room) {
         GSList* result = NULL;
-        GHashTableIter iter;
-        gpointer key;
-        gpointer value;
+        GSequenceIter* iter = g_sequence_get_begin_iter(chat_room->occupants);
 
-        g_hash_table_iter_init(&iter, chat_room->roster);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            Occupant* occupant = (Occupant*)value;
+        // the index is ordered by role, so the role's occupants are adjacent
+        while (!g_sequence_iter_is_end(iter)) {
+            Occupant* occupant = g_sequence_get(iter);
             if (occupant->role == role) {
-                result = g_slist_insert_sorted(result, value, (GCompareFunc)_compare_occupants);
+                result = g_slist_prepend(result, occupant);
+            } else if (result) {
+                break;
             }
+            iter = g_sequence_iter_next(iter);
         }
-        return result;
+        return g_slist_reverse(result);
     } else {
         return NULL;
     }
@@ -815,17 +853,21 @@ muc_jid_autocomplete_add_all(const char* const room, GSList* jids)
     ChatRoom* chat_room = g_hash_table_lookup(rooms, room);
     if (chat_room) {
         if (chat_room->jid_ac) {
+            GPtrArray* barejids = g_ptr_array_new_with_free_func(g_free);
             GSList* curr_jid = jids;
             while (curr_jid) {
                 const char* jid = curr_jid->data;
                 auto_jid Jid* jidp = jid_create(jid);
                 if (jidp) {
                     if (jidp->barejid) {
-                        autocomplete_add(chat_room->jid_ac, jidp->barejid);
+                        g_ptr_array_add(barejids, g_strdup(jidp->barejid));
                     }
                 }
                 curr_jid = g_slist_next(curr_jid);
             }
+            g_ptr_array_add(barejids, NULL);
+            autocomplete_add_all(chat_room->jid_ac, (char**)barejids->pdata);
+            g_ptr_array_free(barejids, TRUE);
         }
     }
 }
@@ -967,6 +1009,9 @@ _free_room(ChatRoom* room)
         free(room->subject);
         free(room->password);
         free(room->autocomplete_prefix);
+        if (room->occupants) {
+            g_sequence_free(room->occupants);
+        }
         if (room->roster) {
             g_hash_table_destroy(room->roster);
         }
@@ -996,6 +1041,42 @@ _compare_occupants(Occupant* a, Occupant* b)
     return result;
 }
 
+static int
+_role_rank(muc_role_t role)
+{
+    switch (role) {
+    case MUC_ROLE_MODERATOR:
+        return 0;
+    case MUC_ROLE_PARTICIPANT:
+        return 1;
+    case MUC_ROLE_VISITOR:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+// order of the occupants index, the nick breaks ties between equal collate keys
+static gint
+_compare_occupants_by_role(gconstpointer a, gconstpointer b, gpointer data)
+{
+    const Occupant* occupant_a = a;
+    const Occupant* occupant_b = b;
+
+    int rank_a = _role_rank(occupant_a->role);
+    int rank_b = _role_rank(occupant_b->role);
+    if (rank_a != rank_b) {
+        return rank_a < rank_b ? -1 : 1;
+    }
+
+    gint result = g_strcmp0(occupant_a->nick_collate_key, occupant_b->nick_collate_key);
+    if (result != 0) {
+        return result;
+    }
+
+    return g_strcmp0(occupant_a->nick, occupant_b->nick);
+}
+
 static muc_role_t
 _role_from_string(const char* const role)
 {
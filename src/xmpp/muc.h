@@ -88,6 +88,7 @@ gboolean muc_roster_add(const char* const room, const char* const nick, const ch
 void muc_roster_remove(const char* const room, const char* const nick);
 void muc_roster_set_complete(const char* const room);
 GList* muc_roster(const char* const room);
+GList* muc_roster_by_role(const char* const room);
 Autocomplete muc_roster_ac(const char* const room);
 Autocomplete muc_roster_jid_ac(const char* const room);
 void muc_jid_autocomplete_reset(const char* const room);
@@ -330,14 +330,16 @@ _presence_handler(xmpp_conn_t* const conn, xmpp_stanza_t* const stanza, void* co
     log_debug("Presence stanza handler fired");
     autoping_timer_extend();
 
-    char* text = NULL;
-    size_t text_size;
-    xmpp_stanza_to_text(stanza, &text, &text_size);
-
-    gboolean cont = plugins_on_presence_stanza_receive(text);
-    xmpp_free(connection_get_ctx(), text);
-    if (!cont) {
-        return 1;
+    if (plugins_has_stanza_hook(STANZA_HOOK_PRESENCE_RECEIVE)) {
+        char* text = NULL;
+        size_t text_size;
+        xmpp_stanza_to_text(stanza, &text, &text_size);
+
+        gboolean cont = plugins_on_presence_stanza_receive(text);
+        xmpp_free(connection_get_ctx(), text);
+        if (!cont) {
+            return 1;
+        }
     }
 
     const char* type = xmpp_stanza_get_type(stanza);
@@ -679,7 +681,7 @@ _available_handler(xmpp_stanza_t* const stanza)
                         }
                     }
 
-                    caps_destroy(caps);
+                    caps_unref(caps);
                 }
 
                 win_println(console, THEME_RED_BOLD, "|", "If it wasn't you, change your password. Use: /changepassword");
@@ -914,11 +916,16 @@ _muc_user_handler(xmpp_stanza_t* const stanza)
 static void
 _send_presence_stanza(xmpp_stanza_t* const stanza)
 {
+    xmpp_conn_t* conn = connection_get_conn();
+    if (!plugins_has_stanza_hook(STANZA_HOOK_PRESENCE_SEND)) {
+        xmpp_send(conn, stanza);
+        return;
+    }
+
     char* text;
     size_t text_size;
     xmpp_stanza_to_text(stanza, &text, &text_size);
 
-    xmpp_conn_t* conn = connection_get_conn();
     auto_char char* plugin_text = plugins_on_presence_stanza_send(text);
     if (plugin_text) {
         xmpp_send_raw_string(conn, "%s", plugin_text);
@@ -43,8 +43,23 @@ typedef struct prof_roster_t
     // groups
     Autocomplete groups_ac;
     GHashTable* group_count;
+
+    // contacts kept in display order, repositioned as each contact changes
+    GSequence* by_name;
+    GSequence* by_presence;
+
+    // contact to its ProfRosterSorted entry
+    GHashTable* sorted;
 } ProfRoster;
 
+typedef struct roster_sorted_t
+{
+    GSequenceIter* by_name;
+    GSequenceIter* by_presence;
+} ProfRosterSorted;
+
+typedef gboolean (*roster_filter_func)(PContact contact, gconstpointer data);
+
 typedef struct pending_presence
 {
     char* barejid;
@@ -60,6 +75,10 @@ static gboolean _key_equals(void* key1, void* key2);
 static gboolean _datetimes_equal(GDateTime* dt1, GDateTime* dt2);
 static void _replace_name(const char* const current_name, const char* const new_name, const char* const barejid);
 static void _add_name_and_barejid(const char* const name, const char* const barejid);
+static void _sorted_add(PContact contact);
+static void _sorted_remove(PContact contact);
+static void _sorted_changed(PContact contact);
+static GSList* _sorted_list(roster_ord_t order, roster_filter_func filter, gconstpointer data);
 
 void
 roster_create(void)
@@ -74,6 +93,9 @@ roster_create(void)
     roster->name_to_barejid = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
     roster->groups_ac = autocomplete_new();
     roster->group_count = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    roster->by_name = g_sequence_new(NULL);
+    roster->by_presence = g_sequence_new(NULL);
+    roster->sorted = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
 
     roster_received = FALSE;
     roster_pending_presence = NULL;
@@ -103,6 +125,9 @@ roster_destroy(void)
     g_hash_table_destroy(roster->name_to_barejid);
     autocomplete_free(roster->groups_ac);
     g_hash_table_destroy(roster->group_count);
+    g_hash_table_destroy(roster->sorted);
+    g_sequence_free(roster->by_name);
+    g_sequence_free(roster->by_presence);
 
     free(roster);
     roster = NULL;
@@ -142,6 +167,7 @@ roster_update_presence(const char* const barejid, Resource* resource, GDateTime*
         p_contact_set_last_activity(contact, last_activity);
     }
     p_contact_set_presence(contact, resource);
+    _sorted_changed(contact);
     auto_jid Jid* jid = jid_create_from_bare_and_resource(barejid, resource->name);
     autocomplete_add(roster->fulljid_ac, jid->fulljid);
 
@@ -201,6 +227,7 @@ roster_contact_offline(const char* const barejid, const char* const resource, co
     } else {
         gboolean result = p_contact_remove_resource(contact, resource);
         if (result == TRUE) {
+            _sorted_changed(contact);
             auto_jid Jid* jid = jid_create_from_bare_and_resource(barejid, resource);
             autocomplete_remove(roster->fulljid_ac, jid->fulljid);
         }
@@ -234,6 +261,7 @@ roster_change_name(PContact contact, const char* const new_name)
     }
 
     p_contact_set_name(contact, new_name);
+    _sorted_changed(contact);
     _replace_name(current_name, new_name, barejid);
 }
 
@@ -276,6 +304,10 @@ roster_remove(const char* const name, const char* const barejid)
     }
 
     // remove the contact
+    PContact removed = g_hash_table_lookup(roster->contacts, barejid);
+    if (removed) {
+        _sorted_remove(removed);
+    }
     g_hash_table_remove(roster->contacts, barejid);
 }
 
@@ -379,6 +411,7 @@ roster_add(const char* const barejid, const char* const name, GSList* groups, co
         }
         g_list_free(resources);
     }
+    _sorted_add(contact);
 
     autocomplete_add(roster->barejid_ac, barejid);
     _add_name_and_barejid(name, barejid);
@@ -407,26 +440,24 @@ roster_barejid_from_name(const char* const name)
     }
 }
 
+static gboolean
+_has_presence(PContact contact, gconstpointer presence)
+{
+    return g_strcmp0(p_contact_presence(contact), presence) == 0;
+}
+
+static gboolean
+_is_online(PContact contact, gconstpointer unused)
+{
+    return g_strcmp0(p_contact_presence(contact), "offline") != 0;
+}
+
 GSList*
 roster_get_contacts_by_presence(const char* const presence)
 {
     assert(roster != NULL);
 
-    GSList* result = NULL;
-    GHashTableIter iter;
-    gpointer key;
-    gpointer value;
-
-    g_hash_table_iter_init(&iter, roster->contacts);
-    while (g_hash_table_iter_next(&iter, &key, &value)) {
-        PContact contact = (PContact)value;
-        if (g_strcmp0(p_contact_presence(contact), presence) == 0) {
-            result = g_slist_insert_sorted(result, value, (GCompareFunc)roster_compare_name);
-        }
-    }
-
-    // return all contact structs
-    return result;
+    return _sorted_list(ROSTER_ORD_NAME, _has_presence, presence);
 }
 
 GSList*
@@ -434,25 +465,7 @@ roster_get_contacts(roster_ord_t order)
 {
     assert(roster != NULL);
 
-    GSList* result = NULL;
-    GHashTableIter iter;
-    gpointer key;
-    gpointer value;
-
-    GCompareFunc cmp_func;
-    if (order == ROSTER_ORD_PRESENCE) {
-        cmp_func = (GCompareFunc)roster_compare_presence;
-    } else {
-        cmp_func = (GCompareFunc)roster_compare_name;
-    }
-
-    g_hash_table_iter_init(&iter, roster->contacts);
-    while (g_hash_table_iter_next(&iter, &key, &value)) {
-        result = g_slist_insert_sorted(result, value, cmp_func);
-    }
-
-    // return all contact structs
-    return result;
+    return _sorted_list(order, NULL, NULL);
 }
 
 GSList*
@@ -460,19 +473,7 @@ roster_get_contacts_online(void)
 {
     assert(roster != NULL);
 
-    GSList* result = NULL;
-    GHashTableIter iter;
-    gpointer key;
-    gpointer value;
-
-    g_hash_table_iter_init(&iter, roster->contacts);
-    while (g_hash_table_iter_next(&iter, &key, &value)) {
-        if (strcmp(p_contact_presence(value), "offline"))
-            result = g_slist_insert_sorted(result, value, (GCompareFunc)roster_compare_name);
-    }
-
-    // return all contact structs
-    return result;
+    return _sorted_list(ROSTER_ORD_NAME, _is_online, NULL);
 }
 
 gboolean
@@ -511,43 +512,22 @@ roster_fulljid_autocomplete(const char* const search_str, gboolean previous, voi
     return autocomplete_complete(roster->fulljid_ac, search_str, TRUE, previous);
 }
 
+static gboolean
+_in_group(PContact contact, gconstpointer group)
+{
+    if (group == NULL) {
+        return p_contact_groups(contact) == NULL;
+    }
+
+    return p_contact_in_group(contact, group);
+}
+
 GSList*
 roster_get_group(const char* const group, roster_ord_t order)
 {
     assert(roster != NULL);
 
-    GSList* result = NULL;
-    GHashTableIter iter;
-    gpointer key;
-    gpointer value;
-
-    GCompareFunc cmp_func;
-    if (order == ROSTER_ORD_PRESENCE) {
-        cmp_func = (GCompareFunc)roster_compare_presence;
-    } else {
-        cmp_func = (GCompareFunc)roster_compare_name;
-    }
-
-    g_hash_table_iter_init(&iter, roster->contacts);
-    while (g_hash_table_iter_next(&iter, &key, &value)) {
-        GSList* groups = p_contact_groups(value);
-        if (group == NULL) {
-            if (groups == NULL) {
-                result = g_slist_insert_sorted(result, value, cmp_func);
-            }
-        } else {
-            while (groups) {
-                if (strcmp(groups->data, group) == 0) {
-                    result = g_slist_insert_sorted(result, value, cmp_func);
-                    break;
-                }
-                groups = g_slist_next(groups);
-            }
-        }
-    }
-
-    // return all contact structs
-    return result;
+    return _sorted_list(order, _in_group, group);
 }
 
 GList*
@@ -629,6 +609,68 @@ _add_name_and_barejid(const char* const name, const char* const barejid)
     }
 }
 
+static gint
+_sorted_compare_name(gconstpointer a, gconstpointer b, gpointer unused)
+{
+    return roster_compare_name((PContact)a, (PContact)b);
+}
+
+static gint
+_sorted_compare_presence(gconstpointer a, gconstpointer b, gpointer unused)
+{
+    return roster_compare_presence((PContact)a, (PContact)b);
+}
+
+static void
+_sorted_add(PContact contact)
+{
+    ProfRosterSorted* entry = g_new0(ProfRosterSorted, 1);
+    entry->by_name = g_sequence_insert_sorted(roster->by_name, contact, _sorted_compare_name, NULL);
+    entry->by_presence = g_sequence_insert_sorted(roster->by_presence, contact, _sorted_compare_presence, NULL);
+    g_hash_table_insert(roster->sorted, contact, entry);
+}
+
+static void
+_sorted_remove(PContact contact)
+{
+    ProfRosterSorted* entry = g_hash_table_lookup(roster->sorted, contact);
+    if (entry) {
+        g_sequence_remove(entry->by_name);
+        g_sequence_remove(entry->by_presence);
+        g_hash_table_remove(roster->sorted, contact);
+    }
+}
+
+// move a contact whose name or presence changed, O(log n) instead of a resort
+static void
+_sorted_changed(PContact contact)
+{
+    ProfRosterSorted* entry = g_hash_table_lookup(roster->sorted, contact);
+    if (entry) {
+        g_sequence_sort_changed(entry->by_name, _sorted_compare_name, NULL);
+        g_sequence_sort_changed(entry->by_presence, _sorted_compare_presence, NULL);
+    }
+}
+
+static GSList*
+_sorted_list(roster_ord_t order, roster_filter_func filter, gconstpointer data)
+{
+    GSequence* seq = order == ROSTER_ORD_PRESENCE ? roster->by_presence : roster->by_name;
+    GSList* result = NULL;
+
+    // walk backwards so prepending yields the list in order
+    GSequenceIter* iter = g_sequence_get_end_iter(seq);
+    while (!g_sequence_iter_is_begin(iter)) {
+        iter = g_sequence_iter_prev(iter);
+        PContact contact = g_sequence_get(iter);
+        if (!filter || filter(contact, data)) {
+            result = g_slist_prepend(result, contact);
+        }
+    }
+
+    return result;
+}
+
 gint
 roster_compare_name(PContact a, PContact b)
 {
@@ -676,14 +718,10 @@ roster_compare_presence(PContact a, PContact b)
     const char* presence_b = p_contact_presence(b);
 
     // if presence different, order by presence
-    if (g_strcmp0(presence_a, presence_b) != 0) {
-        int weight_a = _get_presence_weight(presence_a);
-        int weight_b = _get_presence_weight(presence_b);
-        if (weight_a < weight_b) {
-            return -1;
-        } else {
-            return 1;
-        }
+    int weight_a = _get_presence_weight(presence_a);
+    int weight_b = _get_presence_weight(presence_b);
+    if (weight_a != weight_b) {
+        return weight_a < weight_b ? -1 : 1;
 
         // otherwise order by name
     } else {
@@ -93,11 +93,14 @@ typedef struct software_version_t
     char* os_version;
 } SoftwareVersion;
 
+// Shared and reference counted, feature_set indexes the strings in features.
 typedef struct entity_capabilities_t
 {
     DiscoIdentity* identity;
     SoftwareVersion* software_version;
     GSList* features;
+    GHashTable* feature_set;
+    gint refcount;
 } EntityCapabilities;
 
 typedef struct disco_item_t
@@ -176,6 +179,7 @@ void session_reconnect_now(void);
 
 void connection_disconnect(void);
 jabber_conn_status_t connection_get_status(void);
+int connection_get_fd(void);
 const char* connection_get_presence_msg(void);
 void connection_set_presence_msg(const char* const message);
 const char* connection_get_fulljid(void);
@@ -262,7 +266,9 @@ void iq_muc_register_nick(const char* const roomjid);
 void autoping_timer_extend(void);
 
 EntityCapabilities* caps_lookup(const char* const jid);
-void caps_destroy(EntityCapabilities* caps);
+EntityCapabilities* caps_ref(EntityCapabilities* caps);
+void caps_unref(EntityCapabilities* caps);
+gboolean caps_has_feature(EntityCapabilities* caps, const char* const feature);
 void caps_reset_ver(void);
 void caps_add_feature(char* feature);
 void caps_remove_feature(char* feature);
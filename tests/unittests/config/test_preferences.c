@@ -34,3 +34,39 @@ prefs_get_string__returns__none_for_muc_default(void** state)
     assert_string_equal("none", setting);
     g_free(setting);
 }
+
+void
+prefs_peek_string__returns__value_after_set(void** state)
+{
+    assert_string_equal("none", prefs_peek_string(PREF_STATUSES_MUC));
+
+    prefs_set_string(PREF_STATUSES_MUC, "all");
+
+    assert_string_equal("all", prefs_peek_string(PREF_STATUSES_MUC));
+}
+
+static void
+_count_changes(preference_t pref, void* userdata)
+{
+    if (pref == PREF_BEEP) {
+        (*(int*)userdata)++;
+    }
+}
+
+void
+prefs_set_boolean__notifies__listener(void** state)
+{
+    int changes = 0;
+    prefs_add_listener(_count_changes, &changes);
+
+    prefs_set_boolean(PREF_BEEP, TRUE);
+
+    assert_int_equal(1, changes);
+    assert_true(prefs_get_boolean(PREF_BEEP));
+
+    prefs_remove_listener(_count_changes, &changes);
+    prefs_set_boolean(PREF_BEEP, FALSE);
+
+    assert_int_equal(1, changes);
+    assert_false(prefs_get_boolean(PREF_BEEP));
+}
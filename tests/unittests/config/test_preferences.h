@@ -4,5 +4,7 @@
 void prefs_get_string__returns__all_for_console_default(void** state);
 void prefs_get_string__returns__none_for_chat_default(void** state);
 void prefs_get_string__returns__none_for_muc_default(void** state);
+void prefs_peek_string__returns__value_after_set(void** state);
+void prefs_set_boolean__notifies__listener(void** state);
 
 #endif
@@ -0,0 +1,199 @@
+#include "prof_cmocka.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sqlite3.h>
+
+#include "helpers.h"
+#include "database.h"
+#include "config/account.h"
+#include "xmpp/jid.h"
+#include "xmpp/message.h"
+
+#define DB_DIR  "./tests/files/xdg_data_home/profanity/database"
+#define DB_FILE DB_DIR "/me_at_example.org/chatlog.db"
+
+static ProfAccount account = { .jid = "me@example.org" };
+
+static void
+_add_message(const char* const from, const char* const text, const char* const timestamp)
+{
+    ProfMessage* message = message_init();
+    message->from_jid = jid_create(from);
+    message->to_jid = jid_create("me@example.org");
+    message->plain = strdup(text);
+    message->timestamp = g_date_time_new_from_iso8601(timestamp, NULL);
+    message->type = PROF_MSG_TYPE_CHAT;
+
+    assert_true(log_database_add_incoming(message));
+
+    message_free(message);
+}
+
+// Reopening flushes the writer queue, the messages are read from the database afterwards
+static void
+_add_messages(void)
+{
+    _add_message("alice@example.org", "shall we have lunch today?", "2026-01-01T11:00:00Z");
+    _add_message("bob@example.org", "lunch at noon works for me", "2026-01-02T11:30:00Z");
+    _add_message("alice@example.org", "the report is 100% done", "2026-01-03T09:00:00Z");
+
+    log_database_close();
+    assert_true(log_database_init(&account));
+}
+
+static void
+_drop_search_index(void)
+{
+    sqlite3* db = NULL;
+    assert_int_equal(SQLITE_OK, sqlite3_open(DB_FILE, &db));
+    sqlite3_busy_timeout(db, 5000);
+    assert_int_equal(SQLITE_OK, sqlite3_exec(db, "UPDATE `DbVersion` SET `version` = 3", NULL, 0, NULL));
+    sqlite3_close(db);
+}
+
+int
+database_before_test(void** state)
+{
+    load_preferences(state);
+    create_data_dir(state);
+    assert_true(log_database_init(&account));
+    return 0;
+}
+
+int
+database_after_test(void** state)
+{
+    log_database_close();
+    remove(DB_FILE);
+    remove(DB_FILE "-wal");
+    remove(DB_FILE "-shm");
+    rmdir(DB_DIR "/me_at_example.org");
+    rmdir(DB_DIR);
+    remove_data_dir(state);
+    close_preferences(state);
+    rmdir("./tests/files");
+    return 0;
+}
+
+void
+log_database_search_available__is__false_without_database(void** state)
+{
+    assert_false(log_database_search_available());
+    assert_null(log_database_search("lunch", NULL, NULL, 0, 10));
+}
+
+void
+log_database_search__returns__null_for_empty_query(void** state)
+{
+    _add_messages();
+
+    assert_true(log_database_search_available());
+    assert_null(log_database_search("", NULL, NULL, 0, 10));
+    assert_null(log_database_search("  ", NULL, NULL, 0, 10));
+}
+
+void
+log_database_search__finds__logged_messages(void** state)
+{
+    _add_messages();
+
+    GSList* results = log_database_search("lunch", NULL, NULL, 0, 10);
+
+    assert_int_equal(2, g_slist_length(results));
+    for (GSList* curr = results; curr; curr = g_slist_next(curr)) {
+        ProfMessage* message = curr->data;
+        assert_non_null(strstr(message->plain, "lunch"));
+        assert_string_equal("me@example.org", message->to_jid->barejid);
+    }
+
+    g_slist_free_full(results, (GDestroyNotify)message_free);
+}
+
+void
+log_database_search__finds__queued_messages(void** state)
+{
+    _add_message("alice@example.org", "dinner instead?", "2026-01-04T18:00:00Z");
+
+    GSList* results = log_database_search("dinner", NULL, NULL, 0, 10);
+
+    assert_int_equal(1, g_slist_length(results));
+    ProfMessage* message = results->data;
+    assert_string_equal("alice@example.org", message->from_jid->barejid);
+
+    g_slist_free_full(results, (GDestroyNotify)message_free);
+}
+
+void
+log_database_search__filters__by_jid_and_since(void** state)
+{
+    _add_messages();
+
+    GSList* results = log_database_search("lunch", "bob@example.org", NULL, 0, 10);
+    assert_int_equal(1, g_slist_length(results));
+    assert_string_equal("bob@example.org", ((ProfMessage*)results->data)->from_jid->barejid);
+    g_slist_free_full(results, (GDestroyNotify)message_free);
+
+    results = log_database_search("lunch", NULL, "2026-01-02T00:00:00Z", 0, 10);
+    assert_int_equal(1, g_slist_length(results));
+    assert_string_equal("bob@example.org", ((ProfMessage*)results->data)->from_jid->barejid);
+    g_slist_free_full(results, (GDestroyNotify)message_free);
+}
+
+void
+log_database_search__pages__with_offset_and_limit(void** state)
+{
+    _add_messages();
+
+    GSList* first = log_database_search("lunch", NULL, NULL, 0, 1);
+    GSList* second = log_database_search("lunch", NULL, NULL, 1, 1);
+    GSList* past_end = log_database_search("lunch", NULL, NULL, 2, 1);
+
+    assert_int_equal(1, g_slist_length(first));
+    assert_int_equal(1, g_slist_length(second));
+    assert_null(past_end);
+    assert_string_not_equal(((ProfMessage*)first->data)->from_jid->barejid,
+                            ((ProfMessage*)second->data)->from_jid->barejid);
+
+    g_slist_free_full(first, (GDestroyNotify)message_free);
+    g_slist_free_full(second, (GDestroyNotify)message_free);
+}
+
+void
+log_database_search__falls_back__to_like_without_index(void** state)
+{
+    _add_messages();
+    _drop_search_index();
+
+    assert_true(log_database_search_available());
+
+    // newest first, every word has to match
+    GSList* results = log_database_search("LUNCH", NULL, NULL, 0, 10);
+    assert_int_equal(2, g_slist_length(results));
+    assert_string_equal("lunch at noon works for me", ((ProfMessage*)results->data)->plain);
+    assert_string_equal("shall we have lunch today?", ((ProfMessage*)results->next->data)->plain);
+    g_slist_free_full(results, (GDestroyNotify)message_free);
+
+    results = log_database_search("lunch today", NULL, NULL, 0, 10);
+    assert_int_equal(1, g_slist_length(results));
+    g_slist_free_full(results, (GDestroyNotify)message_free);
+
+    results = log_database_search("lun*", "alice@example.org", NULL, 0, 10);
+    assert_int_equal(1, g_slist_length(results));
+    g_slist_free_full(results, (GDestroyNotify)message_free);
+}
+
+void
+log_database_search__matches__like_wildcards_literally(void** state)
+{
+    _add_messages();
+    _drop_search_index();
+
+    GSList* results = log_database_search("100%", NULL, NULL, 0, 10);
+    assert_int_equal(1, g_slist_length(results));
+    assert_string_equal("the report is 100% done", ((ProfMessage*)results->data)->plain);
+    g_slist_free_full(results, (GDestroyNotify)message_free);
+
+    assert_null(log_database_search("l_nch", NULL, NULL, 0, 10));
+}
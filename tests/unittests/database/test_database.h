@@ -0,0 +1,15 @@
+#ifndef TESTS_TEST_DATABASE_H
+#define TESTS_TEST_DATABASE_H
+
+int database_before_test(void** state);
+int database_after_test(void** state);
+void log_database_search_available__is__false_without_database(void** state);
+void log_database_search__returns__null_for_empty_query(void** state);
+void log_database_search__finds__logged_messages(void** state);
+void log_database_search__finds__queued_messages(void** state);
+void log_database_search__filters__by_jid_and_since(void** state);
+void log_database_search__pages__with_offset_and_limit(void** state);
+void log_database_search__falls_back__to_like_without_index(void** state);
+void log_database_search__matches__like_wildcards_literally(void** state);
+
+#endif
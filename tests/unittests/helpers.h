@@ -11,6 +11,9 @@
 int load_preferences(void** state);
 int close_preferences(void** state);
 
+void create_data_dir(void** state);
+void remove_data_dir(void** state);
+
 int init_chat_sessions(void** state);
 int close_chat_sessions(void** state);
 
@@ -66,3 +66,8 @@ void
 log_stderr_handler(void)
 {
 }
+int
+log_stderr_get_fd(void)
+{
+    return -1;
+}
@@ -1,8 +1,11 @@
 #include <glib.h>
+#include <gcrypt.h>
 
 #include "config/account.h"
 #include "ui/ui.h"
 
+typedef struct omemo_file_stream_t OmemoFileStream;
+
 void
 omemo_init(void)
 {
@@ -122,9 +125,10 @@ omemo_start_sessions(void)
 {
 }
 
-char*
-omemo_encrypt_file(FILE* in, FILE* out, off_t file_size, int* gcry_res)
+OmemoFileStream*
+omemo_encrypt_file_stream(off_t file_size, char** fragment, gcry_error_t* gcry_res)
 {
+    *gcry_res = GPG_ERR_NOT_IMPLEMENTED;
     return NULL;
 };
 void omemo_free(void* a) {};
@@ -0,0 +1,197 @@
+#include "prof_cmocka.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "omemo/omemo.h"
+#include "omemo/crypto.h"
+
+// more than one stream buffer, and not a multiple of the block size
+#define PLAINTEXT_SIZE (600 * 1024 + 5)
+#define CHUNK_SIZE     16381
+
+static const unsigned char key[OMEMO_AESGCM_KEY_LENGTH] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+                                                            17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32 };
+static const unsigned char nonce[OMEMO_AESGCM_NONCE_LENGTH] = { 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 1, 2 };
+
+static FILE*
+_plaintext_file(void)
+{
+    FILE* file = tmpfile();
+    assert_non_null(file);
+    for (int i = 0; i < PLAINTEXT_SIZE; i++) {
+        fputc((i * 31 + i / 251) & 0xff, file);
+    }
+    rewind(file);
+    return file;
+}
+
+// Reads the whole ciphertext in chunks the way curl does, returns its length
+static size_t
+_encrypt(OmemoFileStream* stream, FILE* in, char* out, size_t out_size)
+{
+    size_t len = 0;
+    size_t bytes;
+    do {
+        assert_int_equal(GPG_ERR_NO_ERROR, omemo_file_stream_read(stream, in, out + len, MIN(CHUNK_SIZE, out_size - len), &bytes));
+        len += bytes;
+    } while (bytes > 0 && len < out_size);
+    return len;
+}
+
+static gcry_error_t
+_decrypt(const char* ciphertext, size_t len, FILE* out)
+{
+    gcry_error_t res;
+    OmemoFileStream* stream = omemo_file_stream_new(key, nonce, 0, FALSE, &res);
+    assert_non_null(stream);
+
+    for (size_t pos = 0; pos < len; pos += CHUNK_SIZE) {
+        res = omemo_file_stream_write(stream, out, ciphertext + pos, MIN(CHUNK_SIZE, len - pos));
+        assert_int_equal(GPG_ERR_NO_ERROR, res);
+    }
+    res = omemo_file_stream_finish(stream, out);
+
+    omemo_file_stream_free(stream);
+    return res;
+}
+
+static char*
+_ciphertext(size_t* len)
+{
+    FILE* in = _plaintext_file();
+    gcry_error_t res;
+    OmemoFileStream* stream = omemo_file_stream_new(key, nonce, PLAINTEXT_SIZE, TRUE, &res);
+    assert_non_null(stream);
+
+    char* ciphertext = malloc(PLAINTEXT_SIZE + OMEMO_AESGCM_TAG_LENGTH + 1);
+    *len = _encrypt(stream, in, ciphertext, PLAINTEXT_SIZE + OMEMO_AESGCM_TAG_LENGTH + 1);
+
+    omemo_file_stream_free(stream);
+    fclose(in);
+    return ciphertext;
+}
+
+int
+crypto_before_test(void** state)
+{
+    // libgcrypt is set up once per process
+    if (!gcry_control(GCRYCTL_INITIALIZATION_FINISHED_P)) {
+        assert_int_equal(0, omemo_crypto_init());
+    }
+    return 0;
+}
+
+void
+omemo_file_stream__decrypts__what_it_encrypted(void** state)
+{
+    size_t len;
+    char* ciphertext = _ciphertext(&len);
+    assert_int_equal(PLAINTEXT_SIZE + OMEMO_AESGCM_TAG_LENGTH, len);
+
+    FILE* out = tmpfile();
+    assert_non_null(out);
+    assert_int_equal(GPG_ERR_NO_ERROR, _decrypt(ciphertext, len, out));
+
+    FILE* expected = _plaintext_file();
+    assert_int_equal(PLAINTEXT_SIZE, ftell(out));
+    rewind(out);
+    for (int i = 0; i < PLAINTEXT_SIZE; i++) {
+        assert_int_equal(fgetc(expected), fgetc(out));
+    }
+
+    fclose(expected);
+    fclose(out);
+    free(ciphertext);
+}
+
+void
+omemo_file_stream__fails__on_modified_tag(void** state)
+{
+    size_t len;
+    char* ciphertext = _ciphertext(&len);
+    ciphertext[len - 1] ^= 0x01;
+
+    FILE* out = tmpfile();
+    assert_non_null(out);
+    assert_int_equal(GPG_ERR_CHECKSUM, gcry_err_code(_decrypt(ciphertext, len, out)));
+
+    fclose(out);
+    free(ciphertext);
+}
+
+void
+omemo_file_stream__fails__on_modified_ciphertext(void** state)
+{
+    size_t len;
+    char* ciphertext = _ciphertext(&len);
+    ciphertext[len / 2] ^= 0x80;
+
+    FILE* out = tmpfile();
+    assert_non_null(out);
+    assert_int_equal(GPG_ERR_CHECKSUM, gcry_err_code(_decrypt(ciphertext, len, out)));
+
+    fclose(out);
+    free(ciphertext);
+}
+
+void
+omemo_file_stream__fails__without_tag(void** state)
+{
+    gcry_error_t res;
+    OmemoFileStream* stream = omemo_file_stream_new(key, nonce, 0, FALSE, &res);
+    FILE* out = tmpfile();
+    assert_non_null(out);
+
+    assert_int_equal(GPG_ERR_NO_ERROR, omemo_file_stream_write(stream, out, "short", 5));
+    assert_int_equal(GPG_ERR_INV_LENGTH, gcry_err_code(omemo_file_stream_finish(stream, out)));
+
+    fclose(out);
+    omemo_file_stream_free(stream);
+}
+
+void
+omemo_file_stream_read__fails__when_file_is_shorter(void** state)
+{
+    FILE* in = _plaintext_file();
+    gcry_error_t res;
+    OmemoFileStream* stream = omemo_file_stream_new(key, nonce, PLAINTEXT_SIZE + 1, TRUE, &res);
+
+    char* buffer = malloc(PLAINTEXT_SIZE + 1);
+    size_t bytes;
+    res = omemo_file_stream_read(stream, in, buffer, PLAINTEXT_SIZE + 1, &bytes);
+    assert_int_not_equal(GPG_ERR_NO_ERROR, res);
+
+    free(buffer);
+    omemo_file_stream_free(stream);
+    fclose(in);
+}
+
+void
+omemo_file_stream_rewind__repeats__ciphertext(void** state)
+{
+    size_t len;
+    char* expected = _ciphertext(&len);
+
+    FILE* in = _plaintext_file();
+    gcry_error_t res;
+    OmemoFileStream* stream = omemo_file_stream_new(key, nonce, PLAINTEXT_SIZE, TRUE, &res);
+    char* ciphertext = malloc(len + 1);
+
+    // part of it was sent before, then all of it
+    size_t bytes;
+    assert_int_equal(GPG_ERR_NO_ERROR, omemo_file_stream_read(stream, in, ciphertext, len / 2, &bytes));
+    assert_int_equal(GPG_ERR_NO_ERROR, omemo_file_stream_rewind(stream, in));
+    assert_int_equal(len, _encrypt(stream, in, ciphertext, len + 1));
+    assert_memory_equal(expected, ciphertext, len);
+
+    // and again after the tag
+    assert_int_equal(GPG_ERR_NO_ERROR, omemo_file_stream_rewind(stream, in));
+    assert_int_equal(len, _encrypt(stream, in, ciphertext, len + 1));
+    assert_memory_equal(expected, ciphertext, len);
+
+    free(ciphertext);
+    free(expected);
+    omemo_file_stream_free(stream);
+    fclose(in);
+}
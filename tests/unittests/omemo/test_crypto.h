@@ -0,0 +1,12 @@
+#ifndef TESTS_TEST_CRYPTO_H
+#define TESTS_TEST_CRYPTO_H
+
+int crypto_before_test(void** state);
+void omemo_file_stream__decrypts__what_it_encrypted(void** state);
+void omemo_file_stream__fails__on_modified_tag(void** state);
+void omemo_file_stream__fails__on_modified_ciphertext(void** state);
+void omemo_file_stream__fails__without_tag(void** state);
+void omemo_file_stream_read__fails__when_file_is_shorter(void** state);
+void omemo_file_stream_rewind__repeats__ciphertext(void** state);
+
+#endif
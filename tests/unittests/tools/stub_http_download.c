@@ -2,7 +2,6 @@
 #define TOOLS_HTTP_DOWNLOAD_H
 
 #include <curl/curl.h>
-#include <pthread.h>
 #include "common.h"
 
 typedef struct prof_win_t ProfWin;
@@ -16,18 +15,15 @@ typedef struct http_download_t
     FILE* filehandle;
     curl_off_t bytes_received;
     ProfWin* window;
-    pthread_t worker;
-    int cancel;
+    gboolean cancel;
     gboolean silent;
 } HTTPDownload;
 
-void*
-http_file_get(void* userdata)
+void
+http_download_start(HTTPDownload* download)
 {
-    return NULL;
 }
 
 void http_download_cancel_processes() {};
-void http_download_add_download() {};
 
 #endif
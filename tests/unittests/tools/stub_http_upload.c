@@ -10,7 +10,7 @@
 #define TOOLS_HTTP_UPLOAD_H
 
 #include <curl/curl.h>
-#include <pthread.h>
+#include <glib.h>
 
 // forward -> ui/win_types.h
 typedef struct prof_win_t ProfWin;
@@ -24,14 +24,12 @@ typedef struct http_upload_t
     char* get_url;
     char* put_url;
     ProfWin* window;
-    pthread_t worker;
-    int cancel;
+    gboolean cancel;
 } HTTPUpload;
 
-void*
-http_file_put(void* userdata)
+void
+http_upload_start(HTTPUpload* upload)
 {
-    return NULL;
 }
 
 char*
@@ -47,6 +45,5 @@ file_size(int filedes)
 }
 
 void http_upload_cancel_processes() {};
-void http_upload_add_upload() {};
 
 #endif
@@ -5,14 +5,8 @@
 typedef struct prof_win_t ProfWin;
 typedef struct http_download_t HTTPDownload;
 
-void*
-plugin_download_install(void* userdata)
-{
-    return NULL;
-}
-
 void
-plugin_download_add_download(HTTPDownload* download)
+plugin_download_start(HTTPDownload* plugin_dl)
 {
 }
 
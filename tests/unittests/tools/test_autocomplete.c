@@ -373,3 +373,46 @@ autocomplete_complete__handles__escaped_quotes(void** state)
     autocomplete_free(ac);
     free(result);
 }
+
+void
+autocomplete_add_all__returns__sorted_items(void** state)
+{
+    Autocomplete ac = autocomplete_new();
+    autocomplete_add(ac, "carol");
+    char* items[] = { "bob", "alice", "carol", "dave", NULL };
+    autocomplete_add_all(ac, items);
+
+    GList* result = autocomplete_create_list(ac);
+
+    assert_int_equal(4, g_list_length(result));
+    assert_string_equal("alice", g_list_nth_data(result, 0));
+    assert_string_equal("bob", g_list_nth_data(result, 1));
+    assert_string_equal("carol", g_list_nth_data(result, 2));
+    assert_string_equal("dave", g_list_nth_data(result, 3));
+    assert_true(autocomplete_contains(ac, "dave"));
+
+    autocomplete_free(ac);
+    g_list_free_full(result, free);
+}
+
+void
+autocomplete_complete__returns__next_after_last_found_removed(void** state)
+{
+    Autocomplete ac = autocomplete_new();
+    autocomplete_add(ac, "Hello");
+    autocomplete_add(ac, "Help");
+    autocomplete_add(ac, "Helsinki");
+    char* result1 = autocomplete_complete(ac, "Hel", TRUE, FALSE);
+    char* result2 = autocomplete_complete(ac, result1, TRUE, FALSE);
+    autocomplete_remove(ac, "Help");
+    char* result3 = autocomplete_complete(ac, "Hel", TRUE, FALSE);
+
+    assert_string_equal("Help", result2);
+    assert_string_equal("Hello", result3);
+    assert_false(autocomplete_contains(ac, "Help"));
+
+    autocomplete_free(ac);
+    free(result1);
+    free(result2);
+    free(result3);
+}
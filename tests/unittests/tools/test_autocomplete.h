@@ -26,5 +26,7 @@ void autocomplete_complete__returns__russian(void** state);
 void autocomplete_complete__returns__chinese(void** state);
 void autocomplete_complete__returns__transliterated(void** state);
 void autocomplete_complete__returns__regular_ascii(void** state);
+void autocomplete_add_all__returns__sorted_items(void** state);
+void autocomplete_complete__returns__next_after_last_found_removed(void** state);
 
 #endif
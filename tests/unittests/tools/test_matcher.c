@@ -0,0 +1,102 @@
+#include "prof_cmocka.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "tools/matcher.h"
+
+static void
+_collect(int id, glong offset, const char* start, gsize len, void* userdata)
+{
+    GSList** matches = userdata;
+    *matches = g_slist_append(*matches, g_strdup_printf("%d:%ld:%.*s", id, offset, (int)len, start));
+}
+
+static GSList*
+_scan(Matcher matcher, const char* const text)
+{
+    GSList* matches = NULL;
+    matcher_scan(matcher, text, _collect, &matches);
+    return matches;
+}
+
+void
+matcher_scan__returns__all_patterns_in_one_pass(void** state)
+{
+    Matcher matcher = matcher_new();
+    matcher_add(matcher, "he", 1, 0);
+    matcher_add(matcher, "she", 2, 0);
+    matcher_add(matcher, "hers", 3, 0);
+
+    GSList* matches = _scan(matcher, "ushers");
+
+    assert_int_equal(3, g_slist_length(matches));
+    assert_string_equal("2:1:she", g_slist_nth_data(matches, 0));
+    assert_string_equal("1:2:he", g_slist_nth_data(matches, 1));
+    assert_string_equal("3:2:hers", g_slist_nth_data(matches, 2));
+
+    g_slist_free_full(matches, g_free);
+    matcher_free(matcher);
+}
+
+void
+matcher_scan__returns__case_folded_unless_exact(void** state)
+{
+    Matcher matcher = matcher_new();
+    matcher_add(matcher, "Bob", 1, 0);
+    matcher_add(matcher, "Éva", 2, MATCHER_EXACT_CASE);
+
+    GSList* matches = _scan(matcher, "BOB, éva and Éva");
+
+    assert_int_equal(2, g_slist_length(matches));
+    assert_string_equal("1:0:BOB", g_slist_nth_data(matches, 0));
+    assert_string_equal("2:13:Éva", g_slist_nth_data(matches, 1));
+
+    g_slist_free_full(matches, g_free);
+    matcher_free(matcher);
+}
+
+void
+matcher_scan__returns__whole_words_only(void** state)
+{
+    Matcher matcher = matcher_new();
+    matcher_add(matcher, "bob", 1, MATCHER_WHOLE_WORD);
+
+    GSList* matches = _scan(matcher, "bobby, (bob) kebob bob");
+
+    assert_int_equal(2, g_slist_length(matches));
+    assert_string_equal("1:8:bob", g_slist_nth_data(matches, 0));
+    assert_string_equal("1:19:bob", g_slist_nth_data(matches, 1));
+
+    g_slist_free_full(matches, g_free);
+    matcher_free(matcher);
+}
+
+void
+matcher_scan__returns__urls(void** state)
+{
+    Matcher matcher = matcher_new();
+    matcher_add(matcher, "http://", 1, MATCHER_URL | MATCHER_EXACT_CASE);
+    matcher_add(matcher, "https://", 2, MATCHER_URL | MATCHER_EXACT_CASE);
+
+    GSList* matches = _scan(matcher, "see https://example.org/a?b=http://c, http:// and http://x.y");
+
+    assert_int_equal(2, g_slist_length(matches));
+    assert_string_equal("2:4:https://example.org/a?b=http://c,", g_slist_nth_data(matches, 0));
+    assert_string_equal("1:50:http://x.y", g_slist_nth_data(matches, 1));
+
+    g_slist_free_full(matches, g_free);
+    matcher_free(matcher);
+}
+
+void
+matcher_scan__returns__nothing_for_empty_pattern(void** state)
+{
+    Matcher matcher = matcher_new();
+    matcher_add(matcher, "", 1, 0);
+
+    GSList* matches = _scan(matcher, "anything");
+
+    assert_null(matches);
+
+    matcher_free(matcher);
+}
@@ -0,0 +1,10 @@
+#ifndef TESTS_TEST_MATCHER_H
+#define TESTS_TEST_MATCHER_H
+
+void matcher_scan__returns__all_patterns_in_one_pass(void** state);
+void matcher_scan__returns__case_folded_unless_exact(void** state);
+void matcher_scan__returns__whole_words_only(void** state);
+void matcher_scan__returns__urls(void** state);
+void matcher_scan__returns__nothing_for_empty_pattern(void** state);
+
+#endif
@@ -0,0 +1,157 @@
+#include "prof_cmocka.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "common.h"
+#include "tools/spellcheck.h"
+
+#ifdef HAVE_SPELLCHECK
+
+static int ready_calls;
+static int ready_pending;
+static GPtrArray* ready_words;
+
+// the tests don't depend on what a dictionary knows, any will do
+static gboolean
+_load_any_dict(void)
+{
+    spellcheck_init();
+    GList* langs = spellcheck_get_available_langs();
+    gboolean loaded = langs && spellcheck_set_lang(langs->data);
+    g_list_free_full(langs, g_free);
+    return loaded;
+}
+
+static spellcheck_result_t
+_check(const char* const word, gboolean defer)
+{
+    return spellcheck_check_word(word, strlen(word), defer);
+}
+
+// what the input window does, draw all words again
+static void
+_ready(void)
+{
+    ready_calls++;
+    for (guint i = 0; ready_words && i < ready_words->len; i++) {
+        if (_check(g_ptr_array_index(ready_words, i), TRUE) == SPELLCHECK_PENDING) {
+            ready_pending++;
+        }
+    }
+}
+
+static void
+_reset(void)
+{
+    ready_calls = 0;
+    ready_pending = 0;
+    ready_words = NULL;
+    spellcheck_set_ready_cb(_ready);
+}
+
+static void
+_process_all(void)
+{
+    for (int i = 0; i < 10000 && spellcheck_has_pending(); i++) {
+        spellcheck_process();
+    }
+}
+
+void
+spellcheck_check_word__returns__pending_until_processed(void** state)
+{
+    if (!_load_any_dict()) {
+        spellcheck_deinit();
+        skip();
+    }
+    _reset();
+
+    assert_int_equal(SPELLCHECK_PENDING, _check("profanity", TRUE));
+    assert_true(spellcheck_has_pending());
+    assert_int_equal(0, ready_calls);
+
+    spellcheck_process();
+
+    assert_false(spellcheck_has_pending());
+    assert_int_equal(1, ready_calls);
+    assert_int_not_equal(SPELLCHECK_PENDING, _check("profanity", TRUE));
+
+    spellcheck_deinit();
+}
+
+void
+spellcheck_check_word__returns__cached_result_without_deferring(void** state)
+{
+    if (!_load_any_dict()) {
+        spellcheck_deinit();
+        skip();
+    }
+    _reset();
+
+    spellcheck_result_t result = _check("profanity", FALSE);
+
+    assert_int_equal(result, _check("profanity", TRUE));
+    assert_false(spellcheck_has_pending());
+
+    spellcheck_deinit();
+}
+
+void
+spellcheck_process__checks__one_batch_per_call(void** state)
+{
+    if (!_load_any_dict()) {
+        spellcheck_deinit();
+        skip();
+    }
+    _reset();
+
+    for (int i = 0; i <= SPELLCHECK_BATCH; i++) {
+        auto_gchar gchar* word = g_strdup_printf("word%d", i);
+        assert_int_equal(SPELLCHECK_PENDING, _check(word, TRUE));
+        // queued once only
+        assert_int_equal(SPELLCHECK_PENDING, _check(word, TRUE));
+    }
+
+    spellcheck_process();
+
+    assert_true(spellcheck_has_pending());
+    assert_int_equal(0, ready_calls);
+    assert_int_equal(SPELLCHECK_PENDING, _check("word" G_STRINGIFY(SPELLCHECK_BATCH), TRUE));
+
+    spellcheck_process();
+
+    assert_false(spellcheck_has_pending());
+    assert_int_equal(1, ready_calls);
+
+    spellcheck_deinit();
+}
+
+void
+spellcheck_process__finishes__more_words_than_the_cache_holds(void** state)
+{
+    if (!_load_any_dict()) {
+        spellcheck_deinit();
+        skip();
+    }
+    _reset();
+
+    GPtrArray* words = g_ptr_array_new_with_free_func(g_free);
+    for (int i = 0; i < SPELLCHECK_CACHE_SIZE + SPELLCHECK_BATCH; i++) {
+        g_ptr_array_add(words, g_strdup_printf("word%d", i));
+        _check(g_ptr_array_index(words, i), TRUE);
+    }
+    ready_words = words;
+
+    _process_all();
+
+    // the redraw found every word, even those the cache dropped meanwhile
+    assert_false(spellcheck_has_pending());
+    assert_int_equal(1, ready_calls);
+    assert_int_equal(0, ready_pending);
+
+    g_ptr_array_free(words, TRUE);
+    spellcheck_deinit();
+}
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef TESTS_TEST_SPELLCHECK_H
+#define TESTS_TEST_SPELLCHECK_H
+
+void spellcheck_check_word__returns__pending_until_processed(void** state);
+void spellcheck_check_word__returns__cached_result_without_deferring(void** state);
+void spellcheck_process__checks__one_batch_per_call(void** state);
+void spellcheck_process__finishes__more_words_than_the_cache_holds(void** state);
+
+#endif
@@ -78,6 +78,15 @@ ui_update(void)
 {
 }
 void
+ui_frame(void)
+{
+}
+gint
+ui_frame_delay(void)
+{
+    return G_MAXINT;
+}
+void
 ui_redraw(void)
 {
 }
@@ -86,6 +95,11 @@ ui_resize(void)
 {
 }
 
+void
+ui_update_scrollback(void)
+{
+}
+
 void
 ui_focus_win(ProfWin* win)
 {
@@ -926,6 +940,11 @@ cons_show_bookmarks(const GList* list)
     check_expected(list);
 }
 
+void
+cons_show_history_search(const char* const query, GSList* results, int offset, gboolean more)
+{
+}
+
 void
 cons_show_bookmark(Bookmark* item)
 {
@@ -936,6 +955,11 @@ cons_show_disco_items(GSList* items, const char* const jid)
 {
 }
 
+void
+cons_show_transfers(GList* transfers)
+{
+}
+
 void
 cons_show_disco_info(const char* from, GSList* identities, GSList* features)
 {
@@ -1132,6 +1156,14 @@ cons_inpblock_setting(void)
 {
 }
 void
+cons_scrollback_setting(void)
+{
+}
+void
+cons_framerate_setting(void)
+{
+}
+void
 cons_winpos_setting(void)
 {
 }
@@ -1175,6 +1207,11 @@ cons_strophe_setting(void)
 {
 }
 
+void
+cons_transfers_setting(void)
+{
+}
+
 void
 cons_privacy_setting(void)
 {
@@ -1235,6 +1272,10 @@ void
 rosterwin_roster(void)
 {
 }
+void
+rosterwin_update(void)
+{
+}
 
 // occupants window
 void
@@ -1242,6 +1283,10 @@ occupantswin_occupants(const char* const room)
 {
 }
 void
+occupantswin_update(void)
+{
+}
+void
 occupantswin_occupants_all(void)
 {
 }
@@ -1318,6 +1363,10 @@ win_resize(ProfWin* window)
 {
 }
 void
+win_update_scrollback(ProfWin* window)
+{
+}
+void
 win_hide_subwin(ProfWin* window)
 {
 }
@@ -1479,15 +1528,3 @@ void
 ui_flash(void)
 {
 }
-
-unsigned int
-buffer_size(ProfBuff buffer)
-{
-    return 0;
-}
-
-ProfBuffEntry*
-buffer_get_entry(ProfBuff buffer, unsigned int index)
-{
-    return NULL;
-}
@@ -0,0 +1,124 @@
+#include "prof_cmocka.h"
+#include <stdlib.h>
+
+#include "ui/ui.h"
+#include "ui/buffer.h"
+
+static void
+_append(ProfBuff buffer, int flags, int y_start_pos, int y_end_pos)
+{
+    GDateTime* now = g_date_time_new_now_local();
+    buffer_append(buffer, "-", 0, now, flags, THEME_TEXT, NULL, NULL, "message", NULL, NULL, y_start_pos, y_end_pos);
+    g_date_time_unref(now);
+}
+
+static void
+_prepend(ProfBuff buffer)
+{
+    GDateTime* now = g_date_time_new_now_local();
+    buffer_prepend(buffer, "-", 0, now, 0, THEME_TEXT, NULL, NULL, "history", NULL, NULL, -1, -1);
+    g_date_time_unref(now);
+}
+
+// rows 0-1, 2 up to the middle of the row, 2-3 continuing it, 4-5
+static ProfBuff
+_create_lines(void)
+{
+    ProfBuff buffer = buffer_create();
+    _append(buffer, 0, 0, 2);
+    _append(buffer, NO_EOL, 2, 2);
+    _append(buffer, 0, 2, 4);
+    _append(buffer, 0, 4, 6);
+
+    return buffer;
+}
+
+void
+buffer_first_positioned__returns__start_of_rendered_slice(void** state)
+{
+    ProfBuff buffer = buffer_create();
+    _append(buffer, 0, 0, 1);
+    _append(buffer, 0, 1, 3);
+    _append(buffer, 0, 3, 4);
+    // cut off the bottom of the pad
+    _append(buffer, 0, -1, -1);
+    _append(buffer, 0, -1, -1);
+    // older history is not laid out yet
+    _prepend(buffer);
+    _prepend(buffer);
+
+    assert_int_equal(7, buffer_size(buffer));
+    assert_int_equal(2, buffer_first_positioned(buffer, 5));
+    assert_int_equal(2, buffer_first_positioned(buffer, 3));
+    assert_int_equal(7, buffer_first_positioned(buffer, 7));
+
+    buffer_free(buffer);
+}
+
+void
+buffer_first_positioned__returns__end_when_nothing_is_rendered(void** state)
+{
+    ProfBuff buffer = buffer_create();
+
+    assert_int_equal(0, buffer_first_positioned(buffer, 0));
+
+    _prepend(buffer);
+    _prepend(buffer);
+
+    assert_int_equal(2, buffer_first_positioned(buffer, 2));
+
+    buffer_free(buffer);
+}
+
+void
+buffer_line_at_row__returns__entry_starting_the_line(void** state)
+{
+    ProfBuff buffer = _create_lines();
+
+    assert_int_equal(0, buffer_line_at_row(buffer, 0, 4, 0));
+    assert_int_equal(0, buffer_line_at_row(buffer, 0, 4, 1));
+    assert_int_equal(1, buffer_line_at_row(buffer, 0, 4, 2));
+    assert_int_equal(1, buffer_line_at_row(buffer, 0, 4, 3));
+    assert_int_equal(3, buffer_line_at_row(buffer, 0, 4, 5));
+    assert_int_equal(3, buffer_line_at_row(buffer, 0, 4, 100));
+
+    buffer_free(buffer);
+}
+
+void
+buffer_line_at_row__returns__first_above_the_entries(void** state)
+{
+    ProfBuff buffer = _create_lines();
+
+    assert_int_equal(0, buffer_line_at_row(buffer, 0, 4, -10));
+    assert_int_equal(1, buffer_line_at_row(buffer, 1, 4, 0));
+
+    buffer_free(buffer);
+}
+
+void
+buffer_line_from_row__returns__first_line_on_or_below_row(void** state)
+{
+    ProfBuff buffer = _create_lines();
+
+    assert_int_equal(1, buffer_line_from_row(buffer, 0, 4, 1));
+    assert_int_equal(1, buffer_line_from_row(buffer, 0, 4, 2));
+    assert_int_equal(3, buffer_line_from_row(buffer, 0, 4, 3));
+    assert_int_equal(3, buffer_line_from_row(buffer, 0, 4, 4));
+
+    buffer_free(buffer);
+}
+
+void
+buffer_line_from_row__returns__end_below_the_entries(void** state)
+{
+    ProfBuff buffer = _create_lines();
+
+    assert_int_equal(4, buffer_line_from_row(buffer, 0, 4, 5));
+    assert_int_equal(4, buffer_line_from_row(buffer, 0, 4, 100));
+    // the first entry stays even when the row is above it
+    assert_int_equal(1, buffer_line_from_row(buffer, 0, 4, -10));
+    assert_int_equal(3, buffer_line_from_row(buffer, 0, 3, 4));
+
+    buffer_free(buffer);
+}
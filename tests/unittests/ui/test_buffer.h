@@ -0,0 +1,11 @@
+#ifndef TESTS_TEST_BUFFER_H
+#define TESTS_TEST_BUFFER_H
+
+void buffer_first_positioned__returns__start_of_rendered_slice(void** state);
+void buffer_first_positioned__returns__end_when_nothing_is_rendered(void** state);
+void buffer_line_at_row__returns__entry_starting_the_line(void** state);
+void buffer_line_at_row__returns__first_above_the_entries(void** state);
+void buffer_line_from_row__returns__first_line_on_or_below_row(void** state);
+void buffer_line_from_row__returns__end_below_the_entries(void** state);
+
+#endif
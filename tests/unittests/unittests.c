@@ -32,6 +32,9 @@
 #include "command/test_cmd_pgp.h"
 #include "xmpp/test_jid.h"
 #include "tools/test_parser.h"
+#include "tools/test_matcher.h"
+#include "tools/test_spellcheck.h"
+#include "ui/test_buffer.h"
 #include "xmpp/test_roster_list.h"
 #include "config/test_preferences.h"
 #include "event/test_server_events.h"
@@ -39,6 +42,11 @@
 #include "command/test_cmd_bookmark.h"
 #include "command/test_cmd_join.h"
 #include "xmpp/test_muc.h"
+#include "xmpp/test_capabilities.h"
+#include "database/test_database.h"
+#ifdef HAVE_OMEMO
+#include "omemo/test_crypto.h"
+#endif
 #include "command/test_cmd_ac.h"
 #include "command/test_cmd_roster.h"
 #include "command/test_cmd_disconnect.h"
@@ -143,6 +151,8 @@ main(int argc, char* argv[])
         cmocka_unit_test(autocomplete_complete__returns__chinese),
         cmocka_unit_test(autocomplete_complete__returns__transliterated),
         cmocka_unit_test(autocomplete_complete__returns__regular_ascii),
+        cmocka_unit_test(autocomplete_add_all__returns__sorted_items),
+        cmocka_unit_test(autocomplete_complete__returns__next_after_last_found_removed),
 
         cmocka_unit_test(jid_create__returns__null_from_null),
         cmocka_unit_test(jid_create__returns__null_from_empty_string),
@@ -182,6 +192,26 @@ main(int argc, char* argv[])
         cmocka_unit_test(jid_is_valid__is__false_for_null),
         cmocka_unit_test(jid_is_valid__is__false_for_empty_string),
 
+        cmocka_unit_test(matcher_scan__returns__all_patterns_in_one_pass),
+        cmocka_unit_test(matcher_scan__returns__case_folded_unless_exact),
+        cmocka_unit_test(matcher_scan__returns__whole_words_only),
+        cmocka_unit_test(matcher_scan__returns__urls),
+        cmocka_unit_test(matcher_scan__returns__nothing_for_empty_pattern),
+
+#ifdef HAVE_SPELLCHECK
+        cmocka_unit_test_setup_teardown(spellcheck_check_word__returns__pending_until_processed, load_preferences, close_preferences),
+        cmocka_unit_test_setup_teardown(spellcheck_check_word__returns__cached_result_without_deferring, load_preferences, close_preferences),
+        cmocka_unit_test_setup_teardown(spellcheck_process__checks__one_batch_per_call, load_preferences, close_preferences),
+        cmocka_unit_test_setup_teardown(spellcheck_process__finishes__more_words_than_the_cache_holds, load_preferences, close_preferences),
+#endif
+
+        cmocka_unit_test(buffer_first_positioned__returns__start_of_rendered_slice),
+        cmocka_unit_test(buffer_first_positioned__returns__end_when_nothing_is_rendered),
+        cmocka_unit_test(buffer_line_at_row__returns__entry_starting_the_line),
+        cmocka_unit_test(buffer_line_at_row__returns__first_above_the_entries),
+        cmocka_unit_test(buffer_line_from_row__returns__first_line_on_or_below_row),
+        cmocka_unit_test(buffer_line_from_row__returns__end_below_the_entries),
+
         cmocka_unit_test(parse_args__returns__null_from_null),
         cmocka_unit_test(parse_args__returns__null_from_empty),
         cmocka_unit_test(parse_args__returns__null_from_space),
@@ -276,6 +306,8 @@ main(int argc, char* argv[])
         cmocka_unit_test(roster_get_display_name__returns__nickname_when_exists),
         cmocka_unit_test(roster_get_display_name__returns__barejid_when_nickname_empty),
         cmocka_unit_test(roster_get_display_name__returns__barejid_when_not_exists),
+        cmocka_unit_test(roster_get_contacts__returns__presence_order_after_presence_change),
+        cmocka_unit_test(roster_get_contacts__returns__name_order_after_rename),
 
         cmocka_unit_test_setup_teardown(chat_session_get__returns__null_when_no_session,
                                         init_chat_sessions,
@@ -512,6 +544,12 @@ main(int argc, char* argv[])
         cmocka_unit_test_setup_teardown(prefs_get_string__returns__none_for_muc_default,
                                         load_preferences,
                                         close_preferences),
+        cmocka_unit_test_setup_teardown(prefs_peek_string__returns__value_after_set,
+                                        load_preferences,
+                                        close_preferences),
+        cmocka_unit_test_setup_teardown(prefs_set_boolean__notifies__listener,
+                                        load_preferences,
+                                        close_preferences),
 
         cmocka_unit_test_setup_teardown(sv_ev_contact_online__shows__presence_in_console_when_set_online,
                                         load_preferences,
@@ -555,6 +593,30 @@ main(int argc, char* argv[])
         cmocka_unit_test_setup_teardown(muc_invites_count__returns__5_when_five_invites_added, muc_before_test, muc_after_test),
         cmocka_unit_test_setup_teardown(muc_active__is__false_when_not_joined, muc_before_test, muc_after_test),
         cmocka_unit_test_setup_teardown(muc_active__is__true_when_joined, muc_before_test, muc_after_test),
+        cmocka_unit_test_setup_teardown(muc_roster_by_role__returns__moderators_first_after_role_change, muc_before_test, muc_after_test),
+
+        cmocka_unit_test(caps_create__copies__features),
+        cmocka_unit_test(caps_unref__frees__on_last_reference),
+        cmocka_unit_test_setup_teardown(caps_lookup__returns__shared_caps_for_same_ver, caps_before_test, caps_after_test),
+        cmocka_unit_test_setup_teardown(caps_lookup__returns__null_for_unknown_jid, caps_before_test, caps_after_test),
+
+        cmocka_unit_test(log_database_search_available__is__false_without_database),
+        cmocka_unit_test_setup_teardown(log_database_search__returns__null_for_empty_query, database_before_test, database_after_test),
+        cmocka_unit_test_setup_teardown(log_database_search__finds__logged_messages, database_before_test, database_after_test),
+        cmocka_unit_test_setup_teardown(log_database_search__finds__queued_messages, database_before_test, database_after_test),
+        cmocka_unit_test_setup_teardown(log_database_search__filters__by_jid_and_since, database_before_test, database_after_test),
+        cmocka_unit_test_setup_teardown(log_database_search__pages__with_offset_and_limit, database_before_test, database_after_test),
+        cmocka_unit_test_setup_teardown(log_database_search__falls_back__to_like_without_index, database_before_test, database_after_test),
+        cmocka_unit_test_setup_teardown(log_database_search__matches__like_wildcards_literally, database_before_test, database_after_test),
+
+#ifdef HAVE_OMEMO
+        cmocka_unit_test_setup(omemo_file_stream__decrypts__what_it_encrypted, crypto_before_test),
+        cmocka_unit_test_setup(omemo_file_stream__fails__on_modified_tag, crypto_before_test),
+        cmocka_unit_test_setup(omemo_file_stream__fails__on_modified_ciphertext, crypto_before_test),
+        cmocka_unit_test_setup(omemo_file_stream__fails__without_tag, crypto_before_test),
+        cmocka_unit_test_setup(omemo_file_stream_read__fails__when_file_is_shorter, crypto_before_test),
+        cmocka_unit_test_setup(omemo_file_stream_rewind__repeats__ciphertext, crypto_before_test),
+#endif
 
         cmocka_unit_test(cmd_bookmark__shows__message_when_disconnected),
         cmocka_unit_test(cmd_bookmark__shows__message_when_disconnecting),
@@ -1,12 +1,37 @@
 #include "xmpp/message.h"
+#include "xmpp/jid.h"
 
 ProfMessage*
 message_init(void)
 {
-    return NULL;
+    ProfMessage* message = g_new0(ProfMessage, 1);
+
+    message->enc = PROF_MSG_ENC_NONE;
+    message->omemo_err = OMEMO_ERR_NONE;
+    message->trusted = TRUE;
+    message->type = PROF_MSG_TYPE_UNINITIALIZED;
+
+    return message;
 }
 
 void
 message_free(ProfMessage* message)
 {
+    if (!message) {
+        return;
+    }
+
+    jid_destroy(message->from_jid);
+    jid_destroy(message->to_jid);
+    free(message->id);
+    free(message->originid);
+    free(message->stanzaid);
+    free(message->replace_id);
+    free(message->body);
+    free(message->encrypted);
+    free(message->plain);
+    if (message->timestamp) {
+        g_date_time_unref(message->timestamp);
+    }
+    free(message);
 }
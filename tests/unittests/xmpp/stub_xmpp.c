@@ -9,6 +9,7 @@
 #include "prof_cmocka.h"
 
 #include "xmpp/xmpp.h"
+#include "xmpp/stanza.h"
 
 // connection functions
 void
@@ -127,6 +128,12 @@ connection_get_status(void)
     return mock_type(jabber_conn_status_t);
 }
 
+int
+connection_get_fd(void)
+{
+    return -1;
+}
+
 const char*
 connection_get_presence_msg(void)
 {
@@ -470,37 +477,17 @@ publish_user_mood(const char* const mood, const char* const text)
 {
 }
 
-// caps functions
-void
-caps_add_feature(char* feature)
-{
-}
-
-void
-caps_remove_feature(char* feature)
-{
-}
-
-EntityCapabilities*
-caps_lookup(const char* const jid)
+// stanza functions
+xmpp_stanza_t*
+stanza_create_caps_query_element(xmpp_ctx_t* ctx)
 {
     return NULL;
 }
 
-void
-caps_destroy(EntityCapabilities* caps)
-{
-}
-
-void
-caps_reset_ver(void)
+gchar*
+stanza_create_caps_sha1_from_query(xmpp_stanza_t* const query)
 {
-}
-
-gboolean
-caps_jid_has_feature(const char* const jid, const char* const feature)
-{
-    return FALSE;
+    return NULL;
 }
 
 gboolean
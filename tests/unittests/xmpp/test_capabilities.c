@@ -0,0 +1,106 @@
+#include "prof_cmocka.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "helpers.h"
+#include "xmpp/xmpp.h"
+#include "xmpp/capabilities.h"
+
+static EntityCapabilities*
+_create_caps(void)
+{
+    // the caller's strings go away, caps keeps its own
+    gchar* ping = g_strdup("urn:xmpp:ping");
+    GSList* features = g_slist_append(NULL, ping);
+    features = g_slist_append(features, "http://jabber.org/protocol/chatstates");
+
+    EntityCapabilities* caps = caps_create("client", "pc", "Profanity", NULL, NULL, NULL, NULL, features);
+
+    g_slist_free(features);
+    g_free(ping);
+
+    return caps;
+}
+
+int
+caps_before_test(void** state)
+{
+    load_preferences(state);
+    create_data_dir(state);
+    caps_init();
+    return 0;
+}
+
+int
+caps_after_test(void** state)
+{
+    close_preferences(state);
+    remove("./tests/files/xdg_data_home/profanity/capscache");
+    remove_data_dir(state);
+    rmdir("./tests/files");
+    return 0;
+}
+
+void
+caps_create__copies__features(void** state)
+{
+    EntityCapabilities* caps = _create_caps();
+
+    assert_int_equal(2, g_slist_length(caps->features));
+    assert_string_equal("urn:xmpp:ping", caps->features->data);
+    assert_true(caps_has_feature(caps, "urn:xmpp:ping"));
+    assert_true(caps_has_feature(caps, "http://jabber.org/protocol/chatstates"));
+    assert_false(caps_has_feature(caps, "urn:xmpp:receipts"));
+    assert_false(caps_has_feature(caps, NULL));
+
+    caps_unref(caps);
+}
+
+void
+caps_unref__frees__on_last_reference(void** state)
+{
+    EntityCapabilities* caps = _create_caps();
+    assert_int_equal(1, caps->refcount);
+
+    assert_ptr_equal(caps, caps_ref(caps));
+    assert_int_equal(2, caps->refcount);
+
+    caps_unref(caps);
+    assert_int_equal(1, caps->refcount);
+    assert_true(caps_has_feature(caps, "urn:xmpp:ping"));
+    assert_string_equal("Profanity", caps->identity->name);
+
+    caps_unref(caps);
+}
+
+void
+caps_lookup__returns__shared_caps_for_same_ver(void** state)
+{
+    EntityCapabilities* caps = _create_caps();
+    caps_add_by_ver("ver1", caps);
+    caps_unref(caps);
+
+    caps_map_jid_to_ver("buddy1@server.org/laptop", "ver1");
+    caps_map_jid_to_ver("buddy2@server.org/phone", "ver1");
+
+    EntityCapabilities* caps1 = caps_lookup("buddy1@server.org/laptop");
+    EntityCapabilities* caps2 = caps_lookup("buddy2@server.org/phone");
+
+    assert_non_null(caps1);
+    assert_ptr_equal(caps1, caps2);
+    // one reference kept by the cache and one for each lookup
+    assert_int_equal(3, caps1->refcount);
+    assert_true(caps_has_feature(caps1, "urn:xmpp:ping"));
+    assert_true(caps_jid_has_feature("buddy2@server.org/phone", "http://jabber.org/protocol/chatstates"));
+    assert_false(caps_jid_has_feature("buddy3@server.org/phone", "urn:xmpp:ping"));
+
+    caps_unref(caps1);
+    caps_unref(caps2);
+}
+
+void
+caps_lookup__returns__null_for_unknown_jid(void** state)
+{
+    assert_null(caps_lookup("buddy1@server.org/laptop"));
+}
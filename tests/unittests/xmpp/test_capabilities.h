@@ -0,0 +1,11 @@
+#ifndef TESTS_TEST_CAPABILITIES_H
+#define TESTS_TEST_CAPABILITIES_H
+
+int caps_before_test(void** state);
+int caps_after_test(void** state);
+void caps_create__copies__features(void** state);
+void caps_unref__frees__on_last_reference(void** state);
+void caps_lookup__returns__shared_caps_for_same_ver(void** state);
+void caps_lookup__returns__null_for_unknown_jid(void** state);
+
+#endif
@@ -85,3 +85,23 @@ muc_active__is__true_when_joined(void** state)
 
     assert_true(room_is_active);
 }
+
+void
+muc_roster_by_role__returns__moderators_first_after_role_change(void** state)
+{
+    char* room = "room@server.org";
+    muc_join(room, "bob", NULL, FALSE);
+    muc_roster_add(room, "carol", NULL, "participant", "none", NULL, NULL);
+    muc_roster_add(room, "alice", NULL, "participant", "none", NULL, NULL);
+    muc_roster_add(room, "dave", NULL, "moderator", "none", NULL, NULL);
+    muc_roster_add(room, "carol", NULL, "moderator", "none", NULL, NULL);
+
+    GList* occupants = muc_roster_by_role(room);
+
+    assert_int_equal(3, g_list_length(occupants));
+    assert_string_equal("carol", ((Occupant*)g_list_nth_data(occupants, 0))->nick);
+    assert_string_equal("dave", ((Occupant*)g_list_nth_data(occupants, 1))->nick);
+    assert_string_equal("alice", ((Occupant*)g_list_nth_data(occupants, 2))->nick);
+
+    g_list_free(occupants);
+}
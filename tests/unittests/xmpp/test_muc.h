@@ -10,5 +10,6 @@ void muc_invites_count__returns__0_when_no_invites(void** state);
 void muc_invites_count__returns__5_when_five_invites_added(void** state);
 void muc_active__is__false_when_not_joined(void** state);
 void muc_active__is__true_when_joined(void** state);
+void muc_roster_by_role__returns__moderators_first_after_role_change(void** state);
 
 #endif
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 
 #include "xmpp/contact.h"
+#include "xmpp/resource.h"
 #include "xmpp/roster_list.h"
 
 void
@@ -740,3 +741,56 @@ roster_get_display_name__returns__barejid_when_not_exists(void** state)
 
     roster_destroy();
 }
+
+void
+roster_get_contacts__returns__presence_order_after_presence_change(void** state)
+{
+    roster_create();
+    roster_process_pending_presence();
+    roster_add("bob@server.org", NULL, NULL, NULL, FALSE);
+    roster_add("dave@server.org", NULL, NULL, NULL, FALSE);
+    roster_add("james@server.org", NULL, NULL, NULL, FALSE);
+
+    roster_update_presence("james@server.org", resource_new("laptop", RESOURCE_ONLINE, NULL, 10), NULL);
+    GSList* list = roster_get_contacts(ROSTER_ORD_PRESENCE);
+    assert_string_equal("james@server.org", p_contact_barejid(list->data));
+    g_slist_free(list);
+
+    roster_update_presence("dave@server.org", resource_new("phone", RESOURCE_CHAT, NULL, 10), NULL);
+    list = roster_get_contacts(ROSTER_ORD_PRESENCE);
+    assert_string_equal("dave@server.org", p_contact_barejid(list->data));
+    assert_string_equal("james@server.org", p_contact_barejid(g_slist_next(list)->data));
+    assert_string_equal("bob@server.org", p_contact_barejid(g_slist_nth_data(list, 2)));
+    g_slist_free(list);
+
+    roster_contact_offline("dave@server.org", "phone", NULL);
+    list = roster_get_contacts(ROSTER_ORD_PRESENCE);
+    assert_string_equal("james@server.org", p_contact_barejid(list->data));
+    assert_string_equal("bob@server.org", p_contact_barejid(g_slist_next(list)->data));
+    assert_string_equal("dave@server.org", p_contact_barejid(g_slist_nth_data(list, 2)));
+    g_slist_free(list);
+
+    roster_destroy();
+}
+
+void
+roster_get_contacts__returns__name_order_after_rename(void** state)
+{
+    roster_create();
+    roster_add("bob@server.org", NULL, NULL, NULL, FALSE);
+    roster_add("dave@server.org", NULL, NULL, NULL, FALSE);
+
+    roster_change_name(roster_get_contact("dave@server.org"), "Alice");
+    GSList* list = roster_get_contacts(ROSTER_ORD_NAME);
+    assert_string_equal("dave@server.org", p_contact_barejid(list->data));
+    assert_string_equal("bob@server.org", p_contact_barejid(g_slist_next(list)->data));
+    g_slist_free(list);
+
+    roster_remove("Alice", "dave@server.org");
+    list = roster_get_contacts(ROSTER_ORD_NAME);
+    assert_int_equal(1, g_slist_length(list));
+    assert_string_equal("bob@server.org", p_contact_barejid(list->data));
+    g_slist_free(list);
+
+    roster_destroy();
+}
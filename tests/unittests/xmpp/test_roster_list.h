@@ -37,5 +37,7 @@ void roster_remove__updates__remaining_in_group(void** state);
 void roster_get_display_name__returns__nickname_when_exists(void** state);
 void roster_get_display_name__returns__barejid_when_nickname_empty(void** state);
 void roster_get_display_name__returns__barejid_when_not_exists(void** state);
+void roster_get_contacts__returns__presence_order_after_presence_change(void** state);
+void roster_get_contacts__returns__name_order_after_rename(void** state);
 
 #endif